@@ -55,8 +55,10 @@
     #include "../HAL/hal_bit_bang_i2c.h"
 #elif defined MSP_EXP430F5529LP
     #include "../HAL/hal_msp-exp430f5529lp.h"
+#elif defined LINUX_HOST
+    #include "../HAL/hal_host.h"          //Linux host with a simulated Module, see hal_host.c
 #else
-    #error "You must define a board configuration: MDB1, MDB2, LAUNCHPAD, MSP-EXP430F5529LP, or GW0. In IAR this is done in Project Options : C/C++ Compiler : Preprocessor : Defined Symbols. In CCS this is done in Project Properties : Build : MSP430 Compiler : Advanced Options : Predefined Symbols."
+    #error "You must define a board configuration: MDB1, MDB2, LAUNCHPAD, MSP-EXP430F5529LP, LINUX_HOST, or GW0. In IAR this is done in Project Options : C/C++ Compiler : Preprocessor : Defined Symbols. In CCS this is done in Project Properties : Build : MSP430 Compiler : Advanced Options : Predefined Symbols."
 #endif
 
 /* @} */
@@ -89,6 +89,25 @@ void (*sysTickIsr)(void);
 Parameter is which button was pressed. */
 void (*buttonIsr)(int8_t);
 
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+#include "driverlib/udma.h"
+
+/** Function pointer for the ISR called when a SRDY interrupt occurs */
+void (*srdyIsr)(void);
+
+/** Function pointer for the ISR called when a transfer started with halSpiStartTransfer() has finished */
+void (*spiTransferCompleteIsr)(void);
+
+/** uDMA channel control table. Must be aligned on a 1024 byte boundary. */
+#pragma DATA_ALIGN(uDmaControlTable, 1024)
+uint8_t uDmaControlTable[1024];
+
+/** Whether a transfer started with halSpiStartTransfer() is in progress */
+static volatile uint8_t spiTransferInProgress = 0;
+
+static void halSpiInitAsync();
+#endif
+
 /** Initializes Oscillator: configures MCLK to 25MHz using internal PLL (SYSCTL_USE_PLL) calibrated
  * to 8MHz external crystal (SYSCTL_XTAL_8MHZ).
  * @note PLL native frequency = 200MHz, so divide by 8 (SYSCTL_SYSDIV_8) to get 25MHz
@@ -581,6 +600,9 @@ void halSpiInitModule()
 
     // Don't select the module
     SPI_SS_CLEAR();
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+    halSpiInitAsync();
+#endif
 }
 
 /**
@@ -614,6 +636,136 @@ void spiWrite(unsigned char *bytes, unsigned char numBytes)
 	//while ( (HWREG(SSI0_BASE + SSI_O_SR)) & SSI_SR_BSY) ;   //wait while busy - works without this
 }
 
+/**
+Sends bytes to the Module over SPI. Same as spiWrite() but the bytes received are discarded, so the 
+buffer is not overwritten. Used to send a SREQ, since nothing is received while it is being sent.
+@param bytes the data to be sent.
+@param numBytes the number of bytes to be sent.
+@pre SPI port configured for the Module and Module has been initialized properly
+@see zm_phy_spi.c
+@note this function is not required if using the UART to communicate with the module
+*/
+void spiTransmit(const uint8_t *bytes, uint8_t numBytes)
+{
+    uint32_t ulReadData;
+    while(numBytes--)    // Loop while there are more bytes left to be transferred.
+    {
+        SSIDataPut(SSI2_BASE, *bytes++);            // Write the next byte to the SSI controller with a blocking put.
+        SSIDataGet(SSI2_BASE, &ulReadData);         // Discard the byte received, to keep the receive FIFO empty
+    }
+}
+
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+/**
+Configures the uDMA controller for SSI2 and the SRDY (PA7) interrupt. Called by halSpiInitModule().
+@note IntSSI2 and IntGPIOa must be configured in startup_ccs.c or else will not be called.
+*/
+static void halSpiInitAsync()
+{
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+    PERIPHERAL_ENABLE_DELAY();
+    uDMAEnable();
+    uDMAControlBaseSet(uDmaControlTable);
+    uDMAChannelAssign(UDMA_CH12_SSI2RX);
+    uDMAChannelAssign(UDMA_CH13_SSI2TX);
+    uDMAChannelAttributeDisable(UDMA_CH12_SSI2RX, UDMA_ATTR_ALL);
+    uDMAChannelAttributeDisable(UDMA_CH13_SSI2TX, UDMA_ATTR_ALL);
+    uDMAChannelControlSet(UDMA_CH12_SSI2RX | UDMA_PRI_SELECT, UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_8 | UDMA_ARB_4);
+    uDMAChannelControlSet(UDMA_CH13_SSI2TX | UDMA_PRI_SELECT, UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+    SSIDMAEnable(SSI2_BASE, SSI_DMA_RX | SSI_DMA_TX);
+    IntEnable(INT_SSI2);                                    // uDMA completion is signalled on the SSI interrupt
+
+    GPIOIntTypeSet(GPIO_PORTA_BASE, GPIO_PIN_7, GPIO_FALLING_EDGE);
+    IntEnable(INT_GPIOA);
+}
+
+/**
+Non-blocking version of spiWrite(). Starts the transfer and returns immediately; the bytes are moved
+by the uDMA controller. Since each byte is received after it was sent the same buffer may be used for
+both directions.
+@param bytes the data to be sent or received. Must remain valid until the transfer has finished.
+@param numBytes the number of bytes to be sent. This same buffer will be overwritten with the received data.
+@pre halSpiInitModule() has been called
+@post when spiTransferCompleteIsr() is called, bytes contains received data, if any
+@see zm_phy_spi.c
+*/
+void halSpiStartTransfer(uint8_t *bytes, uint8_t numBytes)
+{
+    if (numBytes == 0)
+    {
+        spiTransferCompleteIsr();
+        return;
+    }
+    spiTransferInProgress = 1;
+    uDMAChannelTransferSet(UDMA_CH12_SSI2RX | UDMA_PRI_SELECT, UDMA_MODE_BASIC, 
+                           (void *)(SSI2_BASE + SSI_O_DR), bytes, numBytes);
+    uDMAChannelTransferSet(UDMA_CH13_SSI2TX | UDMA_PRI_SELECT, UDMA_MODE_BASIC, 
+                           bytes, (void *)(SSI2_BASE + SSI_O_DR), numBytes);
+    uDMAChannelEnable(UDMA_CH12_SSI2RX);
+    uDMAChannelEnable(UDMA_CH13_SSI2TX);                    // Starts the transfer
+}
+
+/** Stops a transfer started with halSpiStartTransfer(). spiTransferCompleteIsr() will not be called. */
+void halSpiAbortTransfer()
+{
+    spiTransferInProgress = 0;
+    uDMAChannelDisable(UDMA_CH13_SSI2TX);
+    uDMAChannelDisable(UDMA_CH12_SSI2RX);
+}
+
+/**
+Arms the SRDY interrupt; srdyIsr() will be called on the selected edge.
+@param edge SRDY_EDGE_FALLING or SRDY_EDGE_RISING
+*/
+void halSrdyInterruptEnable(uint8_t edge)
+{
+    GPIOIntTypeSet(GPIO_PORTA_BASE, GPIO_PIN_7, (edge == SRDY_EDGE_FALLING) ? GPIO_FALLING_EDGE : GPIO_RISING_EDGE);
+#ifdef TIVA
+    GPIOIntClear(GPIO_PORTA_BASE, GPIO_PIN_7);
+    GPIOIntEnable(GPIO_PORTA_BASE, GPIO_PIN_7);
+#else
+    GPIOPinIntClear(GPIO_PORTA_BASE, GPIO_PIN_7);
+    GPIOPinIntEnable(GPIO_PORTA_BASE, GPIO_PIN_7);
+#endif
+}
+
+/** Disarms the SRDY interrupt */
+void halSrdyInterruptDisable()
+{
+#ifdef TIVA
+    GPIOIntDisable(GPIO_PORTA_BASE, GPIO_PIN_7);
+#else
+    GPIOPinIntDisable(GPIO_PORTA_BASE, GPIO_PIN_7);
+#endif
+}
+
+/** Port A interrupt service routine, called on the SRDY edge armed with halSrdyInterruptEnable().
+@note Must be configured in startup_ccs.c or else will not be called.
+*/
+void IntGPIOa(void)
+{
+#ifdef TIVA
+    GPIOIntClear(GPIO_PORTA_BASE, GPIO_PIN_7);
+#else
+    GPIOPinIntClear(GPIO_PORTA_BASE, GPIO_PIN_7);
+#endif
+    srdyIsr();
+}
+
+/** SSI2 interrupt service routine, called when the uDMA has finished a transfer on SSI2.
+@note Must be configured in startup_ccs.c or else will not be called.
+*/
+void IntSSI2(void)
+{
+    SSIIntClear(SSI2_BASE, SSIIntStatus(SSI2_BASE, true));
+    if (spiTransferInProgress && !uDMAChannelIsEnabled(UDMA_CH12_SSI2RX))   // Last byte was received
+    {
+        spiTransferInProgress = 0;
+        spiTransferCompleteIsr();
+    }
+}
+#endif
+
 
 /**
 A fairly accurate Blocking Delay in Milliseconds - delays by at least the specified number of
@@ -776,6 +928,104 @@ int16_t initTimer(uint8_t seconds)
     return 0;
 }
 
+#ifdef ZM_WAIT_FOR_EVENT
+//
+//  Wait timer, used to time out the event-driven waits. See phyWaitForMessage() in zm_phy_spi.c
+//
+/** Longer waits are made of several one-shot periods so that the 32 bit timer can't overflow */
+#define WAIT_TIMER_MAX_PERIOD_MS        1000
+
+static volatile uint32_t waitTimerMsLeft = 0;
+static volatile uint8_t waitTimerExpired = 1;
+
+/** Loads and starts the next period of the wait timer, up to WAIT_TIMER_MAX_PERIOD_MS. */
+static void waitTimerNextPeriod()
+{
+    uint32_t ms = (waitTimerMsLeft > WAIT_TIMER_MAX_PERIOD_MS) ? WAIT_TIMER_MAX_PERIOD_MS : waitTimerMsLeft;
+    waitTimerMsLeft -= ms;
+    ROM_TimerLoadSet(TIMER4_BASE, TIMER_A, (ROM_SysCtlClockGet() / 1000) * ms);
+    ROM_TimerEnable(TIMER4_BASE, TIMER_A);
+}
+
+/**
+Starts the wait timer. When it expires halWaitTimerExpired() returns true, which ends 
+halWaitForEvent().
+@param ms how long until the timer expires, in milliseconds
+@note Uses Timer4. Timer4IntHandler() must be configured in startup_ccs.c or else will not be called.
+*/
+void halWaitTimerStart(uint32_t ms)
+{
+    ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER4);
+    ROM_TimerDisable(TIMER4_BASE, TIMER_A);
+    ROM_TimerConfigure(TIMER4_BASE, TIMER_CFG_ONE_SHOT);    // Full width (32 bit) one-shot timer
+    waitTimerMsLeft = (ms == 0) ? 1 : ms;
+    waitTimerExpired = 0;
+    ROM_IntEnable(INT_TIMER4A);
+    ROM_TimerIntEnable(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
+    waitTimerNextPeriod();
+}
+
+/** Stops the wait timer. halWaitTimerExpired() will return true. */
+void halWaitTimerStop()
+{
+    ROM_TimerDisable(TIMER4_BASE, TIMER_A);
+    waitTimerMsLeft = 0;
+    waitTimerExpired = 1;
+}
+
+/** @return true (1) if the wait timer has expired or was stopped, or 0 if it is running. */
+uint8_t halWaitTimerExpired()
+{
+    return waitTimerExpired;
+}
+
+/** ISR for Timer4, loads the next period of the wait timer or ends the wait. */
+void Timer4IntHandler(void)
+{
+    ROM_TimerIntClear(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
+    if (waitTimerMsLeft)
+        waitTimerNextPeriod();
+    else
+        waitTimerExpired = 1;
+}
+
+/** 
+Sleeps until an interrupt occurs, e.g. the SRDY interrupt, the wait timer or the Module serial port.
+@pre interrupts are disabled, so that an event after the caller last checked can't be missed
+@post interrupts are disabled
+@note A pending interrupt wakes up the processor even while interrupts are disabled; they are 
+enabled briefly afterwards so that its ISR runs.
+*/
+void halWaitForEvent()
+{
+    ROM_SysCtlSleep();
+    HAL_ENABLE_INTERRUPTS();
+    HAL_DISABLE_INTERRUPTS();
+}
+#endif
+
+static uint8_t freeRunningTimerStarted = 0;
+
+/**
+Reads the free-running timer, which counts up at the processor clock and wraps around every 2^32 
+ticks (171 seconds at 25MHz), so the time between two readings is simply their difference. Started
+on the first call.
+@note Uses Timer5.
+@return the timer value, in ticks; HAL_TIMER_TICKS_PER_US per microsecond.
+*/
+uint32_t halTimerTicks()
+{
+    if (!freeRunningTimerStarted)
+    {
+        ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER5);
+        ROM_TimerConfigure(TIMER5_BASE, TIMER_CFG_PERIODIC);      // Full width (32 bit) periodic timer
+        ROM_TimerLoadSet(TIMER5_BASE, TIMER_A, 0xFFFFFFFF);
+        ROM_TimerEnable(TIMER5_BASE, TIMER_A);
+        freeRunningTimerStarted = 1;
+    }
+    return (0xFFFFFFFF - ROM_TimerValueGet(TIMER5_BASE, TIMER_A));   // it counts down
+}
+
 /** Required for compatibility with MSP430 library */
 void halSetWakeupFlags(uint16_t wakeupFlagsToSet)
 {
@@ -39,6 +39,7 @@
 #include "driverlib/interrupt.h"  //for UART2 interrupt
 #include "driverlib/uart.h"
 #include "driverlib/systick.h"
+#include "driverlib/timer.h"
 
 #include "hal_gw1.h"
 //#include "hal.h"
@@ -66,6 +67,24 @@ void (*debugConsoleIsr)(int8_t);
 Parameter is which button was pressed. */
 void (*buttonIsr)(int8_t);
 
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+/** Function pointer for the ISR called when a SRDY interrupt occurs */
+void (*srdyIsr)(void);
+
+/** Function pointer for the ISR called when a transfer started with halSpiStartTransfer() has finished */
+void (*spiTransferCompleteIsr)(void);
+
+/** The LM3S6965 has no uDMA controller, so halSpiStartTransfer() moves the bytes from the SSI0 FIFO
+interrupts instead. These track the transfer in progress. */
+static uint8_t* volatile spiTxBytes;
+static uint8_t* volatile spiRxBytes;
+static volatile uint8_t spiTxBytesLeft = 0;
+static volatile uint8_t spiRxBytesLeft = 0;
+
+/** Depth of the SSI FIFOs; never have more than this many bytes in flight or the Rx FIFO will overrun */
+#define SSI_FIFO_DEPTH  8
+#endif
+
 /**
 Blocking Delay in Milliseconds - delays by at least the specified number of milliseconds (mSec)
 @pre SysCtlClockSet() has been called to set the processor clock rate
@@ -577,6 +596,11 @@ void halSpiInitModule()
 
     // Hold the module in reset
     SPI_SS_CLEAR();
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+    IntEnable(INT_SSI0);
+    GPIOIntTypeSet(GPIO_PORTD_BASE, GPIO_PIN_6, GPIO_FALLING_EDGE);
+    IntEnable(INT_GPIOD);
+#endif
 }
 
 
@@ -611,6 +635,218 @@ void spiWrite(unsigned char *bytes, unsigned char numBytes)
     //SPI_SS_CLEAR();
 }
 
+/**
+Sends bytes to the Module over SPI. Same as spiWrite() but the bytes received are discarded, so the 
+buffer is not overwritten. Used to send a SREQ, since nothing is received while it is being sent.
+@param bytes the data to be sent.
+@param numBytes the number of bytes to be sent.
+@pre SPI port configured for the Module and Module has been initialized properly
+@see zm_phy_spi.c
+@note this function is not required if using the UART to communicate with the module
+*/
+void spiTransmit(const uint8_t *bytes, uint8_t numBytes)
+{
+    unsigned long ulReadData;
+    while(numBytes--)    // Loop while there are more bytes left to be transferred.
+    {
+        SSIDataPut(SSI0_BASE, *bytes++);            // Write the next byte to the SSI controller with a blocking put.
+        SSIDataGet(SSI0_BASE, &ulReadData);         // Discard the byte received, to keep the receive FIFO empty
+    }
+}
+
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+/** Loads the SSI0 Tx FIFO, keeping no more than SSI_FIFO_DEPTH bytes in flight. */
+static void spiFillTxFifo()
+{
+    while (spiTxBytesLeft && ((spiTxBytes - spiRxBytes) < SSI_FIFO_DEPTH) && 
+           SSIDataPutNonBlocking(SSI0_BASE, *spiTxBytes))
+    {
+        spiTxBytes++;
+        spiTxBytesLeft--;
+    }
+}
+
+/**
+Non-blocking version of spiWrite(). Starts the transfer and returns immediately; the remaining bytes 
+are moved by the SSI0 receive FIFO interrupts since this processor does not have a uDMA controller.
+@param bytes the data to be sent or received. Must remain valid until the transfer has finished.
+@param numBytes the number of bytes to be sent. This same buffer will be overwritten with the received data.
+@pre halSpiInitModule() has been called
+@post when spiTransferCompleteIsr() is called, bytes contains received data, if any
+@see zm_phy_spi.c
+*/
+void halSpiStartTransfer(uint8_t *bytes, uint8_t numBytes)
+{
+    if (numBytes == 0)
+    {
+        spiTransferCompleteIsr();
+        return;
+    }
+    spiTxBytes = bytes;
+    spiRxBytes = bytes;
+    spiTxBytesLeft = numBytes;
+    spiRxBytesLeft = numBytes;
+    spiFillTxFifo();
+    SSIIntEnable(SSI0_BASE, SSI_RXFF | SSI_RXTO);   // Rx FIFO half full, or bytes waiting in Rx FIFO
+}
+
+/** Stops a transfer started with halSpiStartTransfer(). spiTransferCompleteIsr() will not be called. */
+void halSpiAbortTransfer()
+{
+    unsigned long ulReadData;
+    SSIIntDisable(SSI0_BASE, SSI_RXFF | SSI_RXTO);
+    spiTxBytesLeft = 0;
+    spiRxBytesLeft = 0;
+    WAIT_WHILE_SPI_BUSY();
+    while (SSIDataGetNonBlocking(SSI0_BASE, &ulReadData)) ;
+}
+
+/**
+Arms the SRDY interrupt; srdyIsr() will be called on the selected edge.
+@param edge SRDY_EDGE_FALLING or SRDY_EDGE_RISING
+*/
+void halSrdyInterruptEnable(uint8_t edge)
+{
+    GPIOIntTypeSet(GPIO_PORTD_BASE, GPIO_PIN_6, (edge == SRDY_EDGE_FALLING) ? GPIO_FALLING_EDGE : GPIO_RISING_EDGE);
+    GPIOPinIntClear(GPIO_PORTD_BASE, GPIO_PIN_6);
+    GPIOPinIntEnable(GPIO_PORTD_BASE, GPIO_PIN_6);
+}
+
+/** Disarms the SRDY interrupt */
+void halSrdyInterruptDisable()
+{
+    GPIOPinIntDisable(GPIO_PORTD_BASE, GPIO_PIN_6);
+}
+
+/** Port D interrupt service routine, called on the SRDY edge armed with halSrdyInterruptEnable().
+@note Must be configured in startup_ccs.c or else will not be called.
+*/
+void IntGPIOd(void)
+{
+    GPIOPinIntClear(GPIO_PORTD_BASE, GPIO_PIN_6);   // Only Interrupt source for this port is PD6
+    srdyIsr();
+}
+
+/** SSI0 interrupt service routine, empties the Rx FIFO and refills the Tx FIFO.
+@note Must be configured in startup_ccs.c or else will not be called.
+*/
+void IntSSI0(void)
+{
+    unsigned long ulReadData;
+    SSIIntClear(SSI0_BASE, SSIIntStatus(SSI0_BASE, true));
+    while (spiRxBytesLeft && SSIDataGetNonBlocking(SSI0_BASE, &ulReadData))
+    {
+        *spiRxBytes++ = (unsigned char)ulReadData;
+        spiRxBytesLeft--;
+    }
+    if (spiRxBytesLeft == 0)
+    {
+        SSIIntDisable(SSI0_BASE, SSI_RXFF | SSI_RXTO);
+        spiTransferCompleteIsr();
+    } else {
+        spiFillTxFifo();
+    }
+}
+#endif
+
+#ifdef ZM_WAIT_FOR_EVENT
+//
+//  Wait timer, used to time out the event-driven waits. See phyWaitForMessage() in zm_phy_spi.c
+//
+/** Longer waits are made of several one-shot periods so that the 32 bit timer can't overflow */
+#define WAIT_TIMER_MAX_PERIOD_MS        1000
+
+static volatile uint32_t waitTimerMsLeft = 0;
+static volatile uint8_t waitTimerExpired = 1;
+
+/** Loads and starts the next period of the wait timer, up to WAIT_TIMER_MAX_PERIOD_MS. */
+static void waitTimerNextPeriod()
+{
+    uint32_t ms = (waitTimerMsLeft > WAIT_TIMER_MAX_PERIOD_MS) ? WAIT_TIMER_MAX_PERIOD_MS : waitTimerMsLeft;
+    waitTimerMsLeft -= ms;
+    TimerLoadSet(TIMER1_BASE, TIMER_A, (SysCtlClockGet() / 1000) * ms);
+    TimerEnable(TIMER1_BASE, TIMER_A);
+}
+
+/**
+Starts the wait timer. When it expires halWaitTimerExpired() returns true, which ends 
+halWaitForEvent().
+@param ms how long until the timer expires, in milliseconds
+@note Uses Timer1. Timer1IntHandler() must be configured in startup_ccs.c or else will not be called.
+*/
+void halWaitTimerStart(uint32_t ms)
+{
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER1);
+    TimerDisable(TIMER1_BASE, TIMER_A);
+    TimerConfigure(TIMER1_BASE, TIMER_CFG_ONE_SHOT);    // Full width (32 bit) one-shot timer
+    waitTimerMsLeft = (ms == 0) ? 1 : ms;
+    waitTimerExpired = 0;
+    IntEnable(INT_TIMER1A);
+    TimerIntEnable(TIMER1_BASE, TIMER_TIMA_TIMEOUT);
+    waitTimerNextPeriod();
+}
+
+/** Stops the wait timer. halWaitTimerExpired() will return true. */
+void halWaitTimerStop()
+{
+    TimerDisable(TIMER1_BASE, TIMER_A);
+    waitTimerMsLeft = 0;
+    waitTimerExpired = 1;
+}
+
+/** @return true (1) if the wait timer has expired or was stopped, or 0 if it is running. */
+uint8_t halWaitTimerExpired()
+{
+    return waitTimerExpired;
+}
+
+/** ISR for Timer1, loads the next period of the wait timer or ends the wait. */
+void Timer1IntHandler(void)
+{
+    TimerIntClear(TIMER1_BASE, TIMER_TIMA_TIMEOUT);
+    if (waitTimerMsLeft)
+        waitTimerNextPeriod();
+    else
+        waitTimerExpired = 1;
+}
+
+/** 
+Sleeps until an interrupt occurs, e.g. the SRDY interrupt, the wait timer or the Module serial port.
+@pre interrupts are disabled, so that an event after the caller last checked can't be missed
+@post interrupts are disabled
+@note A pending interrupt wakes up the processor even while interrupts are disabled; they are 
+enabled briefly afterwards so that its ISR runs.
+*/
+void halWaitForEvent()
+{
+    SysCtlSleep();
+    HAL_ENABLE_INTERRUPTS();
+    HAL_DISABLE_INTERRUPTS();
+}
+#endif
+
+static uint8_t freeRunningTimerStarted = 0;
+
+/**
+Reads the free-running timer, which counts up at the processor clock and wraps around every 2^32 
+ticks (171 seconds at 25MHz), so the time between two readings is simply their difference. Started
+on the first call.
+@note Uses Timer2.
+@return the timer value, in ticks; HAL_TIMER_TICKS_PER_US per microsecond.
+*/
+uint32_t halTimerTicks()
+{
+    if (!freeRunningTimerStarted)
+    {
+        SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER2);
+        TimerConfigure(TIMER2_BASE, TIMER_CFG_PERIODIC);      // Full width (32 bit) periodic timer
+        TimerLoadSet(TIMER2_BASE, TIMER_A, 0xFFFFFFFF);
+        TimerEnable(TIMER2_BASE, TIMER_A);
+        freeRunningTimerStarted = 1;
+    }
+    return (0xFFFFFFFF - TimerValueGet(TIMER2_BASE, TIMER_A));   // it counts down
+}
+
 /**
  * Turn off interrupt sources that may interrupt us (SysTick and Ethernet) and then switch control
  * to the Boot Loader. This will never return!
@@ -18,6 +18,7 @@
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 #include "driverlib/interrupt.h"
+#include "driverlib/cpu.h"
 #include "driverlib/gpio.h"
 #include "driverlib/sysctl.h"
 #include "inc/hw_ssi.h"
@@ -31,6 +32,28 @@ void halInit();
 void delayMs(uint16_t ms);
 void halSpiInitModule();
 void spiWrite(uint8_t *bytes, uint8_t numBytes);
+void spiTransmit(const uint8_t *bytes, uint8_t numBytes);
+
+// Only required if ZM_PHY_SPI_ASYNC is defined, see zm_phy_spi.c. The SRDY interrupt is also used
+// if ZM_WAIT_FOR_EVENT is defined.
+void halSpiStartTransfer(uint8_t *bytes, uint8_t numBytes);
+void halSpiAbortTransfer();
+void halSrdyInterruptEnable(uint8_t edge);
+void halSrdyInterruptDisable();
+#define SRDY_EDGE_FALLING           0
+#define SRDY_EDGE_RISING            1
+
+// Only required if ZM_WAIT_FOR_EVENT is defined, see phyWaitForMessage() in zm_phy_spi.c
+void halWaitTimerStart(uint32_t ms);
+void halWaitTimerStop();
+uint8_t halWaitTimerExpired();
+void halWaitForEvent();
+
+// Free-running timer, used for latency statistics if ZM_LATENCY_STATS is defined, see zm_latency.c
+uint32_t halTimerTicks();
+#define HAL_TIMER_TICKS()           (halTimerTicks())
+#define HAL_TIMER_TICKS_PER_US      (TICKS_PER_MS / 1000)
+
 int16_t toggleLed(uint8_t whichLed);
 int16_t setLed(uint8_t led);
 int16_t clearLed(uint8_t led);
@@ -54,7 +77,7 @@ uint8_t buttonIsPressed(uint8_t button);
 
 
 #define GET_MCLK_FREQ() (SysCtlClockGet())
-#define TICKS_PER_MS	25000			// used in FAST_PROCESSOR option of zm_phy
+#define TICKS_PER_MS	25000			// also used for HAL_TIMER_TICKS_PER_US
 
 #define WAIT_WHILE_SPI_BUSY()  while ((HWREG(SSI0_BASE + SSI_O_SR)) & SSI_SR_BSY)   //wait while busy
 
@@ -83,6 +106,7 @@ uint8_t buttonIsPressed(uint8_t button);
 
 #define HAL_ENABLE_INTERRUPTS()		IntMasterEnable()
 #define HAL_DISABLE_INTERRUPTS()	IntMasterDisable()
+#define HAL_INTERRUPTS_ARE_ENABLED()	(!CPUprimask())
 
 #define SPI_FLASH_SS_SET()                ( GPIOPinWrite(GPIO_PORTC_BASE, GPIO_PIN_5, 0) )
 #define SPI_FLASH_SS_CLEAR()              ( GPIOPinWrite(GPIO_PORTC_BASE, GPIO_PIN_5, GPIO_PIN_5) )
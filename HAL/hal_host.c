@@ -0,0 +1,706 @@
+/**
+* @ingroup hal
+* @{ 
+* @file hal_host.c
+*
+* @brief Hardware Abstraction Layer (HAL) for running the Zigbee Module library on a Linux host, 
+* against a simulated Module on the SPI port.
+*
+* Nothing here touches real hardware. A thread plays the part of the Module: it drives SRDY, answers
+* each SREQ with a SRSP and can send AREQs (see halHostQueueAreq()). SRDY edges, the end of SPI 
+* transfers, the timer and the sysTick are delivered by calling the same function pointers (srdyIsr, 
+* spiTransferCompleteIsr etc.) that the real hal files call from their interrupt service routines. 
+* This allows the zm_phy_spi.c state machines to be run, and their latency measured, without a board. 
+* The Module timing may be changed with halHostSetTiming().
+*
+* To use, define LINUX_HOST and ZM_PHY_SPI and link with -lpthread. To simulate the Module at the 
+* level of MT commands instead, e.g. to run several nodes on one virtual network, define ZM_PHY_SIM 
+* and see zm_phy_sim.c.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "hal.h"
+#include <pthread.h>
+#include <time.h>
+#include <string.h>
+
+/** Function pointer for the ISR called when a debug console character is received. Not used on the 
+host, since there is no debug console interrupt, but required for compatibility with the examples. */
+void (*debugConsoleIsr)(int8_t);
+
+/** Function pointer for the ISR called when the button is pressed. Parameter is which button was pressed. */
+void (*buttonIsr)(int8_t);
+
+/** Function pointer for the ISR called when a timer generates an interrupt */
+void (*timerIsr)(void);
+
+/** Function pointer for the ISR called when a SRDY interrupt occurs */
+void (*srdyIsr)(void);
+
+/** Function pointer for the ISR called when a sysTick interrupt occurs */
+void (*sysTickIsr)(void);
+
+/** Function pointer for the ISR called when a transfer started with halSpiStartTransfer() has finished */
+void (*spiTransferCompleteIsr)(void);
+
+/** Flags to indicate when to wake up the processor from HAL_SLEEP(). */
+uint16_t wakeupFlags = 0;
+
+//
+//  "Interrupts"
+//
+/** Held by the Module thread while it runs an ISR, and by HAL_DISABLE_INTERRUPTS(). Recursive so 
+that the hal methods below may take it when called with interrupts disabled. */
+static pthread_mutex_t interruptLock;
+
+/** Signalled when an event is scheduled, to wake up the Module thread */
+static pthread_cond_t eventCondition;
+
+/** Signalled by HAL_WAKEUP() */
+static pthread_cond_t wakeupCondition;
+static uint8_t wakeupPending = 0;
+
+/** Set in the Module thread, so that HAL_ENABLE_INTERRUPTS() inside an ISR doesn't release the lock */
+static __thread uint8_t inIsr = 0;
+
+/** Whether this thread has disabled interrupts. Like the GIE bit it doesn't nest. */
+static __thread uint8_t interruptsDisabled = 0;
+
+void halHostInterruptsDisable()
+{
+    if (inIsr || interruptsDisabled)
+        return;
+    pthread_mutex_lock(&interruptLock);
+    interruptsDisabled = 1;
+}
+
+void halHostInterruptsEnable()
+{
+    if (inIsr || !interruptsDisabled)
+        return;
+    interruptsDisabled = 0;
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Returns false (0) in an ISR or while interrupts are disabled, like the GIE bit of an MSP430 */
+uint8_t halHostInterruptsAreEnabled()
+{
+    return !inIsr && !interruptsDisabled;
+}
+
+/** Enables interrupts and waits until an ISR calls HAL_WAKEUP(). */
+void halHostSleep()
+{
+    halHostInterruptsEnable();
+    pthread_mutex_lock(&interruptLock);
+    while (!wakeupPending)
+        pthread_cond_wait(&wakeupCondition, &interruptLock);
+    wakeupPending = 0;
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Wakes up HAL_SLEEP(). Must be called from an ISR. */
+void halHostWakeup()
+{
+    wakeupPending = 1;
+    pthread_cond_signal(&wakeupCondition);
+}
+
+/** @return microseconds since an arbitrary point; wraps every ~71 minutes. */
+uint32_t halHostMicros()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint32_t) now.tv_sec * 1000000UL) + (uint32_t) (now.tv_nsec / 1000);
+}
+
+//
+//  Events, run by the Module thread at the scheduled time
+//
+#define EVENT_SRDY_LOW          0
+#define EVENT_SRDY_HIGH         1
+#define EVENT_TRANSFER_DONE     2
+#define EVENT_MODULE_BOOTED     3
+#define EVENT_TIMER             4
+#define EVENT_SYSTICK           5
+#define EVENT_WAIT_TIMER        6
+#define NUM_EVENTS              7
+
+static uint8_t eventPending[NUM_EVENTS];
+static uint32_t eventDueUs[NUM_EVENTS];
+
+/** Set by EVENT_WAIT_TIMER, see halWaitTimerStart() */
+static volatile uint8_t waitTimerExpired = 1;
+
+/** Schedules an event. Must be called with interruptLock held. Replaces any pending event of this type. */
+static void scheduleEvent(uint8_t event, uint32_t delayUs)
+{
+    eventDueUs[event] = halHostMicros() + delayUs;
+    eventPending[event] = 1;
+    pthread_cond_signal(&eventCondition);
+}
+
+//
+//  Simulated Module
+//
+/** Module timing in microseconds. Defaults are typical of the CC2530 ZNP at 2MHz SPI. */
+static uint32_t srdyDelayUs = 40;       // MRDY asserted to SRDY low
+static uint32_t srspDelayUs = 250;      // SREQ received to SRSP ready (SRDY high)
+static uint32_t byteTimeUs = 4;         // per byte on the SPI bus
+#define MODULE_BOOT_TIME_US     600000  // Reset released to SYS_RESET_IND
+
+#define FRAME_BUFFER_SIZE       (0xFF + 3)
+#define AREQ_QUEUE_SIZE         8
+
+static uint8_t moduleRunning = 0;
+static volatile uint8_t srdy = 1;
+static uint8_t mrdy = 0;
+
+/** Whether the Module is receiving a frame from us, or sending its response */
+#define MODULE_RECEIVING        0
+#define MODULE_RESPONDING       1
+static uint8_t modulePhase = MODULE_RECEIVING;
+static uint8_t moduleRx[FRAME_BUFFER_SIZE];
+static uint16_t moduleRxCount = 0;
+static uint8_t moduleTx[FRAME_BUFFER_SIZE];
+static uint16_t moduleTxIndex = 0;
+
+/** AREQs waiting to be sent by the Module */
+static uint8_t areqQueue[AREQ_QUEUE_SIZE][FRAME_BUFFER_SIZE];
+static uint8_t areqHead = 0;
+static uint8_t areqCount = 0;
+
+static uint8_t srdyArmed = 0;
+static uint8_t srdyArmedEdge = SRDY_EDGE_FALLING;
+
+#define MT_TYPE_MASK            0xE0
+#define MT_TYPE_SREQ            0x20
+#define MT_TYPE_SRSP            0x60
+
+/** Queues a frame to be sent by the Module as an AREQ. SRDY will go low when the Module is idle.
+@param frame a complete frame: length, command MSB, command LSB, then length bytes of payload. */
+void halHostQueueAreq(const uint8_t* frame)
+{
+    pthread_mutex_lock(&interruptLock);
+    if (areqCount < AREQ_QUEUE_SIZE)
+    {
+        memcpy(areqQueue[(areqHead + areqCount) % AREQ_QUEUE_SIZE], frame, frame[0] + 3);
+        areqCount++;
+        if (!mrdy && srdy && moduleRunning)
+            scheduleEvent(EVENT_SRDY_LOW, srdyDelayUs);
+    }
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Changes the timing of the simulated Module.
+@param srdyDelay microseconds from MRDY asserted to SRDY low
+@param srspDelay microseconds from the end of a SREQ to the SRSP being ready
+@param byteTime microseconds per byte on the SPI bus */
+void halHostSetTiming(uint32_t srdyDelay, uint32_t srspDelay, uint32_t byteTime)
+{
+    pthread_mutex_lock(&interruptLock);
+    srdyDelayUs = srdyDelay;
+    srspDelayUs = srspDelay;
+    byteTimeUs = byteTime;
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Builds the Module's response to the frame in moduleRx. */
+static void moduleProcessFrame()
+{
+    memset(moduleTx, 0, 3);
+    if ((moduleRx[0] == 0) && (moduleRx[1] == 0) && (moduleRx[2] == 0))    // Poll: send next AREQ
+    {
+        if (areqCount > 0)
+        {
+            memcpy(moduleTx, areqQueue[areqHead], areqQueue[areqHead][0] + 3);
+            areqHead = (areqHead + 1) % AREQ_QUEUE_SIZE;
+            areqCount--;
+        }
+    } 
+    else if ((moduleRx[1] & MT_TYPE_MASK) == MT_TYPE_SREQ)                 // SREQ: SRSP with status success
+    {
+        moduleTx[0] = 1;
+        moduleTx[1] = (moduleRx[1] & ~MT_TYPE_MASK) | MT_TYPE_SRSP;
+        moduleTx[2] = moduleRx[2];
+        moduleTx[3] = 0;
+    }                                                                       // AREQ: nothing to send
+}
+
+/** Exchanges bytes with the Module. Must be called with interruptLock held. */
+static void moduleExchange(uint8_t *bytes, uint8_t numBytes)
+{
+    while (numBytes--)
+    {
+        uint8_t in = *bytes;
+        if (modulePhase == MODULE_RECEIVING)
+        {
+            *bytes = 0;
+            if (moduleRxCount < FRAME_BUFFER_SIZE)
+                moduleRx[moduleRxCount++] = in;
+            if (moduleRxCount == (uint16_t) (moduleRx[0] + 3))             // Frame complete
+            {
+                moduleProcessFrame();
+                modulePhase = MODULE_RESPONDING;
+                moduleTxIndex = 0;
+                scheduleEvent(EVENT_SRDY_HIGH, srspDelayUs);
+            }
+        } else {
+            *bytes = (moduleTxIndex < (uint16_t) (moduleTx[0] + 3)) ? moduleTx[moduleTxIndex] : 0;
+            moduleTxIndex++;
+        }
+        bytes++;
+    }
+}
+
+/** Called when SRDY changes; calls srdyIsr() if this edge was armed. */
+static void srdyChanged(uint8_t edge)
+{
+    if (srdyArmed && (srdyArmedEdge == edge))
+    {
+        srdyIsr();
+        if (wakeupFlags & WAKEUP_AFTER_SRDY)
+            HAL_WAKEUP();
+    }
+}
+
+static void runEvent(uint8_t event)
+{
+    switch (event)
+    {
+    case EVENT_SRDY_LOW:
+        if (!moduleRunning || !srdy)
+            break;
+        srdy = 0;
+        srdyChanged(SRDY_EDGE_FALLING);
+        break;
+    case EVENT_SRDY_HIGH:
+        if (srdy)
+            break;
+        srdy = 1;
+        srdyChanged(SRDY_EDGE_RISING);
+        break;
+    case EVENT_TRANSFER_DONE:
+        spiTransferCompleteIsr();
+        if (wakeupFlags & WAKEUP_AFTER_SRDY)
+            HAL_WAKEUP();
+        break;
+    case EVENT_MODULE_BOOTED:
+    {
+        const uint8_t sysResetInd[] = {6, 0x41, 0x80, 0x00, 0x02, 0x00, 0x02, 0x05, 0x01};
+        moduleRunning = 1;
+        memcpy(areqQueue[(areqHead + areqCount) % AREQ_QUEUE_SIZE], sysResetInd, sizeof(sysResetInd));
+        areqCount++;
+        scheduleEvent(EVENT_SRDY_LOW, 0);
+        break;
+    }
+    case EVENT_TIMER:
+        timerIsr();
+        if (wakeupFlags & WAKEUP_AFTER_TIMER)
+            HAL_WAKEUP();
+        break;
+    case EVENT_SYSTICK:
+        scheduleEvent(EVENT_SYSTICK, SYSTICK_INTERVAL_MS * 1000UL);
+        sysTickIsr();
+        break;
+    case EVENT_WAIT_TIMER:
+        waitTimerExpired = 1;
+        if (wakeupFlags & WAKEUP_AFTER_WAIT_TIMER)
+            HAL_WAKEUP();
+        break;
+    }
+}
+
+static uint32_t timerPeriodUs = 0;
+
+/** The Module thread: runs each event when it is due, with interruptLock held like an ISR. */
+static void* moduleThread(void* arg)
+{
+    (void) arg;
+    pthread_mutex_lock(&interruptLock);
+    inIsr = 1;
+    while (1)
+    {
+        int8_t next = -1;
+        uint8_t i;
+        uint32_t now = halHostMicros();
+        for (i = 0; i < NUM_EVENTS; i++)
+        {
+            if (eventPending[i] && ((next < 0) || ((int32_t) (eventDueUs[i] - eventDueUs[next]) < 0)))
+                next = i;
+        }
+        if (next < 0)
+        {
+            pthread_cond_wait(&eventCondition, &interruptLock);
+        } 
+        else if ((int32_t) (eventDueUs[next] - now) > 0)
+        {
+            struct timespec until;
+            clock_gettime(CLOCK_MONOTONIC, &until);
+            until.tv_nsec += (long) (eventDueUs[next] - now) * 1000L;
+            until.tv_sec += until.tv_nsec / 1000000000L;
+            until.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&eventCondition, &interruptLock, &until);
+        } else {
+            eventPending[next] = 0;
+            runEvent(next);
+            if ((next == EVENT_TIMER) && (timerPeriodUs != 0))
+                scheduleEvent(EVENT_TIMER, timerPeriodUs);
+        }
+    }
+    return 0;
+}
+
+//
+//  HAL methods
+//
+/** Placeholder function to point the function pointers to so that they don't cause mischief */
+static void doNothing(int8_t a) { (void) a; }
+static void doNothingVoid(void) { }
+
+/** Display information about this driver firmware */
+void displayVersion()
+{
+    int i = 0;
+    printf("\r\n\r\n");
+    for (i=0; i<8; i++)
+        printf("-");
+    printf(" Module Interface and Examples %s ", MODULE_INTERFACE_STRING);
+    for (i=0; i<8; i++)
+            printf("-");
+    printf("\r\n");
+    printf("%s", MODULE_VERSION_STRING);
+}
+
+/** Starts the simulated Module thread. The Module is held in reset until RADIO_ON(). */
+void halInit()
+{
+    pthread_mutexattr_t mutexAttributes;
+    pthread_condattr_t conditionAttributes;
+    pthread_t thread;
+
+    pthread_mutexattr_init(&mutexAttributes);
+    pthread_mutexattr_settype(&mutexAttributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&interruptLock, &mutexAttributes);
+    pthread_condattr_init(&conditionAttributes);
+    pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&eventCondition, &conditionAttributes);
+    pthread_cond_init(&wakeupCondition, 0);
+
+    //Point the function pointers to doNothing() so that they don't cause mischief
+    debugConsoleIsr = &doNothing;
+    buttonIsr = &doNothing;
+    timerIsr = &doNothingVoid;
+    srdyIsr = &doNothingVoid;
+    sysTickIsr = &doNothingVoid;
+    spiTransferCompleteIsr = &doNothingVoid;
+
+    setvbuf(stdout, 0, _IONBF, 0);     // Like the debug UART on the boards: no buffering
+    pthread_create(&thread, 0, &moduleThread, 0);
+    displayVersion();
+}
+
+/** Simulates the Module reset line.
+@param running 0 to hold the Module in reset, 1 to let it run */
+void halHostSetReset(uint8_t running)
+{
+    pthread_mutex_lock(&interruptLock);
+    if (running)
+    {
+        if (!moduleRunning)
+            scheduleEvent(EVENT_MODULE_BOOTED, MODULE_BOOT_TIME_US);
+    } else {
+        moduleRunning = 0;
+        srdy = 1;
+        areqCount = 0;
+        modulePhase = MODULE_RECEIVING;
+        moduleRxCount = 0;
+        eventPending[EVENT_SRDY_LOW] = 0;
+        eventPending[EVENT_SRDY_HIGH] = 0;
+        eventPending[EVENT_MODULE_BOOTED] = 0;
+    }
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Simulates MRDY & SS. Asserting starts a frame; de-asserting ends it.
+@param asserted 1 if asserted (low on the real hardware) */
+void halHostSetMrdy(uint8_t asserted)
+{
+    pthread_mutex_lock(&interruptLock);
+    if (asserted && !mrdy)
+    {
+        modulePhase = MODULE_RECEIVING;
+        moduleRxCount = 0;
+        if (srdy && moduleRunning)
+            scheduleEvent(EVENT_SRDY_LOW, srdyDelayUs);
+    } 
+    else if (!asserted && mrdy)
+    {
+        modulePhase = MODULE_RECEIVING;
+        moduleRxCount = 0;
+        if (!srdy)
+            scheduleEvent(EVENT_SRDY_HIGH, 0);
+        if (areqCount > 0)
+            scheduleEvent(EVENT_SRDY_LOW, srdyDelayUs);
+    }
+    mrdy = asserted;
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** @return the simulated SRDY level: 1 if high, 0 if low */
+uint8_t halHostSrdy()
+{
+    return srdy;
+}
+
+/** Nothing to initialize; the simulated Module is always connected */
+void halSpiInitModule()
+{
+}
+
+/** 
+Sends a message over the simulated SPI port to the Module, blocking for the time it would take on the bus.
+@param bytes the data to be sent or received.
+@param numBytes the number of bytes to be sent. This same buffer will be overwritten with the received data.
+*/
+void spiWrite(uint8_t *bytes, uint8_t numBytes)
+{
+    uint32_t start = halHostMicros();
+    uint32_t duration;
+    pthread_mutex_lock(&interruptLock);
+    moduleExchange(bytes, numBytes);
+    duration = numBytes * byteTimeUs;
+    pthread_mutex_unlock(&interruptLock);
+    while ((halHostMicros() - start) < duration) ;
+}
+
+/** Same as spiWrite() but the bytes received are discarded, so the buffer is not overwritten. */
+void spiTransmit(const uint8_t *bytes, uint8_t numBytes)
+{
+    uint32_t start = halHostMicros();
+    uint32_t duration = numBytes * byteTimeUs;
+    pthread_mutex_lock(&interruptLock);
+    while (numBytes--)
+    {
+        uint8_t b = *bytes++;
+        moduleExchange(&b, 1);
+    }
+    pthread_mutex_unlock(&interruptLock);
+    while ((halHostMicros() - start) < duration) ;
+}
+
+/**
+Non-blocking version of spiWrite(). spiTransferCompleteIsr() is called from the Module thread after 
+the time it would take on the bus.
+@param bytes the data to be sent or received. Must remain valid until the transfer has finished.
+@param numBytes the number of bytes to be sent. This same buffer will be overwritten with the received data.
+*/
+void halSpiStartTransfer(uint8_t *bytes, uint8_t numBytes)
+{
+    pthread_mutex_lock(&interruptLock);
+    moduleExchange(bytes, numBytes);
+    scheduleEvent(EVENT_TRANSFER_DONE, numBytes * byteTimeUs);
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Stops a transfer started with halSpiStartTransfer(). spiTransferCompleteIsr() will not be called. */
+void halSpiAbortTransfer()
+{
+    pthread_mutex_lock(&interruptLock);
+    eventPending[EVENT_TRANSFER_DONE] = 0;
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/**
+Arms the SRDY interrupt; srdyIsr() will be called on the selected edge.
+@param edge SRDY_EDGE_FALLING or SRDY_EDGE_RISING
+*/
+void halSrdyInterruptEnable(uint8_t edge)
+{
+    pthread_mutex_lock(&interruptLock);
+    srdyArmedEdge = edge;
+    srdyArmed = 1;
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Disarms the SRDY interrupt */
+void halSrdyInterruptDisable()
+{
+    pthread_mutex_lock(&interruptLock);
+    srdyArmed = 0;
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Blocking delay in milliseconds. 
+@param delay number of milliseconds to delay */
+void delayMs(uint16_t delay)
+{
+    struct timespec duration;
+    duration.tv_sec = delay / 1000;
+    duration.tv_nsec = (delay % 1000) * 1000000L;
+    while (nanosleep(&duration, &duration) != 0) ;
+}
+
+/** Configures the timer to call timerIsr() every period.
+@param seconds period of the timer.
+@return 0 if success; -1 if illegal parameter */
+int16_t initTimer(uint8_t seconds)
+{
+    if (seconds == 0)
+        return -1;
+    pthread_mutex_lock(&interruptLock);
+    wakeupFlags |= WAKEUP_AFTER_TIMER;
+    timerPeriodUs = seconds * 1000000UL;
+    scheduleEvent(EVENT_TIMER, timerPeriodUs);
+    pthread_mutex_unlock(&interruptLock);
+    return 0;
+}
+
+/** Halts the timer. */
+void stopTimer()
+{
+    pthread_mutex_lock(&interruptLock);
+    timerPeriodUs = 0;
+    eventPending[EVENT_TIMER] = 0;
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Starts the wait timer. When it expires halWaitTimerExpired() returns true and the processor is 
+woken up from halWaitForEvent().
+@param ms how long until the timer expires, in milliseconds */
+void halWaitTimerStart(uint32_t ms)
+{
+    pthread_mutex_lock(&interruptLock);
+    waitTimerExpired = 0;
+    scheduleEvent(EVENT_WAIT_TIMER, ((ms == 0) ? 1 : ms) * 1000UL);
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Stops the wait timer. halWaitTimerExpired() will return true. */
+void halWaitTimerStop()
+{
+    pthread_mutex_lock(&interruptLock);
+    eventPending[EVENT_WAIT_TIMER] = 0;
+    waitTimerExpired = 1;
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** @return true (1) if the wait timer has expired or was stopped, or 0 if it is running. */
+uint8_t halWaitTimerExpired()
+{
+    return waitTimerExpired;
+}
+
+/** Sleeps on a condition variable until an ISR wakes up the processor with WAKEUP_AFTER_SRDY or 
+WAKEUP_AFTER_WAIT_TIMER.
+@pre interrupts are disabled, so that an event after the caller last checked can't be missed
+@post interrupts are disabled */
+void halWaitForEvent()
+{
+    uint16_t savedWakeupFlags = wakeupFlags;
+    wakeupFlags |= (WAKEUP_AFTER_SRDY | WAKEUP_AFTER_WAIT_TIMER);
+    halHostSleep();
+    halHostInterruptsDisable();
+    wakeupFlags = savedWakeupFlags;
+}
+
+/** Starts calling sysTickIsr() every SYSTICK_INTERVAL_MS */
+void initSysTick(void)
+{
+    pthread_mutex_lock(&interruptLock);
+    scheduleEvent(EVENT_SYSTICK, SYSTICK_INTERVAL_MS * 1000UL);
+    pthread_mutex_unlock(&interruptLock);
+}
+
+/** Configures which events will wake up the processor if sleeping. */
+void halSetWakeupFlags(uint16_t wakeupFlagsToSet)
+{
+    wakeupFlags |= wakeupFlagsToSet;  
+}
+
+/** These flags will no longer wakeup the processor while it is sleeping. */
+void halClearWakeupFlags(uint16_t wakeupFlagsToClear)
+{
+    wakeupFlags &= ~wakeupFlagsToClear;  
+}
+
+/** Required for compatibility with MSP430 libraries */
+int16_t calibrateVlo()
+{
+    return 1;
+}
+
+/** Required for compatibility with processors (like Stellaris) that have a UART FIFO */
+uint8_t halUartBusy()
+{
+    return 0;
+}
+
+/** There are no buttons on the host. @return 0 */
+uint8_t buttonIsPressed(uint8_t button)
+{
+    (void) button;
+    return 0;
+}
+
+#define NUM_LEDS 3
+static uint8_t leds = 0;
+
+/** Toggles the specified LED.
+@return 0 if success, -1 if invalid LED specified */
+int16_t toggleLed(uint8_t led)
+{
+    if (led >= NUM_LEDS)
+        return -1;
+    return (leds & (1 << led)) ? clearLed(led) : setLed(led);
+}
+
+/** Turns ON the specified LED.
+@return 0 if success, -1 if invalid LED specified */
+int16_t setLed(uint8_t led)
+{
+    if (led >= NUM_LEDS)
+        return -1;
+    leds |= (1 << led);
+    return 0;
+}
+
+/** Turns OFF the specified LED.
+@return 0 if success, -1 if invalid LED specified */
+int16_t clearLed(uint8_t led)
+{
+    if (led >= NUM_LEDS)
+        return -1;
+    leds &= ~(1 << led);
+    return 0;
+}
+
+/** Turns OFF LEDs. */
+void clearLeds()
+{
+    leds = 0;
+}
+
+/* @} */
@@ -0,0 +1,145 @@
+/**
+*  @file hal_host.h
+*
+*  @brief public methods for hal_host.c
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+//
+//  Common Includes (will be included in all projects that #include this hal file)
+//
+#include <stdio.h>
+#include <stdint.h>             // Standard integers (uint8_t, int32_t, etc.)
+
+//
+//  CORE METHODS REQUIRED FOR ZIGBEE MODULE AND EXAMPLES
+//
+void halInit();
+void delayMs(uint16_t delay);
+int16_t toggleLed(uint8_t led);
+int16_t setLed(uint8_t led);
+int16_t clearLed(uint8_t led);
+void clearLeds();
+
+#define ON_NETWORK_LED          2
+#define NETWORK_FAILURE_LED     1
+#define SEND_MESSAGE_LED        0
+
+void halSpiInitModule();
+void spiWrite(uint8_t *bytes, uint8_t numBytes);
+void spiTransmit(const uint8_t *bytes, uint8_t numBytes);
+
+// Only required if ZM_PHY_SPI_ASYNC is defined, see zm_phy_spi.c. The SRDY interrupt is also used
+// if ZM_WAIT_FOR_EVENT is defined.
+void halSpiStartTransfer(uint8_t *bytes, uint8_t numBytes);
+void halSpiAbortTransfer();
+void halSrdyInterruptEnable(uint8_t edge);
+void halSrdyInterruptDisable();
+#define SRDY_EDGE_FALLING           0
+#define SRDY_EDGE_RISING            1
+
+// Only required if ZM_WAIT_FOR_EVENT is defined, see phyWaitForMessage() in zm_phy_spi.c
+void halWaitTimerStart(uint32_t ms);
+void halWaitTimerStop();
+uint8_t halWaitTimerExpired();
+void halWaitForEvent();
+
+int16_t calibrateVlo();
+int16_t initTimer(uint8_t seconds);
+void stopTimer();
+void halSetWakeupFlags(uint16_t wakeupFlagsToSet);
+void halClearWakeupFlags(uint16_t wakeupFlagsToClear);
+uint8_t buttonIsPressed(uint8_t button);
+void initSysTick(void);
+uint8_t halUartBusy();
+
+//
+//  SIMULATION
+//
+void halHostSetReset(uint8_t running);
+void halHostSetMrdy(uint8_t asserted);
+uint8_t halHostSrdy();
+void halHostInterruptsEnable();
+void halHostInterruptsDisable();
+uint8_t halHostInterruptsAreEnabled();
+void halHostSleep();
+void halHostWakeup();
+uint32_t halHostMicros();
+void halHostSetTiming(uint32_t srdyDelayUs, uint32_t srspDelayUs, uint32_t byteTimeUs);
+void halHostQueueAreq(const uint8_t* frame);
+
+// SysTick
+#define SYSTICK_INTERVAL_MS     8
+
+// Buttons
+#define ANY_BUTTON          0xFF
+#define BUTTON_0            0
+
+//
+// #defines
+//
+/* There are no interrupts on the host; the simulated Module runs in its own thread and calls the
+"ISRs" while holding a lock. Disabling interrupts takes the same lock. */
+#define HAL_SLEEP()                 (halHostSleep())
+#define HAL_WAKEUP()                (halHostWakeup())
+
+#define HAL_ENABLE_INTERRUPTS()     (halHostInterruptsEnable())
+#define HAL_DISABLE_INTERRUPTS()    (halHostInterruptsDisable())
+#define HAL_INTERRUPTS_ARE_ENABLED() (halHostInterruptsAreEnabled())
+
+/** Free-running microsecond counter, used to measure transaction latency */
+#define HAL_GET_MICROS()            (halHostMicros())
+/** Free-running timer, used for latency statistics; see zm_latency.c */
+#define HAL_TIMER_TICKS()           (halHostMicros())
+#define HAL_TIMER_TICKS_PER_US      1
+
+//
+//  MACROS REQUIRED FOR ZM
+//
+#define RADIO_ON()                  (halHostSetReset(1))  //ZM Reset Line
+#define RADIO_OFF()                 (halHostSetReset(0))
+
+//  Zigbee Module SPI
+#define SPI_SS_SET()                (halHostSetMrdy(1))   //control SS and MRDY
+#define SPI_SS_CLEAR()              (halHostSetMrdy(0))
+#define SRDY_IS_HIGH()              (halHostSrdy())
+#define SRDY_IS_LOW()               (!halHostSrdy())
+
+#define NO_WAKEUP                   0
+#define WAKEUP_AFTER_TIMER          1
+#define WAKEUP_AFTER_BUTTON         2
+#define WAKEUP_AFTER_SRDY           4
+#define WAKEUP_AFTER_WAIT_TIMER     8
+
+//
+//  MISC OTHER DEFINES
+//
+#define TICKS_PER_MS                1000
+#define GET_MCLK_FREQ()             (1000000L)
+
+#endif
@@ -17,6 +17,7 @@ SMCLK: 4MHz (see oscInit()), sources the following:
 - UART - see halUartInit()
 - SPI - see halSpiInitModule()
 - PWM for RGB LEDs
+- System timer (Timer A1) - see halTimerTicks()
 ACLK: Sourced by VLO, ~12kHz
 - Timer - see initTimer()
 
@@ -76,6 +77,16 @@ void (*srdyIsr)(void);
 /** Function pointer for the ISR called when a sysTick interrupt occurs */
 void (*sysTickIsr)(void);
 
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+/** Function pointer for the ISR called when a transfer started with halSpiStartTransfer() has finished */
+void (*spiTransferCompleteIsr)(void);
+
+/** The G2553 has no DMA controller, so halSpiStartTransfer() moves the bytes from the USCI_B0 RX 
+interrupt instead. These track the transfer in progress. */
+static uint8_t* volatile spiTransferBytes;
+static volatile uint8_t spiTransferBytesLeft = 0;
+#endif
+
 
 /** 
 Flags to indicate when to wake up the processor. These are read in the various ISRs. 
@@ -109,6 +120,21 @@ __interrupt void USCIAB0RX_ISR(void)
     {
         debugConsoleIsr(UCA0RXBUF);    //reading this register clears the interrupt flag
     }
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+    if ((IFG2 & UCB0RXIFG) && (IE2 & UCB0RXIE))     //module SPI byte received, see halSpiStartTransfer()
+    {
+        *spiTransferBytes++ = UCB0RXBUF;            //reading this register clears the interrupt flag
+        if (--spiTransferBytesLeft)
+        {
+            UCB0TXBUF = *spiTransferBytes;          //write-to-read: send the next byte
+        } else {
+            IE2 &= ~UCB0RXIE;
+            spiTransferCompleteIsr();
+            if (wakeupFlags & WAKEUP_AFTER_SRDY)    
+                HAL_WAKEUP();          
+        }
+    }
+#endif
 }
 
 
@@ -370,6 +396,221 @@ void spiWrite(uint8_t *bytes, uint8_t numBytes)
     }
 }
 
+/**
+Sends bytes to the Module over SPI. Same as spiWrite() but the bytes received are discarded, so the 
+buffer is not overwritten. Used to send a SREQ, since nothing is received while it is being sent.
+@param bytes the data to be sent.
+@param numBytes the number of bytes to be sent.
+@pre SPI port configured for the Module and Module has been initialized properly
+@see zm_phy_spi.c
+@note this function is not required if using the UART to communicate with the module
+*/
+void spiTransmit(const uint8_t *bytes, uint8_t numBytes)
+{
+    while (numBytes--)
+    {  
+        UCB0TXBUF = *bytes++;
+        while (!(IFG2 & UCB0RXIFG)) ;     //WAIT for the byte to be clocked out
+        (void) UCB0RXBUF;                 //discard the received byte; clears UCB0RXIFG
+    }
+}
+
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+/**
+Non-blocking version of spiWrite(). Starts the transfer and returns immediately; the remaining bytes 
+are moved by the USCI_B0 RX interrupt since this processor does not have a DMA controller.
+@param bytes the data to be sent or received. Must remain valid until the transfer has finished.
+@param numBytes the number of bytes to be sent. This same buffer will be overwritten with the received data.
+@pre SPI port configured for the Module and Module has been initialized properly
+@post when spiTransferCompleteIsr() is called, bytes contains received data, if any
+@see zm_phy_spi.c
+*/
+void halSpiStartTransfer(uint8_t *bytes, uint8_t numBytes)
+{
+    if (numBytes == 0)
+    {
+        spiTransferCompleteIsr();
+        return;
+    }
+    spiTransferBytes = bytes;
+    spiTransferBytesLeft = numBytes;
+    IFG2 &= ~UCB0RXIFG;
+    IE2 |= UCB0RXIE;
+    UCB0TXBUF = *bytes;
+}
+
+/** Stops a transfer started with halSpiStartTransfer(). spiTransferCompleteIsr() will not be called. */
+void halSpiAbortTransfer()
+{
+    IE2 &= ~UCB0RXIE;
+    spiTransferBytesLeft = 0;
+}
+
+/**
+Arms the SRDY interrupt; srdyIsr() will be called on the selected edge.
+@param edge SRDY_EDGE_FALLING or SRDY_EDGE_RISING
+*/
+void halSrdyInterruptEnable(uint8_t edge)
+{
+    if (edge == SRDY_EDGE_FALLING)
+        P2IES |= BIT2;                  // Interrupt on high-to-low transition
+    else
+        P2IES &= ~BIT2;                 // Interrupt on low-to-high transition
+    P2IFG &= ~BIT2;                     // Changing P2IES may set the interrupt flag
+    ENABLE_SRDY_INTERRUPT();
+}
+
+/** Disarms the SRDY interrupt */
+void halSrdyInterruptDisable()
+{
+    DISABLE_SRDY_INTERRUPT();
+    P2IFG &= ~BIT2;
+}
+#endif
+
+//
+//  System timer: Timer A1 runs continuously from SMCLK (4MHz) / 4 = 1MHz. Its counter, extended to 
+//  32 bits by counting overflows, is the free-running timer of halTimerTicks(), and its CCR0 is the 
+//  wait timer. The MSP430G2553 has only two timers and both drive the RGB LED, so once 
+//  halRgbLedPwmInit() has taken Timer A1 the time can only be estimated: each halTimerTicks() waits 
+//  SYSTEM_TIMER_FALLBACK_US and counts that much.
+//
+#define SYSTEM_TIMER_STOPPED            0
+#define SYSTEM_TIMER_RUNNING            1
+#define SYSTEM_TIMER_TAKEN              2       // by halRgbLedPwmInit()
+#define SYSTEM_TIMER_FALLBACK_US        10
+
+static volatile uint16_t systemTimerOverflows = 0;
+static uint8_t systemTimerState = SYSTEM_TIMER_STOPPED;
+static uint32_t systemTimerFallbackTicks = 0;
+
+/** Starts Timer A1 in continuous mode, if it isn't running yet. */
+static void systemTimerStart()
+{
+    if (systemTimerState == SYSTEM_TIMER_STOPPED)
+    {
+        TA1CCTL0 = 0;
+        TA1CTL = TASSEL_2 + ID_2 + MC_2 + TACLR + TAIE;   // SMCLK / 4, continuous mode, overflow interrupt
+        systemTimerState = SYSTEM_TIMER_RUNNING;
+    }
+}
+
+/**
+Reads the free-running timer, which counts up at 1MHz and wraps around every 2^32 ticks (71 
+minutes), so the time between two readings is simply their difference. Started on the first call.
+@note Uses Timer A1, see above for when the RGB PWM functions are used.
+@return the timer value, in ticks; HAL_TIMER_TICKS_PER_US per microsecond.
+*/
+uint32_t halTimerTicks()
+{
+    if (systemTimerState == SYSTEM_TIMER_TAKEN)
+    {
+        __delay_cycles(SYSTEM_TIMER_FALLBACK_US * TICKS_PER_US);
+        systemTimerFallbackTicks += SYSTEM_TIMER_FALLBACK_US * HAL_TIMER_TICKS_PER_US;
+        return systemTimerFallbackTicks;
+    }
+    systemTimerStart();
+    uint16_t interruptState = __get_interrupt_state();
+    HAL_DISABLE_INTERRUPTS();
+    uint16_t high = systemTimerOverflows;
+    uint16_t low = TA1R;
+    if ((TA1CTL & TAIFG) && (low < 0x8000))         // Overflowed, but the ISR hasn't counted it yet
+        high++;
+    __set_interrupt_state(interruptState);
+    return (((uint32_t) high) << 16) | low;
+}
+
+/** Timer A1 overflow interrupt service routine, extends the counter for halTimerTicks(). */
+#pragma vector=TIMER1_A1_VECTOR
+__interrupt void Timer_A1_Overflow(void)
+{
+    if (TA1IV == TA1IV_TAIFG)
+        systemTimerOverflows++;
+}
+
+#ifdef ZM_WAIT_FOR_EVENT
+//
+//  Wait timer, used to time out the event-driven waits. See phyWaitForMessage() in zm_phy_spi.c
+//
+/** CCR0 of the system timer, at 1MHz. Longer waits are made of several periods. */
+#define WAIT_TIMER_COUNTS_PER_MS        1000U
+#define WAIT_TIMER_MAX_PERIOD_MS        50
+
+static volatile uint32_t waitTimerMsLeft = 0;
+static volatile uint8_t waitTimerExpired = 1;
+
+/** Loads the next period of the wait timer, up to WAIT_TIMER_MAX_PERIOD_MS. */
+static void waitTimerNextPeriod()
+{
+    uint16_t ms = (waitTimerMsLeft > WAIT_TIMER_MAX_PERIOD_MS) ? WAIT_TIMER_MAX_PERIOD_MS : (uint16_t) waitTimerMsLeft;
+    waitTimerMsLeft -= ms;
+    TA1CCR0 += ms * WAIT_TIMER_COUNTS_PER_MS;
+}
+
+/**
+Starts the wait timer. When it expires halWaitTimerExpired() returns true and the processor is woken
+up from halWaitForEvent().
+@param ms how long until the timer expires, in milliseconds
+@note Uses CCR0 of Timer A1, the system timer, so cannot be used at the same time as the RGB PWM 
+functions.
+*/
+void halWaitTimerStart(uint32_t ms)
+{
+    systemTimerStart();
+    TA1CCTL0 = 0;
+    waitTimerMsLeft = (ms == 0) ? 1 : ms;
+    waitTimerExpired = 0;
+    TA1CCR0 = TA1R;
+    waitTimerNextPeriod();
+    TA1CCTL0 = CCIE;
+}
+
+/** Stops the wait timer. halWaitTimerExpired() will return true. */
+void halWaitTimerStop()
+{
+    TA1CCTL0 = 0;
+    waitTimerMsLeft = 0;
+    waitTimerExpired = 1;
+}
+
+/** @return true (1) if the wait timer has expired or was stopped, or 0 if it is running. */
+uint8_t halWaitTimerExpired()
+{
+    return waitTimerExpired;
+}
+
+/** Timer A1 CCR0 interrupt service routine, loads the next period of the wait timer or ends the wait. */
+#pragma vector=TIMER1_A0_VECTOR
+__interrupt void Timer_A1(void)
+{
+    if (waitTimerMsLeft)
+    {
+        waitTimerNextPeriod();
+    } else {
+        TA1CCTL0 = 0;
+        waitTimerExpired = 1;
+        if (wakeupFlags & WAKEUP_AFTER_WAIT_TIMER)    
+            HAL_WAKEUP();          
+    }
+}
+
+/** 
+Sleeps until an ISR wakes up the processor with WAKEUP_AFTER_SRDY or WAKEUP_AFTER_WAIT_TIMER: the 
+SRDY interrupt, the wait timer, or the Module serial port ISR.
+@pre interrupts are disabled, so that an event after the caller last checked can't be missed
+@post interrupts are disabled
+@note Sleeps in LPM0, not LPM3, since the wait timer runs from SMCLK.
+*/
+void halWaitForEvent()
+{
+    uint16_t savedWakeupFlags = wakeupFlags;
+    wakeupFlags |= (WAKEUP_AFTER_SRDY | WAKEUP_AFTER_WAIT_TIMER);
+    __bis_SR_register(LPM0_bits + GIE);             // Enables interrupts and sleeps in one instruction
+    HAL_DISABLE_INTERRUPTS();
+    wakeupFlags = savedWakeupFlags;
+}
+#endif
+
 /** 
 A fairly accurate blocking delay for waits in the millisecond range. Good for 1mSec to 1000mSec. 
 @note At 1MHz, error of zero for 100mSec or 1000mSec. For 10mSec, error of 100uSec. At 1mSec, error is 20uSec.
@@ -707,10 +948,13 @@ uint8_t halUartBusy()
 /**
 Initializes the PWM engine used for the RGB LED. This allows the RGB LED to display many colors.
 @post RGB LED may be used, with halRgbSetLeds().
-@note Uses SMCLK and Timer modules TA1 and TA0.
+@note Uses SMCLK and Timer modules TA1 and TA0. Takes Timer A1 from the system timer, see 
+halTimerTicks().
 */
 void halRgbLedPwmInit()
 {
+    systemTimerFallbackTicks = halTimerTicks();     // so that deadlines already started carry on
+    systemTimerState = SYSTEM_TIMER_TAKEN;
     P2SEL |= BIT1 | BIT5 | BIT6;    // Select Timer functionality
     P2DIR |= BIT1 | BIT5 | BIT6;    // Output
     P2SEL2 = 0;
@@ -17,6 +17,7 @@ SMCLK: 4MHz (see oscInit()), sources the following:
 - UART - see halUartInit()
 - SPI - see halSpiInitModule()
 - PWM for RGB LEDs
+- System timer (Timer A2) - see halTimerTicks()
 ACLK: Sourced by XT1, 32.768KHz
 - Timer - see initTimer()
 
@@ -76,6 +77,18 @@ void (*srdyIsr)(void);
 /** Function pointer for the ISR called when a sysTick interrupt occurs */
 void (*sysTickIsr)(void);
 
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+/** Function pointer for the ISR called when a transfer started with halSpiStartTransfer() has finished */
+void (*spiTransferCompleteIsr)(void);
+
+/** Which SRDY edge is armed with halSrdyInterruptEnable(). SRDY is on P4.1 which can't generate an
+interrupt, so the level is sampled by Timer B0 instead. */
+static volatile uint8_t srdyArmedEdge = SRDY_EDGE_FALLING;
+
+/** Timer B0 period used to sample SRDY: SMCLK (4MHz) / 256 = 64uSec */
+#define SRDY_SAMPLE_PERIOD_TICKS    256
+#endif
+
 
 /** 
 Flags to indicate when to wake up the processor. These are read in the various ISRs. 
@@ -534,6 +547,248 @@ void spiWrite(uint8_t *bytes, uint8_t numBytes)
     }
 }
 
+/**
+Sends bytes to the Module over SPI. Same as spiWrite() but the bytes received are discarded, so the 
+buffer is not overwritten. Used to send a SREQ, since nothing is received while it is being sent.
+@param bytes the data to be sent.
+@param numBytes the number of bytes to be sent.
+@pre SPI port configured for the Module and Module has been initialized properly
+@see zm_phy_spi.c
+@note this function is not required if using the UART to communicate with the module
+*/
+void spiTransmit(const uint8_t *bytes, uint8_t numBytes)
+{
+    while (numBytes--)
+    {  
+        UCB0TXBUF = *bytes++;
+        while (!(UCRXIFG & UCB0IFG));     //WAIT for the byte to be clocked out
+        (void) UCB0RXBUF;                 //discard the received byte; clears UCRXIFG
+    }
+}
+
+#if defined(ZM_PHY_SPI_ASYNC) || defined(ZM_WAIT_FOR_EVENT)
+/**
+Non-blocking version of spiWrite(). Starts the transfer and returns immediately; the bytes are moved 
+by DMA. Channel 0 reads UCB0RXBUF into the buffer and interrupts when the last byte was received. 
+Channel 1 writes the buffer into UCB0TXBUF. Since each byte is received after it was sent the same 
+buffer may be used for both.
+@param bytes the data to be sent or received. Must remain valid until the transfer has finished.
+@param numBytes the number of bytes to be sent. This same buffer will be overwritten with the received data.
+@pre SPI port configured for the Module and Module has been initialized properly
+@post when spiTransferCompleteIsr() is called, bytes contains received data, if any
+@see zm_phy_spi.c
+*/
+void halSpiStartTransfer(uint8_t *bytes, uint8_t numBytes)
+{
+    if (numBytes == 0)
+    {
+        spiTransferCompleteIsr();
+        return;
+    }
+    DMACTL0 = DMA0TSEL_18 | DMA1TSEL_19;            // Channel 0 = USCI_B0 RX, Channel 1 = USCI_B0 TX
+    (void) UCB0RXBUF;                               // Discard any stale byte so the RX trigger is an edge
+    UCB0IFG &= ~UCRXIFG;
+    
+    __data16_write_addr((unsigned short) &DMA0SA, (unsigned long) &UCB0RXBUF);
+    __data16_write_addr((unsigned short) &DMA0DA, (unsigned long) bytes);
+    DMA0SZ = numBytes;
+    DMA0CTL = DMADT_0 | DMADSTINCR_3 | DMASRCINCR_0 | DMADSTBYTE | DMASRCBYTE | DMAIE | DMAEN;
+    
+    if (numBytes > 1)
+    {
+        __data16_write_addr((unsigned short) &DMA1SA, (unsigned long) (bytes + 1));
+        __data16_write_addr((unsigned short) &DMA1DA, (unsigned long) &UCB0TXBUF);
+        DMA1SZ = numBytes - 1;
+        DMA1CTL = DMADT_0 | DMADSTINCR_0 | DMASRCINCR_3 | DMADSTBYTE | DMASRCBYTE | DMAEN;
+    }
+    UCB0TXBUF = *bytes;                             // The first byte starts the transfer; TXIFG then triggers channel 1
+}
+
+/** Stops a transfer started with halSpiStartTransfer(). spiTransferCompleteIsr() will not be called. */
+void halSpiAbortTransfer()
+{
+    DMA0CTL = 0;
+    DMA1CTL = 0;
+}
+
+/**
+Arms the SRDY "interrupt"; srdyIsr() will be called when SRDY is at the level of the selected edge.
+@param edge SRDY_EDGE_FALLING or SRDY_EDGE_RISING
+@note SRDY is on P4.1, which is not interrupt capable, so Timer B0 samples it every 64uSec while armed.
+*/
+void halSrdyInterruptEnable(uint8_t edge)
+{
+    srdyArmedEdge = edge;
+    TB0CCR0 = SRDY_SAMPLE_PERIOD_TICKS - 1;
+    TB0CCTL0 = CCIE;
+    TB0CTL = TBSSEL_2 | MC_1 | TBCLR;               // SMCLK, up mode
+}
+
+/** Disarms the SRDY interrupt */
+void halSrdyInterruptDisable()
+{
+    TB0CTL = MC_0;
+    TB0CCTL0 = 0;
+}
+
+/** DMA interrupt service routine, called when channel 0 has received the last byte of a transfer. */
+#pragma vector=DMA_VECTOR
+__interrupt void DMA_ISR(void)
+{
+    switch (__even_in_range(DMAIV, 16))
+    {
+    case DMAIV_DMA0IFG:
+        spiTransferCompleteIsr();
+        if (wakeupFlags & WAKEUP_AFTER_SRDY)    
+            HAL_WAKEUP();          
+        break;
+    default: 
+        break;
+    }
+}
+
+/** Timer B0 interrupt service routine, samples SRDY while it is armed with halSrdyInterruptEnable(). */
+#pragma vector=TIMER0_B0_VECTOR
+__interrupt void TIMER0_B0_ISR(void)
+{
+    if ((srdyArmedEdge == SRDY_EDGE_FALLING) ? SRDY_IS_LOW() : SRDY_IS_HIGH())
+    {
+        halSrdyInterruptDisable();
+        srdyIsr();
+        if (wakeupFlags & WAKEUP_AFTER_SRDY)    
+            HAL_WAKEUP();          
+    }
+}
+#endif
+
+//
+//  System timer: Timer A2 runs continuously from SMCLK (4MHz) / 4 = 1MHz. Its counter, extended to 
+//  32 bits by counting overflows, is the free-running timer of halTimerTicks(), and its CCR0 is the 
+//  wait timer.
+//
+static volatile uint16_t systemTimerOverflows = 0;
+static uint8_t systemTimerStarted = 0;
+
+/** Starts Timer A2 in continuous mode, if it isn't running yet. */
+static void systemTimerStart()
+{
+    if (!systemTimerStarted)
+    {
+        TA2CCTL0 = 0;
+        TA2CTL = TASSEL_2 + ID_2 + MC_2 + TACLR + TAIE;   // SMCLK / 4, continuous mode, overflow interrupt
+        systemTimerStarted = 1;
+    }
+}
+
+/**
+Reads the free-running timer, which counts up at 1MHz and wraps around every 2^32 ticks (71 
+minutes), so the time between two readings is simply their difference. Started on the first call.
+@note Uses Timer A2.
+@return the timer value, in ticks; HAL_TIMER_TICKS_PER_US per microsecond.
+*/
+uint32_t halTimerTicks()
+{
+    systemTimerStart();
+    uint16_t interruptState = __get_interrupt_state();
+    HAL_DISABLE_INTERRUPTS();
+    uint16_t high = systemTimerOverflows;
+    uint16_t low = TA2R;
+    if ((TA2CTL & TAIFG) && (low < 0x8000))         // Overflowed, but the ISR hasn't counted it yet
+        high++;
+    __set_interrupt_state(interruptState);
+    return (((uint32_t) high) << 16) | low;
+}
+
+/** Timer A2 overflow interrupt service routine, extends the counter for halTimerTicks(). */
+#pragma vector=TIMER2_A1_VECTOR
+__interrupt void Timer_A2_Overflow(void)
+{
+    if (TA2IV == TA2IV_TAIFG)
+        systemTimerOverflows++;
+}
+
+#ifdef ZM_WAIT_FOR_EVENT
+//
+//  Wait timer, used to time out the event-driven waits. See phyWaitForMessage() in zm_phy_spi.c
+//
+/** CCR0 of the system timer, at 1MHz. Longer waits are made of several periods. */
+#define WAIT_TIMER_COUNTS_PER_MS        1000U
+#define WAIT_TIMER_MAX_PERIOD_MS        50
+
+static volatile uint32_t waitTimerMsLeft = 0;
+static volatile uint8_t waitTimerExpired = 1;
+
+/** Loads the next period of the wait timer, up to WAIT_TIMER_MAX_PERIOD_MS. */
+static void waitTimerNextPeriod()
+{
+    uint16_t ms = (waitTimerMsLeft > WAIT_TIMER_MAX_PERIOD_MS) ? WAIT_TIMER_MAX_PERIOD_MS : (uint16_t) waitTimerMsLeft;
+    waitTimerMsLeft -= ms;
+    TA2CCR0 += ms * WAIT_TIMER_COUNTS_PER_MS;
+}
+
+/**
+Starts the wait timer. When it expires halWaitTimerExpired() returns true and the processor is woken
+up from halWaitForEvent().
+@param ms how long until the timer expires, in milliseconds
+@note Uses CCR0 of Timer A2, the system timer.
+*/
+void halWaitTimerStart(uint32_t ms)
+{
+    systemTimerStart();
+    TA2CCTL0 = 0;
+    waitTimerMsLeft = (ms == 0) ? 1 : ms;
+    waitTimerExpired = 0;
+    TA2CCR0 = TA2R;
+    waitTimerNextPeriod();
+    TA2CCTL0 = CCIE;
+}
+
+/** Stops the wait timer. halWaitTimerExpired() will return true. */
+void halWaitTimerStop()
+{
+    TA2CCTL0 = 0;
+    waitTimerMsLeft = 0;
+    waitTimerExpired = 1;
+}
+
+/** @return true (1) if the wait timer has expired or was stopped, or 0 if it is running. */
+uint8_t halWaitTimerExpired()
+{
+    return waitTimerExpired;
+}
+
+/** Timer A2 CCR0 interrupt service routine, loads the next period of the wait timer or ends the wait. */
+#pragma vector=TIMER2_A0_VECTOR
+__interrupt void Timer_A2(void)
+{
+    if (waitTimerMsLeft)
+    {
+        waitTimerNextPeriod();
+    } else {
+        TA2CCTL0 = 0;
+        waitTimerExpired = 1;
+        if (wakeupFlags & WAKEUP_AFTER_WAIT_TIMER)    
+            HAL_WAKEUP();          
+    }
+}
+
+/** 
+Sleeps until an ISR wakes up the processor with WAKEUP_AFTER_SRDY or WAKEUP_AFTER_WAIT_TIMER: the 
+SRDY interrupt, the wait timer, or the Module serial port ISR.
+@pre interrupts are disabled, so that an event after the caller last checked can't be missed
+@post interrupts are disabled
+@note Sleeps in LPM0, not LPM3, since the wait timer and the SRDY sampling timer run from SMCLK.
+*/
+void halWaitForEvent()
+{
+    uint16_t savedWakeupFlags = wakeupFlags;
+    wakeupFlags |= (WAKEUP_AFTER_SRDY | WAKEUP_AFTER_WAIT_TIMER);
+    __bis_SR_register(LPM0_bits + GIE);             // Enables interrupts and sleeps in one instruction
+    HAL_DISABLE_INTERRUPTS();
+    wakeupFlags = savedWakeupFlags;
+}
+#endif
+
 /** 
 A fairly accurate blocking delay for waits in the millisecond range. Good for 1mSec to 1000mSec. 
 @note At 1MHz, error of zero for 100mSec or 1000mSec. For 10mSec, error of 100uSec. At 1mSec, error is 20uSec.
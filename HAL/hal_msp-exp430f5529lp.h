@@ -64,6 +64,28 @@ void clearLeds();
 
 void halSpiInitModule();
 void spiWrite(uint8_t *bytes, uint8_t numBytes);
+void spiTransmit(const uint8_t *bytes, uint8_t numBytes);
+
+// Only required if ZM_PHY_SPI_ASYNC is defined, see zm_phy_spi.c. The SRDY interrupt is also used
+// if ZM_WAIT_FOR_EVENT is defined.
+void halSpiStartTransfer(uint8_t *bytes, uint8_t numBytes);
+void halSpiAbortTransfer();
+void halSrdyInterruptEnable(uint8_t edge);
+void halSrdyInterruptDisable();
+#define SRDY_EDGE_FALLING           0
+#define SRDY_EDGE_RISING            1
+
+// Only required if ZM_WAIT_FOR_EVENT is defined, see phyWaitForMessage() in zm_phy_spi.c
+void halWaitTimerStart(uint32_t ms);
+void halWaitTimerStop();
+uint8_t halWaitTimerExpired();
+void halWaitForEvent();
+
+// Free-running timer, used for deadlines (zm_deadline.c) and latency statistics (zm_latency.c)
+uint32_t halTimerTicks();
+#define HAL_TIMER_TICKS()           (halTimerTicks())
+#define HAL_TIMER_TICKS_PER_US      1           // Timer A2 runs at SMCLK / 4 = 1MHz
+
 uint16_t calibrateVlo();
 int16_t initTimer(uint8_t seconds);
 void halSetWakeupFlags(uint16_t wakeupFlagsToSet);
@@ -111,6 +133,7 @@ uint16_t getCurrentSensor();
 
 #define HAL_ENABLE_INTERRUPTS()         (_EINT())
 #define HAL_DISABLE_INTERRUPTS()        (_DINT())
+#define HAL_INTERRUPTS_ARE_ENABLED()    (__get_SR_register() & GIE)
 
 //
 //  MACROS REQUIRED FOR ZM
@@ -129,6 +152,7 @@ uint16_t getCurrentSensor();
 #define WAKEUP_AFTER_TIMER          1
 #define WAKEUP_AFTER_BUTTON         2
 #define WAKEUP_AFTER_SRDY           4
+#define WAKEUP_AFTER_WAIT_TIMER     8
 
 //
 //  MISC OTHER DEFINES
@@ -63,6 +63,7 @@
 #include "../ZM/zdo.h"
 #include "module_example_utils.h"
 #include "../ZM/zm_phy_spi.h"
+#include "../ZM/zm_frame.h"
 
 /** function pointer (in hal file) for the function that gets called when a button is pressed*/
 extern void (*buttonIsr)(int8_t);
@@ -93,7 +94,6 @@ enum count_state{
 	TEMP_COUNT = 0,
 	NOM_COUNT
 };
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
 /** The number of failed messages before initiating a network restart */
 uint8_t failCount = 0;
 #define MAX_FAILED_MESSAGES_BEFORE_RESTART  2
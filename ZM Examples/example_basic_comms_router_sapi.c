@@ -52,10 +52,9 @@
 #include "../ZM/module_errors.h"
 #include "../ZM/simple_api.h"
 #include "../ZM/zm_phy_spi.h"
+#include "../ZM/zm_frame.h"
 #include "module_example_utils.h"  
 
-extern unsigned char zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 /** Used to store return value from module operations */
 moduleResult_t result;  
 
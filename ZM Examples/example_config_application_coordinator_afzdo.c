@@ -48,6 +48,7 @@
 #include "../ZM/zm_phy_spi.h"
 #include "../ZM/module_errors.h"
 #include "../ZM/module_utilities.h"
+#include "../ZM/zm_frame.h"
 #include "../Common/utilities.h"
 #include "Messages/infoMessage.h"
 #include "Messages/configRequestMessage.h"
@@ -126,8 +127,6 @@ volatile uint32_t timestamp = 0;//0xDEADBEEF;
 /** Number of mS since last sysTick */
 volatile uint16_t sysTickMilliseconds = 0;
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 //uncomment below to see more information about the messages received.
 //#define VERBOSE_MESSAGE_DISPLAY
 
@@ -48,22 +48,17 @@
 #include "../ZM/module_errors.h"
 #include "../ZM/module_utilities.h"
 #include "../ZM/zm_phy_spi.h"
+#include "../ZM/zm_frame.h"
 #include "../Common/utilities.h"
 #include <string.h>
 #include "module_example_utils.h"
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
-/* Use a smaller message size if we're compiling for Launchpad. Launchpad cannot handle a full 600B 
- message because the MSP430F2553 only has 512B of RAM. The other platforms (Stellaris, MDB1, etc.)
- use processors with more RAM and can support a longer message. */
-#ifdef LAUNCHPAD
-#define MESSAGE_LENGTH     130
-#else
+/* The message is displayed as it is retrieved from the Module, so no buffer is needed for it and 
+even LaunchPad, whose MSP430G2553 only has 512B of RAM, can receive a full 600B message. */
 #define MESSAGE_LENGTH     AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH
-#endif
 
-uint8_t totalMessage[MESSAGE_LENGTH];  //for extended messages
+/** Displays each part of an extended message as it is retrieved */
+moduleResult_t displayMessageChunk(uint16_t index, const uint8_t* data, uint8_t length);
 
 moduleResult_t result;
 
@@ -120,19 +115,15 @@ int main( void )
                  Must use helper method to get the full payload. */
                         printf(" Retrieving extended message contents\r\n");
                         /* Use our very cool utility method to fetch the entire payload from the module
-                     and copy it into the totalMessage buffer. This makes multiple calls to the module */
-                        moduleResult_t result = retrieveExtendedMessage(zmBuf + AF_INCOMING_MESSAGE_EXT_TIMESTAMP_START_FIELD, len, totalMessage);
-                        if (result == MODULE_SUCCESS)
-                            printHexBytes(totalMessage, len);
-                        else
-                            printf("retrieveExtendedMessage error %02X\r\n");
+                     and display each part as it arrives. This makes multiple calls to the module */
+                        moduleResult_t result = retrieveExtendedMessageStream(zmBuf + AF_INCOMING_MESSAGE_EXT_TIMESTAMP_START_FIELD, len, &displayMessageChunk);
+                        if (result != MODULE_SUCCESS)
+                            printf("retrieveExtendedMessage error %02X\r\n", result);
 
                     } else {
                         /* One message holds the entire message payload so we can get contents directly */
                         printf(" All in one message\r\n");
-                        memcpy(totalMessage, zmBuf+AF_INCOMING_MESSAGE_EXT_PAYLOAD_START_FIELD, len);
-                        /* totalMessage holds entire message now */
-                        printHexBytes(totalMessage, len);
+                        printHexBytes(zmBuf+AF_INCOMING_MESSAGE_EXT_PAYLOAD_START_FIELD, len);
                     }
                 }
             }
@@ -141,5 +132,12 @@ int main( void )
     }
 }
 
+/** Displays each part of an extended message as it is retrieved */
+moduleResult_t displayMessageChunk(uint16_t index, const uint8_t* data, uint8_t length)
+{
+    printf("%u: ", index);
+    printHexBytes((uint8_t*) data, length);
+    return MODULE_SUCCESS;
+}
 
 /* @} */
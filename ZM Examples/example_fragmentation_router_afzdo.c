@@ -60,18 +60,12 @@ void handleButtonPress(int8_t);
 
 moduleResult_t result;
 
-/* Use a smaller message size if we're compiling for Launchpad. Launchpad cannot handle a full 600B 
- message because the MSP430F2553 only has 512B of RAM. The other platforms (Stellaris, MDB1, etc.)
- use processors with more RAM and can support a longer message. */
-#ifdef LAUNCHPAD
-#define MESSAGE_LENGTH     130
-#else
+/* The message is generated as it is sent, so no buffer is needed for it and even LaunchPad, whose 
+MSP430G2553 only has 512B of RAM, can send a full 600B message. */
 #define MESSAGE_LENGTH     AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH
-#endif
-
-/* Buffer to contain the message that we wish to send */
-uint8_t testMessage[MESSAGE_LENGTH];    // Note: this causes a faultISR if declared in main application body
 
+/** Generates each part of the message as it is sent */
+moduleResult_t generateMessageChunk(uint16_t index, uint8_t* destination, uint8_t length);
 
 int main( void )
 {
@@ -103,20 +97,15 @@ int main( void )
     /* Now the network is running - send a message to the coordinator every few seconds.*/
 #define TEST_CLUSTER 0x77    
 
-    /* Fill test message buffer with an incrementing counter */
-    int i = 0;
-    for (i=0; i<MESSAGE_LENGTH; i++)
-    {
-    	testMessage[i] = i;
-    }
-    printf("Sending the following message:\r\n");
-
     uint8_t counter = 0;
     while (1)
     {       
         printf("Sending Message #%u L%u to Short Address 0x0000 (Coordinator) ", counter++, MESSAGE_LENGTH);
-        /* Send an extended length message to a short address */
-        moduleResult_t result = afSendDataExtendedShort(DEFAULT_ENDPOINT, DEFAULT_ENDPOINT, 0, TEST_CLUSTER, testMessage, MESSAGE_LENGTH);  //a short message - coordinator will receive an AF_INCOMING_MSG_EXT
+        /* Send an extended length message to a short address. The message is an incrementing 
+        counter, written straight into the messages to the Module by generateMessageChunk(). */
+        uint8_t address[8] = {0};   // Short address 0x0000 (Coordinator), LSB first
+        moduleResult_t result = afSendDataExtendedStream(DEFAULT_ENDPOINT, DEFAULT_ENDPOINT, address, DESTINATION_ADDRESS_MODE_SHORT, 
+                                                         TEST_CLUSTER, &generateMessageChunk, MESSAGE_LENGTH);  //coordinator will receive an AF_INCOMING_MSG_EXT
         if (result == MODULE_SUCCESS)
         {
             printf("Success\r\n");
@@ -134,6 +123,16 @@ int main( void )
     }   
 }
 
+/** Generates each part of the message as it is sent: an incrementing counter */
+moduleResult_t generateMessageChunk(uint16_t index, uint8_t* destination, uint8_t length)
+{
+    uint8_t i;
+    for (i = 0; i < length; i++)
+    {
+        destination[i] = (uint8_t) (index + i);
+    }
+    return MODULE_SUCCESS;
+}
 
 /** When a button is pressed, display device information */
 void handleButtonPress(int8_t btn)
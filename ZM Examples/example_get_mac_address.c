@@ -56,12 +56,11 @@
 #include "../Common/utilities.h"
 #include "../ZM/module_errors.h"
 #include "../ZM/zm_phy.h"
+#include "../ZM/zm_frame.h"
 #include <stdint.h>
 
 moduleResult_t result = MODULE_SUCCESS;
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 int main( void )
 {
     halInit();
@@ -42,13 +42,12 @@
 #include "../ZM/module.h"
 #include "../ZM/module_errors.h"
 #include "../ZM/zm_phy_spi.h"
+#include "../ZM/zm_frame.h"
 #include "../Common/utilities.h"
 #include <stdint.h>
 
 moduleResult_t result = MODULE_SUCCESS;
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 int main( void )
 {
     halInit();
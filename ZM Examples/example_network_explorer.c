@@ -50,6 +50,7 @@
 #include "../ZM/zm_phy_spi.h"
 #include "../ZM/module_errors.h"
 #include "../ZM/module_utilities.h"
+#include "../ZM/zm_frame.h"
 #include "../Common/utilities.h"
 #include "module_example_utils.h"
 #include "set.h"
@@ -116,8 +117,6 @@ enum STATE pendingState = STATE_IDLE;
 /** Various flags between states */
 uint16_t stateFlags = 0;
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 /** Which device type to use to start the module. This can be changed via CLI. */
 uint8_t zigbeeDeviceType = ROUTER;
 
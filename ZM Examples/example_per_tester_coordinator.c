@@ -47,6 +47,7 @@
 #include "../ZM/zm_phy.h"
 #include "../ZM/module_errors.h"
 #include "../ZM/module_utilities.h"
+#include "../ZM/zm_frame.h"
 #include "../Common/utilities.h"
 #include "module_example_utils.h"
 #include <stdint.h>
@@ -54,8 +55,6 @@
 /** This will hold the result of various module functions. Define once here so we can reuse. */
 moduleResult_t result;
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 uint16_t packetCounter = 0;
 
 void waitForPackets();
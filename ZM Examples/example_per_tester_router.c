@@ -48,9 +48,9 @@
 #include "../ZM/af.h"
 #include "../ZM/zdo.h"
 #include "../ZM/zm_phy.h"
+#include "../ZM/zm_frame.h"
 #include "../Common/utilities.h"
 #include "module_example_utils.h"
-#include <string.h>                 //for memcpy()
 
 /** function pointer (in hal file) for the function that gets called when a button is pressed*/
 extern void (*buttonIsr)(int8_t);
@@ -63,19 +63,16 @@ void handleButtonPress(int8_t whichButton);
 
 uint8_t counter = 0;
 
-/* Note: TEST_MESSAGE_PAYLOAD_LENGTH + MESSAGE_HEADER_LENGTH must be less than length of zmBuf */
+/* Note: must not be more than MAXIMUM_PAYLOAD_LENGTH */
 #define TEST_MESSAGE_PAYLOAD_LENGTH     10  
 
-/* The message that will be sent each time */
-//uint8_t testMessage[];   
-
 #define NUMBER_OF_PACKETS_TO_SEND 1000    
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
+/** The number of messages that were not delivered */
+uint16_t failCount = 0;
 
-/** The number of failed messages before initiating a network restart */
-uint8_t failCount = 0;
-#define MAX_FAILED_MESSAGES_BEFORE_RESTART  2
+/** Called with the AF_DATA_CONFIRM status of each message */
+void handleDataConfirm(requestToken_t token, moduleResult_t status);
 
 int main( void )
 {
@@ -121,65 +118,33 @@ int main( void )
     /* Now the network is running - send messages to the Coordinator.*/    
 #define TEST_CLUSTER 0x77
     
-#define MESSAGE_HEADER_LENGTH    13
-#define MESSAGE_LENGTH  (TEST_MESSAGE_PAYLOAD_LENGTH + MESSAGE_HEADER_LENGTH)
-    /* Here we precompute zmBuf contents so that we don't have to do it in the loop. This is faster.
-    This is the equivalent of afSendData(DEFAULT_ENDPOINT,DEFAULT_ENDPOINT,0, TEST_CLUSTER, testMessage, 10); */
-    uint8_t testBuf[MESSAGE_LENGTH];
-    testBuf[0] = MESSAGE_LENGTH;
-    testBuf[1] = MSB(AF_DATA_REQUEST);
-    testBuf[2] = LSB(AF_DATA_REQUEST);      
-    
-    testBuf[3] = 0; 
-    testBuf[4] = 0;
-    testBuf[5] = DEFAULT_ENDPOINT;
-    testBuf[6] = DEFAULT_ENDPOINT;
-    testBuf[7] = LSB(TEST_CLUSTER); 
-    testBuf[8] = MSB(TEST_CLUSTER); 
-    testBuf[9] = 0xFF;  // Sequence: we don't care
-    testBuf[10] = AF_MAC_ACK; //Could also use AF_APS_ACK;
-    testBuf[11] = DEFAULT_RADIUS;
-    testBuf[12] = TEST_MESSAGE_PAYLOAD_LENGTH; // Datalength
-    //memcpy(testBuf+MESSAGE_HEADER_LENGTH, testMessage, TEST_MESSAGE_PAYLOAD_LENGTH);
-    //testBuf is now loaded with our test message.        
+    /* The message that will be sent each time */
+    uint8_t testMessage[TEST_MESSAGE_PAYLOAD_LENGTH];
+    uint8_t index;
+    for (index = 0; index < TEST_MESSAGE_PAYLOAD_LENGTH; index++)
+    {
+        testMessage[index] = index;
+    }
     
     printf("!!  Sending %u messages  !!\r\n", NUMBER_OF_PACKETS_TO_SEND);    
     
     while (1)
     {
     	uint16_t packetCounter;
+        failCount = 0;
         for (packetCounter = 0; packetCounter<NUMBER_OF_PACKETS_TO_SEND; packetCounter++)
         {
-            /* Copy our message over to zmBuf because zmBuf gets overwritten when the AF_DATA_CONFIRM is received */
-            memcpy(zmBuf, testBuf, MESSAGE_LENGTH);
-            
-            /* Now initialize the payload */
-            int index;
-            for (index = MESSAGE_HEADER_LENGTH; index < (TEST_MESSAGE_PAYLOAD_LENGTH + MESSAGE_HEADER_LENGTH); index++)
-            {
-                testBuf[index] = index;
-            }
-
-            /* Send the message to the Coordinator */
-            result = sendMessage();       
+            /* Send the message to the Coordinator. Up to AF_SEND_WINDOW messages are in flight at 
+            once; this only waits for an AF_DATA_CONFIRM when the window is full. The result of each
+            message is reported to handleDataConfirm(). */
+            result = afSendDataWindowed(DEFAULT_ENDPOINT, DEFAULT_ENDPOINT, 0, TEST_CLUSTER, 
+                                        testMessage, TEST_MESSAGE_PAYLOAD_LENGTH, &handleDataConfirm);
             if (result != MODULE_SUCCESS)
             {
                 printf("afSendData Error %02X; stopping\r\n", result);
                 while (1);
             }        
             
-            /* Now, wait for the AF_DATA_CONFIRM to verify that the message was successfully sent*/
-            while (!(MODULE_HAS_MESSAGE_WAITING()));
-            
-            /* Retrieve the AF_DATA_CONFIRM message */
-            getMessage();
-            
-            if (!(IS_AF_DATA_CONFIRM())) 
-            {
-                /* Stop if we receive a different message */
-                printf("Error; stopped after packet %u", packetCounter);
-            }        
-            
             toggleLed(1); 
             /* If you want to slow down the rate of sending packets then add:
             delayMs(1);
@@ -190,6 +155,14 @@ int main( void )
                 printf("%u\r\n", packetCounter);
             }
         }
+        /* Wait for the AF_DATA_CONFIRMs of the last messages */
+        afWindowFlush();
+        if (failCount > 0)
+        {
+            printf("%u packets failed\r\n", failCount);
+        }
+        /* Messages received while sending were parked; we're not interested in them */
+        frameDiscardParked();
         printf("Done! Sent %u packets!\r\nPress button to start again\r\n", NUMBER_OF_PACKETS_TO_SEND);        
         
         /* Wait until a button is pressed, then send another 1000 */
@@ -197,6 +170,16 @@ int main( void )
     }
 }
 
+/** Counts the messages that were not delivered */
+void handleDataConfirm(requestToken_t token, moduleResult_t status)
+{
+    (void) token;                   //only the result is counted
+    if (status != MODULE_SUCCESS)
+    {
+        failCount++;
+    }
+}
+
 /** When a button is pressed, display device information */
 void handleButtonPress(int8_t whichButton)
 {
@@ -48,10 +48,9 @@
 #include "../ZM/module.h"
 #include "../ZM/module_errors.h"
 #include "../ZM/zm_phy_spi.h"
+#include "../ZM/zm_frame.h"
 #include <stdint.h>
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 int main( void )
 {
     halInit();
@@ -43,10 +43,9 @@
 #include "../ZM/module.h"
 #include "../ZM/module_errors.h"
 #include "../ZM/zm_phy_spi.h"
+#include "../ZM/zm_frame.h"
 #include <stdint.h>
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 
 moduleResult_t result = MODULE_SUCCESS;
 
@@ -55,10 +55,9 @@
 #include "../ZM/module.h"
 #include "../ZM/module_errors.h"
 #include "../ZM/zm_phy_spi.h"
+#include "../ZM/zm_frame.h"
 #include <stdint.h>
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 #define NO_CHARACTER_RECEIVED 0xFF
 
 /** Which RF Test Mode we're in. Will be changed by the commands. 
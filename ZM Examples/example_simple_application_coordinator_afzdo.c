@@ -47,6 +47,7 @@
 #include "../ZM/zm_phy_spi.h"
 #include "../ZM/module_errors.h"
 #include "../ZM/module_utilities.h"
+#include "../ZM/zm_frame.h"
 #include "../Common/utilities.h"
 #include "Messages/infoMessage.h"
 #include "Messages/kvp.h"
@@ -99,8 +100,6 @@ uint8_t zigbeeNetworkStatus = NWK_OFFLINE;
 /* What to display on the RGB LED */
 uint8_t rgbLedDisplayMode = 0;
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 //uncomment below to see more information about the messages received.
 //#define VERBOSE_MESSAGE_DISPLAY
 
@@ -280,6 +279,10 @@ void stateMachine()
 void parseMessages()
 {
     getMessage();
+#ifdef AF_COMPRESSION
+    if (afDecompressMessage() != MODULE_SUCCESS)    // Restore the payload if the sender compressed it
+        return;
+#endif
     if ((zmBuf[SRSP_LENGTH_FIELD] > 0) && (IS_AF_INCOMING_MESSAGE()))
     {
         setLed(0);                                  //LED will blink to indicate a message was received
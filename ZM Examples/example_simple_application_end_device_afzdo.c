@@ -49,6 +49,7 @@
 #include "../ZM/module_errors.h"
 #include "../ZM/module_utilities.h"
 #include "../ZM/zm_phy.h"
+#include "../ZM/zm_frame.h"
 #include "../Common/utilities.h"
 #include "Messages/infoMessage.h"
 #include "Messages/kvp.h"
@@ -57,8 +58,6 @@
 #include <stdint.h>
 #include <string.h>  
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 uint16_t sequenceNumber = 0;  //an application-level sequence number to track acknowledgements from server
 
 /** function pointer (in hal file) for the function that gets called when the timer generates an int*/
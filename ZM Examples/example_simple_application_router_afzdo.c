@@ -72,6 +72,7 @@
 #include "../ZM/module_errors.h"
 #include "../ZM/module_utilities.h"
 #include "../ZM/zm_phy.h"
+#include "../ZM/zm_frame.h"
 #include "../Common/utilities.h"
 #include "Messages/infoMessage.h"
 #include "Messages/kvp.h"
@@ -80,8 +81,6 @@
 #include <stdint.h>
 #include <string.h>  
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 /* An application-level sequence number to track acknowledgements from server */
 uint16_t sequenceNumber = 0;  
 
@@ -0,0 +1,143 @@
+/**
+ * @ingroup moduleInterface
+ * @{
+ *
+ * @file example_spi_async_latency.c
+ *
+ * @brief Resets Radio, then measures how long a SYS_VERSION SREQ/SRSP exchange takes, first with 
+ * the blocking sendMessage() and then with the interrupt/DMA driven sendMessageAsync().
+ *
+ * While the asynchronous transaction is in flight the processor is free; here it just counts how many
+ * times it went around the loop, to show how much of the exchange the CPU gets back.
+ *
+ * Requires ZM_PHY_SPI and ZM_PHY_SPI_ASYNC to be defined, and a hal file that defines HAL_GET_MICROS(),
+ * e.g. LINUX_HOST (hal_host.c) which runs against a simulated Module.
+ *
+ * @section support Support
+ * Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+ * is available via email at the following addresses:
+ * - Questions on how to use the product: AIR@anaren.com
+ * - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+ * - Consulting engagements: sales@teslacontrols.com
+ *
+ * @section license License
+ * Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+ * Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+ * source and binary forms, with or without modification, are subject to the Software License 
+ * Agreement in the file "anaren_eula.txt"
+ * 
+ * YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+ * WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+ * WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+ * EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+ * STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+ * INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+ * PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+ * GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+ * DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+ */
+
+#include "../HAL/hal.h"
+#include "../ZM/module.h"
+#include "../ZM/module_errors.h"
+#include "../ZM/module_commands.h"
+#include "../ZM/zm_phy.h"
+#include "../ZM/zm_frame.h"
+#include "../Common/utilities.h"
+#include <stdint.h>
+
+#if !defined ZM_PHY_SPI_ASYNC || !defined HAL_GET_MICROS
+#error "This example requires ZM_PHY_SPI_ASYNC and a hal file with HAL_GET_MICROS(), e.g. LINUX_HOST"
+#endif
+
+#define NUMBER_OF_TRANSACTIONS  100
+
+/** Set by handleTransactionComplete() */
+static volatile uint8_t transactionComplete = 0;
+static volatile moduleResult_t transactionResult = MODULE_SUCCESS;
+
+/** Called (from interrupt context) when the asynchronous transaction has finished */
+void handleTransactionComplete(moduleResult_t result)
+{
+    transactionResult = result;
+    transactionComplete = 1;
+}
+
+/** Loads a SYS_VERSION SREQ into zmBuf */
+void loadSysVersion()
+{
+    zmBuf[0] = 0;
+    zmBuf[1] = MSB(SYS_VERSION);
+    zmBuf[2] = LSB(SYS_VERSION);
+}
+
+/** Displays minimum, average and maximum of the measured times */
+void displayTimes(char* name, uint32_t minimum, uint32_t total, uint32_t maximum)
+{
+    printf("%s: min %luuS, avg %luuS, max %luuS\r\n", name, (unsigned long) minimum, 
+           (unsigned long) (total / NUMBER_OF_TRANSACTIONS), (unsigned long) maximum);
+}
+
+int main( void )
+{
+    uint16_t i;
+    uint32_t t, minimum, maximum, total;
+    uint32_t freeLoops = 0;
+    moduleResult_t result;
+
+    halInit();
+    moduleInit();
+    HAL_ENABLE_INTERRUPTS();
+    printf("\r\nResetting Module, then measuring SREQ/SRSP latency\r\n");
+    result = moduleReset();
+    if (result != MODULE_SUCCESS)
+    {
+        printf("Reset ERROR 0x%02X, STOPPING\r\n", result);
+        while (1);
+    }
+
+    /* Blocking */
+    minimum = 0xFFFFFFFF; maximum = 0; total = 0;
+    for (i = 0; i < NUMBER_OF_TRANSACTIONS; i++)
+    {
+        loadSysVersion();
+        t = HAL_GET_MICROS();
+        result = sendMessage();
+        t = HAL_GET_MICROS() - t;
+        if (result != MODULE_SUCCESS)
+            printf("sendMessage() ERROR 0x%02X\r\n", result);
+        if (t < minimum) minimum = t;
+        if (t > maximum) maximum = t;
+        total += t;
+    }
+    displayTimes("sendMessage()     ", minimum, total, maximum);
+
+    /* Asynchronous */
+    minimum = 0xFFFFFFFF; maximum = 0; total = 0;
+    for (i = 0; i < NUMBER_OF_TRANSACTIONS; i++)
+    {
+        loadSysVersion();
+        transactionComplete = 0;
+        result = sendMessageAsync(&handleTransactionComplete);
+        if (result != MODULE_SUCCESS)
+        {
+            printf("sendMessageAsync() ERROR 0x%02X\r\n", result);
+            continue;
+        }
+        while (!transactionComplete)        // The application would do useful work here
+            freeLoops++;
+        if (transactionResult != MODULE_SUCCESS)
+            printf("Transaction ERROR 0x%02X\r\n", transactionResult);
+        t = spiTransactionTimeUs;
+        if (t < minimum) minimum = t;
+        if (t > maximum) maximum = t;
+        total += t;
+    }
+    displayTimes("sendMessageAsync()", minimum, total, maximum);
+    printf("Processor was free for %lu loops per transaction\r\n", (unsigned long) (freeLoops / NUMBER_OF_TRANSACTIONS));
+
+    while (1)
+        HAL_SLEEP();
+}
+
+/* @} */
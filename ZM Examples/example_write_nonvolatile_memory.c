@@ -44,12 +44,11 @@
 #include "../Common/utilities.h"
 #include "../ZM/module_errors.h"
 #include "../ZM/zm_phy_spi.h"
+#include "../ZM/zm_frame.h"
 #include <stdint.h>
 
 moduleResult_t result = MODULE_SUCCESS;
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 #define NO_CHARACTER_RECEIVED 0xFF
 
 uint8_t getWhichNvItemToWrite();
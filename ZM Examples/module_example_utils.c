@@ -37,6 +37,7 @@
 #include "../ZM/af.h"   
 #include "../ZM/zdo.h"    
 #include "../ZM/zm_phy.h"
+#include "../ZM/zm_frame.h"
 #include "../Common/utilities.h"
 #include "Messages/oids.h"
 #include "Messages/kvp.h"
@@ -45,8 +46,6 @@
 #include "../HAL/hal_TI_TMP006_IR_temperature_sensor.h"
 #include <math.h>
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 /** Poll the Module for any messages and display them to the console.
 Used in Simple API coordinator, AFZDO coordinator, secure comms examples, etc.
 @pre moduleHasMessageWaiting() returned true.
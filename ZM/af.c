@@ -13,6 +13,17 @@ the Module physical interface. Module interface could be either SPI or UART.
 * In the defined symbols box, add:
 * AF_VERBOSE
 *
+* @note Define AF_COMPRESSION to compress the payloads of afSendData() and afSendDataExtended() with 
+* zm_compress.c when that makes them shorter. All devices on the network must use it, and receivers 
+* must call afDecompressMessage() on each AF_INCOMING_MSG before parsing the payload.
+*
+* @note Define AF_AGGREGATE to collect small messages to the same destination with afAggregateData(). 
+* It is off by default since its buffers use AF_AGGREGATE_BUFFERS * (AF_MAXIMUM_DATA_LENGTH + 8) 
+* bytes of RAM. Receivers don't need it to split the messages with afDeaggregate().
+*
+* @note Define AF_BROADCAST to rate limit broadcasts with afBroadcastData(). It is off by default
+* since its queue uses AF_BROADCAST_QUEUE_SIZE * (MAXIMUM_PAYLOAD_LENGTH + 7) bytes of RAM.
+*
 * $Rev: 2200 $
 * $Author: dsmith $
 * $Date: 2014-06-19 11:48:25 -0700 (Thu, 19 Jun 2014) $
@@ -48,10 +59,12 @@ the Module physical interface. Module interface could be either SPI or UART.
 #include "../Common/utilities.h"
 #include "application_configuration.h"
 #include "zm_phy_spi.h"
+#include "zm_frame.h"
 #include <string.h>                 //for memcpy()
 #include <stdint.h>
-
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
+#ifdef AF_COMPRESSION
+#include "zm_compress.h"
+#endif
 
 /** Incremented for each AF_DATA_REQUEST, wraps around to 0. */
 static uint8_t transactionSequenceNumber = 0;
@@ -64,6 +77,16 @@ static uint8_t acknowledgmentMode = AF_MAC_ACK;
 /** The maximum number of bytes that can be sent with an afDataStore() function */
 #define MAXIMUM_DATA_STORE_PAYLOAD_LENGTH 	247
 
+#define AF_REGISTER_SREQ_FIELDS(L, F) \
+    F(L, ENDPOINT, MT_U8) \
+    F(L, PROFILE_ID, MT_U16) \
+    F(L, DEVICE_ID, MT_U16) \
+    F(L, DEVICE_VERSION, MT_U8) \
+    F(L, LATENCY, MT_U8) \
+    F(L, INPUT_CLUSTER_COUNT, MT_U8) \
+    F(L, INPUT_CLUSTERS, MT_VARIABLE)                  //followed by the output cluster count and clusters
+MT_LAYOUT(AF_REGISTER_SREQ);
+
 #define METHOD_AF_REGISTER_APPLICATION                    0x2100
 /** 
  Configures the Module for our application.
@@ -85,21 +108,14 @@ moduleResult_t afRegisterApplication(const struct applicationConfiguration* ac)
     RETURN_NULL_PARAMETER_IF_TRUE( (ac == 0), METHOD_AF_REGISTER_APPLICATION);    
     RETURN_INVALID_CLUSTER_IF_TRUE( ((ac->numberOfBindingInputClusters > MAX_BINDING_CLUSTERS) || (ac->numberOfBindingOutputClusters > MAX_BINDING_CLUSTERS)), METHOD_AF_REGISTER_APPLICATION);
     
-    //zmBuf[0] (length) will be set later
-    zmBuf[1] = MSB(AF_REGISTER);
-    zmBuf[2] = LSB(AF_REGISTER);  
+    MT_PUT_U8(AF_REGISTER_SREQ_ENDPOINT, ac->endPoint);
+    MT_PUT_U16(AF_REGISTER_SREQ_PROFILE_ID, ac->profileId);
+    MT_PUT_U16(AF_REGISTER_SREQ_DEVICE_ID, ac->deviceId);
+    MT_PUT_U8(AF_REGISTER_SREQ_DEVICE_VERSION, ac->deviceVersion);
+    MT_PUT_U8(AF_REGISTER_SREQ_LATENCY, ac->latencyRequested);
+    MT_PUT_U8(AF_REGISTER_SREQ_INPUT_CLUSTER_COUNT, ac->numberOfBindingInputClusters);
     
-    uint8_t bufferIndex;
-    zmBuf[3] = ac->endPoint;
-    zmBuf[4] = ac->profileId & 0xFF;      //LSB
-    zmBuf[5] = ac->profileId >> 8;        //MSB
-    zmBuf[6] = ac->deviceId & 0xFF;       //LSB
-    zmBuf[7] = ac->deviceId >> 8;         //MSB
-    zmBuf[8] = ac->deviceVersion;
-    zmBuf[9] = ac->latencyRequested;
-    zmBuf[10] = ac->numberOfBindingInputClusters;
-    
-    bufferIndex = 11;
+    uint8_t bufferIndex = MT_INDEX(AF_REGISTER_SREQ_INPUT_CLUSTERS);
     int cluster;
     for (cluster = 0; cluster < ac->numberOfBindingInputClusters; cluster++)
     {
@@ -113,8 +129,7 @@ moduleResult_t afRegisterApplication(const struct applicationConfiguration* ac)
         zmBuf[bufferIndex++] = ac->bindingOutputClusters[cluster] & 0xFF;
         zmBuf[bufferIndex++] = ac->bindingOutputClusters[cluster] >> 8;
     }
-    zmBuf[0] = bufferIndex;
-    RETURN_RESULT(sendMessage(), METHOD_AF_REGISTER_APPLICATION); 
+    RETURN_RESULT(mtSend(AF_REGISTER, bufferIndex - SRSP_HEADER_SIZE), METHOD_AF_REGISTER_APPLICATION); 
 }
 
 
@@ -126,21 +141,14 @@ Sets which endpoint, profileId, etc. we're using as well as binding information
 */
 moduleResult_t afRegisterGenericApplication()
 {
-#define AF_REGISTER_PAYLOAD_LEN 9
-    zmBuf[0] = AF_REGISTER_PAYLOAD_LEN;
-    zmBuf[1] = MSB(AF_REGISTER);
-    zmBuf[2] = LSB(AF_REGISTER);      
-    
-    zmBuf[3] = DEFAULT_ENDPOINT;
-    zmBuf[4] = LSB(DEFAULT_PROFILE_ID);
-    zmBuf[5] = MSB(DEFAULT_PROFILE_ID);
-    zmBuf[6] = LSB(DEVICE_ID);
-    zmBuf[7] = MSB(DEVICE_ID);
-    zmBuf[8] = DEVICE_VERSION;
-    zmBuf[9] = LATENCY_NORMAL;
-    zmBuf[10] = 0; //number of binding input clusters
-    zmBuf[11] = 0; //number of binding output clusters
-    RETURN_RESULT(sendMessage(), METHOD_AF_REGISTER_GENERIC_APPLICATION);
+    MT_PUT_U8(AF_REGISTER_SREQ_ENDPOINT, DEFAULT_ENDPOINT);
+    MT_PUT_U16(AF_REGISTER_SREQ_PROFILE_ID, DEFAULT_PROFILE_ID);
+    MT_PUT_U16(AF_REGISTER_SREQ_DEVICE_ID, DEVICE_ID);
+    MT_PUT_U8(AF_REGISTER_SREQ_DEVICE_VERSION, DEVICE_VERSION);
+    MT_PUT_U8(AF_REGISTER_SREQ_LATENCY, LATENCY_NORMAL);
+    MT_PUT_U8(AF_REGISTER_SREQ_INPUT_CLUSTER_COUNT, 0);
+    MT_PUT_U8(AF_REGISTER_SREQ_INPUT_CLUSTERS, 0);          //number of binding output clusters
+    RETURN_RESULT(mtSend(AF_REGISTER, MT_LENGTH(AF_REGISTER_SREQ) + 1), METHOD_AF_REGISTER_GENERIC_APPLICATION);
 }
 
 /** Returns the current transactionSequenceNumber. This is included in afSendData, and reported in
@@ -175,6 +183,155 @@ uint8_t getAckMode()
 	return acknowledgmentMode;
 }
 
+#ifdef AF_COMPRESSION
+/** Whether payloads are compressed, see afSetCompression() */
+static uint8_t compressionEnabled = 1;
+
+/** A payload with its compression header while it is sent, or a received payload while it is 
+decompressed. Not kept between method calls. */
+static uint8_t afCompressionBuffer[AF_COMPRESSION_BUFFER_SIZE];
+
+#define METHOD_AF_SET_COMPRESSION                    0x9400
+/** Turns compression of payloads on or off; it is on by default. When off, payloads still get the
+compression header, so receivers don't need to know, but are not compressed. Turn it off to save 
+time when sending data that doesn't compress, e.g. data that is already compressed or encrypted.
+@param enabled nonzero to compress payloads
+*/
+moduleResult_t afSetCompression(uint8_t enabled)
+{
+    compressionEnabled = (enabled != 0);
+    return MODULE_SUCCESS;
+}
+
+/** Adds the compression header to a payload in afCompressionBuffer, compressing the payload if that
+makes it shorter. Private helper method for the afSendData() methods.
+@param data the payload to send
+@param dataLength length of data
+@param maxLength the longest payload with header that may be sent
+@return the length of the payload with header, or 0 if it would be longer than maxLength.
+*/
+static uint16_t afCompressPayload(uint8_t* data, uint16_t dataLength, uint16_t maxLength)
+{
+    if (maxLength > AF_COMPRESSION_BUFFER_SIZE)
+        maxLength = AF_COMPRESSION_BUFFER_SIZE;
+    uint16_t compressedLength;
+    if ((compressionEnabled) &&
+        (compressData(data, dataLength, afCompressionBuffer + AF_COMPRESSION_HEADER_LENGTH, 
+                      maxLength - AF_COMPRESSION_HEADER_LENGTH, &compressedLength) == MODULE_SUCCESS) &&
+        (compressedLength < dataLength))
+    {
+        afCompressionBuffer[0] = AF_COMPRESSION_FLAG_COMPRESSED;
+        return compressedLength + AF_COMPRESSION_HEADER_LENGTH;
+    }
+    if ((dataLength + AF_COMPRESSION_HEADER_LENGTH) > maxLength)
+        return 0;
+    afCompressionBuffer[0] = 0;
+    memcpy(afCompressionBuffer + AF_COMPRESSION_HEADER_LENGTH, data, dataLength);
+    return dataLength + AF_COMPRESSION_HEADER_LENGTH;
+}
+
+#define METHOD_AF_DECOMPRESS_MESSAGE                    0x9500
+/** Restores the payload of a received message sent with AF_COMPRESSION: removes the compression
+header and decompresses the payload if needed. The payload, its length field and the length of the
+message in zmBuf are updated, so the message can then be parsed as usual. Call once for each message,
+straight after it was received.
+@pre zmBuf holds the received message.
+@return MODULE_SUCCESS, also if zmBuf doesn't hold an AF_INCOMING_MSG. INVALID_LENGTH if the 
+payload has no header or decompresses to more than AF_COMPRESSION_BUFFER_SIZE, INVALID_PARAMETER if 
+the compressed payload is malformed.
+@note an AF_INCOMING_MSG_EXT is only restored if its payload is in zmBuf. If it must be retrieved
+with retrieveExtendedMessage() instead then its first byte is the header, and decompressData() can 
+be used on the rest.
+*/
+moduleResult_t afDecompressMessage()
+{
+    uint8_t* payload;
+    uint16_t length;
+    if (IS_AF_INCOMING_MESSAGE())
+    {
+        payload = zmBuf + AF_INCOMING_MESSAGE_PAYLOAD_START_FIELD;
+        length = AF_INCOMING_MESSAGE_PAYLOAD_LEN;
+    } else if ((IS_AF_INCOMING_MESSAGE_EXT()) && 
+               (zmBuf[SRSP_LENGTH_FIELD] == (AF_INCOMING_MESSAGE_EXT_PAYLOAD_START_FIELD - SRSP_HEADER_SIZE + AF_INCOMING_MESSAGE_EXT_LENGTH()))) {
+        payload = zmBuf + AF_INCOMING_MESSAGE_EXT_PAYLOAD_START_FIELD;
+        length = AF_INCOMING_MESSAGE_EXT_LENGTH();
+    } else {
+        return MODULE_SUCCESS;
+    }
+    RETURN_INVALID_LENGTH_IF_TRUE( (length < AF_COMPRESSION_HEADER_LENGTH), METHOD_AF_DECOMPRESS_MESSAGE);
+    
+    uint16_t newLength = length - AF_COMPRESSION_HEADER_LENGTH;
+    if (payload[0] & AF_COMPRESSION_FLAG_COMPRESSED)
+    {
+        //Must fit in zmBuf, and the length of an AF_INCOMING_MSG in one byte
+        uint16_t maxLength = ZIGBEE_MODULE_BUFFER_SIZE - (payload - zmBuf);
+        if (maxLength > AF_COMPRESSION_BUFFER_SIZE)
+            maxLength = AF_COMPRESSION_BUFFER_SIZE;
+        RETURN_RESULT_IF_FAIL(decompressData(payload + AF_COMPRESSION_HEADER_LENGTH, newLength, 
+                                             afCompressionBuffer, maxLength, &newLength), METHOD_AF_DECOMPRESS_MESSAGE);
+        memcpy(payload, afCompressionBuffer, newLength);
+    } else {
+        memmove(payload, payload + AF_COMPRESSION_HEADER_LENGTH, newLength);
+    }
+    
+    zmBuf[SRSP_LENGTH_FIELD] = zmBuf[SRSP_LENGTH_FIELD] - length + newLength;
+    if (IS_AF_INCOMING_MESSAGE())
+    {
+        zmBuf[AF_INCOMING_MESSAGE_PAYLOAD_LEN_FIELD] = newLength;
+    } else {
+        zmBuf[AF_INCOMING_MESSAGE_EXT_PAYLOAD_LEN_LSB_FIELD] = LSB(newLength);
+        zmBuf[AF_INCOMING_MESSAGE_EXT_PAYLOAD_LEN_MSB_FIELD] = MSB(newLength);
+    }
+    return MODULE_SUCCESS;
+}
+#endif
+
+
+#define AF_DATA_REQUEST_SREQ_FIELDS(L, F) \
+    F(L, DESTINATION_ADDRESS, MT_U16) \
+    F(L, DESTINATION_ENDPOINT, MT_U8) \
+    F(L, SOURCE_ENDPOINT, MT_U8) \
+    F(L, CLUSTER_ID, MT_U16) \
+    F(L, TRANS_ID, MT_U8) \
+    F(L, OPTIONS, MT_U8) \
+    F(L, RADIUS, MT_U8) \
+    F(L, LENGTH, MT_U8) \
+    F(L, DATA, MT_VARIABLE)
+MT_LAYOUT(AF_DATA_REQUEST_SREQ);
+/** The SRSP of AF_DATA_REQUEST, and of AF_DATA_REQUEST_EXT, is only a status */
+#define AF_DATA_REQUEST_SRSP_FIELDS(L, F) \
+    F(L, STATUS, MT_U8)
+MT_LAYOUT(AF_DATA_REQUEST_SRSP);
+/** Writes an AF_DATA_REQUEST into a buffer. Private helper method for afSendData() and afBuildData(),
+which check the parameters. With AF_COMPRESSION the payload is written with its compression header.
+@see afSendData for description of the fields.
+@return MODULE_SUCCESS, or INVALID_LENGTH if the payload with compression header is too long.
+*/
+static moduleResult_t afPackDataRequest(uint8_t* buf, uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                                        uint16_t destinationShortAddress, uint16_t clusterId, 
+                                        uint8_t* data, uint8_t dataLength)
+{
+#ifdef AF_COMPRESSION
+    uint16_t length = afCompressPayload(data, dataLength, MAXIMUM_PAYLOAD_LENGTH);
+    if (length == 0)
+        return INVALID_LENGTH;
+    data = afCompressionBuffer;
+    dataLength = length;
+#endif
+    mtPack(buf, AF_DATA_REQUEST, MT_LENGTH(AF_DATA_REQUEST_SREQ) + dataLength);
+    MT_BUF_PUT_U16(buf, AF_DATA_REQUEST_SREQ_DESTINATION_ADDRESS, destinationShortAddress);
+    MT_BUF_PUT_U8(buf, AF_DATA_REQUEST_SREQ_DESTINATION_ENDPOINT, destinationEndpoint);
+    MT_BUF_PUT_U8(buf, AF_DATA_REQUEST_SREQ_SOURCE_ENDPOINT, sourceEndpoint);
+    MT_BUF_PUT_U16(buf, AF_DATA_REQUEST_SREQ_CLUSTER_ID, clusterId);
+    MT_BUF_PUT_U8(buf, AF_DATA_REQUEST_SREQ_TRANS_ID, transactionSequenceNumber);  //Improperly read on Stellaris when post-increment operation here
+    MT_BUF_PUT_U8(buf, AF_DATA_REQUEST_SREQ_OPTIONS, acknowledgmentMode);
+    MT_BUF_PUT_U8(buf, AF_DATA_REQUEST_SREQ_RADIUS, DEFAULT_RADIUS);
+    MT_BUF_PUT_U8(buf, AF_DATA_REQUEST_SREQ_LENGTH, dataLength);
+    transactionSequenceNumber++;
+    
+    memcpy(MT_BUF_POINTER(buf, AF_DATA_REQUEST_SREQ_DATA), data, dataLength);
+    return MODULE_SUCCESS;
+}
 
 #define METHOD_AF_SEND_DATA                    0x2300
 /** Sends a message to another device over the Zigbee network using the AF command AF_DATA_REQUEST.
@@ -187,6 +344,7 @@ A cluster is typically a particular command, e.g. "turn on lights" or "get tempe
 predefined Zigbee Alliance Application Profile then this cluster will follow the Zigbee Cluster Library.
 @param  data is the data to send.
 @param  dataLength is how many bytes of data to send. Must be nonzero and less than MAXIMUM_PAYLOAD_LENGTH.
+With AF_COMPRESSION, at most AF_MAXIMUM_DATA_LENGTH unless the data can be compressed.
 @note On a coordinator in a trivial test setup, it takes approximately 10mSec from sending 
 AF_DATA_REQUEST to when we receive AF_DATA_CONFIRM.
 @note   When sending data, three things happen:
@@ -221,33 +379,14 @@ moduleResult_t afSendData(uint8_t destinationEndpoint, uint8_t sourceEndpoint,
            dataLength, destinationEndpoint, sourceEndpoint, clusterId, clusterId, destinationShortAddress, destinationShortAddress);
 #endif  
     
-#define AF_DATA_REQUEST_PAYLOAD_LEN 10
-    
-    zmBuf[0] = AF_DATA_REQUEST_PAYLOAD_LEN + dataLength;
-    zmBuf[1] = MSB(AF_DATA_REQUEST);
-    zmBuf[2] = LSB(AF_DATA_REQUEST);      
-    
-    zmBuf[3] = LSB(destinationShortAddress); 
-    zmBuf[4] = MSB(destinationShortAddress);
-    zmBuf[5] = destinationEndpoint;
-    zmBuf[6] = sourceEndpoint;
-    zmBuf[7] = LSB(clusterId); 
-    zmBuf[8] = MSB(clusterId); 
-    zmBuf[9] = transactionSequenceNumber;  //Improperly read on Stellaris when post-increment operation here
-    zmBuf[10] = acknowledgmentMode;
-    zmBuf[11] = DEFAULT_RADIUS;
-    zmBuf[12] = dataLength; 
-    transactionSequenceNumber++;
-    
-    memcpy(zmBuf+AF_DATA_REQUEST_PAYLOAD_LEN+3, data, dataLength);
+    RETURN_RESULT_IF_FAIL(afPackDataRequest(zmBuf, destinationEndpoint, sourceEndpoint, destinationShortAddress, clusterId, data, dataLength), METHOD_AF_SEND_DATA);
     RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_AF_SEND_DATA); 
-#define AF_DATA_REQUEST_SRSP_STATUS_FIELD   SRSP_PAYLOAD_START
     //Now check the status returned in the SRSP:
     
 #ifdef AF_DATA_CONFIRM_HANDLED_BY_APPLICATION           //Return control to main application
-    RETURN_RESULT(zmBuf[AF_DATA_REQUEST_SRSP_STATUS_FIELD], METHOD_AF_SEND_DATA); 
+    RETURN_RESULT(MT_GET_U8(AF_DATA_REQUEST_SRSP_STATUS), METHOD_AF_SEND_DATA); 
 #else
-    RETURN_RESULT_IF_FAIL(zmBuf[AF_DATA_REQUEST_SRSP_STATUS_FIELD], METHOD_AF_SEND_DATA); 
+    RETURN_RESULT_IF_FAIL(MT_GET_U8(AF_DATA_REQUEST_SRSP_STATUS), METHOD_AF_SEND_DATA); 
     
 #define AF_DATA_CONFIRM_TIMEOUT 2
     RETURN_RESULT_IF_FAIL(waitForMessage(AF_DATA_CONFIRM, AF_DATA_CONFIRM_TIMEOUT), METHOD_AF_SEND_DATA);
@@ -256,32 +395,557 @@ moduleResult_t afSendData(uint8_t destinationEndpoint, uint8_t sourceEndpoint,
 }
 
 
+#define METHOD_AF_BUILD_DATA                    0x2A00
+/** Builds the same AF_DATA_REQUEST as afSendData() in a frame, without sending it. Send it with 
+sendFrame(). Since the SRSP and AF_DATA_CONFIRM are received into zmBuf, the frame is not 
+overwritten and the same message can be sent many times without building it again.
+@param frame a frame from frameAlloc()
+@see afSendData for description of the other fields.
+@note the transactionSequenceNumber is assigned when the frame is built, so each send of this frame 
+uses the same one.
+@note the application is responsible for checking the SRSP status and receiving the AF_DATA_CONFIRM,
+as with AF_DATA_CONFIRM_HANDLED_BY_APPLICATION.
+@return MODULE_SUCCESS, or INVALID_PARAMETER if frame is not valid, or an error as in afSendData().
+*/
+moduleResult_t afBuildData(frameHandle_t frame, uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                           uint16_t destinationShortAddress, uint16_t clusterId, 
+                           uint8_t* data, uint8_t dataLength)
+{
+    RETURN_INVALID_LENGTH_IF_TRUE( ((dataLength > MAXIMUM_PAYLOAD_LENGTH) || (dataLength == 0)), METHOD_AF_BUILD_DATA);
+    RETURN_INVALID_CLUSTER_IF_TRUE( (clusterId == 0), METHOD_AF_BUILD_DATA);
+    uint8_t* buf = frameData(frame);
+    RETURN_INVALID_PARAMETER_IF_TRUE( (buf == 0), METHOD_AF_BUILD_DATA);
+    
+    RETURN_RESULT(afPackDataRequest(buf, destinationEndpoint, sourceEndpoint, destinationShortAddress, clusterId, data, dataLength), METHOD_AF_BUILD_DATA);
+}
+
+#define METHOD_AF_SEND_DATA_ASYNC                    0x2B00
+#define AF_DATA_CONFIRM_TIMEOUT_MS                   2000
+/** Non-blocking version of afSendData(): sends the AF_DATA_REQUEST and returns once the SRSP has 
+been received. The callback is called with the AF_DATA_CONFIRM status when the AF_DATA_CONFIRM with
+the same transactionSequenceNumber is received, so many messages can be in flight at once.
+@param callback called when the message has been delivered or has failed
+@param token is set to the token of the request
+@see afSendData for description of the other fields.
+@see zm_pipeline.c for how to receive the AF_DATA_CONFIRM.
+@return MODULE_SUCCESS if the message was accepted by the Module, else an error as in afSendData() 
+or pipelineSend(). If an error is returned then the callback won't be called.
+*/
+moduleResult_t afSendDataAsync(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                               uint16_t destinationShortAddress, uint16_t clusterId, 
+                               uint8_t* data, uint8_t dataLength, 
+                               requestCallback_t callback, requestToken_t* token)
+{
+    RETURN_INVALID_LENGTH_IF_TRUE( ((dataLength > MAXIMUM_PAYLOAD_LENGTH) || (dataLength == 0)), METHOD_AF_SEND_DATA_ASYNC);
+    RETURN_INVALID_CLUSTER_IF_TRUE( (clusterId == 0), METHOD_AF_SEND_DATA_ASYNC);
+    
+    RETURN_RESULT_IF_FAIL(afPackDataRequest(zmBuf, destinationEndpoint, sourceEndpoint, destinationShortAddress, clusterId, data, dataLength), METHOD_AF_SEND_DATA_ASYNC);
+    uint8_t transId = MT_GET_U8(AF_DATA_REQUEST_SREQ_TRANS_ID);
+    RETURN_RESULT(pipelineSend(AF_DATA_CONFIRM, AF_DATA_CONFIRM_TRANS_ID_FIELD, &transId, 1, 
+                               AF_DATA_CONFIRM_STATUS_FIELD, AF_DATA_CONFIRM_TIMEOUT_MS, callback, token), 
+                  METHOD_AF_SEND_DATA_ASYNC);
+}
+
+
+//Z-Stack status values of a AF_DATA_CONFIRM when the Module or MAC is out of buffers, see module_errors.h
+#define AF_STATUS_BUFFER_FULL                        0x11    //ZBufferFull
+#define AF_STATUS_MAC_TRANSACTION_OVERFLOW           0xf1    //ZMacTransactionOverFlow
+
+/** Callback of each windowed message, indexed by the token of its request */
+static requestCallback_t afWindowCallbacks[ZM_PIPELINE_SIZE];
+/** Number of windowed messages waiting for their AF_DATA_CONFIRM */
+static uint8_t afWindowCount = 0;
+/** Current window size, 1 .. AF_SEND_WINDOW. Halved when the Module runs out of buffers */
+static uint8_t afWindowSize = AF_SEND_WINDOW;
+
+/** Pipeline callback of windowed messages. Adjusts the window size and passes the status on to the 
+callback given to afSendDataWindowed(). */
+static void afWindowConfirm(requestToken_t token, moduleResult_t status)
+{
+    if (afWindowCount > 0)
+        afWindowCount--;
+    if ((status == AF_STATUS_BUFFER_FULL) || (status == AF_STATUS_MAC_TRANSACTION_OVERFLOW) || (status == TIMEOUT))
+    {
+        afWindowSize = (afWindowSize > 1) ? (afWindowSize / 2) : 1;
+    } else if ((status == MODULE_SUCCESS) && (afWindowSize < AF_SEND_WINDOW)) {
+        afWindowSize++;
+    }
+    requestCallback_t callback = afWindowCallbacks[token];
+    afWindowCallbacks[token] = 0;
+    if (callback != 0)
+        callback(token, status);
+}
+
+#define AF_WINDOW_POLL_INTERVAL_MS                   1
+/** Receives messages until the number of windowed messages in flight is below the limit. 
+AF_DATA_CONFIRMs are given to pipelineDispatch(); all other messages are parked so that the 
+application still receives them from getMessage(). Confirms received by a blocking method, e.g. while 
+waiting for the SRSP of the next AF_DATA_REQUEST, are parked too, so check those first.
+@param limit wait until fewer than this many windowed messages are in flight
+*/
+static void afWindowWait(uint8_t limit)
+{
+    uint8_t parked = framesParked();
+    while ((parked-- > 0) && frameUnparkCommand(AF_DATA_CONFIRM))
+    {
+        if (!pipelineDispatch())
+            frameParkWorking();
+    }
+    while ((afWindowCount >= limit) || (pipelineOutstanding() >= ZM_PIPELINE_SIZE))
+    {
+        if (phyHasMessageWaiting())
+        {
+            if (phyGetMessage() != MODULE_SUCCESS)
+                continue;
+            if (!pipelineDispatch())
+                frameParkWorking();
+        } else {
+            delayMs(AF_WINDOW_POLL_INTERVAL_MS);
+            pipelineTick(AF_WINDOW_POLL_INTERVAL_MS);
+        }
+    }
+}
+
+#define METHOD_AF_SEND_DATA_WINDOWED                 0x2C00
+#define AF_WINDOW_MAX_RETRIES                        5
+#define AF_WINDOW_RETRY_DELAY_MS                     10
+/** Sends a message with up to AF_SEND_WINDOW messages in flight at once, instead of waiting for the
+AF_DATA_CONFIRM of each message before sending the next as afSendData() does. Blocks only while the 
+window is full. The window is halved when the Module or MAC runs out of buffers (ZBufferFull or 
+ZMacTransactionOverFlow) and grows back by one with each successful confirm.
+@param callback called with the AF_DATA_CONFIRM status of this message; may be null
+@see afSendData for description of the other fields.
+@see afWindowFlush() to wait for all windowed messages to complete.
+@return MODULE_SUCCESS if the message is in flight, else an error as in afSendDataAsync(). If an 
+error is returned then the callback won't be called.
+@note Other messages received while the window is full are parked and returned by getMessage().
+*/
+moduleResult_t afSendDataWindowed(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                                  uint16_t destinationShortAddress, uint16_t clusterId, 
+                                  uint8_t* data, uint8_t dataLength, requestCallback_t callback)
+{
+    requestToken_t token;
+    uint8_t retries = 0;
+    while (1)
+    {
+        afWindowWait(afWindowSize);
+        moduleResult = afSendDataAsync(destinationEndpoint, sourceEndpoint, destinationShortAddress, 
+                                       clusterId, data, dataLength, &afWindowConfirm, &token);
+        if (moduleResult == MODULE_SUCCESS)
+            break;
+        if ((moduleResult != AF_STATUS_BUFFER_FULL) || (retries++ == AF_WINDOW_MAX_RETRIES))
+        {
+            RETURN_RESULT(moduleResult, METHOD_AF_SEND_DATA_WINDOWED);
+        }
+        //The Module is out of buffers: shrink the window and let messages drain before retrying
+        afWindowSize = (afWindowSize > 1) ? (afWindowSize / 2) : 1;
+        if (afWindowCount > 0)
+            afWindowWait(afWindowCount);
+        else
+            delayMs(AF_WINDOW_RETRY_DELAY_MS);
+    }
+    afWindowCallbacks[token] = callback;
+    afWindowCount++;
+    return MODULE_SUCCESS;
+}
+
+/** Waits until all messages sent with afSendDataWindowed() have completed and their callbacks have 
+been called. */
+void afWindowFlush()
+{
+    afWindowWait(1);
+}
+
+/** @return the number of messages sent with afSendDataWindowed() that are waiting for their 
+AF_DATA_CONFIRM */
+uint8_t afWindowOutstanding()
+{
+    return afWindowCount;
+}
+
+#ifdef AF_AGGREGATE
+/** Messages collected by afAggregateData() for one destination. A length of zero marks a free 
+buffer. */
+struct afAggregateBuffer
+{
+    uint16_t destinationShortAddress;
+    uint16_t clusterId;
+    uint8_t destinationEndpoint;
+    uint8_t sourceEndpoint;
+    uint8_t length;
+    uint16_t ageMs;                     //time since the first message was added
+    uint8_t data[AF_MAXIMUM_DATA_LENGTH];
+};
+static struct afAggregateBuffer afAggregateBuffers[AF_AGGREGATE_BUFFERS];
+
+#define METHOD_AF_AGGREGATE_FLUSH                    0x2E00
+/** Sends the messages collected in one buffer as one AF_DATA_REQUEST with afSendData(). The buffer 
+is freed even if sending fails, so that a destination that can't be reached doesn't block others. */
+static moduleResult_t afAggregateSend(struct afAggregateBuffer* b)
+{
+    uint8_t length = b->length;
+    b->length = 0;
+    if (length == 0)
+        return MODULE_SUCCESS;
+    RETURN_RESULT(afSendData(b->destinationEndpoint, b->sourceEndpoint, b->destinationShortAddress, 
+                             b->clusterId, b->data, length), METHOD_AF_AGGREGATE_FLUSH);
+}
+
+#define METHOD_AF_AGGREGATE_DATA                    0x2D00
+/** Sends a message together with other small messages to the same destination, endpoints and 
+cluster, to use fewer AF_DATA_REQUESTs and less airtime than afSendData() for each message. The 
+message is added to a buffer, preceded by its length, and the buffer is sent with afSendData() when:
+- the next message doesn't fit, up to AF_MAXIMUM_DATA_LENGTH
+- the buffer holds AF_AGGREGATE_FLUSH_LENGTH bytes or more
+- the first message in it is AF_AGGREGATE_FLUSH_MS old, see afAggregateTick()
+- all buffers are in use and a message to another destination is added; the oldest buffer is sent
+- afAggregateFlush() is called.
+
+The receiver must split the payload into the original messages with afDeaggregate(), so use a 
+cluster for aggregated messages only.
+@param dataLength length of data, at most AF_AGGREGATE_MAX_DATA_LENGTH. Send longer messages with 
+afSendData() or afSendDataExtended().
+@see afSendData for description of the other fields.
+@return MODULE_SUCCESS if the message was added, or an error as in afSendData() if a buffer had to 
+be sent to make room and that failed. The message is added in either case, except if it was invalid.
+@note since messages are sent later, an error may be returned for messages that were added before.
+*/
+moduleResult_t afAggregateData(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                               uint16_t destinationShortAddress, uint16_t clusterId, 
+                               uint8_t* data, uint8_t dataLength)
+{
+    RETURN_INVALID_LENGTH_IF_TRUE( ((dataLength > AF_AGGREGATE_MAX_DATA_LENGTH) || (dataLength == 0)), METHOD_AF_AGGREGATE_DATA);
+    RETURN_INVALID_CLUSTER_IF_TRUE( (clusterId == 0), METHOD_AF_AGGREGATE_DATA);
+    RETURN_NULL_PARAMETER_IF_TRUE( (data == 0), METHOD_AF_AGGREGATE_DATA);
+    
+    moduleResult_t result = MODULE_SUCCESS;
+    struct afAggregateBuffer* b = 0;
+    struct afAggregateBuffer* oldest = afAggregateBuffers;
+    uint8_t i;
+    for (i = 0; i < AF_AGGREGATE_BUFFERS; i++)
+    {
+        struct afAggregateBuffer* c = &afAggregateBuffers[i];
+        if (c->length == 0)
+        {
+            if (b == 0)
+                b = c;
+        } else if ((c->destinationShortAddress == destinationShortAddress) && (c->clusterId == clusterId) &&
+                   (c->destinationEndpoint == destinationEndpoint) && (c->sourceEndpoint == sourceEndpoint)) {
+            b = c;
+            break;
+        } else if (c->ageMs > oldest->ageMs) {
+            oldest = c;
+        }
+    }
+    if (b == 0)                                         //All buffers are in use for other destinations
+    {
+        result = afAggregateSend(oldest);
+        b = oldest;
+    } else if ((b->length + AF_AGGREGATE_HEADER_LENGTH + dataLength) > AF_MAXIMUM_DATA_LENGTH) {
+        result = afAggregateSend(b);
+    }
+    if (b->length == 0)
+    {
+        b->destinationShortAddress = destinationShortAddress;
+        b->clusterId = clusterId;
+        b->destinationEndpoint = destinationEndpoint;
+        b->sourceEndpoint = sourceEndpoint;
+        b->ageMs = 0;
+    }
+    b->data[b->length++] = dataLength;
+    memcpy(b->data + b->length, data, dataLength);
+    b->length += dataLength;
+    
+    if (b->length >= AF_AGGREGATE_FLUSH_LENGTH)
+    {
+        moduleResult_t sendResult = afAggregateSend(b);
+        if (result == MODULE_SUCCESS)
+            result = sendResult;
+    }
+    RETURN_RESULT(result, METHOD_AF_AGGREGATE_DATA);
+}
+
+/** Sends the messages collected by afAggregateData() that have waited AF_AGGREGATE_FLUSH_MS. Call 
+periodically, e.g. from the same timer as pipelineTick().
+@param elapsedMs time since the last call, in milliseconds
+@return MODULE_SUCCESS, or the error from the first buffer that couldn't be sent. 
+*/
+moduleResult_t afAggregateTick(uint16_t elapsedMs)
+{
+    moduleResult_t result = MODULE_SUCCESS;
+    uint8_t i;
+    for (i = 0; i < AF_AGGREGATE_BUFFERS; i++)
+    {
+        struct afAggregateBuffer* b = &afAggregateBuffers[i];
+        if (b->length == 0)
+            continue;
+        if (elapsedMs > (0xFFFF - b->ageMs))
+            b->ageMs = 0xFFFF;
+        else
+            b->ageMs += elapsedMs;
+        if (b->ageMs >= AF_AGGREGATE_FLUSH_MS)
+        {
+            moduleResult_t sendResult = afAggregateSend(b);
+            if (result == MODULE_SUCCESS)
+                result = sendResult;
+        }
+    }
+    return result;
+}
+
+/** Sends all messages collected by afAggregateData() now, e.g. before sleeping. 
+@return MODULE_SUCCESS, or the error from the first buffer that couldn't be sent. 
+*/
+moduleResult_t afAggregateFlush()
+{
+    moduleResult_t result = MODULE_SUCCESS;
+    uint8_t i;
+    for (i = 0; i < AF_AGGREGATE_BUFFERS; i++)
+    {
+        moduleResult_t sendResult = afAggregateSend(&afAggregateBuffers[i]);
+        if (result == MODULE_SUCCESS)
+            result = sendResult;
+    }
+    return result;
+}
+#endif
+
+#define METHOD_AF_DEAGGREGATE                    0x2F00
+/** Splits the payload of a message sent with afAggregateData() into the original messages, e.g.
+<code>afDeaggregate(zmBuf + AF_INCOMING_MESSAGE_PAYLOAD_START_FIELD, AF_INCOMING_MESSAGE_PAYLOAD_LEN, 
+handleInfoMessage)</code>
+@param data the payload of the received message
+@param dataLength length of the payload
+@param sink called with the index (0, 1, ...) and contents of each message, in the order they were 
+added. The contents point into data, so copy what is needed before calling any library methods if 
+data is in zmBuf.
+@return MODULE_SUCCESS, INVALID_LENGTH if the payload is not made of whole messages (the messages 
+before the bad one are given to the sink), or the error returned by the sink, which stops splitting.
+*/
+moduleResult_t afDeaggregate(const uint8_t* data, uint8_t dataLength, afDataSink_t sink)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE( ((data == 0) || (sink == 0)), METHOD_AF_DEAGGREGATE);
+    uint16_t index = 0;
+    while (dataLength > 0)
+    {
+        uint8_t length = *data;
+        RETURN_INVALID_LENGTH_IF_TRUE( ((length == 0) || (length >= dataLength)), METHOD_AF_DEAGGREGATE);
+        RETURN_RESULT_IF_FAIL(sink(index++, data + AF_AGGREGATE_HEADER_LENGTH, length), METHOD_AF_DEAGGREGATE);
+        data += AF_AGGREGATE_HEADER_LENGTH + length;
+        dataLength -= AF_AGGREGATE_HEADER_LENGTH + length;
+    }
+    return MODULE_SUCCESS;
+}
+
+#ifdef AF_BROADCAST
+/** A broadcast waiting in the queue of afBroadcastData() */
+struct afBroadcastEntry
+{
+    uint16_t broadcastAddress;
+    uint16_t clusterId;
+    uint8_t destinationEndpoint;
+    uint8_t sourceEndpoint;
+    uint8_t length;
+    uint8_t data[MAXIMUM_PAYLOAD_LENGTH];
+};
+static struct afBroadcastEntry afBroadcastQueue[AF_BROADCAST_QUEUE_SIZE];
+static uint8_t afBroadcastHead = 0;             //oldest entry
+static uint8_t afBroadcastCount = 0;
+static uint8_t afBroadcastTokens = AF_BROADCAST_BURST;
+static uint16_t afBroadcastTokenMs = 0;         //time towards the next token
+static struct afBroadcastStatistics afBroadcastStatistics;
+
+#define AF_BROADCAST_COUNT(counter)     if (counter < 0xFFFF) counter++
+
+#define METHOD_AF_BROADCAST_SEND                    0x9300
+/** Sends a broadcast with afSendData(), using a token. */
+static moduleResult_t afBroadcastSend(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                                      uint16_t broadcastAddress, uint16_t clusterId, 
+                                      uint8_t* data, uint8_t dataLength)
+{
+    afBroadcastTokens--;
+    AF_BROADCAST_COUNT(afBroadcastStatistics.sent);
+    moduleResult_t result = afSendData(destinationEndpoint, sourceEndpoint, broadcastAddress, 
+                                       clusterId, data, dataLength);
+    if (result != MODULE_SUCCESS)
+    {
+        AF_BROADCAST_COUNT(afBroadcastStatistics.failed);
+    }
+    RETURN_RESULT(result, METHOD_AF_BROADCAST_SEND);
+}
+
+#define METHOD_AF_BROADCAST_DATA                    0x9100
+/** Sends a broadcast without overflowing the broadcast transaction table (BTT) of the Module and 
+of the routers that relay it. Every broadcast holds a BTT entry for AF_BROADCAST_DELIVERY_MS and a 
+broadcast is lost when the table is full, so a loop of broadcasts loses most of them. The rate is
+limited with a token bucket: up to AF_BROADCAST_BURST broadcasts are sent at once, then one more 
+each AF_BROADCAST_TOKEN_MS. Broadcasts above that rate are queued and sent in order by 
+afBroadcastTick(). A broadcast that is the same as one already in the queue (address, endpoints, 
+cluster and payload) is not queued again, e.g. a periodic announcement that couldn't be sent yet.
+@param broadcastAddress AF_BROADCAST_ALL_DEVICES, AF_BROADCAST_RX_ON_WHEN_IDLE or AF_BROADCAST_ROUTERS
+@see afSendData for description of the other fields.
+@return MODULE_SUCCESS if the broadcast was sent, queued or already queued, ZM_BROADCAST_QUEUE_FULL
+if it couldn't be queued, or an error as in afSendData() if it was sent and that failed.
+@see afBroadcastGetStatistics() for the number of broadcasts sent, queued etc.
+@note there is no delivery confirmation for a broadcast: the AF_DATA_CONFIRM only means that it was 
+transmitted.
+*/
+moduleResult_t afBroadcastData(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                               uint16_t broadcastAddress, uint16_t clusterId, 
+                               uint8_t* data, uint8_t dataLength)
+{
+    RETURN_INVALID_LENGTH_IF_TRUE( ((dataLength > MAXIMUM_PAYLOAD_LENGTH) || (dataLength == 0)), METHOD_AF_BROADCAST_DATA);
+    RETURN_INVALID_CLUSTER_IF_TRUE( (clusterId == 0), METHOD_AF_BROADCAST_DATA);
+    RETURN_INVALID_PARAMETER_IF_TRUE( ((broadcastAddress != AF_BROADCAST_ALL_DEVICES) && (broadcastAddress != AF_BROADCAST_RX_ON_WHEN_IDLE) && (broadcastAddress != AF_BROADCAST_ROUTERS)), METHOD_AF_BROADCAST_DATA);
+    RETURN_NULL_PARAMETER_IF_TRUE( (data == 0), METHOD_AF_BROADCAST_DATA);
+    
+    if ((afBroadcastCount == 0) && (afBroadcastTokens > 0))     //Queued broadcasts go first
+    {
+        RETURN_RESULT(afBroadcastSend(destinationEndpoint, sourceEndpoint, broadcastAddress, 
+                                      clusterId, data, dataLength), METHOD_AF_BROADCAST_DATA);
+    }
+    
+    uint8_t i;
+    for (i = 0; i < afBroadcastCount; i++)
+    {
+        struct afBroadcastEntry* e = &afBroadcastQueue[(afBroadcastHead + i) % AF_BROADCAST_QUEUE_SIZE];
+        if ((e->broadcastAddress == broadcastAddress) && (e->clusterId == clusterId) &&
+            (e->destinationEndpoint == destinationEndpoint) && (e->sourceEndpoint == sourceEndpoint) &&
+            (e->length == dataLength) && (memcmp(e->data, data, dataLength) == 0))
+        {
+            AF_BROADCAST_COUNT(afBroadcastStatistics.duplicates);
+            return MODULE_SUCCESS;
+        }
+    }
+    if (afBroadcastCount == AF_BROADCAST_QUEUE_SIZE)
+    {
+        AF_BROADCAST_COUNT(afBroadcastStatistics.dropped);
+        RETURN_RESULT(ZM_BROADCAST_QUEUE_FULL, METHOD_AF_BROADCAST_DATA);
+    }
+    struct afBroadcastEntry* e = &afBroadcastQueue[(afBroadcastHead + afBroadcastCount) % AF_BROADCAST_QUEUE_SIZE];
+    e->broadcastAddress = broadcastAddress;
+    e->clusterId = clusterId;
+    e->destinationEndpoint = destinationEndpoint;
+    e->sourceEndpoint = sourceEndpoint;
+    e->length = dataLength;
+    memcpy(e->data, data, dataLength);
+    afBroadcastCount++;
+    AF_BROADCAST_COUNT(afBroadcastStatistics.queued);
+    return MODULE_SUCCESS;
+}
+
+#define METHOD_AF_BROADCAST_TICK                    0x9200
+/** Adds the tokens for the time that has passed and sends the queued broadcasts that they allow. Call
+periodically, e.g. from the same timer as pipelineTick().
+@param elapsedMs time since the last call, in milliseconds
+@return MODULE_SUCCESS, or the error from the first broadcast that couldn't be sent. A broadcast is
+removed from the queue even if sending it fails.
+*/
+moduleResult_t afBroadcastTick(uint16_t elapsedMs)
+{
+    while ((elapsedMs > 0) && (afBroadcastTokens < AF_BROADCAST_BURST))
+    {
+        uint16_t needed = AF_BROADCAST_TOKEN_MS - afBroadcastTokenMs;
+        if (elapsedMs < needed)
+        {
+            afBroadcastTokenMs += elapsedMs;
+            break;
+        }
+        elapsedMs -= needed;
+        afBroadcastTokenMs = 0;
+        afBroadcastTokens++;
+    }
+    if (afBroadcastTokens == AF_BROADCAST_BURST)
+        afBroadcastTokenMs = 0;                         //a full bucket doesn't save up time
+    
+    moduleResult_t result = MODULE_SUCCESS;
+    while ((afBroadcastCount > 0) && (afBroadcastTokens > 0))
+    {
+        struct afBroadcastEntry* e = &afBroadcastQueue[afBroadcastHead];
+        afBroadcastHead = (afBroadcastHead + 1) % AF_BROADCAST_QUEUE_SIZE;
+        afBroadcastCount--;
+        moduleResult_t sendResult = afBroadcastSend(e->destinationEndpoint, e->sourceEndpoint, 
+                                                    e->broadcastAddress, e->clusterId, e->data, e->length);
+        if (result == MODULE_SUCCESS)
+            result = sendResult;
+    }
+    RETURN_RESULT(result, METHOD_AF_BROADCAST_TICK);
+}
+
+/** Returns the number of broadcasts in the queue of afBroadcastData() */
+uint8_t afBroadcastPending()
+{
+    return afBroadcastCount;
+}
+
+/** Returns the counters of afBroadcastData(), since the program started */
+const struct afBroadcastStatistics* afBroadcastGetStatistics()
+{
+    return &afBroadcastStatistics;
+}
+#endif
+
+#define AF_DATA_STORE_SREQ_FIELDS(L, F) \
+    F(L, INDEX, MT_U16) \
+    F(L, LENGTH, MT_U8) \
+    F(L, DATA, MT_VARIABLE)
+MT_LAYOUT(AF_DATA_STORE_SREQ);
+#define AF_DATA_STORE_FIT_LENGTH            (ZIGBEE_MODULE_BUFFER_SIZE - SRSP_HEADER_SIZE - MT_LENGTH(AF_DATA_STORE_SREQ))
+/** The maximum number of bytes in each AF_DATA_STORE. Less than MAXIMUM_DATA_STORE_PAYLOAD_LENGTH if
+the AF_DATA_STORE would not fit in zmBuf, e.g. on LaunchPad. */
+#define AF_DATA_STORE_CHUNK_LENGTH          ((AF_DATA_STORE_FIT_LENGTH < MAXIMUM_DATA_STORE_PAYLOAD_LENGTH) ? \
+                                             AF_DATA_STORE_FIT_LENGTH : MAXIMUM_DATA_STORE_PAYLOAD_LENGTH)
+
 #define METHOD_AF_DATA_STORE                    0x2400
-/** Upload a chunk of data to the Module. Private helper method for afSendDataExtended().
+/** Upload a chunk of data to the Module. Private helper method for afSendDataExtendedStream().
  * @param index where in the whole message this chunk of bytes should start
- * @param data the bytes to store
+ * @param source called to copy the bytes to store into the message
  * @param dataLength how many bytes to store. A length of zero is special and triggers the actually
  * sending of the data request over the air.
 */
-static moduleResult_t afDataStore(uint16_t index, uint8_t* data, uint8_t dataLength)
+static moduleResult_t afDataStore(uint16_t index, afDataSource_t source, uint8_t dataLength)
 {
-    RETURN_INVALID_LENGTH_IF_TRUE( (dataLength > MAXIMUM_DATA_STORE_PAYLOAD_LENGTH), METHOD_AF_DATA_STORE);
+    RETURN_INVALID_LENGTH_IF_TRUE( (dataLength > AF_DATA_STORE_CHUNK_LENGTH), METHOD_AF_DATA_STORE);
     
 #ifdef AF_VERBOSE     
     printf("Storing %u bytes starting at index %u\r\n", dataLength, index);
 #endif 
-#define AF_DATA_STORE_HEADER_LEN           3
-    zmBuf[0] = AF_DATA_STORE_HEADER_LEN + dataLength;
-    zmBuf[1] = MSB(AF_DATA_STORE);
-    zmBuf[2] = LSB(AF_DATA_STORE);  
-    
-    zmBuf[3] = LSB(index); 
-    zmBuf[4] = MSB(index);
-    zmBuf[5] = dataLength;
-    memcpy(zmBuf+AF_DATA_STORE_HEADER_LEN + 3, data, dataLength);
-    RETURN_RESULT(sendMessage(), METHOD_AF_DATA_STORE);
+    MT_PUT_U16(AF_DATA_STORE_SREQ_INDEX, index);
+    MT_PUT_U8(AF_DATA_STORE_SREQ_LENGTH, dataLength);
+    if (dataLength > 0)
+    {
+        RETURN_RESULT_IF_FAIL(source(index, MT_POINTER(AF_DATA_STORE_SREQ_DATA), dataLength), METHOD_AF_DATA_STORE);
+    }
+    RETURN_RESULT(mtSend(AF_DATA_STORE, MT_LENGTH(AF_DATA_STORE_SREQ) + dataLength), METHOD_AF_DATA_STORE);
 }
 
+/** The message being sent by afSendDataExtended(), for afMemorySource() */
+static uint8_t* afExtendedData;
+
+/** Data source for afSendDataExtended(): copies from the buffer given to afSendDataExtended() */
+static moduleResult_t afMemorySource(uint16_t index, uint8_t* destination, uint8_t length)
+{
+    memcpy(destination, afExtendedData + index, length);
+    return MODULE_SUCCESS;
+}
+
+#ifdef AF_COMPRESSION
+/** Data source for afSendDataExtended() when the payload is too long to be compressed: the 
+compression header, then the buffer given to afSendDataExtended() */
+static moduleResult_t afHeaderSource(uint16_t index, uint8_t* destination, uint8_t length)
+{
+    if (index == 0)
+    {
+        *destination++ = 0;
+        length--;
+    } else {
+        index -= AF_COMPRESSION_HEADER_LENGTH;
+    }
+    memcpy(destination, afExtendedData + index, length);
+    return MODULE_SUCCESS;
+}
+#endif
+
 //Note: no method ID since this is a simple wrapper method, and wrapped method does all error checking
 /** Simple wrapper function to send extended messages via short address.
 @see afSendData for description of these fields.
@@ -302,70 +966,128 @@ moduleResult_t afSendDataExtendedShort(uint8_t _destinationEndpoint, uint8_t _so
                               _clusterId, _data, _dataLength);
 }
 
-
-#define METHOD_AF_DATA_REQUEST_EXT                    0x2600
+//Note: no method ID since this is a simple wrapper method, and wrapped method does all error checking
 /** Sends a message using extended messaging. This is more flexible and allows for long addressing.
 @param destinationLongAddress If using short addressing then the first two bytes are the short address, 
 LSB first. Remaining 6 bytes are don't care. If using long addressing then this is the 8 byte MAC, and LSB first.
-@param destinationAddressMode Either DESTINATION_ADDRESS_MODE_LONG or DESTINATION_ADDRESS_MODE_SHORT
+@param destinationAddressMode DESTINATION_ADDRESS_MODE_LONG, DESTINATION_ADDRESS_MODE_SHORT, or
+DESTINATION_ADDRESS_MODE_GROUP in which case the first two bytes are the group ID, LSB first.
+@param dataLength length of data, up to AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH, or up to 
+AF_GROUP_MAX_DATA_LENGTH with DESTINATION_ADDRESS_MODE_GROUP, see afSendDataGroup().
 @see afSendData for description of remaining fields.
+@see afSendDataExtendedStream() to send a message without having all of it in RAM.
+@note with AF_COMPRESSION the payload is only compressed if it is at most 
+AF_COMPRESSION_MAX_EXTENDED_LENGTH, and dataLength must leave room for the compression header.
 */
 moduleResult_t afSendDataExtended(uint8_t destinationEndpoint, uint8_t sourceEndpoint,
                                   uint8_t* destinationAddress, uint8_t destinationAddressMode,
                                   uint16_t clusterId, uint8_t* data, uint16_t dataLength)
+{
+#ifdef AF_COMPRESSION
+    if ((dataLength > 0) && (dataLength <= AF_COMPRESSION_MAX_EXTENDED_LENGTH))
+    {
+        uint16_t length = afCompressPayload(data, dataLength, AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH);
+        if (length > 0)
+        {
+            afExtendedData = afCompressionBuffer;
+            return afSendDataExtendedStream(destinationEndpoint, sourceEndpoint, destinationAddress, 
+                                            destinationAddressMode, clusterId, &afMemorySource, length);
+        }
+    }
+    if (dataLength > 0)
+    {
+        afExtendedData = data;
+        return afSendDataExtendedStream(destinationEndpoint, sourceEndpoint, destinationAddress, 
+                                        destinationAddressMode, clusterId, &afHeaderSource, 
+                                        dataLength + AF_COMPRESSION_HEADER_LENGTH);
+    }
+#endif
+    afExtendedData = data;
+    return afSendDataExtendedStream(destinationEndpoint, sourceEndpoint, destinationAddress, 
+                                    destinationAddressMode, clusterId, &afMemorySource, dataLength);
+}
+
+#define AF_DATA_REQUEST_EXT_SREQ_FIELDS(L, F) \
+    F(L, DESTINATION_ADDRESS_MODE, MT_U8) \
+    F(L, DESTINATION_ADDRESS, MT_BYTES(8)) \
+    F(L, DESTINATION_ENDPOINT, MT_U8) \
+    F(L, DESTINATION_PAN_ID, MT_U16) \
+    F(L, SOURCE_ENDPOINT, MT_U8) \
+    F(L, CLUSTER_ID, MT_U16) \
+    F(L, TRANS_ID, MT_U8) \
+    F(L, OPTIONS, MT_U8) \
+    F(L, RADIUS, MT_U8) \
+    F(L, LENGTH, MT_U16) \
+    F(L, DATA, MT_VARIABLE)
+MT_LAYOUT(AF_DATA_REQUEST_EXT_SREQ);
+#define AF_DATA_REQUEST_EXT_FIT_LENGTH      (ZIGBEE_MODULE_BUFFER_SIZE - SRSP_HEADER_SIZE - MT_LENGTH(AF_DATA_REQUEST_EXT_SREQ))
+/** Largest payload that is sent in the AF_DATA_REQUEST_EXT itself instead of with AF_DATA_STORE. 
+Less than AF_DATA_REQUEST_EXT_MAX_PAYLOAD_LENGTH if the message would not fit in zmBuf. */
+#define AF_DATA_REQUEST_EXT_INLINE_LENGTH   ((AF_DATA_REQUEST_EXT_FIT_LENGTH < AF_DATA_REQUEST_EXT_MAX_PAYLOAD_LENGTH) ? \
+                                             AF_DATA_REQUEST_EXT_FIT_LENGTH : AF_DATA_REQUEST_EXT_MAX_PAYLOAD_LENGTH)
+
+#define METHOD_AF_DATA_REQUEST_EXT                    0x2600
+/** Sends a message using extended messaging, getting the payload from a data source one chunk at a 
+time instead of from one buffer. The chunks are copied straight into the AF_DATA_STORE messages, so 
+the whole message never needs to be in RAM, e.g. it can be read from EEPROM as it is sent.
+@param source called with consecutive parts of the payload, in order, as they are sent.
+@param dataLength total length of the payload, up to AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH, or
+up to AF_DATA_REQUEST_EXT_MAX_PAYLOAD_LENGTH with DESTINATION_ADDRESS_MODE_GROUP since Z-Stack only 
+fragments unicasts
+@note the payload is sent as given, also with AF_COMPRESSION: the source must supply the compression
+header as the first byte.
+@see afSendDataExtended for description of remaining fields.
+@return MODULE_SUCCESS, an error from the source, or error code as in afSendDataExtended().
+*/
+moduleResult_t afSendDataExtendedStream(uint8_t destinationEndpoint, uint8_t sourceEndpoint,
+                                        uint8_t* destinationAddress, uint8_t destinationAddressMode,
+                                        uint16_t clusterId, afDataSource_t source, uint16_t dataLength)
 {
     RETURN_INVALID_LENGTH_IF_TRUE( ((dataLength > AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH) || (dataLength == 0)), METHOD_AF_DATA_REQUEST_EXT);
+    RETURN_INVALID_LENGTH_IF_TRUE( ((destinationAddressMode == DESTINATION_ADDRESS_MODE_GROUP) && (dataLength > AF_DATA_REQUEST_EXT_MAX_PAYLOAD_LENGTH)), METHOD_AF_DATA_REQUEST_EXT);
     RETURN_INVALID_CLUSTER_IF_TRUE( (clusterId == 0), METHOD_AF_DATA_REQUEST_EXT);
-    RETURN_INVALID_PARAMETER_IF_TRUE( ((destinationAddressMode != DESTINATION_ADDRESS_MODE_SHORT) && (destinationAddressMode != DESTINATION_ADDRESS_MODE_LONG)), METHOD_AF_DATA_REQUEST_EXT);
+    RETURN_INVALID_PARAMETER_IF_TRUE( ((destinationAddressMode != DESTINATION_ADDRESS_MODE_SHORT) && (destinationAddressMode != DESTINATION_ADDRESS_MODE_LONG) && (destinationAddressMode != DESTINATION_ADDRESS_MODE_GROUP)), METHOD_AF_DATA_REQUEST_EXT);
+    RETURN_NULL_PARAMETER_IF_TRUE( (source == 0), METHOD_AF_DATA_REQUEST_EXT);
     
 #ifdef AF_VERBOSE     
-    char* destinationAddressModeName = (destinationAddressMode == DESTINATION_ADDRESS_MODE_LONG) ? "LONG" : "SHORT";
+    char* destinationAddressModeName = (destinationAddressMode == DESTINATION_ADDRESS_MODE_LONG) ? "LONG" : 
+        ((destinationAddressMode == DESTINATION_ADDRESS_MODE_GROUP) ? "GROUP" : "SHORT");
     printf("Sending EXT %u bytes to endpoint %u from endpoint %u with cluster %u (%04X) using addressing mode %u (%s) at Address ",
            dataLength, destinationEndpoint, sourceEndpoint, clusterId, clusterId, destinationAddressMode, destinationAddressModeName);
     printHexBytes(destinationAddress, 8);
 #endif  
-#define AF_DATA_REQUEST_EXT_HEADER_LEN  20
-    //zmBuf[0] = AF_DATA_REQUEST_EXT_HEADER_LEN + dataLength;
-    // Note: zmBuf[0] (length of this message) will be set below, based on whether the payload will fit in one message.
-    zmBuf[1] = MSB(AF_DATA_REQUEST_EXT);
-    zmBuf[2] = LSB(AF_DATA_REQUEST_EXT);      
-    zmBuf[3] = destinationAddressMode;
+    // Note: the length of this message will be set below, based on whether the payload will fit in one message.
+    MT_PUT_U8(AF_DATA_REQUEST_EXT_SREQ_DESTINATION_ADDRESS_MODE, destinationAddressMode);
     if (destinationAddressMode == DESTINATION_ADDRESS_MODE_LONG) 
     {
-        memcpy(zmBuf+4, destinationAddress, 8);
-    } else {  // short addressing
-        memcpy(zmBuf+4, destinationAddress, 2);  //remaining bytes are don't care
+        memcpy(MT_POINTER(AF_DATA_REQUEST_EXT_SREQ_DESTINATION_ADDRESS), destinationAddress, 8);
+    } else {  // short or group addressing
+        memcpy(MT_POINTER(AF_DATA_REQUEST_EXT_SREQ_DESTINATION_ADDRESS), destinationAddress, 2);  //remaining bytes are don't care
     } 
-    zmBuf[12] = destinationEndpoint;
-    zmBuf[13] = LSB(INTRA_PAN);
-    zmBuf[14] = MSB(INTRA_PAN);
-    zmBuf[15] = sourceEndpoint;
-    zmBuf[16] = LSB(clusterId); 
-    zmBuf[17] = MSB(clusterId); 
-    zmBuf[18] = transactionSequenceNumber;  //this value will get returned for use by higher level
-    zmBuf[19] = acknowledgmentMode;
-    zmBuf[20] = DEFAULT_RADIUS;
-    zmBuf[21] = LSB(dataLength); 
-    zmBuf[22] = MSB(dataLength); 
+    MT_PUT_U8(AF_DATA_REQUEST_EXT_SREQ_DESTINATION_ENDPOINT, destinationEndpoint);
+    MT_PUT_U16(AF_DATA_REQUEST_EXT_SREQ_DESTINATION_PAN_ID, INTRA_PAN);
+    MT_PUT_U8(AF_DATA_REQUEST_EXT_SREQ_SOURCE_ENDPOINT, sourceEndpoint);
+    MT_PUT_U16(AF_DATA_REQUEST_EXT_SREQ_CLUSTER_ID, clusterId);
+    MT_PUT_U8(AF_DATA_REQUEST_EXT_SREQ_TRANS_ID, transactionSequenceNumber);  //this value will get returned for use by higher level
+    MT_PUT_U8(AF_DATA_REQUEST_EXT_SREQ_OPTIONS, acknowledgmentMode);
+    MT_PUT_U8(AF_DATA_REQUEST_EXT_SREQ_RADIUS, DEFAULT_RADIUS);
+    MT_PUT_U16(AF_DATA_REQUEST_EXT_SREQ_LENGTH, dataLength);
     transactionSequenceNumber++;
-
-#define AF_DATA_REQUEST_EXT_SRSP_STATUS_FIELD   SRSP_PAYLOAD_START
     
     /* if payload IS short enough, then include it in this message and send the message just like sendMessage() */
-    if (dataLength <= AF_DATA_REQUEST_EXT_MAX_PAYLOAD_LENGTH)                       
+    if (dataLength <= AF_DATA_REQUEST_EXT_INLINE_LENGTH)                       
     {
-        zmBuf[0] = AF_DATA_REQUEST_EXT_HEADER_LEN + dataLength;        
 #ifdef AF_VERBOSE
-        printf("Sending all in one message since dataLength %u < AF_DATA_REQUEST_EXT_MAX_PAYLOAD_LENGTH %u\r\n", dataLength, AF_DATA_REQUEST_EXT_MAX_PAYLOAD_LENGTH);
+        printf("Sending all in one message since dataLength %u < AF_DATA_REQUEST_EXT_INLINE_LENGTH %u\r\n", dataLength, AF_DATA_REQUEST_EXT_INLINE_LENGTH);
 #endif
-        memcpy(zmBuf+AF_DATA_REQUEST_EXT_HEADER_LEN+3, data, dataLength);
+        RETURN_RESULT_IF_FAIL(source(0, MT_POINTER(AF_DATA_REQUEST_EXT_SREQ_DATA), dataLength), METHOD_AF_DATA_REQUEST_EXT);
         
 #ifdef AF_DATA_CONFIRM_HANDLED_BY_APPLICATION           //Return control to main application
-        RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_AF_DATA_REQUEST_EXT);         
-        RETURN_RESULT(zmBuf[AF_DATA_REQUEST_EXT_SRSP_STATUS_FIELD], METHOD_AF_DATA_REQUEST_EXT);          
+        RETURN_RESULT_IF_FAIL(mtSend(AF_DATA_REQUEST_EXT, MT_LENGTH(AF_DATA_REQUEST_EXT_SREQ) + dataLength), METHOD_AF_DATA_REQUEST_EXT);         
+        RETURN_RESULT(MT_GET_U8(AF_DATA_REQUEST_SRSP_STATUS), METHOD_AF_DATA_REQUEST_EXT);          
 #else
-        RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_AF_DATA_REQUEST_EXT); 
-        RETURN_RESULT_IF_FAIL(zmBuf[AF_DATA_REQUEST_EXT_SRSP_STATUS_FIELD], METHOD_AF_DATA_REQUEST_EXT);       
+        RETURN_RESULT_IF_FAIL(mtSend(AF_DATA_REQUEST_EXT, MT_LENGTH(AF_DATA_REQUEST_EXT_SREQ) + dataLength), METHOD_AF_DATA_REQUEST_EXT); 
+        RETURN_RESULT_IF_FAIL(MT_GET_U8(AF_DATA_REQUEST_SRSP_STATUS), METHOD_AF_DATA_REQUEST_EXT);       
         
 #define AF_DATA_CONFIRM_TIMEOUT 2
         RETURN_RESULT_IF_FAIL(waitForMessage(AF_DATA_CONFIRM, AF_DATA_CONFIRM_TIMEOUT), METHOD_AF_DATA_REQUEST_EXT);
@@ -374,11 +1096,10 @@ moduleResult_t afSendDataExtended(uint8_t destinationEndpoint, uint8_t sourceEnd
 #endif
         //all done!
     } else {
-        zmBuf[0] = AF_DATA_REQUEST_EXT_HEADER_LEN; // no payload included in this message.
-        /* The message was larger than could fit into one message, so send the AF_DATA_REQUEST_EXT and then store the data */
-        RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_AF_DATA_REQUEST_EXT);
+        /* The message was larger than could fit into one message, so send the AF_DATA_REQUEST_EXT without payload and then store the data */
+        RETURN_RESULT_IF_FAIL(mtSend(AF_DATA_REQUEST_EXT, MT_LENGTH(AF_DATA_REQUEST_EXT_SREQ)), METHOD_AF_DATA_REQUEST_EXT);
         /* Verify that we received a "Success" status back from the module */
-        RETURN_RESULT_IF_FAIL(zmBuf[AF_DATA_REQUEST_EXT_SRSP_STATUS_FIELD], METHOD_AF_DATA_REQUEST_EXT);  
+        RETURN_RESULT_IF_FAIL(MT_GET_U8(AF_DATA_REQUEST_SRSP_STATUS), METHOD_AF_DATA_REQUEST_EXT);  
         
         /* Index in the Module data buffer. This will be sent to the Module */
         uint16_t totalMessageIndex = 0;
@@ -388,14 +1109,14 @@ moduleResult_t afSendDataExtended(uint8_t destinationEndpoint, uint8_t sourceEnd
             /* How many bytes to send in this afDataStore message */
             uint8_t bytesToSend = 0;
             
-            if (dataLength > MAXIMUM_DATA_STORE_PAYLOAD_LENGTH)  // If more bytes than what will fit in one message..
+            if (dataLength > AF_DATA_STORE_CHUNK_LENGTH)         // If more bytes than what will fit in one message..
             {
-                bytesToSend = MAXIMUM_DATA_STORE_PAYLOAD_LENGTH; // ...then only send MAXIMUM_DATA_STORE_PAYLOAD_LENGTH bytes
+                bytesToSend = AF_DATA_STORE_CHUNK_LENGTH;        // ...then only send AF_DATA_STORE_CHUNK_LENGTH bytes
             } else {
                 bytesToSend = dataLength;                        // ...otherwise it will all fit in one afDataStore message
             }
 
-            RETURN_RESULT_IF_FAIL(afDataStore(totalMessageIndex, (data + totalMessageIndex), bytesToSend), METHOD_AF_DATA_REQUEST_EXT);  //store each chunk of the total message
+            RETURN_RESULT_IF_FAIL(afDataStore(totalMessageIndex, source, bytesToSend), METHOD_AF_DATA_REQUEST_EXT);  //store each chunk of the total message
             
             dataLength -= bytesToSend;                          // decrement our byte counter
             totalMessageIndex += bytesToSend;					// increment our total message counter
@@ -406,21 +1127,87 @@ moduleResult_t afSendDataExtended(uint8_t destinationEndpoint, uint8_t sourceEnd
         }
         
 #ifdef AF_DATA_CONFIRM_HANDLED_BY_APPLICATION
-        RETURN_RESULT(afDataStore(0, data, 0), METHOD_AF_DATA_REQUEST_EXT);
+        RETURN_RESULT(afDataStore(0, source, 0), METHOD_AF_DATA_REQUEST_EXT);
 #else
         /* Now we send a final afDataStore with length of 0 to indicate that we're done sending data */
-        RETURN_RESULT_IF_FAIL(afDataStore(0, data, 0), METHOD_AF_DATA_REQUEST_EXT);
+        RETURN_RESULT_IF_FAIL(afDataStore(0, source, 0), METHOD_AF_DATA_REQUEST_EXT);
         RETURN_RESULT(waitForMessage(AF_DATA_CONFIRM, AF_DATA_CONFIRM_TIMEOUT), METHOD_AF_DATA_REQUEST_EXT);
 #endif
     }
 }
 
+#define METHOD_AF_SEND_DATA_GROUP                    0x9600
+/** Sends one message to every device that has added destinationEndpoint to the group, with a single
+broadcast instead of a unicast to each device. Group messages are not acknowledged by the receivers: 
+the AF_DATA_CONFIRM only means that the message was transmitted.
+@param groupId the group, as given to afAddGroup() on the receiving devices
+@param dataLength length of data, at most AF_GROUP_MAX_DATA_LENGTH. Z-Stack only fragments unicasts,
+so unlike afSendDataExtended() a group message can't be longer than one AF_DATA_REQUEST_EXT.
+@see afSendDataExtended for description of remaining fields.
+@return INVALID_LENGTH if dataLength is too long, else the result of afSendDataExtended()
+*/
+moduleResult_t afSendDataGroup(uint8_t destinationEndpoint, uint8_t sourceEndpoint, uint16_t groupId, 
+                               uint16_t clusterId, uint8_t* data, uint16_t dataLength)
+{
+    RETURN_INVALID_LENGTH_IF_TRUE( (dataLength > AF_GROUP_MAX_DATA_LENGTH), METHOD_AF_SEND_DATA_GROUP);
+    uint8_t address[8];
+    address[0] = LSB(groupId);
+    address[1] = MSB(groupId);
+    return afSendDataExtended(destinationEndpoint, sourceEndpoint, address, DESTINATION_ADDRESS_MODE_GROUP,
+                              clusterId, data, dataLength);
+}
+
+#define METHOD_AF_ADD_GROUP                    0x2000
+/** Adds an endpoint of this device to a group, so that messages sent to the group with 
+afSendDataGroup() are received on that endpoint. Group membership is kept in the Module's NV memory,
+so it survives a reset unless the network state is cleared with STARTOPT_CLEAR_STATE.
+@pre application has been registered on endpoint with afRegisterApplication()
+@pre Module firmware includes MT_ZDO_EXTENSIONS
+@param endpoint the endpoint that joins the group
+@param groupId the group to join
+@return MODULE_SUCCESS, or the status from the Module, e.g. if the group table is full.
+*/
+moduleResult_t afAddGroup(uint8_t endpoint, uint16_t groupId)
+{
+    RETURN_INVALID_PARAMETER_IF_TRUE( (endpoint == 0), METHOD_AF_ADD_GROUP);
+    MT_PUT_U8(ZDO_EXT_ADD_GROUP_SREQ_ENDPOINT, endpoint);
+    MT_PUT_U16(ZDO_EXT_ADD_GROUP_SREQ_GROUP_ID, groupId);
+    MT_PUT_U8(ZDO_EXT_ADD_GROUP_SREQ_NAME_LENGTH, 0);
+    RETURN_RESULT(mtRequest(ZDO_EXT_ADD_GROUP, MT_LENGTH(ZDO_EXT_ADD_GROUP_SREQ)), METHOD_AF_ADD_GROUP);
+}
+
+#define METHOD_AF_REMOVE_GROUP                    0x2500
+/** Removes an endpoint of this device from a group.
+@pre Module firmware includes MT_ZDO_EXTENSIONS
+@param endpoint the endpoint that leaves the group
+@param groupId the group to leave
+@return MODULE_SUCCESS, or the status from the Module, e.g. if the endpoint was not in the group.
+*/
+moduleResult_t afRemoveGroup(uint8_t endpoint, uint16_t groupId)
+{
+    RETURN_INVALID_PARAMETER_IF_TRUE( (endpoint == 0), METHOD_AF_REMOVE_GROUP);
+    MT_PUT_U8(ZDO_EXT_REMOVE_GROUP_SREQ_ENDPOINT, endpoint);
+    MT_PUT_U16(ZDO_EXT_REMOVE_GROUP_SREQ_GROUP_ID, groupId);
+    RETURN_RESULT(mtRequest(ZDO_EXT_REMOVE_GROUP, MT_LENGTH(ZDO_EXT_REMOVE_GROUP_SREQ)), METHOD_AF_REMOVE_GROUP);
+}
+
+#define AF_DATA_RETRIEVE_SREQ_FIELDS(L, F) \
+    F(L, TIMESTAMP, MT_BYTES(4)) \
+    F(L, INDEX, MT_U16) \
+    F(L, LENGTH, MT_U8)
+MT_LAYOUT(AF_DATA_RETRIEVE_SREQ);
+#define AF_DATA_RETRIEVE_FIT_LENGTH         (ZIGBEE_MODULE_BUFFER_SIZE - SRSP_HEADER_SIZE - MT_LENGTH(AF_DATA_RETRIEVE_SRSP))
+/** The maximum number of bytes in each AF_DATA_RETRIEVE. Less than 
+MAXIMUM_AF_DATA_RETRIEVE_PAYLOAD_LENGTH if the SRSP would not fit in zmBuf, e.g. on LaunchPad. */
+#define AF_DATA_RETRIEVE_CHUNK_LENGTH       ((AF_DATA_RETRIEVE_FIT_LENGTH < MAXIMUM_AF_DATA_RETRIEVE_PAYLOAD_LENGTH) ? \
+                                             AF_DATA_RETRIEVE_FIT_LENGTH : MAXIMUM_AF_DATA_RETRIEVE_PAYLOAD_LENGTH)
+
 #define METHOD_AF_DATA_RETRIEVE                    0x2700
 /** Private method used to retrieve bytes from the Module message store.
 @pre a AF_INCOMING_MSG_EXT was received
 @param timestamp the timestamp of the AF_INCOMING_MSG_EXT message, to identify the message
 @param index where to start the retrieval inside the Module's message store
-@param dataLength how many bytes to retrieve. Must be less than MAXIMUM_AF_DATA_RETRIEVE_PAYLOAD_LENGTH.
+@param dataLength how many bytes to retrieve. Must be less than AF_DATA_RETRIEVE_CHUNK_LENGTH.
 A length of zero is special and triggers the freeing of the corresponding incoming message
 @return MODULE_SUCCESS, or error code
 */
@@ -430,40 +1217,61 @@ static moduleResult_t afDataRetrieve(uint8_t* timestamp, uint16_t index, uint8_t
     printf("afDataRetrieve: index=%u, dataLength=%u, timestamp= ", index, dataLength);
     printHexBytes(timestamp, 4);
 #endif
-    RETURN_INVALID_LENGTH_IF_TRUE( (dataLength > MAXIMUM_AF_DATA_RETRIEVE_PAYLOAD_LENGTH), METHOD_AF_DATA_RETRIEVE);
-    
-#define AF_DATA_RETRIEVE_PAYLOAD_LEN                7    
-    zmBuf[0] = AF_DATA_RETRIEVE_PAYLOAD_LEN;
-    zmBuf[1] = MSB(AF_DATA_RETRIEVE);
-    zmBuf[2] = LSB(AF_DATA_RETRIEVE);      
+    RETURN_INVALID_LENGTH_IF_TRUE( (dataLength > AF_DATA_RETRIEVE_CHUNK_LENGTH), METHOD_AF_DATA_RETRIEVE);
     
-    memcpy(zmBuf+3, timestamp, 4);
-    zmBuf[7] = LSB(index);
-    zmBuf[8] = MSB(index);
-    zmBuf[9] = dataLength;
-    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_AF_DATA_RETRIEVE); 
-    RETURN_RESULT(zmBuf[AF_DATA_RETRIEVE_SRSP_STATUS_FIELD], METHOD_AF_DATA_RETRIEVE);
+    memcpy(MT_POINTER(AF_DATA_RETRIEVE_SREQ_TIMESTAMP), timestamp, 4);
+    MT_PUT_U16(AF_DATA_RETRIEVE_SREQ_INDEX, index);
+    MT_PUT_U8(AF_DATA_RETRIEVE_SREQ_LENGTH, dataLength);
+    RETURN_RESULT(mtRequest(AF_DATA_RETRIEVE, MT_LENGTH(AF_DATA_RETRIEVE_SREQ)), METHOD_AF_DATA_RETRIEVE);
 }
 
-#define METHOD_AF_RETRIEVE_EXTENDED_MESSAGE                    0x2800
+/** Where retrieveExtendedMessage() is copying the message to, for afMemorySink() */
+static uint8_t* afExtendedDestination;
+
+/** Data sink for retrieveExtendedMessage(): copies to the buffer given to retrieveExtendedMessage() */
+static moduleResult_t afMemorySink(uint16_t index, const uint8_t* data, uint8_t length)
+{
+    memcpy(afExtendedDestination + index, data, length);
+    return MODULE_SUCCESS;
+}
+
+//Note: no method ID since this is a simple wrapper method, and wrapped method does all error checking
 /** Retrieves all bytes of an AF_INCOMING_MESSAGE_EXT using multiple calls to AF_DATA_RETRIEVE as necessary.
 @pre destinationPtr points to memory large enough to contain the entire message (500B?)
 @param ts the timestamp of the message to retrieve.
 @param destinationPtr where to copy the bytes
 @param length of message payload to retrieve. Must be less than AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH.
 @post message will be copied into destinationPtr.
+@see retrieveExtendedMessageStream() to process the message without having all of it in RAM.
 */
 moduleResult_t retrieveExtendedMessage(uint8_t* ts, uint16_t length, uint8_t* destinationPtr)
+{
+    afExtendedDestination = destinationPtr;
+    return retrieveExtendedMessageStream(ts, length, &afMemorySink);
+}
+
+#define METHOD_AF_RETRIEVE_EXTENDED_MESSAGE                    0x2800
+/** Retrieves all bytes of an AF_INCOMING_MESSAGE_EXT and gives each chunk to a data sink as soon as 
+it has been received, so the message can be processed while it is retrieved without a buffer for all
+of it.
+@param ts the timestamp of the message to retrieve.
+@param length of message payload to retrieve. Must be less than AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH.
+@param sink called with consecutive parts of the payload, in order. If it returns an error then the 
+retrieval stops, the message is freed and that error is returned.
+@return MODULE_SUCCESS, an error from the sink, or error code from AF_DATA_RETRIEVE.
+*/
+moduleResult_t retrieveExtendedMessageStream(uint8_t* ts, uint16_t length, afDataSink_t sink)
 {
     RETURN_INVALID_LENGTH_IF_TRUE( ((length > AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH) ||
                                     (length == 0)), METHOD_AF_RETRIEVE_EXTENDED_MESSAGE);    
+    RETURN_NULL_PARAMETER_IF_TRUE( (sink == 0), METHOD_AF_RETRIEVE_EXTENDED_MESSAGE);
     
 #ifdef AF_VERBOSE    
     printf("Getting Extended Message, L%u, timestamp = ", length);
     printHexBytes(ts, 4);
 #endif
     
-    /* Index in the destinationPtr buffer containing the bytes we're writing. Will be sent to the Module */
+    /* Index in the message of the bytes we're retrieving. Will be sent to the Module */
     uint16_t totalMessageIndex = 0;
     
     /* This identifies which message we are retrieving. Basically a unique ID of the message */
@@ -473,9 +1281,9 @@ moduleResult_t retrieveExtendedMessage(uint8_t* ts, uint16_t length, uint8_t* de
     while (length > 0)  //while there are remaining bytes to be retrieved
     {
         uint8_t bytesToGet = 0;
-        if (length > MAXIMUM_AF_DATA_RETRIEVE_PAYLOAD_LENGTH)       // If the number of remaining bytes is more than what will fit in a message
+        if (length > AF_DATA_RETRIEVE_CHUNK_LENGTH)                 // If the number of remaining bytes is more than what will fit in a message
         {
-            bytesToGet = MAXIMUM_AF_DATA_RETRIEVE_PAYLOAD_LENGTH;   // then only get as many as will fit
+            bytesToGet = AF_DATA_RETRIEVE_CHUNK_LENGTH;             // then only get as many as will fit
         } else {
             bytesToGet = length;                                    // otherwise get all that are remaining
         }
@@ -484,7 +1292,12 @@ moduleResult_t retrieveExtendedMessage(uint8_t* ts, uint16_t length, uint8_t* de
 #endif 
         
         RETURN_RESULT_IF_FAIL(afDataRetrieve(timestamp, totalMessageIndex, bytesToGet), METHOD_AF_RETRIEVE_EXTENDED_MESSAGE);
-        memcpy(destinationPtr + totalMessageIndex, zmBuf+AF_DATA_RETRIEVE_SRSP_PAYLOAD_START_FIELD, bytesToGet); //copy this message's payload to the destination
+        moduleResult_t sinkResult = sink(totalMessageIndex, MT_POINTER(AF_DATA_RETRIEVE_SRSP_DATA), bytesToGet);
+        if (sinkResult != MODULE_SUCCESS)
+        {
+            afDataRetrieve(timestamp, 0, 0);                        // Free the message anyway
+            RETURN_RESULT(sinkResult, METHOD_AF_RETRIEVE_EXTENDED_MESSAGE);
+        }
         totalMessageIndex += bytesToGet;
         length -= bytesToGet;
     }
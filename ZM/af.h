@@ -36,27 +36,196 @@
 
 #include "application_configuration.h"
 #include "module_errors.h"
+#include "zm_frame.h"
+#include "zm_pipeline.h"
+#include "zm_mt.h"
 #include <stdint.h>
 
+/** Supplies part of the payload of an extended message as it is sent, see afSendDataExtendedStream().
+Must copy length bytes of the payload, starting at index, to destination. Must not call any library
+methods since destination points into zmBuf. Returns MODULE_SUCCESS, or an error to stop sending. */
+typedef moduleResult_t (*afDataSource_t)(uint16_t index, uint8_t* destination, uint8_t length);
+
+/** Consumes part of the payload of an extended message as it is received, see 
+retrieveExtendedMessageStream(). data holds length bytes of the payload starting at index; it points 
+into zmBuf so copy what is needed before calling any library methods. Returns MODULE_SUCCESS, or an 
+error to stop retrieving. */
+typedef moduleResult_t (*afDataSink_t)(uint16_t index, const uint8_t* data, uint8_t length);
+
 uint8_t getTransactionSequenceNumber();
 moduleResult_t afRegisterApplication(const struct applicationConfiguration* ac);
 moduleResult_t afRegisterGenericApplication();
 moduleResult_t afSendData(uint8_t destinationEndpoint, uint8_t sourceEndpoint,
                       uint16_t destinationShortAddress, uint16_t clusterId, 
                       uint8_t* data, uint8_t dataLength);
+moduleResult_t afBuildData(frameHandle_t frame, uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                           uint16_t destinationShortAddress, uint16_t clusterId, 
+                           uint8_t* data, uint8_t dataLength);
+moduleResult_t afSendDataAsync(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                               uint16_t destinationShortAddress, uint16_t clusterId, 
+                               uint8_t* data, uint8_t dataLength, 
+                               requestCallback_t callback, requestToken_t* token);
+moduleResult_t afSendDataWindowed(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                                  uint16_t destinationShortAddress, uint16_t clusterId, 
+                                  uint8_t* data, uint8_t dataLength, requestCallback_t callback);
+void afWindowFlush();
+uint8_t afWindowOutstanding();
+#ifdef AF_AGGREGATE
+moduleResult_t afAggregateData(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                               uint16_t destinationShortAddress, uint16_t clusterId, 
+                               uint8_t* data, uint8_t dataLength);
+moduleResult_t afAggregateTick(uint16_t elapsedMs);
+moduleResult_t afAggregateFlush();
+#endif
+moduleResult_t afDeaggregate(const uint8_t* data, uint8_t dataLength, afDataSink_t sink);
+#ifdef AF_BROADCAST
+moduleResult_t afBroadcastData(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                               uint16_t broadcastAddress, uint16_t clusterId, 
+                               uint8_t* data, uint8_t dataLength);
+moduleResult_t afBroadcastTick(uint16_t elapsedMs);
+uint8_t afBroadcastPending();
+const struct afBroadcastStatistics* afBroadcastGetStatistics();
+#endif
 moduleResult_t afSendDataExtended(uint8_t destinationEndpoint, uint8_t sourceEndpoint,
                         uint8_t* destinationAddress, uint8_t destinationAddressMode,
                         uint16_t clusterId, uint8_t* data, uint16_t dataLength);
 moduleResult_t afSendDataExtendedShort(uint8_t _destinationEndpoint, uint8_t _sourceEndpoint,
                                        uint16_t _destinationShortAddress, 
                                        uint16_t _clusterId, uint8_t* _data, uint16_t _dataLength);
+moduleResult_t afSendDataExtendedStream(uint8_t destinationEndpoint, uint8_t sourceEndpoint,
+                                        uint8_t* destinationAddress, uint8_t destinationAddressMode,
+                                        uint16_t clusterId, afDataSource_t source, uint16_t dataLength);
+moduleResult_t afSendDataGroup(uint8_t destinationEndpoint, uint8_t sourceEndpoint, uint16_t groupId, 
+                               uint16_t clusterId, uint8_t* data, uint16_t dataLength);
+moduleResult_t afAddGroup(uint8_t endpoint, uint16_t groupId);
+moduleResult_t afRemoveGroup(uint8_t endpoint, uint16_t groupId);
 moduleResult_t retrieveExtendedMessage(uint8_t* ts, uint16_t length, uint8_t* destinationPtr);
+moduleResult_t retrieveExtendedMessageStream(uint8_t* ts, uint16_t length, afDataSink_t sink);
 
 int16_t printAfIncomingMsgHeader(uint8_t* srsp);
 void printAfIncomingMsgHeaderNames();
 
 moduleResult_t afSetAckMode(uint8_t ackMode);
 inline uint8_t getAckMode();
+#ifdef AF_COMPRESSION
+moduleResult_t afSetCompression(uint8_t enabled);
+moduleResult_t afDecompressMessage();
+#endif
+
+/** With AF_COMPRESSION every payload starts with a header byte; AF_COMPRESSION_FLAG_COMPRESSED is set
+if the rest of the payload is compressed with compressData(), else the rest is the payload as given. */
+#ifdef AF_COMPRESSION
+#define AF_COMPRESSION_HEADER_LENGTH    1
+#else
+#define AF_COMPRESSION_HEADER_LENGTH    0
+#endif
+#define AF_COMPRESSION_FLAG_COMPRESSED  0x80
+
+/** Longest payload that afSendData() always accepts. Longer ones, up to MAXIMUM_PAYLOAD_LENGTH, are 
+only accepted with AF_COMPRESSION if they can be compressed. */
+#define AF_MAXIMUM_DATA_LENGTH          (MAXIMUM_PAYLOAD_LENGTH - AF_COMPRESSION_HEADER_LENGTH)
+
+/** Holds a payload while it is compressed or decompressed. Received messages must decompress to 
+this size, and extended messages are only sent compressed if they compress to it. */
+#ifndef AF_COMPRESSION_BUFFER_SIZE
+#define AF_COMPRESSION_BUFFER_SIZE      (ZIGBEE_MODULE_BUFFER_SIZE - AF_INCOMING_MESSAGE_PAYLOAD_START_FIELD)
+#endif
+
+/** Longest payload of afSendDataExtended() that is compressed. The receiver decompresses the payload
+in zmBuf, so longer ones are sent with a header that says they are not compressed. */
+#define AF_COMPRESSION_MAX_EXTENDED_LENGTH  (ZIGBEE_MODULE_BUFFER_SIZE - AF_INCOMING_MESSAGE_EXT_PAYLOAD_START_FIELD)
+
+/** Maximum number of messages sent with afSendDataWindowed() that may be waiting for their 
+AF_DATA_CONFIRM at once. Limited by the size of the request pipeline. */
+#ifndef AF_SEND_WINDOW
+#if (ZM_PIPELINE_SIZE < 4)
+#define AF_SEND_WINDOW                  ZM_PIPELINE_SIZE
+#else
+#define AF_SEND_WINDOW                  4
+#endif
+#endif
+#if (AF_SEND_WINDOW < 1) || (AF_SEND_WINDOW > ZM_PIPELINE_SIZE)
+#error "AF_SEND_WINDOW must be 1 .. ZM_PIPELINE_SIZE"
+#endif
+
+#ifdef AF_AGGREGATE
+/** Number of destinations (address, endpoints and cluster) that afAggregateData() can collect 
+messages for at once. Each uses AF_MAXIMUM_DATA_LENGTH + 8 bytes of RAM. */
+#ifndef AF_AGGREGATE_BUFFERS
+#ifdef LAUNCHPAD                        // LaunchPad is RAM limited
+#define AF_AGGREGATE_BUFFERS            1
+#else
+#define AF_AGGREGATE_BUFFERS            2
+#endif
+#endif
+#if (AF_AGGREGATE_BUFFERS < 1)
+#error "AF_AGGREGATE_BUFFERS must be at least 1"
+#endif
+
+/** Longest time that a message waits in afAggregateData() for others to the same destination */
+#ifndef AF_AGGREGATE_FLUSH_MS
+#define AF_AGGREGATE_FLUSH_MS           50
+#endif
+
+/** Collected messages are sent as soon as they fill this many bytes of the payload */
+#ifndef AF_AGGREGATE_FLUSH_LENGTH
+#define AF_AGGREGATE_FLUSH_LENGTH       (AF_MAXIMUM_DATA_LENGTH - 8)
+#endif
+#endif
+
+/** Each message in an aggregated payload is preceded by its length */
+#define AF_AGGREGATE_HEADER_LENGTH      1
+#define AF_AGGREGATE_MAX_DATA_LENGTH    (AF_MAXIMUM_DATA_LENGTH - AF_AGGREGATE_HEADER_LENGTH)
+
+//Broadcast addresses for afSendData() and afBroadcastData()
+#define AF_BROADCAST_ALL_DEVICES        0xFFFF
+#define AF_BROADCAST_RX_ON_WHEN_IDLE    0xFFFD
+#define AF_BROADCAST_ROUTERS            0xFFFC
+
+#ifdef AF_BROADCAST
+/** Entries in the broadcast transaction table (BTT) of the Module, MAX_BCAST in the Module firmware. 
+Each broadcast holds an entry for AF_BROADCAST_DELIVERY_MS, on this device and on every router 
+that relays it; a broadcast is dropped when the table is full. */
+#define AF_BROADCAST_TABLE_SIZE         9
+#define AF_BROADCAST_DELIVERY_MS        3000
+
+/** Broadcasts that afBroadcastData() sends at once before it starts to queue them */
+#ifndef AF_BROADCAST_BURST
+#define AF_BROADCAST_BURST              4
+#endif
+
+/** Time for one more broadcast to be allowed, up to AF_BROADCAST_BURST */
+#ifndef AF_BROADCAST_TOKEN_MS
+#define AF_BROADCAST_TOKEN_MS           1000
+#endif
+
+//Over any AF_BROADCAST_DELIVERY_MS, leave at least one BTT entry for the stack's own broadcasts
+#if ((AF_BROADCAST_BURST + (AF_BROADCAST_DELIVERY_MS / AF_BROADCAST_TOKEN_MS)) >= AF_BROADCAST_TABLE_SIZE)
+#error "AF_BROADCAST_BURST and AF_BROADCAST_TOKEN_MS would overflow the broadcast transaction table"
+#endif
+
+/** Broadcasts that can wait to be sent. Each uses MAXIMUM_PAYLOAD_LENGTH + 7 bytes of RAM. */
+#ifndef AF_BROADCAST_QUEUE_SIZE
+#ifdef LAUNCHPAD                        // LaunchPad is RAM limited
+#define AF_BROADCAST_QUEUE_SIZE         2
+#else
+#define AF_BROADCAST_QUEUE_SIZE         4
+#endif
+#endif
+#if (AF_BROADCAST_QUEUE_SIZE < 1)
+#error "AF_BROADCAST_QUEUE_SIZE must be at least 1"
+#endif
+
+/** Counters of afBroadcastData(). Counts saturate instead of wrapping. */
+struct afBroadcastStatistics
+{
+    uint16_t sent;                      //broadcasts given to the Module
+    uint16_t queued;                    //broadcasts that had to wait for a token
+    uint16_t duplicates;                //broadcasts not queued since the same one was already waiting
+    uint16_t dropped;                   //broadcasts not queued since the queue was full
+    uint16_t failed;                    //broadcasts that the Module returned an error for
+};
+#endif
 
 //For options field of afSendData()
 #define AF_MAC_ACK                         0x00    //Require Acknowledgement from next device on route
@@ -103,9 +272,14 @@ inline uint8_t getAckMode();
 
 #define IS_AF_INCOMING_MESSAGE_EXT()                    (CONVERT_TO_INT(zmBuf[SRSP_CMD_LSB_FIELD], zmBuf[SRSP_CMD_MSB_FIELD]) == AF_INCOMING_MSG_EXT)
 
-#define AF_DATA_RETRIEVE_SRSP_STATUS_FIELD              (SRSP_PAYLOAD_START)
-#define AF_DATA_RETRIEVE_SRSP_LENGTH_FIELD              (SRSP_PAYLOAD_START+1)
-#define AF_DATA_RETRIEVE_SRSP_PAYLOAD_START_FIELD       (SRSP_PAYLOAD_START+2)
+#define AF_DATA_RETRIEVE_SRSP_FIELDS(L, F) \
+    F(L, STATUS, MT_U8) \
+    F(L, LENGTH, MT_U8) \
+    F(L, DATA, MT_VARIABLE)
+MT_LAYOUT(AF_DATA_RETRIEVE_SRSP);
+#define AF_DATA_RETRIEVE_SRSP_STATUS_FIELD              MT_INDEX(AF_DATA_RETRIEVE_SRSP_STATUS)
+#define AF_DATA_RETRIEVE_SRSP_LENGTH_FIELD              MT_INDEX(AF_DATA_RETRIEVE_SRSP_LENGTH)
+#define AF_DATA_RETRIEVE_SRSP_PAYLOAD_START_FIELD       MT_INDEX(AF_DATA_RETRIEVE_SRSP_DATA)
 
 #define AF_DATA_CONFIRM_STATUS_FIELD                    (SRSP_PAYLOAD_START)
 #define AF_DATA_CONFIRM_ENDPOINT_FIELD                  (SRSP_PAYLOAD_START+1)
@@ -117,6 +291,7 @@ inline uint8_t getAckMode();
 
 
 //for extended messages - AF_DATA_REQUEST_EXT, etc.
+#define DESTINATION_ADDRESS_MODE_GROUP 1
 #define DESTINATION_ADDRESS_MODE_SHORT 2
 #define DESTINATION_ADDRESS_MODE_LONG 3
 #define INTRA_PAN 0  //same PAN
@@ -124,5 +299,19 @@ inline uint8_t getAckMode();
 #define AF_DATA_REQUEST_EXT_MAX_PAYLOAD_LENGTH 230
 #define MAXIMUM_AF_DATA_RETRIEVE_PAYLOAD_LENGTH 248
 #define AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH 600
+/** Longest payload of afSendDataGroup(). The Module only fragments unicasts, so a group message 
+must fit in a single AF_DATA_REQUEST_EXT. */
+#define AF_GROUP_MAX_DATA_LENGTH        (AF_DATA_REQUEST_EXT_MAX_PAYLOAD_LENGTH - AF_COMPRESSION_HEADER_LENGTH)
+
+//Group membership, see afAddGroup(). The group name is not used, so it is always sent empty.
+#define ZDO_EXT_ADD_GROUP_SREQ_FIELDS(L, F) \
+    F(L, ENDPOINT, MT_U8) \
+    F(L, GROUP_ID, MT_U16) \
+    F(L, NAME_LENGTH, MT_U8)
+MT_LAYOUT(ZDO_EXT_ADD_GROUP_SREQ);
+#define ZDO_EXT_REMOVE_GROUP_SREQ_FIELDS(L, F) \
+    F(L, ENDPOINT, MT_U8) \
+    F(L, GROUP_ID, MT_U16)
+MT_LAYOUT(ZDO_EXT_REMOVE_GROUP_SREQ);
 
 #endif
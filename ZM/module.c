@@ -47,11 +47,12 @@
 #include "../Common/utilities.h"
 #include "zm_phy.h"
 #include "module_errors.h"
+#include "zm_frame.h"
+#include "zm_deadline.h"
+#include "zm_mt.h"
 #include <stddef.h>                     //for NULL
 #include <stdint.h>
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 /** 
 Initializes the module's physical interface, either SPI or UART, depending on which phy file is included.
 */
@@ -60,47 +61,84 @@ void moduleInit()
   zm_phy_init();  //this is phy dependent.
 }
 
+/** Time from releasing the Module's reset to the SYS_RESET_IND being available in the last 
+moduleReset(), in milliseconds */
+uint16_t moduleResetTimeMs = 0;
+
+/** Private method to toggle the Module's reset line. Received messages from before the reset are 
+discarded, since they are no longer valid. */
+static void resetModuleHardware()
+{
+    frameDiscardParked();
+    moduleInvalidateDeviceInfo();
+    RADIO_OFF();
+#ifdef ZM_PHY_UART
+    uartDiscardFrames();                                        //nothing more arrives while in reset
+#endif
+    delayMs(1);
+    RADIO_ON(); 
+}
+
 #define METHOD_MODULE_RESET        0x0100
 /** 
 Resets the Module using hardware and retrieves the SYS_RESET_IND message. This method is used to 
 restart the Module's internal state machine and apply changes to startup options, zigbee device type, etc.
+Returns as soon as the SYS_RESET_IND is available: when SRDY goes low (SPI) or the frame has been
+received (UART). If ZM_WAIT_FOR_EVENT is defined and the hal file has a free-running timer 
+(HAL_TIMER_TICKS) to measure the reset time then the processor sleeps until then, else the Module 
+is polled continuously.
 @post zmBuf contains the version structure, starting at MODULE_RESET_RESULT_START_FIELD
+@post moduleResetTimeMs is how long the Module took
+@return MODULE_SUCCESS, or TIMEOUT if the Module wasn't ready within MODULE_RESET_TIMEOUT_MS or was
+ready in less than MODULE_RESET_MINIMUM_MS, e.g. because SRDY is stuck low.
 @see Interface Specification for order of fields
 */
 moduleResult_t moduleReset()
 {
-    RADIO_OFF();
-    delayMs(1);
-    RADIO_ON(); 
-#define MODULE_RESET_INITIAL_DELAY_MS   400
-    delayMs(MODULE_RESET_INITIAL_DELAY_MS);                        //Necessary to allow proper module startup
+    resetModuleHardware();
     
-#ifdef ZM_PHY_SPI
+#if defined ZM_PHY_SPI || defined ZM_PHY_UART
 
-#define TEST_SRDY_INTERVAL_MS           10        // check SRDY every 10 mSec
-#define TEST_SRDY_TIMEOUT_MS            2000      // ...and timeout after 1500mSec
-#define TEST_SRDY_MINIMUM_TIMEOUT_MS    100       // If SRDY transitions less then this than an error.
-    unsigned int elapsedTime = 0;       //now, poll for SRDY going low...
-    do
-    {
-        delayMs(TEST_SRDY_INTERVAL_MS);
-        elapsedTime += TEST_SRDY_INTERVAL_MS;
-    }
-    while ((elapsedTime < TEST_SRDY_TIMEOUT_MS) && (!(MODULE_HAS_MESSAGE_WAITING())));
+#define MODULE_RESET_TIMEOUT_MS         2400      // timeout after 2400mSec
+#define MODULE_RESET_MINIMUM_MS         100       // If the Module is ready sooner than this then an error.
+    struct deadline d;
+    deadlineStart(&d, MODULE_RESET_TIMEOUT_MS * 1000UL);
+#if defined ZM_WAIT_FOR_EVENT && defined HAL_TIMER_TICKS
+    halWaitTimerStart(MODULE_RESET_TIMEOUT_MS);
+    if (phyWaitForMessage())
+        halWaitTimerStop();
+    deadlineExpired(&d);                                           //brings the elapsed time up to date
+#else
+    while ((!phyHasMessageWaiting()) && (!deadlineExpired(&d))) ;
+#endif
+    moduleResetTimeMs = deadlineElapsedUs(&d) / 1000;
 
-    RETURN_RESULT_IF_EXPRESSION_TRUE(((SRDY_IS_HIGH()) || (elapsedTime < TEST_SRDY_MINIMUM_TIMEOUT_MS)), METHOD_MODULE_RESET, TIMEOUT);
+    RETURN_RESULT_IF_EXPRESSION_TRUE(((!phyHasMessageWaiting()) || (moduleResetTimeMs < MODULE_RESET_MINIMUM_MS)), METHOD_MODULE_RESET, TIMEOUT);
 #ifdef MODULE_INTERFACE_VERBOSE
-    printf("Module ready in %umS\r\n", elapsedTime + MODULE_RESET_INITIAL_DELAY_MS);
+    printf("Module ready in %umS\r\n", moduleResetTimeMs);
 #endif
-    return (getMessage());
+    return (phyGetMessage());
 
-#elif defined ZM_PHY_UART
-    return (receiveAreq(20, 2000));
+#elif defined ZM_PHY_SIM
+    return (phySimReset());
 #else
 #error "No ZM PHY option selected"
 #endif
 }
 
+/** 
+Resets the Module using hardware like moduleReset(), but returns without waiting for the Module to 
+be ready. The SYS_RESET_IND is received later like any other message, with getMessage(), e.g. by 
+startupDispatch(). The application can do other work in the meantime.
+*/
+void moduleResetStart()
+{
+    resetModuleHardware();
+#ifdef ZM_PHY_SIM
+    phySimResetAsync();
+#endif
+}
+
 /** 
 Displays the contents of a SYS_RESET_IND message. These are returned from the module after a 
 hard or soft reset. 
@@ -142,11 +180,7 @@ Retrieves the Module's version information using SYS_VERSION command.
 */
 moduleResult_t sysVersion()
 {
-#define SYS_VERSION_PAYLOAD_LEN 0
-    zmBuf[0] = SYS_VERSION_PAYLOAD_LEN;
-    zmBuf[1] = MSB(SYS_VERSION);
-    zmBuf[2] = LSB(SYS_VERSION);   
-    RETURN_RESULT(sendMessage(), METHOD_SYS_VERSION);     
+    RETURN_RESULT(mtSend(SYS_VERSION, 0), METHOD_SYS_VERSION);     
 }
 
 /** 
@@ -177,11 +211,7 @@ number generator that uses RF noise to derive the random number.
 */
 moduleResult_t sysRandom()
 {
-#define SYS_RANDOM_PAYLOAD_LEN 0
-    zmBuf[0] = SYS_RANDOM_PAYLOAD_LEN;
-    zmBuf[1] = MSB(SYS_RANDOM);
-    zmBuf[2] = LSB(SYS_RANDOM);  
-    RETURN_RESULT(sendMessage(), METHOD_SYS_RANDOM);    
+    RETURN_RESULT(mtSend(SYS_RANDOM, 0), METHOD_SYS_RANDOM);    
 }
 
 #define METHOD_SYS_SET_TX_POWER                    0x1100  // Out of sequence because it was added later
@@ -204,41 +234,59 @@ moduleResult_t sysSetTxPower(uint8_t txPowerSetting, uint8_t* actualTxPowerSetti
 #ifdef MODULE_INTERFACE_VERBOSE     
     printf("Setting TX_POWER to %u requested; ", txPowerSetting);
 #endif
-#define SYS_SET_TX_POWER_PAYLOAD_LEN 1
-    zmBuf[0] = SYS_SET_TX_POWER_PAYLOAD_LEN;
-    zmBuf[1] = MSB(SYS_SET_TX_POWER);
-    zmBuf[2] = LSB(SYS_SET_TX_POWER);
-    
-    zmBuf[3] = txPowerSetting;
-    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_SYS_SET_TX_POWER); 
+    MT_PUT_U8(SYS_SET_TX_POWER_SREQ_TX_POWER, txPowerSetting);
+    RETURN_RESULT_IF_FAIL(mtSend(SYS_SET_TX_POWER, MT_LENGTH(SYS_SET_TX_POWER_SREQ)), METHOD_SYS_SET_TX_POWER); 
 #ifdef MODULE_INTERFACE_VERBOSE     
-    printf("Actual TX_POWER set to %d\r\n", zmBuf[SYS_SET_TX_POWER_RESULT_FIELD]);
+    printf("Actual TX_POWER set to %d\r\n", MT_GET_U8(SYS_SET_TX_POWER_SRSP_TX_POWER));
 #endif
-    *actualTxPowerSetting = zmBuf[SYS_SET_TX_POWER_RESULT_FIELD];
+    *actualTxPowerSetting = MT_GET_U8(SYS_SET_TX_POWER_SRSP_TX_POWER);
    return MODULE_SUCCESS;
 }
 
 
+#ifndef ZM_NV_WRITE_ALWAYS
+/** 
+Private utility method to check whether the Module already has this configuration data, by reading 
+it with ZB_READ_CONFIGURATION. 
+@return true (1) if the stored value is the same length and value as data, else 0, including if it 
+couldn't be read.
+@post zmBuf is overwritten
+*/
+static uint8_t configurationUnchanged(uint8_t zcd, uint8_t zcdLength, const uint8_t* data)
+{
+    if (getConfigurationParameter(zcd) != MODULE_SUCCESS)
+        return 0;
+    return ((MT_GET_U8(ZB_READ_CONFIGURATION_SRSP_LENGTH) == zcdLength) && 
+            (memcmp(MT_POINTER(ZB_READ_CONFIGURATION_SRSP_VALUE), data, zcdLength) == 0));
+}
+#endif
+
 //note: no method ID for this one; it should be wrapped by others.
 /** 
-Private utility method to write configuration data to the Module
+Private utility method to write configuration data to the Module. The value is read first and isn't 
+written if it is unchanged, so that restarting the Module with the same moduleConfiguration doesn't 
+rewrite every item. Define ZM_NV_WRITE_ALWAYS to always write.
 @param zcd the Zigbee configuration data ID
 @param zcdLength the length of above
-@param data an array containing the data to write.
+@param data an array containing the data to write. Must not be in zmBuf.
 @note All ZB_WRITE_CONFIGURATION commands take approx. 3.5mSec between SREQ & SRSP; presumably to 
-write to flash inside the Module. 
+write to flash inside the Module. Reading takes much less time, and doesn't wear the flash.
 */
 moduleResult_t zbWriteConfiguration(uint8_t zcd, uint8_t zcdLength, uint8_t* data)
 {
-#define ZB_WRITE_CONFIGURATION_LEN      2  //excluding payload length
-    zmBuf[0] = ZB_WRITE_CONFIGURATION_LEN + zcdLength;
-    zmBuf[1] = MSB(ZB_WRITE_CONFIGURATION);
-    zmBuf[2] = LSB(ZB_WRITE_CONFIGURATION);
-    
-    zmBuf[3] = zcd;
-    zmBuf[4] = zcdLength;
-    memcpy(zmBuf+5, data, zcdLength);
-    return (sendMessage()); 
+#ifndef ZM_NV_WRITE_ALWAYS
+    if (configurationUnchanged(zcd, zcdLength, data))
+    {
+#ifdef MODULE_INTERFACE_VERBOSE
+        printf("ZCD %02X unchanged\r\n", zcd);
+#endif
+        return MODULE_SUCCESS;
+    }
+#endif
+    MT_PUT_U8(ZB_WRITE_CONFIGURATION_SREQ_CONFIG_ID, zcd);
+    MT_PUT_U8(ZB_WRITE_CONFIGURATION_SREQ_LENGTH, zcdLength);
+    memcpy(MT_POINTER(ZB_WRITE_CONFIGURATION_SREQ_VALUE), data, zcdLength);
+    return (mtSend(ZB_WRITE_CONFIGURATION, MT_LENGTH(ZB_WRITE_CONFIGURATION_SREQ) + zcdLength)); 
 }
 
 
@@ -328,12 +376,95 @@ moduleResult_t zbGetDeviceInfo(uint8_t dip)
 {
     RETURN_INVALID_PARAMETER_IF_TRUE( (dip > MAX_DEVICE_INFORMATION_PROPERTY), METHOD_GET_DEVICE_INFO);
 
-#define ZB_GET_DEVICE_INFO_PAYLOAD_LEN 1
-    zmBuf[0] = ZB_GET_DEVICE_INFO_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZB_GET_DEVICE_INFO);
-    zmBuf[2] = LSB(ZB_GET_DEVICE_INFO);
-    zmBuf[3] = dip;
-    RETURN_RESULT(sendMessage(), METHOD_GET_DEVICE_INFO); 
+    MT_PUT_U8(ZB_GET_DEVICE_INFO_SREQ_PROPERTY, dip);
+    RETURN_RESULT(mtSend(ZB_GET_DEVICE_INFO, MT_LENGTH(ZB_GET_DEVICE_INFO_SREQ)), METHOD_GET_DEVICE_INFO); 
+}
+
+#define METHOD_GET_DEVICE_INFO_SNAPSHOT     0x1500
+
+/** The Device Information Properties, see moduleGetDeviceInfoSnapshot(). Only valid if 
+deviceInfoValid is set. */
+static struct deviceInformation deviceInfo;
+static uint8_t deviceInfoValid = 0;
+
+/** Value of a two byte DIP, e.g. an address, in zmBuf. LSB is first. */
+#define DIP_VALUE_AS_INT()  MT_GET_U16(ZB_GET_DEVICE_INFO_SRSP_VALUE)
+
+/** 
+Private method to read all of the Device Information Properties from the Module into deviceInfo, 
+unless they are already there.
+@return MODULE_SUCCESS, or the error from the first property that couldn't be read
+*/
+static moduleResult_t refreshDeviceInfo()
+{
+    if (deviceInfoValid)
+        return MODULE_SUCCESS;
+#ifdef ZM_UTIL_GET_DEVICE_INFO
+    RETURN_RESULT_IF_FAIL(mtRequest(UTIL_GET_DEVICE_INFO, 0), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    deviceInfo.deviceState = MT_GET_U8(UTIL_GET_DEVICE_INFO_SRSP_DEVICE_STATE);
+    memcpy(deviceInfo.macAddress, MT_POINTER(UTIL_GET_DEVICE_INFO_SRSP_MAC_ADDRESS), DIP_MAC_ADDRESS_LENGTH);
+    deviceInfo.shortAddress = MT_GET_U16(UTIL_GET_DEVICE_INFO_SRSP_SHORT_ADDRESS);
+#else
+    RETURN_RESULT_IF_FAIL(zbGetDeviceInfo(DIP_STATE), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    deviceInfo.deviceState = MT_GET_U8(ZB_GET_DEVICE_INFO_SRSP_VALUE);
+    RETURN_RESULT_IF_FAIL(zbGetDeviceInfo(DIP_MAC_ADDRESS), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    memcpy(deviceInfo.macAddress, MT_POINTER(ZB_GET_DEVICE_INFO_SRSP_VALUE), DIP_MAC_ADDRESS_LENGTH);
+    RETURN_RESULT_IF_FAIL(zbGetDeviceInfo(DIP_SHORT_ADDRESS), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    deviceInfo.shortAddress = DIP_VALUE_AS_INT();
+#endif
+    RETURN_RESULT_IF_FAIL(zbGetDeviceInfo(DIP_PARENT_SHORT_ADDRESS), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    deviceInfo.parentShortAddress = DIP_VALUE_AS_INT();
+    RETURN_RESULT_IF_FAIL(zbGetDeviceInfo(DIP_PARENT_MAC_ADDRESS), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    memcpy(deviceInfo.parentMacAddress, MT_POINTER(ZB_GET_DEVICE_INFO_SRSP_VALUE), DIP_PARENT_MAC_ADDRESS_LENGTH);
+    RETURN_RESULT_IF_FAIL(zbGetDeviceInfo(DIP_CHANNEL), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    deviceInfo.channel = MT_GET_U8(ZB_GET_DEVICE_INFO_SRSP_VALUE);
+    RETURN_RESULT_IF_FAIL(zbGetDeviceInfo(DIP_PANID), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    deviceInfo.panId = DIP_VALUE_AS_INT();
+    RETURN_RESULT_IF_FAIL(zbGetDeviceInfo(DIP_EXTENDED_PANID), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    memcpy(deviceInfo.extendedPanId, MT_POINTER(ZB_GET_DEVICE_INFO_SRSP_VALUE), DIP_EXTENDED_PANID_LENGTH);
+    deviceInfoValid = 1;
+    return MODULE_SUCCESS;
+}
+
+/** 
+Retrieves all of the Device Information Properties at once. They are read from the Module the first 
+time and then cached, so that e.g. the application can look up its own short address before every 
+send without communicating with the Module. The cache is invalidated when a ZDO_STATE_CHANGE_IND is
+received, since the addresses, channel and PAN change when the device joins or leaves a network, 
+and by moduleReset(). 
+If the Module firmware includes the MT_UTIL commands then define ZM_UTIL_GET_DEVICE_INFO to get the 
+state, MAC address and short address with one UTIL_GET_DEVICE_INFO instead of three DIP reads.
+@param info the Device Information Properties are copied here
+@post zmBuf is overwritten if the properties were read from the Module
+@return MODULE_SUCCESS, or an error if a property couldn't be read
+*/
+moduleResult_t moduleGetDeviceInfoSnapshot(struct deviceInformation* info)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((info == NULL), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    RETURN_RESULT_IF_FAIL(refreshDeviceInfo(), METHOD_GET_DEVICE_INFO_SNAPSHOT);
+    memcpy(info, &deviceInfo, sizeof(struct deviceInformation));
+    return MODULE_SUCCESS;
+}
+
+/** 
+Discards the cached Device Information Properties, so that the next moduleGetDeviceInfoSnapshot() 
+reads them from the Module. Only needed if something other than a ZDO_STATE_CHANGE_IND or a reset
+changes them, e.g. resetting the Module without moduleReset(). 
+*/
+void moduleInvalidateDeviceInfo()
+{
+    deviceInfoValid = 0;
+}
+
+/** 
+Called by the module interface (zm_phy) for every message received from the Module. Invalidates the
+cached Device Information Properties if the device state has changed.
+@param areq the message
+*/
+void deviceInfoAreqReceived(const uint8_t* areq)
+{
+    if (CONVERT_TO_INT(areq[SRSP_CMD_LSB_FIELD], areq[SRSP_CMD_MSB_FIELD]) == ZDO_STATE_CHANGE_IND)
+        deviceInfoValid = 0;
 }
 
 
@@ -370,16 +501,9 @@ moduleResult_t sysNvRead(uint8_t nvItem)
 {
     RETURN_INVALID_PARAMETER_IF_TRUE( ((nvItem < MIN_NV_ITEM) || (nvItem > MAX_NV_ITEM) || (nvItem == NV_ITEM_RESERVED)), METHOD_SYS_NV_READ);
     
-#define SYS_NV_READ_PAYLOAD_LEN 3  
-    zmBuf[0] = SYS_NV_READ_PAYLOAD_LEN;
-    zmBuf[1] = MSB(SYS_NV_READ);
-    zmBuf[2] = LSB(SYS_NV_READ);  
-    
-    zmBuf[3] = nvItem;         //item number, 1-6
-    zmBuf[4] = 0x0F;           //MSB of item number, but only items 1-6 are supported
-    zmBuf[5] = 0;              //offset from beginning of the NV item, not used
-    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_SYS_NV_READ); 
-    RETURN_RESULT(zmBuf[SYS_NV_READ_STATUS_FIELD], METHOD_SYS_NV_READ);
+    MT_PUT_U16(SYS_NV_READ_SREQ_ID, NV_USER_ITEM_ID(nvItem));
+    MT_PUT_U8(SYS_NV_READ_SREQ_OFFSET, 0);
+    RETURN_RESULT(mtRequest(SYS_NV_READ, MT_LENGTH(SYS_NV_READ_SREQ)), METHOD_SYS_NV_READ);
 }
 
 #define METHOD_SYS_NV_WRITE              0x0900
@@ -401,18 +525,120 @@ moduleResult_t sysNvWrite(uint8_t nvItem, uint8_t* data)
     printf("Writing NV Item %u (length %u) with data: ", nvItem, nvItemSize);
     printHexBytes(data, nvItemSize);
 #endif      
-#define SYS_NV_WRITE_PAYLOAD_LEN 4  //excludes length of NV item    
-    zmBuf[0] = SYS_NV_WRITE_PAYLOAD_LEN + nvItemSize;
-    zmBuf[1] = MSB(SYS_NV_WRITE);
-    zmBuf[2] = LSB(SYS_NV_WRITE);  
+    MT_PUT_U16(SYS_NV_WRITE_SREQ_ID, NV_USER_ITEM_ID(nvItem));
+    MT_PUT_U8(SYS_NV_WRITE_SREQ_OFFSET, 0);
+    MT_PUT_U8(SYS_NV_WRITE_SREQ_LENGTH, nvItemSize);
+    memcpy(MT_POINTER(SYS_NV_WRITE_SREQ_VALUE), data, nvItemSize);
+    RETURN_RESULT(mtSend(SYS_NV_WRITE, MT_LENGTH(SYS_NV_WRITE_SREQ) + nvItemSize), METHOD_SYS_NV_WRITE);       
+}
+
+//Longest part of an NV item that fits in one SYS_NV_READ SRSP or SYS_NV_WRITE SREQ:
+#define SYS_NV_READ_CHUNK_LENGTH        (ZIGBEE_MODULE_BUFFER_SIZE - SRSP_HEADER_SIZE - MT_LENGTH(SYS_NV_READ_SRSP))
+#define SYS_NV_WRITE_CHUNK_LENGTH       (ZIGBEE_MODULE_BUFFER_SIZE - SRSP_HEADER_SIZE - MT_LENGTH(SYS_NV_WRITE_SREQ))
+
+#define METHOD_SYS_NV_READ_BYTES              0x1600
+/** 
+Reads part of a Non-Volatile (NV) memory item from the Module, straight into a buffer. Unlike 
+sysNvRead() this works with any NV item ID, not just the user items, and only the requested bytes are
+kept. Longer reads are split into several SYS_NV_READs.
+@param nvId the NV item ID, e.g. NV_USER_ITEM_ID(5) for user item 5
+@param offset where in the NV item to start reading
+@param length how many bytes to read; offset + length must not be more than 256
+@param data where to put the bytes read
+@return MODULE_SUCCESS, the status from the Module if the item couldn't be read, or INVALID_LENGTH if
+the item is shorter than offset + length.
+@post zmBuf is overwritten
+*/
+moduleResult_t sysNvReadBytes(uint16_t nvId, uint8_t offset, uint8_t length, uint8_t* data)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((data == NULL), METHOD_SYS_NV_READ_BYTES);
+    RETURN_INVALID_LENGTH_IF_TRUE(((length == 0) || ((offset + length) > 0x100)), METHOD_SYS_NV_READ_BYTES);
     
-    zmBuf[3] = nvItem;         //item number, 1-6
-    zmBuf[4] = 0x0F;           //MSB of item number, but only items 1-6 are supported
-    zmBuf[5] = 0;              //offset from beginning of the NV item, not used
-    zmBuf[6] = nvItemSize;     //length
+    while (length > 0)
+    {
+        MT_PUT_U16(SYS_NV_READ_SREQ_ID, nvId);
+        MT_PUT_U8(SYS_NV_READ_SREQ_OFFSET, offset);
+        RETURN_RESULT_IF_FAIL(mtRequest(SYS_NV_READ, MT_LENGTH(SYS_NV_READ_SREQ)), METHOD_SYS_NV_READ_BYTES); 
+        
+        /* The Module returns the rest of the item after offset, or as much of it as fits */
+        uint8_t chunk = (length > SYS_NV_READ_CHUNK_LENGTH) ? SYS_NV_READ_CHUNK_LENGTH : length;
+        RETURN_INVALID_LENGTH_IF_TRUE((MT_GET_U8(SYS_NV_READ_SRSP_LENGTH) < chunk), METHOD_SYS_NV_READ_BYTES);
+        memcpy(data, MT_POINTER(SYS_NV_READ_SRSP_VALUE), chunk);
+        data += chunk;
+        offset += chunk;
+        length -= chunk;
+    }
+    return MODULE_SUCCESS;
+}
+
+#define METHOD_SYS_NV_WRITE_BYTES              0x1700
+/** 
+Writes part of a Non-Volatile (NV) memory item in the Module, e.g. to update a 2 byte counter in a 16 
+byte item without rewriting the rest of it. Works with any NV item ID. Longer writes are split into 
+several SYS_NV_WRITEs.
+@param nvId the NV item ID, e.g. NV_USER_ITEM_ID(5) for user item 5
+@param offset where in the NV item to start writing
+@param length how many bytes to write; offset + length must not be more than 256
+@param data the bytes to write. Must not be in zmBuf.
+@return MODULE_SUCCESS, or the status from the Module if the item couldn't be written
+@post zmBuf is overwritten
+*/
+moduleResult_t sysNvWriteBytes(uint16_t nvId, uint8_t offset, uint8_t length, const uint8_t* data)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((data == NULL), METHOD_SYS_NV_WRITE_BYTES);
+    RETURN_INVALID_LENGTH_IF_TRUE(((length == 0) || ((offset + length) > 0x100)), METHOD_SYS_NV_WRITE_BYTES);
     
-    memcpy(zmBuf+7, data, nvItemSize);
-    RETURN_RESULT(sendMessage(), METHOD_SYS_NV_WRITE);       
+    while (length > 0)
+    {
+        uint8_t chunk = (length > SYS_NV_WRITE_CHUNK_LENGTH) ? SYS_NV_WRITE_CHUNK_LENGTH : length;
+        MT_PUT_U16(SYS_NV_WRITE_SREQ_ID, nvId);
+        MT_PUT_U8(SYS_NV_WRITE_SREQ_OFFSET, offset);
+        MT_PUT_U8(SYS_NV_WRITE_SREQ_LENGTH, chunk);
+        memcpy(MT_POINTER(SYS_NV_WRITE_SREQ_VALUE), data, chunk);
+        RETURN_RESULT_IF_FAIL(mtRequest(SYS_NV_WRITE, MT_LENGTH(SYS_NV_WRITE_SREQ) + chunk), METHOD_SYS_NV_WRITE_BYTES); 
+        data += chunk;
+        offset += chunk;
+        length -= chunk;
+    }
+    return MODULE_SUCCESS;
+}
+
+#define METHOD_SYS_NV_READ_MULTIPLE              0x1800
+/** 
+Reads several NV items, or parts of NV items, one after the other with sysNvReadBytes().
+@param items what to read, and where to put it
+@param count how many entries in items
+@return MODULE_SUCCESS, or the error from the first item that couldn't be read. The items before it 
+were read.
+*/
+moduleResult_t sysNvReadMultiple(const struct nvAccess* items, uint8_t count)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((items == NULL), METHOD_SYS_NV_READ_MULTIPLE);
+    uint8_t i;
+    for (i = 0; i < count; i++)
+    {
+        RETURN_RESULT_IF_FAIL(sysNvReadBytes(items[i].nvId, items[i].offset, items[i].length, items[i].data), METHOD_SYS_NV_READ_MULTIPLE);
+    }
+    return MODULE_SUCCESS;
+}
+
+#define METHOD_SYS_NV_WRITE_MULTIPLE              0x1900
+/** 
+Writes several NV items, or parts of NV items, one after the other with sysNvWriteBytes().
+@param items what to write, and the data to write
+@param count how many entries in items
+@return MODULE_SUCCESS, or the error from the first item that couldn't be written. The items before 
+it were written.
+*/
+moduleResult_t sysNvWriteMultiple(const struct nvAccess* items, uint8_t count)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((items == NULL), METHOD_SYS_NV_WRITE_MULTIPLE);
+    uint8_t i;
+    for (i = 0; i < count; i++)
+    {
+        RETURN_RESULT_IF_FAIL(sysNvWriteBytes(items[i].nvId, items[i].offset, items[i].length, items[i].data), METHOD_SYS_NV_WRITE_MULTIPLE);
+    }
+    return MODULE_SUCCESS;
 }
 
 #define METHOD_SYS_GPIO              0x0A00
@@ -430,14 +656,9 @@ moduleResult_t sysGpio(uint8_t operation, uint8_t value)
     RETURN_INVALID_PARAMETER_IF_TRUE( ((operation > GPIO_OPERATION_MAX) || 
                                        ((value > 0x0F) && (operation != GPIO_SET_INPUT_MODE))), METHOD_SYS_GPIO);
     
-#define SYS_GPIO_PAYLOAD_LEN 2
-    zmBuf[0] = SYS_GPIO_PAYLOAD_LEN;
-    zmBuf[1] = MSB(SYS_GPIO);
-    zmBuf[2] = LSB(SYS_GPIO);
-    
-    zmBuf[3] = operation;
-    zmBuf[4] = value;
-    RETURN_RESULT(sendMessage(), METHOD_SYS_GPIO);        
+    MT_PUT_U8(SYS_GPIO_SREQ_OPERATION, operation);
+    MT_PUT_U8(SYS_GPIO_SREQ_VALUE, value);
+    RETURN_RESULT(mtSend(SYS_GPIO, MT_LENGTH(SYS_GPIO_SREQ)), METHOD_SYS_GPIO);        
 }
 
 #define METHOD_SET_RF_TEST_MODE              0x0B00
@@ -459,19 +680,15 @@ moduleResult_t setRfTestMode(uint8_t mode, uint8_t channel, uint8_t txPower, uin
     RETURN_INVALID_PARAMETER_IF_TRUE( ((!IS_VALID_CHANNEL(channel)) || (mode > RF_TEST_MODE_MAXIMUM)), METHOD_SET_RF_TEST_MODE);    
        
 #define ZCD_NV_RF_TEST_MODE_LEN 4
-    zmBuf[0] = SYS_NV_WRITE_PAYLOAD_LEN + ZCD_NV_RF_TEST_MODE_LEN;
-    zmBuf[1] = MSB(SYS_NV_WRITE);
-    zmBuf[2] = LSB(SYS_NV_WRITE);  
-    
-    zmBuf[3] = 0x07;           //LSB of item number
-    zmBuf[4] = 0x0F;           //MSB of item number
-    zmBuf[5] = 0;              //offset from beginning of the NV item, not used
-    zmBuf[6] = ZCD_NV_RF_TEST_MODE_LEN;     //length
-    zmBuf[7] = mode;
-    zmBuf[8] = channel;
-    zmBuf[9] = txPower;
-    zmBuf[10] = txTone;
-    RETURN_RESULT(sendMessage(), METHOD_SET_RF_TEST_MODE); 
+    MT_PUT_U16(SYS_NV_WRITE_SREQ_ID, NV_USER_ITEM_ID(NV_ITEM_RESERVED));  //0x0F07
+    MT_PUT_U8(SYS_NV_WRITE_SREQ_OFFSET, 0);
+    MT_PUT_U8(SYS_NV_WRITE_SREQ_LENGTH, ZCD_NV_RF_TEST_MODE_LEN);
+    uint8_t* value = MT_POINTER(SYS_NV_WRITE_SREQ_VALUE);
+    value[0] = mode;
+    value[1] = channel;
+    value[2] = txPower;
+    value[3] = txTone;
+    RETURN_RESULT(mtSend(SYS_NV_WRITE, MT_LENGTH(SYS_NV_WRITE_SREQ) + ZCD_NV_RF_TEST_MODE_LEN), METHOD_SET_RF_TEST_MODE); 
 }
 
 /** 
@@ -575,30 +792,38 @@ moduleResult_t setCallbacks(uint8_t cb)
 //
 #define METHOD_WAIT_FOR_MESSAGE                    0x0F00
 /** 
-Waits for the specified type of message. Ignores any other messages received. The received message 
-will be in zmBuf[]. If the specified type of message isn't received by timeout then a TIMEOUT error
-will be returned.
+Waits for the specified type of message. Other messages received are parked in the frame pool, so 
+getMessage() will return them afterwards; if there is no free frame then they are ignored. A parked 
+message of the specified type is returned first. The received message will be in zmBuf[]. If the 
+specified type of message isn't received by timeout then a TIMEOUT error will be returned.
 @param messageType the type of message that you are waiting for. Once this message type is received
 the method will return with a status of SUCCESS.
 @param timeoutSecs how many seconds to wait for the desired message type 
 @note If you need to receive messages in the meantime then return control to application instead.
 This is enabled by compile options in the various files. For example, in afSendData, define 
 AF_DATA_CONFIRM_HANDLED_BY_APPLICATION.
+@note If ZM_WAIT_FOR_EVENT is defined then the processor sleeps until the Module has a message,
+using phyWaitForMessage() and the hal wait timer, instead of polling until a deadline.
 */
 moduleResult_t waitForMessage(uint16_t messageType, uint8_t timeoutSecs)
 {
     RETURN_INVALID_PARAMETER_IF_TRUE( ((messageType == 0) || (timeoutSecs == 0)), METHOD_WAIT_FOR_MESSAGE);     
     
-    /** How often to check that the module has a message */
-#define WFM_POLL_INTERVAL_MS   100
+    if (frameUnparkCommand(messageType))                        // Received earlier, while waiting for something else
+        return MODULE_SUCCESS;
     
-     uint16_t intervals = timeoutSecs * 1000 / WFM_POLL_INTERVAL_MS; //how many times to check   
-    //for (int i=0; i<intervals; i++)
-     while (intervals--)
+#ifdef ZM_WAIT_FOR_EVENT
+    halWaitTimerStart(timeoutSecs * 1000UL);
+    while (phyWaitForMessage())
+#else
+    struct deadline d;
+    deadlineStart(&d, timeoutSecs * 1000000UL);
+    while (!deadlineExpired(&d))
+#endif
     {
-        if (moduleHasMessageWaiting())                           // If there's a message waiting for us
+        if (phyHasMessageWaiting())                              // If there's a message waiting for us
         {
-          getMessage();
+          phyGetMessage();
           
             if (zmBuf[SRSP_LENGTH_FIELD] > 0)
             {
@@ -607,16 +832,19 @@ moduleResult_t waitForMessage(uint16_t messageType, uint8_t timeoutSecs)
                 {
 #ifdef ZM_INTERFACE_VERBOSE
                     printf("Received expected message %04X\r\n", messageType);
+#endif
+#ifdef ZM_WAIT_FOR_EVENT
+                    halWaitTimerStop();
 #endif
                     return MODULE_SUCCESS;
-                } else {                                            //not what we wanted; ignore
+                } else {                                            //not what we wanted; keep for later
 #ifdef ZM_INTERFACE_VERBOSE
                     printf("Received message %04X\r\n", rcvMsgType);
 #endif 
+                    frameParkWorking();
                 }
             }
         }
-        delayMs(WFM_POLL_INTERVAL_MS);
     }
                                                  // We've completed without receiving the state that we want
     RETURN_RESULT(TIMEOUT, METHOD_WAIT_FOR_MESSAGE);    
@@ -634,32 +862,19 @@ module.h for a list of valid config parameters. Not checked for validity.
 moduleResult_t getConfigurationParameter(uint8_t configId)
 {
 #define LENGTH_OF_LARGEST_CONFIG_PARAMETER 17  //ZCD_NV_USERDESC is largest
-#define ZB_READ_CONFIGURATION_PAYLOAD_LEN 1
-    zmBuf[0] = ZB_READ_CONFIGURATION_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZB_READ_CONFIGURATION);
-    zmBuf[2] = LSB(ZB_READ_CONFIGURATION);  
-    
-    zmBuf[3] = configId;
-    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_GET_CONFIGURATION_PARAMETER);    
-
-#define ZB_READ_CONFIGURATION_STATUS_FIELD            SRSP_PAYLOAD_START
-    RETURN_RESULT(zmBuf[ZB_READ_CONFIGURATION_STATUS_FIELD], METHOD_GET_CONFIGURATION_PARAMETER);  
+    MT_PUT_U8(ZB_READ_CONFIGURATION_SREQ_CONFIG_ID, configId);
+    RETURN_RESULT(mtRequest(ZB_READ_CONFIGURATION, MT_LENGTH(ZB_READ_CONFIGURATION_SREQ)), METHOD_GET_CONFIGURATION_PARAMETER);  
 
     /* If you would like to do more extensive error checking then replace the above line of code with:
     
-#define CONFIG_ID_FIELD         SRSP_PAYLOAD_START + 1
-#define LENGTH_FIELD            SRSP_PAYLOAD_START + 2
-    //when using SPI, zmBuf[3] holds status, [4] holds configId, [5] holds length
-    if ((zmBuf[STATUS_FIELD] != SRSP_STATUS_SUCCESS) ||                  //if status was success...
-    (zmBuf[CONFIG_ID_FIELD] != configId) ||                          //and the requested configId was what we requested..
-    (zmBuf[LENGTH_FIELD] > LENGTH_OF_LARGEST_CONFIG_PARAMETER) ||    //if the length is valid
-    (zmBuf[LENGTH_FIELD] == 0))
+    RETURN_RESULT_IF_FAIL(mtRequest(ZB_READ_CONFIGURATION, MT_LENGTH(ZB_READ_CONFIGURATION_SREQ)), METHOD_GET_CONFIGURATION_PARAMETER);
+    if ((MT_GET_U8(ZB_READ_CONFIGURATION_SRSP_CONFIG_ID) != configId) ||                //if the requested configId was what we requested..
+    (MT_GET_U8(ZB_READ_CONFIGURATION_SRSP_LENGTH) > LENGTH_OF_LARGEST_CONFIG_PARAMETER) ||    //if the length is valid
+    (MT_GET_U8(ZB_READ_CONFIGURATION_SRSP_LENGTH) == 0))
     {
     *Return Error here* 
-
-} else {
-    RETURN_RESULT(zmBuf[ZB_READ_CONFIGURATION_STATUS_FIELD], METHOD_GET_CONFIGURATION_PARAMETER); 
-}
+    }
+    return MODULE_SUCCESS;
     */ 
 }
 
@@ -747,52 +962,36 @@ For an end-device then this parent MAC address will always specify which router
 
 If device is not connected to a network then the Short Address fields will be 0xFEFF, 
 the Parent MAC Address and channel will be 0, and the Extended PAN ID will be this device's MAC Address.
+@note the properties are cached; see moduleGetDeviceInfoSnapshot()
 */
 moduleResult_t displayDeviceInformation()
 {
     int i;
     printf("Device Information Properties (MSB first)\r\n");
-    moduleResult_t result = MODULE_SUCCESS;
-    
-    result = zbGetDeviceInfo(DIP_STATE);
+    moduleResult_t result = refreshDeviceInfo();
     if (result != MODULE_SUCCESS) return result;
-    printf("    Device State:               %s (%u)\r\n", getDeviceStateName(zmBuf[SRSP_DIP_VALUE_FIELD]), (zmBuf[SRSP_DIP_VALUE_FIELD])); 
     
-    result = zbGetDeviceInfo(DIP_MAC_ADDRESS);
+    printf("    Device State:               %s (%u)\r\n", getDeviceStateName(deviceInfo.deviceState), deviceInfo.deviceState); 
+    
     printf("    MAC Address:                ");
-    if (result != MODULE_SUCCESS) return result;
-    for (i = SRSP_DIP_VALUE_FIELD+7; i>=SRSP_DIP_VALUE_FIELD; i--)
-        printf("%02X ", zmBuf[i]);
+    for (i = DIP_MAC_ADDRESS_LENGTH-1; i>=0; i--)
+        printf("%02X ", deviceInfo.macAddress[i]);
     printf("\r\n");
     
-    result = zbGetDeviceInfo(DIP_SHORT_ADDRESS);
-    if (result != MODULE_SUCCESS) return result;
-    printf("    Short Address:              %04X\r\n", CONVERT_TO_INT(zmBuf[SRSP_DIP_VALUE_FIELD] , zmBuf[SRSP_DIP_VALUE_FIELD+1]));
-    
-    result = zbGetDeviceInfo(DIP_PARENT_SHORT_ADDRESS);
-    if (result != MODULE_SUCCESS) return result;
-    printf("    Parent Short Address:       %04X\r\n", CONVERT_TO_INT(zmBuf[SRSP_DIP_VALUE_FIELD] , zmBuf[SRSP_DIP_VALUE_FIELD+1]));
+    printf("    Short Address:              %04X\r\n", deviceInfo.shortAddress);
+    printf("    Parent Short Address:       %04X\r\n", deviceInfo.parentShortAddress);
     
-    result = zbGetDeviceInfo(DIP_PARENT_MAC_ADDRESS);
-    if (result != MODULE_SUCCESS) return result;
     printf("    Parent MAC Address:         ");
-    for (i = SRSP_DIP_VALUE_FIELD+7; i>=SRSP_DIP_VALUE_FIELD; i--)
-        printf("%02X ", zmBuf[i]);
+    for (i = DIP_PARENT_MAC_ADDRESS_LENGTH-1; i>=0; i--)
+        printf("%02X ", deviceInfo.parentMacAddress[i]);
     printf("\r\n");
     
-    result = zbGetDeviceInfo(DIP_CHANNEL);
-    if (result != MODULE_SUCCESS) return result;
-    printf("    Device Channel:             %u\r\n", zmBuf[SRSP_DIP_VALUE_FIELD]);
+    printf("    Device Channel:             %u\r\n", deviceInfo.channel);
+    printf("    PAN ID:                     %04X\r\n", deviceInfo.panId);
     
-    result = zbGetDeviceInfo(DIP_PANID);
-    if (result != MODULE_SUCCESS) return result;
-    printf("    PAN ID:                     %04X\r\n", CONVERT_TO_INT(zmBuf[SRSP_DIP_VALUE_FIELD], zmBuf[SRSP_DIP_VALUE_FIELD+1]));
-    
-    result = zbGetDeviceInfo(DIP_EXTENDED_PANID);
-    if (result != MODULE_SUCCESS) return result;
     printf("    Extended PAN ID:            ");
-    for (i = SRSP_DIP_VALUE_FIELD+7; i>=SRSP_DIP_VALUE_FIELD; i--)
-        printf("%02X ", zmBuf[i]);
+    for (i = DIP_EXTENDED_PANID_LENGTH-1; i>=0; i--)
+        printf("%02X ", deviceInfo.extendedPanId[i]);
     printf("\r\n");
     
     return MODULE_SUCCESS;
@@ -801,6 +1000,8 @@ moduleResult_t displayDeviceInformation()
 /** 
 A minimalized version of displayDeviceInformation() for use on memory-constrained devices.
 @see displayDeviceInformation() for description of fields.
+@note reads only the four properties it displays, and doesn't fill the cache of 
+moduleGetDeviceInfoSnapshot().
 */
 moduleResult_t displayBasicDeviceInformation()
 {
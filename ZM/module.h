@@ -36,6 +36,7 @@
 
 #include "module_commands.h"
 #include "module_errors.h"
+#include "zm_mt.h"
 #include <stdint.h>
 
 //
@@ -44,26 +45,46 @@
 
 // RESET and SYS_RESET_IND
 moduleResult_t moduleReset();
+void moduleResetStart();
+extern uint16_t moduleResetTimeMs;
 char* getResetReason(uint8_t reason);
 void displaySysResetInd();
 void moduleInit();
-#define SYS_RESET_IND_START_FIELD       (SRSP_PAYLOAD_START)
-#define SYS_RESET_IND_PRODUCTID_FIELD   (SYS_RESET_IND_START_FIELD + 2)
+#define SYS_RESET_IND_AREQ_FIELDS(L, F) \
+    F(L, REASON, MT_U8) \
+    F(L, TRANSPORT, MT_U8) \
+    F(L, PRODUCT_ID, MT_U8) \
+    F(L, FW_MAJOR, MT_U8) \
+    F(L, FW_MINOR, MT_U8) \
+    F(L, HW_REVISION, MT_U8)
+MT_LAYOUT(SYS_RESET_IND_AREQ);
+#define SYS_RESET_IND_START_FIELD       MT_INDEX(SYS_RESET_IND_AREQ_REASON)
+#define SYS_RESET_IND_PRODUCTID_FIELD   MT_INDEX(SYS_RESET_IND_AREQ_PRODUCT_ID)
 
 // SYS_VERSION
 moduleResult_t sysVersion();
 void displaySysVersion();
-#define SYS_VERSION_RESULT_START_FIELD      (SRSP_PAYLOAD_START)
-#define SYS_VERSION_RESULT_PRODUCTID_FIELD   (SRSP_PAYLOAD_START + 1)
-#define SYS_VERSION_RESULT_FW_MAJOR_FIELD   (SRSP_PAYLOAD_START + 2)
-#define SYS_VERSION_RESULT_FW_MINOR_FIELD   (SRSP_PAYLOAD_START + 3)
-#define SYS_VERSION_RESULT_FW_BUILD_FIELD   (SRSP_PAYLOAD_START + 4)
+#define SYS_VERSION_SRSP_FIELDS(L, F) \
+    F(L, TRANSPORT, MT_U8) \
+    F(L, PRODUCT_ID, MT_U8) \
+    F(L, FW_MAJOR, MT_U8) \
+    F(L, FW_MINOR, MT_U8) \
+    F(L, FW_BUILD, MT_U8)
+MT_LAYOUT(SYS_VERSION_SRSP);
+#define SYS_VERSION_RESULT_START_FIELD      MT_INDEX(SYS_VERSION_SRSP_TRANSPORT)
+#define SYS_VERSION_RESULT_PRODUCTID_FIELD  MT_INDEX(SYS_VERSION_SRSP_PRODUCT_ID)
+#define SYS_VERSION_RESULT_FW_MAJOR_FIELD   MT_INDEX(SYS_VERSION_SRSP_FW_MAJOR)
+#define SYS_VERSION_RESULT_FW_MINOR_FIELD   MT_INDEX(SYS_VERSION_SRSP_FW_MINOR)
+#define SYS_VERSION_RESULT_FW_BUILD_FIELD   MT_INDEX(SYS_VERSION_SRSP_FW_BUILD)
 
 // SYS_RANDOM
 moduleResult_t sysRandom();
-#define SYS_RANDOM_RESULT_LSB_FIELD (SRSP_PAYLOAD_START)
-#define SYS_RANDOM_RESULT_MSB_FIELD (SRSP_PAYLOAD_START+1)
-#define SYS_RANDOM_RESULT()           (CONVERT_TO_INT(zmBuf[SYS_RANDOM_RESULT_LSB_FIELD], zmBuf[SYS_RANDOM_RESULT_MSB_FIELD]))
+#define SYS_RANDOM_SRSP_FIELDS(L, F) \
+    F(L, VALUE, MT_U16)
+MT_LAYOUT(SYS_RANDOM_SRSP);
+#define SYS_RANDOM_RESULT_LSB_FIELD MT_INDEX(SYS_RANDOM_SRSP_VALUE)
+#define SYS_RANDOM_RESULT_MSB_FIELD (SYS_RANDOM_RESULT_LSB_FIELD + 1)
+#define SYS_RANDOM_RESULT()           MT_GET_U16(SYS_RANDOM_SRSP_VALUE)
 
 //Miscellaneous
 void displayZmBuf();
@@ -153,8 +174,41 @@ moduleResult_t displayBasicDeviceInformation();
 #define DEV_ZB_COORD                    9
 #define DEV_NWK_ORPHAN                  10
 #define MAX_DEVICE_STATE                10
-#define SRSP_DIP_VALUE_FIELD (SRSP_HEADER_SIZE+1) //index in zmBuf[] of the start of the Device Information Property field. LSB is first.
+#define ZB_GET_DEVICE_INFO_SREQ_FIELDS(L, F) \
+    F(L, PROPERTY, MT_U8)
+MT_LAYOUT(ZB_GET_DEVICE_INFO_SREQ);
+#define ZB_GET_DEVICE_INFO_SRSP_FIELDS(L, F) \
+    F(L, PROPERTY, MT_U8) \
+    F(L, VALUE, MT_BYTES(8))
+MT_LAYOUT(ZB_GET_DEVICE_INFO_SRSP);
+#define UTIL_GET_DEVICE_INFO_SRSP_FIELDS(L, F) \
+    F(L, STATUS, MT_U8) \
+    F(L, MAC_ADDRESS, MT_BYTES(DIP_MAC_ADDRESS_LENGTH)) \
+    F(L, SHORT_ADDRESS, MT_U16) \
+    F(L, DEVICE_TYPE, MT_U8) \
+    F(L, DEVICE_STATE, MT_U8) \
+    F(L, ASSOCIATED_DEVICE_COUNT, MT_U8) \
+    F(L, ASSOCIATED_DEVICES, MT_VARIABLE)
+MT_LAYOUT(UTIL_GET_DEVICE_INFO_SRSP);
+#define SRSP_DIP_VALUE_FIELD MT_INDEX(ZB_GET_DEVICE_INFO_SRSP_VALUE) //index in zmBuf[] of the start of the Device Information Property field. LSB is first.
 #define IS_VALID_DEVICE_STATE(state)    (state <= MAX_DEVICE_STATE)
+
+/** All of the Device Information Properties, see moduleGetDeviceInfoSnapshot(). Addresses are LSB 
+first, as received from the Module. */
+struct deviceInformation
+{
+    uint8_t deviceState;                                //one of the DEV_ values
+    uint8_t macAddress[DIP_MAC_ADDRESS_LENGTH];
+    uint16_t shortAddress;
+    uint16_t parentShortAddress;
+    uint8_t parentMacAddress[DIP_PARENT_MAC_ADDRESS_LENGTH];
+    uint8_t channel;
+    uint16_t panId;
+    uint8_t extendedPanId[DIP_EXTENDED_PANID_LENGTH];
+};
+moduleResult_t moduleGetDeviceInfoSnapshot(struct deviceInformation* info);
+void moduleInvalidateDeviceInfo();
+void deviceInfoAreqReceived(const uint8_t* areq);
 #define SRSP                            0x4000
 #define MODULE_COMMAND()                (CONVERT_TO_INT(zmBuf[SRSP_CMD_LSB_FIELD], zmBuf[SRSP_CMD_MSB_FIELD]))
 #define IS_SYS_RESET_IND()              (MODULE_COMMAND() == SYS_RESET_IND)
@@ -166,7 +220,21 @@ char* getDeviceStateName(uint8_t state);
 //  Z-Stack Common Definitions (ZCD) Items
 //
 moduleResult_t getConfigurationParameter(uint8_t configId);
-#define ZB_READ_CONFIGURATION_START_OF_VALUE_FIELD    SRSP_PAYLOAD_START + 3
+#define ZB_READ_CONFIGURATION_SREQ_FIELDS(L, F) \
+    F(L, CONFIG_ID, MT_U8)
+MT_LAYOUT(ZB_READ_CONFIGURATION_SREQ);
+#define ZB_READ_CONFIGURATION_SRSP_FIELDS(L, F) \
+    F(L, STATUS, MT_U8) \
+    F(L, CONFIG_ID, MT_U8) \
+    F(L, LENGTH, MT_U8) \
+    F(L, VALUE, MT_VARIABLE)
+MT_LAYOUT(ZB_READ_CONFIGURATION_SRSP);
+#define ZB_WRITE_CONFIGURATION_SREQ_FIELDS(L, F) \
+    F(L, CONFIG_ID, MT_U8) \
+    F(L, LENGTH, MT_U8) \
+    F(L, VALUE, MT_VARIABLE)
+MT_LAYOUT(ZB_WRITE_CONFIGURATION_SREQ);
+#define ZB_READ_CONFIGURATION_START_OF_VALUE_FIELD    MT_INDEX(ZB_READ_CONFIGURATION_SRSP_VALUE)
 moduleResult_t displayNetworkConfigurationParameters();
 //General
 #define ZCD_NV_USERDESC                 0x81
@@ -210,11 +278,29 @@ moduleResult_t setSecurityKey(uint8_t* key);
 //  Non-volatile memory item storage
 //
 moduleResult_t sysNvRead(uint8_t nvItem);
-#define SYS_NV_READ_STATUS_FIELD        (SRSP_PAYLOAD_START)
-#define SYS_NV_READ_RESULT_START_FIELD  (SRSP_PAYLOAD_START + 2)
+#define SYS_NV_READ_SREQ_FIELDS(L, F) \
+    F(L, ID, MT_U16) \
+    F(L, OFFSET, MT_U8)
+MT_LAYOUT(SYS_NV_READ_SREQ);
+#define SYS_NV_READ_SRSP_FIELDS(L, F) \
+    F(L, STATUS, MT_U8) \
+    F(L, LENGTH, MT_U8) \
+    F(L, VALUE, MT_VARIABLE)
+MT_LAYOUT(SYS_NV_READ_SRSP);
+#define SYS_NV_READ_STATUS_FIELD        MT_INDEX(SYS_NV_READ_SRSP_STATUS)
+#define SYS_NV_READ_RESULT_START_FIELD  MT_INDEX(SYS_NV_READ_SRSP_VALUE)
 
 moduleResult_t sysNvWrite(uint8_t nvItem, uint8_t* data);
-#define SYS_NV_WRITE_STATUS_FIELD        (SRSP_PAYLOAD_START)
+#define SYS_NV_WRITE_SREQ_FIELDS(L, F) \
+    F(L, ID, MT_U16) \
+    F(L, OFFSET, MT_U8) \
+    F(L, LENGTH, MT_U8) \
+    F(L, VALUE, MT_VARIABLE)
+MT_LAYOUT(SYS_NV_WRITE_SREQ);
+#define SYS_NV_WRITE_SRSP_FIELDS(L, F) \
+    F(L, STATUS, MT_U8)
+MT_LAYOUT(SYS_NV_WRITE_SRSP);
+#define SYS_NV_WRITE_STATUS_FIELD        MT_INDEX(SYS_NV_WRITE_SRSP_STATUS)
 uint8_t getNvItemSize(uint8_t nvItem);
 #define MIN_NV_ITEM                     1
 #define MAX_NV_ITEM                     9
@@ -222,11 +308,35 @@ uint8_t getNvItemSize(uint8_t nvItem);
 #define MAX_NV_ITEM_USER                6
 #define NV_ITEM_RESERVED                7 // Do not use
 
+/** NV item ID of user item 1-6, for sysNvReadBytes() etc. */
+#define NV_USER_ITEM_ID(item)           (0x0F00 + (item))
+#define SYS_NV_READ_LENGTH_FIELD        MT_INDEX(SYS_NV_READ_SRSP_LENGTH)
+
+/** Part of an NV item, for sysNvReadMultiple() and sysNvWriteMultiple() */
+struct nvAccess
+{
+    uint16_t nvId;                      //e.g. NV_USER_ITEM_ID(5)
+    uint8_t offset;
+    uint8_t length;
+    uint8_t* data;                      //where to read into, or what to write
+};
+moduleResult_t sysNvReadBytes(uint16_t nvId, uint8_t offset, uint8_t length, uint8_t* data);
+moduleResult_t sysNvWriteBytes(uint16_t nvId, uint8_t offset, uint8_t length, const uint8_t* data);
+moduleResult_t sysNvReadMultiple(const struct nvAccess* items, uint8_t count);
+moduleResult_t sysNvWriteMultiple(const struct nvAccess* items, uint8_t count);
+
 //
 //      GPIO Pin read/write
 //
 moduleResult_t sysGpio(uint8_t operation, uint8_t value);
-#define SYS_GPIO_READ_RESULT_FIELD   (SRSP_PAYLOAD_START)
+#define SYS_GPIO_SREQ_FIELDS(L, F) \
+    F(L, OPERATION, MT_U8) \
+    F(L, VALUE, MT_U8)
+MT_LAYOUT(SYS_GPIO_SREQ);
+#define SYS_GPIO_SRSP_FIELDS(L, F) \
+    F(L, VALUE, MT_U8)
+MT_LAYOUT(SYS_GPIO_SRSP);
+#define SYS_GPIO_READ_RESULT_FIELD   MT_INDEX(SYS_GPIO_SRSP_VALUE)
 
 //Operations:
 #define GPIO_SET_DIRECTION      0x00
@@ -301,7 +411,13 @@ moduleResult_t setCallbacks(uint8_t cb);
 //
 //  Set Tx Power
 //
-#define SYS_SET_TX_POWER_RESULT_FIELD        (SRSP_PAYLOAD_START)
+#define SYS_SET_TX_POWER_SREQ_FIELDS(L, F) \
+    F(L, TX_POWER, MT_U8)
+MT_LAYOUT(SYS_SET_TX_POWER_SREQ);
+#define SYS_SET_TX_POWER_SRSP_FIELDS(L, F) \
+    F(L, TX_POWER, MT_U8)
+MT_LAYOUT(SYS_SET_TX_POWER_SRSP);
+#define SYS_SET_TX_POWER_RESULT_FIELD        MT_INDEX(SYS_SET_TX_POWER_SRSP_TX_POWER)
 moduleResult_t sysSetTxPower(uint8_t txPowerDb, uint8_t* actualPowerDb);
 
 //
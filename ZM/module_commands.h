@@ -104,7 +104,12 @@
 #define ZDO_END_DEVICE_ANNCE_IND        0x45C1 //will receive this asynchronously
 #define ZDO_LEAVE_IND        			0x45C9 //will receive this asynchronously
 
+// ZDO extension commands, only if the Module firmware includes MT_ZDO_EXTENSIONS:
+#define ZDO_EXT_REMOVE_GROUP            0x2547
+#define ZDO_EXT_ADD_GROUP               0x254B
+
 // UTIL commands:
+#define UTIL_GET_DEVICE_INFO            0x2700 //only if the Module firmware includes MT_UTIL
 #define UTIL_ADDRMGR_NWK_ADDR_LOOKUP    0x2741
 
 // Other commands:
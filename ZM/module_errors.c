@@ -68,6 +68,10 @@ char* getErrorName(moduleResult_t err)
         return ("ZM_INVALID_MODULE_CONFIGURATION");
     case ZM_PHY_OTHER_ERROR:
         return ("ZM_PHY_OTHER_ERROR");   
+    case ZM_PHY_BUSY:
+        return ("ZM_PHY_BUSY");
+    case ZM_PIPELINE_FULL:
+        return ("ZM_PIPELINE_FULL");
     default:
         return ("Other Error");
     }
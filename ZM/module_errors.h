@@ -7,11 +7,14 @@
 * The module library has a powerful and flexible error handling system. Each method in the library
 * has a unique methodId:
  - module.c: 0x0100 .. 0x1F00
- - af.c: 0x2000 .. 0x2F00
+ - af.c: 0x2000 .. 0x2F00 AND 0x9000 .. 0x9F00
  - zdo.c: 0x3000 .. 0x3F00 AND 0x7000 .. 0x7F00
  - simple_api.c: 0x4000 .. 0x4F00
- - Reserved 0x5000 .. 0x5F00
+ - zm_pipeline.c: 0x5000 .. 0x5F00
  - module_utilities.c 0x6000 .. 0x6F00
+ - zm_random.c: 0x8000 .. 0x8F00
+ - zm_transfer.c: 0xA000 .. 0xAF00
+ - zm_compress.c: 0xB000 .. 0xBF00
 
 Also, there are different error codes depending on what caused the error. These are divided into
 two types of errors:
@@ -276,6 +279,15 @@ doesn't do anything.
 /** An error occured that doesn't fit into one of the other categories
 @see Module physical interface files (e.g. zm_phy_spi.c) for more information*/
 #define ZM_PHY_OTHER_ERROR              (0x3B)
+/** The physical interface is busy with a previous transaction and can't start a new one
+@see Module physical interface files (e.g. zm_phy_spi.c) for more information*/
+#define ZM_PHY_BUSY                     (0x3C)
+/** There are already ZM_PIPELINE_SIZE outstanding requests
+@see zm_pipeline.c */
+#define ZM_PIPELINE_FULL                (0x3D)
+/** There are already AF_BROADCAST_QUEUE_SIZE broadcasts waiting to be sent
+@see afBroadcastData() in af.c */
+#define ZM_BROADCAST_QUEUE_FULL         (0x3E)
 
 
 
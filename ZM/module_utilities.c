@@ -38,10 +38,11 @@
 #include "module_errors.h"
 #include "module_utilities.h"
 #include "zm_phy.h"
+#include "zm_frame.h"
+#include "zm_deadline.h"
 #include "../Common/utilities.h"
 #include <stddef.h>
-
-extern unsigned char zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
+#include <string.h>
 
  /** Default configuration for a standard coordinator. Modify in application as needed. */
 const struct moduleConfiguration DEFAULT_MODULE_CONFIGURATION_COORDINATOR = {
@@ -76,44 +77,56 @@ SECURITY_MODE_OFF,
 NULL
 };
 
-/** 
-How often in milliseconds to check whether the module has a state change method. This is just
-reading a GPIO, not actually communicating with the module (unless indeed a message is waiting. */
-#define WFDS_POLL_INTERVAL_MS   100
+/** Shortest timeout accepted by waitForDeviceState() */
+#define WFDS_MINIMUM_TIMEOUT_MS   100
 
 #define METHOD_WAIT_FOR_DEVICE_STATE              0x6000
 /** 
 Private method used to wait until a message is received indicating that we are on the network. 
 Exits if received message is a ZDO_STATE_CHANGE_IND and the state matches what we want. 
-Else loops until timeout. 
+Else loops until timeout. Other messages are parked in the frame pool, if there is a free frame.
 @note Since this is basically a blocking wait, you can also implement this in your application.
 @param expectedState the deviceState we are expecting - DEV_ZB_COORD etc.
-@param timeoutMs the amount of milliseconds to wait before returning an error. Should be an integer
-multiple of WFDS_POLL_INTERVAL_MS.
+@param timeoutMs the amount of milliseconds to wait before returning an error, at least 
+WFDS_MINIMUM_TIMEOUT_MS.
+@note If ZM_WAIT_FOR_EVENT is defined then the processor sleeps until the Module has a message 
+instead of polling until a deadline.
 @todo modify this if using UART.
 */
 static moduleResult_t waitForDeviceState(unsigned char expectedState, uint16_t timeoutMs)
 {
-  RETURN_INVALID_PARAMETER_IF_TRUE( ((!(IS_VALID_DEVICE_STATE(expectedState))) || (timeoutMs < WFDS_POLL_INTERVAL_MS)), METHOD_WAIT_FOR_DEVICE_STATE);
+  RETURN_INVALID_PARAMETER_IF_TRUE( ((!(IS_VALID_DEVICE_STATE(expectedState))) || (timeoutMs < WFDS_MINIMUM_TIMEOUT_MS)), METHOD_WAIT_FOR_DEVICE_STATE);
   
-  uint16_t intervals = timeoutMs / WFDS_POLL_INTERVAL_MS;                   // how many times to check
   uint8_t state = 0xFF;
 
-  while (intervals--)
+#ifdef ZM_WAIT_FOR_EVENT
+  halWaitTimerStart(timeoutMs);
+  while (phyWaitForMessage())
+#else
+  struct deadline d;
+  deadlineStart(&d, timeoutMs * 1000UL);
+  while (!deadlineExpired(&d))
+#endif
   {
-    if (moduleHasMessageWaiting())                                          // If there's a message waiting for us
+    if (phyHasMessageWaiting())                                             // If there's a message waiting for us
     {
-      getMessage();
+      phyGetMessage();
 
       if (CONVERT_TO_INT(zmBuf[2], zmBuf[1]) == ZDO_STATE_CHANGE_IND)       // if it's a state change message
       {
         state = zmBuf[SRSP_PAYLOAD_START];
         printf("%s, ", getDeviceStateName(state));                          // display the name of the state in the message
         if (state == expectedState)                                         // if it's the state we're expecting
+        {
+#ifdef ZM_WAIT_FOR_EVENT
+          halWaitTimerStop();
+#endif
           return MODULE_SUCCESS;                                                //Then we're done!
-      } //else we received a different type of message so we just ignore it
+        }
+      } else {                                                              //else we received a different type of message so keep it for later
+        frameParkWorking();
+      }
     }
-    delayMs(WFDS_POLL_INTERVAL_MS);
   }
   // We've completed the loop without receiving the sate that we want; so therefore we've timed out.
   RETURN_RESULT(TIMEOUT, METHOD_WAIT_FOR_DEVICE_STATE);
@@ -243,35 +256,19 @@ static moduleResult_t setModuleRfPower(uint8_t productId, uint16_t moduleRegion)
 }
 
 
-#define METHOD_EXPRESS_START_MODULE              0x6300
 /**
-Starts module using an operating region as a parameter. This does NOT read the GPIO pin to set the region.
-@param mc the module configuration - what RF channel, which PAN ID, etc. These options are used in
-this expressStartModule function as arguments to the various functions.
-@param ac the Zigbee application configuration - which endpoint to use and other global settings. 
-If not using GENERIC_APPLICATION_CONFIGURATION then you must #define the compilation option 
-SUPPORT_CUSTOM_APPLICATION_CONFIGURATION. Normally this option is NOT defined to reduce code size.
-@param moduleRegion - which region of the world to use to ensure FCC/ETSI compliance.
+Private method to configure the Module, after the Module was reset with the startup options applied. 
+Used by expressStartModule(), warmStartModule() and the non-blocking startup. Configuration items 
+that are unchanged aren't rewritten, see zbWriteConfiguration().
+@param mc the module configuration
+@param productId from the SYS_RESET_IND
+@param moduleRegion which region of the world to use to ensure FCC/ETSI compliance
+@param methodId the method to report errors for
 */
-moduleResult_t expressStartModule(const struct moduleConfiguration* mc, const struct applicationConfiguration* ac, const uint8_t moduleRegion)
+static moduleResult_t configureModule(const struct moduleConfiguration* mc, uint8_t productId, 
+                                      uint8_t moduleRegion, uint16_t methodId)
 {
-    printf("Express Startup ");
-    
-    /* Initialize the Module */
-    RETURN_RESULT_IF_FAIL(moduleReset(), METHOD_EXPRESS_START_MODULE);
-    
-    /* Clear out any old network or state information (if requested) */
-    printf("Startup Options 0x%02X\r\n", mc->startupOptions);
-    RETURN_RESULT_IF_FAIL(setStartupOptions(mc->startupOptions), METHOD_EXPRESS_START_MODULE);
-
-    /* Reset the Module to apply the changes we just set */
-    RETURN_RESULT_IF_FAIL(moduleReset(), METHOD_EXPRESS_START_MODULE);
-    
-    /* Read the productId - this indicates the model of module used. */
-    uint8_t productId = zmBuf[SYS_RESET_IND_PRODUCTID_FIELD]; 
-    
-    /* If this is not valid (bad firmware) then stop */
-    RETURN_RESULT_IF_EXPRESSION_TRUE((productId < MINIMUM_BUILD_ID), METHOD_EXPRESS_START_MODULE, ZM_INVALID_MODULE_CONFIGURATION); 
+    (void) methodId;                                    //only used if HANDLE_ERROR() reports errors
     
     /* Configure the module's RF output */ 
     setModuleRfPower(productId, moduleRegion);
@@ -279,48 +276,95 @@ moduleResult_t expressStartModule(const struct moduleConfiguration* mc, const st
     /* Set any end device options */
     if (mc->deviceType == END_DEVICE)
     {
-	    RETURN_RESULT_IF_FAIL(setPollRate(mc->endDevicePollRate), METHOD_EXPRESS_START_MODULE);
+	    RETURN_RESULT_IF_FAIL(setPollRate(mc->endDevicePollRate), methodId);
     }
     /* Override for testing low power operation - referenced in Basic Comms ED example*/
 #ifdef DISABLE_END_DEVICE_POLLING
-    RETURN_RESULT_IF_FAIL(setPollRate(0), METHOD_EXPRESS_START_MODULE);
+    RETURN_RESULT_IF_FAIL(setPollRate(0), methodId);
 #endif
     
     /* Configure the Zigbee Device Type (Coordinator, Router, End Device */
-    RETURN_RESULT_IF_FAIL(setZigbeeDeviceType(mc->deviceType), METHOD_EXPRESS_START_MODULE);
+    RETURN_RESULT_IF_FAIL(setZigbeeDeviceType(mc->deviceType), methodId);
 
     /* Configure which RF Channels to use. If none set then this will default to a default set. */
-    RETURN_RESULT_IF_FAIL(setChannelMask(mc->channelMask), METHOD_EXPRESS_START_MODULE);
+    RETURN_RESULT_IF_FAIL(setChannelMask(mc->channelMask), methodId);
     
     /* Set the PAN ID, if you want to restrict the module to only a particular PAN ID. */
-    RETURN_RESULT_IF_FAIL(setPanId(mc->panId), METHOD_EXPRESS_START_MODULE);
-    RETURN_RESULT_IF_FAIL(setCallbacks(CALLBACKS_ENABLED), METHOD_EXPRESS_START_MODULE);
+    RETURN_RESULT_IF_FAIL(setPanId(mc->panId), methodId);
+    RETURN_RESULT_IF_FAIL(setCallbacks(CALLBACKS_ENABLED), methodId);
     
     /* Set security mode and security key if required. Note: If a coordinator has 
     ZCD_NV_SECURITY_MODE = 00 then router must have ZCD_NV_SECURITY_MODE = 01 or else they won't communicate */
     if (mc->securityMode != SECURITY_MODE_OFF)        
     {
-    	RETURN_RESULT_IF_FAIL(setSecurityMode(mc->securityMode), METHOD_EXPRESS_START_MODULE);
-    	RETURN_RESULT_IF_FAIL(setSecurityKey(mc->securityKey), METHOD_EXPRESS_START_MODULE);
+    	RETURN_RESULT_IF_FAIL(setSecurityMode(mc->securityMode), methodId);
+    	RETURN_RESULT_IF_FAIL(setSecurityKey(mc->securityKey), methodId);
     }
+    return MODULE_SUCCESS;
+}
 
+/**
+Private method to register the application with the Module, after configureModule().
+@param ac the Zigbee application configuration
+@param methodId the method to report errors for
+*/
+static moduleResult_t registerApplication(const struct applicationConfiguration* ac, uint16_t methodId)
+{
+    (void) methodId;                                    //only used if HANDLE_ERROR() reports errors
 #ifdef SUPPORT_CUSTOM_APPLICATION_CONFIGURATION    
     if (ac == GENERIC_APPLICATION_CONFIGURATION)
     {
-    RETURN_RESULT_IF_FAIL(afRegisterGenericApplication(), METHOD_EXPRESS_START_MODULE);    // Configure the Module for our application
+    RETURN_RESULT_IF_FAIL(afRegisterGenericApplication(), methodId);    // Configure the Module for our application
     } else {
-    RETURN_RESULT_IF_FAIL(afRegisterApplication(ac), METHOD_EXPRESS_START_MODULE);
+    RETURN_RESULT_IF_FAIL(afRegisterApplication(ac), methodId);
     }
 #else    
     if (ac == GENERIC_APPLICATION_CONFIGURATION)
     {
-    RETURN_RESULT_IF_FAIL(afRegisterGenericApplication(), METHOD_EXPRESS_START_MODULE);    // Configure the Module for our application
+    RETURN_RESULT_IF_FAIL(afRegisterGenericApplication(), methodId);    // Configure the Module for our application
     } else {
         /* Note: to use a custom application configuration, you must #define SUPPORT_CUSTOM_APPLICATION_CONFIGURATION. */
     return INVALID_PARAMETER;
     }    
 #endif
     
+    return MODULE_SUCCESS;
+}
+
+#define METHOD_EXPRESS_START_MODULE              0x6300
+/**
+Starts module using an operating region as a parameter. This does NOT read the GPIO pin to set the region.
+@param mc the module configuration - what RF channel, which PAN ID, etc. These options are used in
+this expressStartModule function as arguments to the various functions.
+@param ac the Zigbee application configuration - which endpoint to use and other global settings. 
+If not using GENERIC_APPLICATION_CONFIGURATION then you must #define the compilation option 
+SUPPORT_CUSTOM_APPLICATION_CONFIGURATION. Normally this option is NOT defined to reduce code size.
+@param moduleRegion - which region of the world to use to ensure FCC/ETSI compliance.
+*/
+moduleResult_t expressStartModule(const struct moduleConfiguration* mc, const struct applicationConfiguration* ac, const uint8_t moduleRegion)
+{
+    printf("Express Startup ");
+    
+    /* Initialize the Module */
+    RETURN_RESULT_IF_FAIL(moduleReset(), METHOD_EXPRESS_START_MODULE);
+    
+    /* Clear out any old network or state information (if requested) */
+    printf("Startup Options 0x%02X\r\n", mc->startupOptions);
+    RETURN_RESULT_IF_FAIL(setStartupOptions(mc->startupOptions), METHOD_EXPRESS_START_MODULE);
+
+    /* Reset the Module to apply the changes we just set */
+    RETURN_RESULT_IF_FAIL(moduleReset(), METHOD_EXPRESS_START_MODULE);
+    
+    /* Read the productId - this indicates the model of module used. */
+    uint8_t productId = zmBuf[SYS_RESET_IND_PRODUCTID_FIELD]; 
+    
+    /* If this is not valid (bad firmware) then stop */
+    RETURN_RESULT_IF_EXPRESSION_TRUE((productId < MINIMUM_BUILD_ID), METHOD_EXPRESS_START_MODULE, ZM_INVALID_MODULE_CONFIGURATION); 
+    
+    /* Configure the Module and register our application */
+    RETURN_RESULT_IF_FAIL(configureModule(mc, productId, moduleRegion, METHOD_EXPRESS_START_MODULE), METHOD_EXPRESS_START_MODULE);
+    RETURN_RESULT_IF_FAIL(registerApplication(ac, METHOD_EXPRESS_START_MODULE), METHOD_EXPRESS_START_MODULE);
+    
     /* Note: you can register more than one Zigbee endpoint; just call afRegisterApplication() here
     for the next endpoint */
     
@@ -339,6 +383,132 @@ moduleResult_t expressStartModule(const struct moduleConfiguration* mc, const st
 	#endif
 }
 
+/** How long warmStartModule() took to get back on the network, in milliseconds. 0 if the hal file 
+has no free-running timer (HAL_TIMER_TICKS) to measure it. */
+uint32_t warmStartOffNetworkMs = 0;
+
+//Layout of the network state in WARM_START_NV_ITEM. Addresses are LSB first.
+#define NETWORK_STATE_MARKER_FIELD              0
+#define NETWORK_STATE_DEVICE_STATE_FIELD        1
+#define NETWORK_STATE_PANID_FIELD               2
+#define NETWORK_STATE_CHANNEL_FIELD             4
+#define NETWORK_STATE_SHORT_ADDRESS_FIELD       5
+#define NETWORK_STATE_EXTENDED_PANID_FIELD      7
+#define NETWORK_STATE_LENGTH                    15
+#define NETWORK_STATE_VALID                     0xA5
+
+#define METHOD_WARM_START_MODULE               0x6400
+#define METHOD_SAVE_NETWORK_STATE              0x6500
+/**
+Saves the network that the Module is on, so that warmStartModule() can tell whether the Module still 
+has it after a reset. Called by warmStartModule(); call it after startModule() or expressStartModule()
+to use warmStartModule() on the next startup. The NV item is only written if the network changed.
+@pre Module is on a network
+@post zmBuf is overwritten
+*/
+moduleResult_t saveNetworkState()
+{
+    struct deviceInformation di;
+    RETURN_RESULT_IF_FAIL(moduleGetDeviceInfoSnapshot(&di), METHOD_SAVE_NETWORK_STATE);
+    
+    uint8_t state[16];                                  //the size of WARM_START_NV_ITEM
+    memset(state, 0, sizeof(state));
+    state[NETWORK_STATE_MARKER_FIELD] = NETWORK_STATE_VALID;
+    state[NETWORK_STATE_DEVICE_STATE_FIELD] = di.deviceState;
+    state[NETWORK_STATE_PANID_FIELD] = LSB(di.panId);
+    state[NETWORK_STATE_PANID_FIELD+1] = MSB(di.panId);
+    state[NETWORK_STATE_CHANNEL_FIELD] = di.channel;
+    state[NETWORK_STATE_SHORT_ADDRESS_FIELD] = LSB(di.shortAddress);
+    state[NETWORK_STATE_SHORT_ADDRESS_FIELD+1] = MSB(di.shortAddress);
+    memcpy(state + NETWORK_STATE_EXTENDED_PANID_FIELD, di.extendedPanId, DIP_EXTENDED_PANID_LENGTH);
+    
+    if ((sysNvRead(WARM_START_NV_ITEM) == MODULE_SUCCESS) && 
+        (memcmp(zmBuf + SYS_NV_READ_RESULT_START_FIELD, state, NETWORK_STATE_LENGTH) == 0))
+        return MODULE_SUCCESS;                          //unchanged, so don't wear the flash
+    RETURN_RESULT(sysNvWrite(WARM_START_NV_ITEM, state), METHOD_SAVE_NETWORK_STATE);
+}
+
+/**
+Private method to resume the network saved in WARM_START_NV_ITEM, used by warmStartModule(). 
+@pre the Module was just reset
+@return MODULE_SUCCESS if the Module is back on the network (or ZDO_STATE_CHANGE_IND_HANDLED_BY_APPLICATION
+is defined and it was started), else an error code, e.g. ZM_INVALID_MODULE_CONFIGURATION if there's no 
+saved network that matches mc.
+*/
+static moduleResult_t resumeNetwork(const struct moduleConfiguration* mc, const struct applicationConfiguration* ac, 
+                                    uint8_t productId, uint8_t moduleRegion)
+{
+    if (sysNvRead(WARM_START_NV_ITEM) != MODULE_SUCCESS)
+        return ZM_INVALID_MODULE_CONFIGURATION;
+    uint8_t* state = zmBuf + SYS_NV_READ_RESULT_START_FIELD;
+    uint16_t panId = CONVERT_TO_INT(state[NETWORK_STATE_PANID_FIELD], state[NETWORK_STATE_PANID_FIELD+1]);
+    if ((state[NETWORK_STATE_MARKER_FIELD] != NETWORK_STATE_VALID) || 
+        (state[NETWORK_STATE_DEVICE_STATE_FIELD] != getDeviceStateForDeviceType(mc->deviceType)) ||
+        ((mc->panId != ANY_PAN) && (mc->panId != panId)))
+    {
+        printf("- no saved network\r\n");
+        return ZM_INVALID_MODULE_CONFIGURATION;
+    }
+    printf("- resuming PAN 0x%04X channel %u\r\n", panId, state[NETWORK_STATE_CHANNEL_FIELD]);
+    
+    /* Keep the network state, but use any other startup options. These are read when the Module 
+    starts, so there's no need to reset again. */
+    RETURN_RESULT_IF_FAIL(setStartupOptions(mc->startupOptions & ~(STARTOPT_CLEAR_CONFIG | STARTOPT_CLEAR_STATE)), METHOD_WARM_START_MODULE);
+    RETURN_RESULT_IF_FAIL(configureModule(mc, productId, moduleRegion, METHOD_WARM_START_MODULE), METHOD_WARM_START_MODULE);
+    RETURN_RESULT_IF_FAIL(registerApplication(ac, METHOD_WARM_START_MODULE), METHOD_WARM_START_MODULE);
+    RETURN_RESULT_IF_FAIL(zdoStartApplication(), METHOD_WARM_START_MODULE);
+#ifdef ZDO_STATE_CHANGE_IND_HANDLED_BY_APPLICATION
+    return MODULE_SUCCESS;
+#else
+    return waitForDeviceState(getDeviceStateForDeviceType(mc->deviceType), WARM_START_TIMEOUT_MS);
+#endif
+}
+
+/**
+Restarts the Module on the network that it was on before, e.g. after the application processor or
+the Module was reset. If WARM_START_NV_ITEM shows that the Module was on a network as this deviceType
+(and on this panId, unless ANY_PAN) then the startup options that clear the network state aren't used,
+so the Module resumes with the PAN, channel and short address in its NV memory instead of joining 
+again. This is much faster than a cold start and doesn't cause association traffic on the network.
+If there is no saved network, or the Module doesn't resume within WARM_START_TIMEOUT_MS, then this 
+does a cold start with expressStartModule().
+@param mc the module configuration, see expressStartModule()
+@param ac the Zigbee application configuration, see expressStartModule()
+@param moduleRegion which region of the world to use to ensure FCC/ETSI compliance.
+@post warmStartOffNetworkMs is how long it took to get back on the network
+@post the network is saved with saveNetworkState() for the next time
+@note if ZDO_STATE_CHANGE_IND_HANDLED_BY_APPLICATION is defined then this returns without waiting; 
+the application should call saveNetworkState() once it is on the network.
+*/
+moduleResult_t warmStartModule(const struct moduleConfiguration* mc, const struct applicationConfiguration* ac, const uint8_t moduleRegion)
+{
+#ifdef HAL_TIMER_TICKS
+    struct deadline offNetwork;                         //only used to measure the time
+    deadlineStart(&offNetwork, 0xFFFFFFFF);
+#endif
+    printf("Warm Startup ");
+    warmStartOffNetworkMs = 0;
+    RETURN_RESULT_IF_FAIL(moduleReset(), METHOD_WARM_START_MODULE);
+    uint8_t productId = zmBuf[SYS_RESET_IND_PRODUCTID_FIELD]; 
+    RETURN_RESULT_IF_EXPRESSION_TRUE((productId < MINIMUM_BUILD_ID), METHOD_WARM_START_MODULE, ZM_INVALID_MODULE_CONFIGURATION); 
+    
+    if (resumeNetwork(mc, ac, productId, moduleRegion) != MODULE_SUCCESS)
+    {
+        printf("Cold start: ");
+        RETURN_RESULT_IF_FAIL(expressStartModule(mc, ac, moduleRegion), METHOD_WARM_START_MODULE);
+    }
+#ifdef ZDO_STATE_CHANGE_IND_HANDLED_BY_APPLICATION
+    return MODULE_SUCCESS;
+#else
+#ifdef HAL_TIMER_TICKS
+    deadlineExpired(&offNetwork);
+    warmStartOffNetworkMs = deadlineElapsedUs(&offNetwork) / 1000;
+#endif
+    printf("On network after %lumS\r\n", (unsigned long) warmStartOffNetworkMs);
+    RETURN_RESULT(saveNetworkState(), METHOD_WARM_START_MODULE);
+#endif
+}
+
 #define METHOD_START_MODULE              0x6100
 /**
 Start the Module and join a network, using the AF/ZDO interface. Reads RF Operating Region (US/EU) from GPIO.
@@ -416,6 +586,179 @@ moduleResult_t startModule(const struct moduleConfiguration* mc, const struct ap
 }
 
 
+/* State of the non-blocking startup, see startupBegin() */
+static uint8_t startupState = STARTUP_IDLE;
+static const struct moduleConfiguration* startupMc;
+static const struct applicationConfiguration* startupAc;
+static uint8_t startupRegion;
+static uint8_t startupProductId;
+static uint16_t startupTimeLeftMs;
+static startupCallback_t startupCallback;
+
+/** Private method to move the startup to the next step and tell the application. */
+static void startupEnter(uint8_t step, moduleResult_t result)
+{
+    startupState = step;
+    if (startupCallback != NULL)
+        startupCallback(step, result);
+}
+
+/** Private method to reset the Module without waiting for it, and wait for the SYS_RESET_IND in step. */
+static void startupReset(uint8_t step)
+{
+    moduleResetStart();
+    startupTimeLeftMs = STARTUP_RESET_TIMEOUT_MS;
+    startupEnter(step, MODULE_SUCCESS);
+}
+
+#define METHOD_STARTUP_BEGIN              0x6600
+/**
+Starts the Module like expressStartModule(), but without blocking, so that the application can keep
+doing its own work, e.g. sampling sensors, while the Module starts and joins the network. The startup
+is done in steps: STARTUP_RESET, STARTUP_OPTIONS, STARTUP_RESET_APPLY, STARTUP_CONFIGURE, 
+STARTUP_REGISTER, STARTUP_START and STARTUP_WAIT_FOR_STATE, and ends with STARTUP_DONE or 
+STARTUP_FAILED. The application drives it from its loop:
+<pre>
+    startupBegin(&mc, GENERIC_APPLICATION_CONFIGURATION, MODULE_REGION_NORTH_AMERICA, startupProgress);
+    while (1)
+    {
+        if (moduleHasMessageWaiting())
+        {
+            getMessage();
+            if (!startupDispatch())
+                handleMessage();
+        }
+        if (tickElapsed)
+            startupTick(TICK_MS);
+        sampleSensors();
+    }
+</pre>
+The steps that send commands to the Module are done in startupTick(), one step per call, and each 
+takes a few milliseconds. The waits for the Module to reset and to join the network are done by 
+startupDispatch() when the SYS_RESET_IND or ZDO_STATE_CHANGE_IND is received, and time out in 
+startupTick(). Calling startupBegin() again starts over.
+@param mc the module configuration, see expressStartModule(). Must stay valid until the startup ends.
+@param ac the Zigbee application configuration, see expressStartModule(). Must stay valid until the 
+startup ends.
+@param moduleRegion which region of the world to use to ensure FCC/ETSI compliance.
+@param callback called with the step and MODULE_SUCCESS when each step starts, with STARTUP_DONE or 
+with STARTUP_FAILED and the error when the startup ends, and with STARTUP_WAIT_FOR_STATE for each 
+ZDO_STATE_CHANGE_IND while joining, which is then in zmBuf. May be NULL.
+*/
+moduleResult_t startupBegin(const struct moduleConfiguration* mc, const struct applicationConfiguration* ac, 
+                            uint8_t moduleRegion, startupCallback_t callback)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((mc == NULL), METHOD_STARTUP_BEGIN);
+    RETURN_INVALID_PARAMETER_IF_TRUE((getDeviceStateForDeviceType(mc->deviceType) == INVALID_DEVICETYPE), METHOD_STARTUP_BEGIN);
+    startupMc = mc;
+    startupAc = ac;
+    startupRegion = moduleRegion;
+    startupCallback = callback;
+    startupReset(STARTUP_RESET);
+    return MODULE_SUCCESS;
+}
+
+/**
+Gives the message in zmBuf to the non-blocking startup, see startupBegin().
+@return 1 if the message was for the startup: the SYS_RESET_IND that it was waiting for, or a 
+ZDO_STATE_CHANGE_IND while joining. Otherwise 0 and the application should handle the message.
+*/
+uint8_t startupDispatch()
+{
+    switch (startupState)
+    {
+    case STARTUP_RESET:
+        if (!IS_SYS_RESET_IND())
+            return 0;
+        startupEnter(STARTUP_OPTIONS, MODULE_SUCCESS);
+        return 1;
+    case STARTUP_RESET_APPLY:
+        if (!IS_SYS_RESET_IND())
+            return 0;
+        startupProductId = zmBuf[SYS_RESET_IND_PRODUCTID_FIELD];
+        if (startupProductId < MINIMUM_BUILD_ID)
+            startupEnter(STARTUP_FAILED, ZM_INVALID_MODULE_CONFIGURATION);
+        else
+            startupEnter(STARTUP_CONFIGURE, MODULE_SUCCESS);
+        return 1;
+    case STARTUP_WAIT_FOR_STATE:
+        if (MODULE_COMMAND() != ZDO_STATE_CHANGE_IND)
+            return 0;
+        if (zmBuf[SRSP_PAYLOAD_START] == getDeviceStateForDeviceType(startupMc->deviceType))
+            startupEnter(STARTUP_DONE, MODULE_SUCCESS);
+        else if (startupCallback != NULL)
+            startupCallback(STARTUP_WAIT_FOR_STATE, MODULE_SUCCESS);
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+#define METHOD_STARTUP_TICK              0x6700
+/**
+Does the next step of the non-blocking startup if it sends commands to the Module, or counts down 
+the timeout of the step if it waits for the Module. See startupBegin().
+@param elapsedMs time since the last call, in milliseconds
+*/
+void startupTick(uint16_t elapsedMs)
+{
+    moduleResult_t result = MODULE_SUCCESS;
+    switch (startupState)
+    {
+    case STARTUP_RESET:
+    case STARTUP_RESET_APPLY:
+    case STARTUP_WAIT_FOR_STATE:
+        if (elapsedMs >= startupTimeLeftMs)
+            result = TIMEOUT;
+        else
+            startupTimeLeftMs -= elapsedMs;
+        break;
+    case STARTUP_OPTIONS:
+        /* Clear out any old network or state information (if requested), then reset to apply it */
+        result = setStartupOptions(startupMc->startupOptions);
+        if (result == MODULE_SUCCESS)
+            startupReset(STARTUP_RESET_APPLY);
+        break;
+    case STARTUP_CONFIGURE:
+        result = configureModule(startupMc, startupProductId, startupRegion, METHOD_STARTUP_TICK);
+        if (result == MODULE_SUCCESS)
+            startupEnter(STARTUP_REGISTER, MODULE_SUCCESS);
+        break;
+    case STARTUP_REGISTER:
+        result = registerApplication(startupAc, METHOD_STARTUP_TICK);
+        if (result == MODULE_SUCCESS)
+            startupEnter(STARTUP_START, MODULE_SUCCESS);
+        break;
+    case STARTUP_START:
+        result = zdoStartApplication();
+        if (result == MODULE_SUCCESS)
+        {
+#ifdef ZDO_STATE_CHANGE_IND_HANDLED_BY_APPLICATION
+            startupEnter(STARTUP_DONE, MODULE_SUCCESS);
+#else
+            startupTimeLeftMs = STARTUP_JOIN_TIMEOUT_MS;
+            startupEnter(STARTUP_WAIT_FOR_STATE, MODULE_SUCCESS);
+#endif
+        }
+        break;
+    default:
+        return;
+    }
+    if (result != MODULE_SUCCESS)
+    {
+        HANDLE_ERROR(result, METHOD_STARTUP_TICK);
+        startupEnter(STARTUP_FAILED, result);
+    }
+}
+
+/**
+@return the current step of the non-blocking startup, e.g. STARTUP_DONE. See startupBegin().
+*/
+uint8_t startupStep()
+{
+    return startupState;
+}
+
 /** 
 Displays the type of message in zmBuf.
 Ignores the message if length = 0.
@@ -79,6 +79,49 @@ struct moduleConfiguration
 moduleResult_t startModule(const struct moduleConfiguration* mc, const struct applicationConfiguration* ac);
 moduleResult_t expressStartModule(const struct moduleConfiguration* mc, const struct applicationConfiguration* ac, const uint8_t moduleRegion);
 //moduleResult_t expressStartModule(const struct moduleConfiguration* mc, const struct applicationConfiguration* ac);
+moduleResult_t warmStartModule(const struct moduleConfiguration* mc, const struct applicationConfiguration* ac, const uint8_t moduleRegion);
+moduleResult_t saveNetworkState();
+extern uint32_t warmStartOffNetworkMs;
+
+/** The user NV item that saveNetworkState() uses; must be one of the 16 byte items, 5 or 6. Don't use
+it for anything else if using warmStartModule(). */
+#ifndef WARM_START_NV_ITEM
+#define WARM_START_NV_ITEM          6
+#endif
+/** How long warmStartModule() waits for the Module to resume before doing a cold start instead */
+#ifndef WARM_START_TIMEOUT_MS
+#define WARM_START_TIMEOUT_MS       5000
+#endif
+
+/* Steps of the non-blocking startup, see startupBegin() */
+#define STARTUP_IDLE                0
+#define STARTUP_RESET               1       //waiting for the Module to reset
+#define STARTUP_OPTIONS             2       //setting the startup options
+#define STARTUP_RESET_APPLY         3       //waiting for the Module to reset with the startup options
+#define STARTUP_CONFIGURE           4       //configuring device type, channels, PAN ID, security
+#define STARTUP_REGISTER            5       //registering the application
+#define STARTUP_START               6       //starting the application
+#define STARTUP_WAIT_FOR_STATE      7       //waiting to join or form the network
+#define STARTUP_DONE                8
+#define STARTUP_FAILED              9
+
+/** Called by the non-blocking startup with the step it is in, see startupBegin() */
+typedef void (*startupCallback_t)(uint8_t step, moduleResult_t result);
+
+moduleResult_t startupBegin(const struct moduleConfiguration* mc, const struct applicationConfiguration* ac, 
+                            uint8_t moduleRegion, startupCallback_t callback);
+uint8_t startupDispatch();
+void startupTick(uint16_t elapsedMs);
+uint8_t startupStep();
+
+/** How long the non-blocking startup waits for the Module to reset */
+#ifndef STARTUP_RESET_TIMEOUT_MS
+#define STARTUP_RESET_TIMEOUT_MS    2400
+#endif
+/** How long the non-blocking startup waits for the Module to join or form the network */
+#ifndef STARTUP_JOIN_TIMEOUT_MS
+#define STARTUP_JOIN_TIMEOUT_MS     15000
+#endif
 
 #define DEFAULT_CHANNEL_MASK		(CHANNEL_MASK_11 | CHANNEL_MASK_14 | CHANNEL_MASK_17 | CHANNEL_MASK_20 | CHANNEL_MASK_23)
 #define DEFAULT_POLL_RATE_MS		2000
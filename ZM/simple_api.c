@@ -48,13 +48,22 @@
 #include <string.h> //for memcpy()
 #include "module_errors.h"
 #include "zm_phy_spi.h"
+#include "zm_frame.h"
 #include <stdint.h>
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
 /** Incremented for each SEND_DATA_REQUEST, wraps around to 0. */
 uint8_t sequenceNumber = 0;
                 
+#define ZB_APP_REGISTER_REQUEST_SREQ_FIELDS(L, F) \
+    F(L, ENDPOINT, MT_U8) \
+    F(L, PROFILE_ID, MT_U16) \
+    F(L, DEVICE_ID, MT_U16) \
+    F(L, DEVICE_VERSION, MT_U8) \
+    F(L, UNUSED, MT_U8) \
+    F(L, INPUT_CLUSTER_COUNT, MT_U8) \
+    F(L, INPUT_CLUSTERS, MT_VARIABLE)                  //followed by the output cluster count and clusters
+MT_LAYOUT(ZB_APP_REGISTER_REQUEST_SREQ);
+
 #define METHOD_SAPI_REGISTER_APPLICATION              0x4100
 /** Configures the Module for our application.
 Sets which endpoint, profileId, etc. we're using as well as binding information.
@@ -72,21 +81,13 @@ moduleResult_t sapiRegisterApplication(struct applicationConfiguration ac)
     RETURN_INVALID_PARAMETER_IF_TRUE( (ac.endPoint == 0), METHOD_SAPI_REGISTER_APPLICATION);
     RETURN_INVALID_CLUSTER_IF_TRUE( ((ac.numberOfBindingInputClusters > MAX_BINDING_CLUSTERS) || (ac.numberOfBindingOutputClusters > MAX_BINDING_CLUSTERS)), METHOD_SAPI_REGISTER_APPLICATION);
 
-    uint8_t bufferIndex;
-    
-    //zmBuf[0] (length) will be set later
-    zmBuf[1] = MSB(ZB_APP_REGISTER_REQUEST);
-    zmBuf[2] = LSB(ZB_APP_REGISTER_REQUEST); 
-    
-    zmBuf[3] = ac.endPoint;
-    zmBuf[4] = LSB(ac.profileId);
-    zmBuf[5] = MSB(ac.profileId);
-    zmBuf[6] = LSB(ac.deviceId);
-    zmBuf[7] = MSB(ac.deviceId);
-    zmBuf[8] = ac.deviceVersion;
-    zmBuf[9] = 0x00;                     //unused, set to zero
-    zmBuf[10] = ac.numberOfBindingInputClusters;
-    bufferIndex = 11;
+    MT_PUT_U8(ZB_APP_REGISTER_REQUEST_SREQ_ENDPOINT, ac.endPoint);
+    MT_PUT_U16(ZB_APP_REGISTER_REQUEST_SREQ_PROFILE_ID, ac.profileId);
+    MT_PUT_U16(ZB_APP_REGISTER_REQUEST_SREQ_DEVICE_ID, ac.deviceId);
+    MT_PUT_U8(ZB_APP_REGISTER_REQUEST_SREQ_DEVICE_VERSION, ac.deviceVersion);
+    MT_PUT_U8(ZB_APP_REGISTER_REQUEST_SREQ_UNUSED, 0x00);  //unused, set to zero
+    MT_PUT_U8(ZB_APP_REGISTER_REQUEST_SREQ_INPUT_CLUSTER_COUNT, ac.numberOfBindingInputClusters);
+    uint8_t bufferIndex = MT_INDEX(ZB_APP_REGISTER_REQUEST_SREQ_INPUT_CLUSTERS);
     uint8_t i = 0;
     for (i = 0; i<ac.numberOfBindingInputClusters; i++)
     {
@@ -99,8 +100,7 @@ moduleResult_t sapiRegisterApplication(struct applicationConfiguration ac)
         zmBuf[bufferIndex++] = LSB(ac.bindingOutputClusters[i]);
         zmBuf[bufferIndex++] = MSB(ac.bindingOutputClusters[i]);
     }
-    zmBuf[0] = bufferIndex;
-    RETURN_RESULT(sendMessage(), METHOD_SAPI_REGISTER_APPLICATION); 
+    RETURN_RESULT(mtSend(ZB_APP_REGISTER_REQUEST, bufferIndex - SRSP_HEADER_SIZE), METHOD_SAPI_REGISTER_APPLICATION); 
 }
 
 #define METHOD_SAPI_REGISTER_GENERIC_APPLICATION              0x4200
@@ -110,23 +110,20 @@ Sets which endpoint, profileId, etc. we're using as well as binding information
 */
 moduleResult_t sapiRegisterGenericApplication()
 {
-    #define ZB_APP_REGISTER_REQUEST_PAYLOAD_LEN 9    
-    zmBuf[0] = ZB_APP_REGISTER_REQUEST_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZB_APP_REGISTER_REQUEST);
-    zmBuf[2] = LSB(ZB_APP_REGISTER_REQUEST); 
-    
-    zmBuf[3] = DEFAULT_ENDPOINT;
-    zmBuf[4] = LSB(DEFAULT_PROFILE_ID);
-    zmBuf[5] = MSB(DEFAULT_PROFILE_ID);
-    zmBuf[6] = LSB(DEVICE_ID);
-    zmBuf[7] = MSB(DEVICE_ID);
-    zmBuf[8] = DEVICE_VERSION;
-    zmBuf[9] = 0; //unused
-    zmBuf[10] = 0; //number of binding input clusters
-    zmBuf[11] = 0; //number of binding output clusters
-    RETURN_RESULT(sendMessage(), METHOD_SAPI_REGISTER_APPLICATION);
+    MT_PUT_U8(ZB_APP_REGISTER_REQUEST_SREQ_ENDPOINT, DEFAULT_ENDPOINT);
+    MT_PUT_U16(ZB_APP_REGISTER_REQUEST_SREQ_PROFILE_ID, DEFAULT_PROFILE_ID);
+    MT_PUT_U16(ZB_APP_REGISTER_REQUEST_SREQ_DEVICE_ID, DEVICE_ID);
+    MT_PUT_U8(ZB_APP_REGISTER_REQUEST_SREQ_DEVICE_VERSION, DEVICE_VERSION);
+    MT_PUT_U8(ZB_APP_REGISTER_REQUEST_SREQ_UNUSED, 0);
+    MT_PUT_U8(ZB_APP_REGISTER_REQUEST_SREQ_INPUT_CLUSTER_COUNT, 0);
+    MT_PUT_U8(ZB_APP_REGISTER_REQUEST_SREQ_INPUT_CLUSTERS, 0);  //number of binding output clusters
+    RETURN_RESULT(mtSend(ZB_APP_REGISTER_REQUEST, MT_LENGTH(ZB_APP_REGISTER_REQUEST_SREQ) + 1), METHOD_SAPI_REGISTER_APPLICATION);
 }
 
+#define ZB_START_CONFIRM_AREQ_FIELDS(L, F) \
+    F(L, STATUS, MT_U8)
+MT_LAYOUT(ZB_START_CONFIRM_AREQ);
+
 #define METHOD_SAPI_START_APPLICATION              0x4300
 /** Starts the Zigbee stack in the Module using the settings from a previous sapiRegisterApplication().
 After this start request process completes, the device is ready to send, receive, and route network traffic.
@@ -144,17 +141,18 @@ moduleResult_t sapiStartApplication()
 #ifdef SIMPLE_API_VERBOSE    
     printf("Start Application with Simple API...");
 #endif    
-    #define ZB_APP_START_REQUEST_PAYLOAD_LEN 0
-    zmBuf[0] = ZB_APP_START_REQUEST_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZB_APP_START_REQUEST);
-    zmBuf[2] = LSB(ZB_APP_START_REQUEST);     
-    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_SAPI_START_APPLICATION);     
+    RETURN_RESULT_IF_FAIL(mtSend(ZB_APP_START_REQUEST, 0), METHOD_SAPI_START_APPLICATION);     
 
 #define ZB_START_CONFIRM_TIMEOUT 15
      RETURN_RESULT_IF_FAIL(waitForMessage(ZB_START_CONFIRM, ZB_START_CONFIRM_TIMEOUT), METHOD_SAPI_START_APPLICATION);
-     RETURN_RESULT(zmBuf[SRSP_PAYLOAD_START], METHOD_SAPI_START_APPLICATION);    
+     RETURN_RESULT(MT_GET_U8(ZB_START_CONFIRM_AREQ_STATUS), METHOD_SAPI_START_APPLICATION);    
 }
 
+#define ZB_PERMIT_JOINING_REQUEST_SREQ_FIELDS(L, F) \
+    F(L, DESTINATION, MT_U16) \
+    F(L, TIMEOUT, MT_U8)
+MT_LAYOUT(ZB_PERMIT_JOINING_REQUEST_SREQ);
+
 #define METHOD_SAPI_SET_JOINING_PERMISSIONS              0x4400
 /** Sets the Joining Permissions for this device or other devices. 
 By default, after a setStartupOptions(CLEAR_CONFIG), joining is set to allow all devices, indefinitely.
@@ -176,18 +174,26 @@ moduleResult_t sapiSetJoiningPermissions(uint16_t destination, uint8_t timeout)
         printf(" for %u seconds\r\n", timeout);
 #endif
     
-    #define ZB_PERMIT_JOINING_REQUEST_PAYLOAD_LEN 3
-    zmBuf[0] = ZB_PERMIT_JOINING_REQUEST_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZB_PERMIT_JOINING_REQUEST);
-    zmBuf[2] = LSB(ZB_PERMIT_JOINING_REQUEST);   
-    
-    zmBuf[3] = LSB(destination);
-    zmBuf[4] = MSB(destination);
-    zmBuf[5] = timeout;
-    RETURN_RESULT(sendMessage(), METHOD_SAPI_SET_JOINING_PERMISSIONS);      
+    MT_PUT_U16(ZB_PERMIT_JOINING_REQUEST_SREQ_DESTINATION, destination);
+    MT_PUT_U8(ZB_PERMIT_JOINING_REQUEST_SREQ_TIMEOUT, timeout);
+    RETURN_RESULT(mtSend(ZB_PERMIT_JOINING_REQUEST, MT_LENGTH(ZB_PERMIT_JOINING_REQUEST_SREQ)), METHOD_SAPI_SET_JOINING_PERMISSIONS);      
 }
 
 
+#define ZB_SEND_DATA_REQUEST_SREQ_FIELDS(L, F) \
+    F(L, DESTINATION, MT_U16) \
+    F(L, COMMAND_ID, MT_U16) \
+    F(L, HANDLE, MT_U8) \
+    F(L, ACK, MT_U8) \
+    F(L, RADIUS, MT_U8) \
+    F(L, LENGTH, MT_U8) \
+    F(L, DATA, MT_VARIABLE)
+MT_LAYOUT(ZB_SEND_DATA_REQUEST_SREQ);
+#define ZB_SEND_DATA_CONFIRM_AREQ_FIELDS(L, F) \
+    F(L, HANDLE, MT_U8) \
+    F(L, STATUS, MT_U8)
+MT_LAYOUT(ZB_SEND_DATA_CONFIRM_AREQ);
+
 #define METHOD_SAPI_SEND_DATA              0x4500
 /** Sends a message to another device over the Zigbee network.
 @note On a coordinator in a trivial test setup, it takes approximately 10mSec from sending 
@@ -218,28 +224,21 @@ moduleResult_t sapiSendData(uint16_t destinationShortAddress, uint16_t clusterId
     RETURN_INVALID_LENGTH_IF_TRUE( ((dataLength > MAXIMUM_PAYLOAD_LENGTH) || (dataLength == 0)), METHOD_SAPI_SEND_DATA);
     RETURN_INVALID_CLUSTER_IF_TRUE( (clusterId == 0), METHOD_SAPI_SEND_DATA);
 
-    #define ZB_SEND_DATA_REQUEST_PAYLOAD_LEN 8
-    zmBuf[0] = ZB_SEND_DATA_REQUEST_PAYLOAD_LEN + dataLength;
-    zmBuf[1] = MSB(ZB_SEND_DATA_REQUEST);
-    zmBuf[2] = LSB(ZB_SEND_DATA_REQUEST);  
-    
-    zmBuf[3] = LSB(destinationShortAddress); 
-    zmBuf[4] = MSB(destinationShortAddress); 
-    zmBuf[5] = LSB(clusterId); 
-    zmBuf[6] = MSB(clusterId); 
-    zmBuf[7] = sequenceNumber++;  //handle aka Transaction Sequence Number
-    zmBuf[8] = SAPI_MAC_ACK;  
-    zmBuf[9] = DEFAULT_RADIUS;
-    zmBuf[10] = dataLength;  
-    memcpy(zmBuf+ZB_SEND_DATA_REQUEST_PAYLOAD_LEN+3, data, dataLength);
+    MT_PUT_U16(ZB_SEND_DATA_REQUEST_SREQ_DESTINATION, destinationShortAddress);
+    MT_PUT_U16(ZB_SEND_DATA_REQUEST_SREQ_COMMAND_ID, clusterId);
+    MT_PUT_U8(ZB_SEND_DATA_REQUEST_SREQ_HANDLE, sequenceNumber++);  //handle aka Transaction Sequence Number
+    MT_PUT_U8(ZB_SEND_DATA_REQUEST_SREQ_ACK, SAPI_MAC_ACK);
+    MT_PUT_U8(ZB_SEND_DATA_REQUEST_SREQ_RADIUS, DEFAULT_RADIUS);
+    MT_PUT_U8(ZB_SEND_DATA_REQUEST_SREQ_LENGTH, dataLength);
+    memcpy(MT_POINTER(ZB_SEND_DATA_REQUEST_SREQ_DATA), data, dataLength);
     
-    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_SAPI_SEND_DATA);  
+    RETURN_RESULT_IF_FAIL(mtSend(ZB_SEND_DATA_REQUEST, MT_LENGTH(ZB_SEND_DATA_REQUEST_SREQ) + dataLength), METHOD_SAPI_SEND_DATA);  
     #define ZB_SEND_DATA_CONFIRM_TIMEOUT    5
     
     //Now, wait for message, and verify that it's a ZB_SEND_DATA_CONFIRM, else timeout.
     //NOTE: Do not print anything out here, or else you might miss the ZB_SEND_DATA_CONFIRM!    
     RETURN_RESULT_IF_FAIL(waitForMessage(ZB_SEND_DATA_CONFIRM, ZB_SEND_DATA_CONFIRM_TIMEOUT), METHOD_SAPI_SEND_DATA);
-    RETURN_RESULT(zmBuf[SRSP_PAYLOAD_START+1], METHOD_SAPI_SEND_DATA); //verify status is succesS
+    RETURN_RESULT(MT_GET_U8(ZB_SEND_DATA_CONFIRM_AREQ_STATUS), METHOD_SAPI_SEND_DATA); //verify status is succesS
 }
 
 #define MODULE_TYPE_MASK                    0x0F    
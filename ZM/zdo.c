@@ -47,10 +47,13 @@
 #include "../Common/utilities.h"
 #include "module_errors.h"
 #include "zm_phy_spi.h"
+#include "zm_frame.h"
 #include <string.h>                 //for memcpy()
 #include <stdint.h>
 
-extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
+#define ZDO_STARTUP_FROM_APP_SREQ_FIELDS(L, F) \
+    F(L, START_DELAY, MT_U8)
+MT_LAYOUT(ZDO_STARTUP_FROM_APP_SREQ);
 
 #define METHOD_ZDO_STARTUP_FROM_APP                    0x31
 /** Starts the Zigbee stack in the Module using the settings from a previous afRegisterApplication().
@@ -67,17 +70,27 @@ moduleResult_t zdoStartApplication()
 #ifdef ZDO_VERBOSE    
     printf("Start Application with AF/ZDO...");
 #endif    
-#define ZDO_STARTUP_FROM_APP_PAYLOAD_LEN 1    
-    zmBuf[0] = ZDO_STARTUP_FROM_APP_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZDO_STARTUP_FROM_APP);
-    zmBuf[2] = LSB(ZDO_STARTUP_FROM_APP);      
-    
 #define NO_START_DELAY 0
-    zmBuf[3] = NO_START_DELAY;
-    RETURN_RESULT(sendMessage(), ZDO_STARTUP_FROM_APP);
+    MT_PUT_U8(ZDO_STARTUP_FROM_APP_SREQ_START_DELAY, NO_START_DELAY);
+    RETURN_RESULT(mtSend(ZDO_STARTUP_FROM_APP, MT_LENGTH(ZDO_STARTUP_FROM_APP_SREQ)), ZDO_STARTUP_FROM_APP);
 }
 
 
+#define ZDO_IEEE_ADDR_REQ_SREQ_FIELDS(L, F) \
+    F(L, SHORT_ADDRESS, MT_U16) \
+    F(L, REQUEST_TYPE, MT_U8) \
+    F(L, START_INDEX, MT_U8)
+MT_LAYOUT(ZDO_IEEE_ADDR_REQ_SREQ);
+/** Writes a ZDO_IEEE_ADDR_REQ into zmBuf. Private helper method for zdoRequestIeeeAddress() and 
+zdoRequestIeeeAddressAsync(), which check the parameters. */
+static void zdoPackIeeeAddressRequest(uint16_t shortAddress, uint8_t requestType, uint8_t startIndex)
+{
+    mtPack(zmBuf, ZDO_IEEE_ADDR_REQ, MT_LENGTH(ZDO_IEEE_ADDR_REQ_SREQ));
+    MT_PUT_U16(ZDO_IEEE_ADDR_REQ_SREQ_SHORT_ADDRESS, shortAddress);
+    MT_PUT_U8(ZDO_IEEE_ADDR_REQ_SREQ_REQUEST_TYPE, requestType);
+    MT_PUT_U8(ZDO_IEEE_ADDR_REQ_SREQ_START_INDEX, startIndex);
+}
+
 #define METHOD_ZDO_IEEE_ADDR_REQ                    0x32
 #define METHOD_ZDO_IEEE_ADDR_RSP                    0x33
 /** Requests a remote device's MAC Address (64-bit IEEE Address) given a short address.
@@ -97,15 +110,7 @@ moduleResult_t zdoRequestIeeeAddress(uint16_t shortAddress, uint8_t requestType,
            shortAddress, (requestType == 0) ? "Single" : "Extended", startIndex);
 #endif 
     
-#define ZDO_IEEE_ADDR_REQ_PAYLOAD_LEN 4
-    zmBuf[0] = ZDO_IEEE_ADDR_REQ_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZDO_IEEE_ADDR_REQ);             
-    zmBuf[2] = LSB(ZDO_IEEE_ADDR_REQ);      
-    
-    zmBuf[3] = LSB(shortAddress);
-    zmBuf[4] = MSB(shortAddress);
-    zmBuf[5] = requestType;
-    zmBuf[6] = startIndex;
+    zdoPackIeeeAddressRequest(shortAddress, requestType, startIndex);
     
 #ifdef ZDO_IEEE_ADDR_RSP_HANDLED_BY_APPLICATION           //Return control to main application
     RETURN_RESULT(sendMessage(), METHOD_ZDO_IEEE_ADDR_REQ);
@@ -118,6 +123,44 @@ moduleResult_t zdoRequestIeeeAddress(uint16_t shortAddress, uint8_t requestType,
 #endif
 }
 
+#define METHOD_ZDO_IEEE_ADDR_REQ_ASYNC              0x73
+/** Non-blocking version of zdoRequestIeeeAddress(): sends the ZDO_IEEE_ADDR_REQ and returns once the
+SRSP has been received. The callback is called when the ZDO_IEEE_ADDR_RSP for this short address 
+is received, so lookups of many devices can be outstanding at once.
+@param callback called with the status of the ZDO_IEEE_ADDR_RSP, or TIMEOUT. The response is in zmBuf.
+@param token is set to the token of the request
+@see zdoRequestIeeeAddress for description of the other fields.
+@see zm_pipeline.c for how to receive the ZDO_IEEE_ADDR_RSP.
+@return MODULE_SUCCESS if the request was accepted by the Module, else an error. If an error is 
+returned then the callback won't be called.
+*/
+moduleResult_t zdoRequestIeeeAddressAsync(uint16_t shortAddress, uint8_t requestType, uint8_t startIndex,
+                                          requestCallback_t callback, requestToken_t* token)
+{
+    RETURN_INVALID_PARAMETER_IF_TRUE(((requestType != SINGLE_DEVICE_RESPONSE) && (requestType != INCLUDE_ASSOCIATED_DEVICES)), METHOD_ZDO_IEEE_ADDR_REQ_ASYNC);
+    zdoPackIeeeAddressRequest(shortAddress, requestType, startIndex);
+    
+    uint8_t address[2] = {LSB(shortAddress), MSB(shortAddress)};
+    RETURN_RESULT(pipelineSend(ZDO_IEEE_ADDR_RSP, (SRSP_PAYLOAD_START + ZDO_IEEE_ADDR_RSP_SHORT_ADDRESS_FIELD_START), 
+                               address, 2, ZDO_IEEE_ADDR_RSP_STATUS_FIELD, PIPELINE_DEFAULT_TIMEOUT_MS, 
+                               callback, token), METHOD_ZDO_IEEE_ADDR_REQ_ASYNC);
+}
+
+#define ZDO_NWK_ADDR_REQ_SREQ_FIELDS(L, F) \
+    F(L, IEEE_ADDRESS, MT_BYTES(8)) \
+    F(L, REQUEST_TYPE, MT_U8) \
+    F(L, START_INDEX, MT_U8)
+MT_LAYOUT(ZDO_NWK_ADDR_REQ_SREQ);
+/** Writes a ZDO_NWK_ADDR_REQ into zmBuf. Private helper method for zdoNetworkAddressRequest() and 
+zdoNetworkAddressRequestAsync(), which check the parameters. */
+static void zdoPackNetworkAddressRequest(uint8_t* ieeeAddress, uint8_t requestType, uint8_t startIndex)
+{
+    mtPack(zmBuf, ZDO_NWK_ADDR_REQ, MT_LENGTH(ZDO_NWK_ADDR_REQ_SREQ));
+    memcpy(MT_POINTER(ZDO_NWK_ADDR_REQ_SREQ_IEEE_ADDRESS), ieeeAddress, 8);
+    MT_PUT_U8(ZDO_NWK_ADDR_REQ_SREQ_REQUEST_TYPE, requestType);
+    MT_PUT_U8(ZDO_NWK_ADDR_REQ_SREQ_START_INDEX, startIndex);
+}
+
 
 #define METHOD_ZDO_NWK_ADDR_REQ                     0x34
 #define METHOD_ZDO_NWK_ADDR_RSP                     0x35
@@ -141,14 +184,7 @@ moduleResult_t zdoNetworkAddressRequest(uint8_t* ieeeAddress, uint8_t requestTyp
     printHexBytes(ieeeAddress, 8);
     printf("requestType %s, startIndex %u\r\n", (requestType == 0) ? "Single" : "Extended", startIndex);
 #endif
-#define ZDO_NWK_ADDR_REQ_PAYLOAD_LEN 10
-    zmBuf[0] = ZDO_NWK_ADDR_REQ_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZDO_NWK_ADDR_REQ);
-    zmBuf[2] = LSB(ZDO_NWK_ADDR_REQ);      
-    
-    memcpy(zmBuf+3, ieeeAddress, 8);
-    zmBuf[11] = requestType;
-    zmBuf[12] = startIndex;
+    zdoPackNetworkAddressRequest(ieeeAddress, requestType, startIndex);
     
 #ifdef ZDO_NWK_ADDR_RSP_HANDLED_BY_APPLICATION  //Main application will wait for ZDO_NWK_ADDR_RSP message.    
     RETURN_RESULT(sendMessage(), METHOD_ZDO_NWK_ADDR_REQ);
@@ -161,6 +197,29 @@ moduleResult_t zdoNetworkAddressRequest(uint8_t* ieeeAddress, uint8_t requestTyp
 #endif
 }
 
+#define METHOD_ZDO_NWK_ADDR_REQ_ASYNC               0x74
+/** Non-blocking version of zdoNetworkAddressRequest(): sends the ZDO_NWK_ADDR_REQ and returns once 
+the SRSP has been received. The callback is called when the ZDO_NWK_ADDR_RSP for this long address 
+is received, so lookups of many devices can be outstanding at once.
+@param callback called with the status of the ZDO_NWK_ADDR_RSP, or TIMEOUT. The response is in zmBuf.
+@param token is set to the token of the request
+@see zdoNetworkAddressRequest for description of the other fields.
+@see zm_pipeline.c for how to receive the ZDO_NWK_ADDR_RSP.
+@return MODULE_SUCCESS if the request was accepted by the Module, else an error. If an error is 
+returned then the callback won't be called.
+*/
+moduleResult_t zdoNetworkAddressRequestAsync(uint8_t* ieeeAddress, uint8_t requestType, uint8_t startIndex,
+                                             requestCallback_t callback, requestToken_t* token)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((ieeeAddress == 0), METHOD_ZDO_NWK_ADDR_REQ_ASYNC);
+    RETURN_INVALID_PARAMETER_IF_TRUE(((requestType != SINGLE_DEVICE_RESPONSE) && (requestType != INCLUDE_ASSOCIATED_DEVICES)), METHOD_ZDO_NWK_ADDR_REQ_ASYNC);
+    zdoPackNetworkAddressRequest(ieeeAddress, requestType, startIndex);
+    
+    RETURN_RESULT(pipelineSend(ZDO_NWK_ADDR_RSP, ZDO_NWK_ADDR_RSP_IEEE_ADDRESS_FIELD_START, ieeeAddress, 8,
+                               ZDO_NWK_ADDR_RSP_STATUS_FIELD, PIPELINE_DEFAULT_TIMEOUT_MS, 
+                               callback, token), METHOD_ZDO_NWK_ADDR_REQ_ASYNC);
+}
+
 
 /** Displays the returned value of ZdoUserDescriptorRequest()
 @param rsp points to the beginning of the response
@@ -349,6 +408,12 @@ void displayZdoNetworkDiscoveryResponse(uint8_t* rsp)
 }
 
 
+/** Layout of ZDO_USER_DESC_REQ and ZDO_NODE_DESC_REQ */
+#define ZDO_DESC_REQ_SREQ_FIELDS(L, F) \
+    F(L, DESTINATION_ADDRESS, MT_U16) \
+    F(L, NWK_ADDRESS_OF_INTEREST, MT_U16)
+MT_LAYOUT(ZDO_DESC_REQ_SREQ);
+
 #define METHOD_ZDO_USER_DESC_REQ                    0x36
 #define METHOD_ZDO_USER_DESC_RSP                    0x37
 /** Requests a remote device's user descriptor. This is a 16 byte text field that may be used for
@@ -363,20 +428,13 @@ moduleResult_t zdoUserDescriptorRequest(uint16_t destinationAddress, uint16_t ne
     printf("Requesting User Descriptor for destination %04X, NWK address %04X\r\n", destinationAddress, networkAddressOfInterest);
 #endif 
     
-#define ZDO_USER_DESC_REQ_PAYLOAD_LEN 4
-    zmBuf[0] = ZDO_USER_DESC_REQ_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZDO_USER_DESC_REQ);             
-    zmBuf[2] = LSB(ZDO_USER_DESC_REQ);      
-    
-    zmBuf[3] = LSB(destinationAddress);
-    zmBuf[4] = MSB(destinationAddress);
-    zmBuf[5] = LSB(networkAddressOfInterest);
-    zmBuf[6] = MSB(networkAddressOfInterest);
+    MT_PUT_U16(ZDO_DESC_REQ_SREQ_DESTINATION_ADDRESS, destinationAddress);
+    MT_PUT_U16(ZDO_DESC_REQ_SREQ_NWK_ADDRESS_OF_INTEREST, networkAddressOfInterest);
     
 #ifdef ZDO_USER_DESC_RSP_HANDLED_BY_APPLICATION           //Return control to main application
-    RETURN_RESULT(sendMessage(), METHOD_ZDO_USER_DESC_REQ);
+    RETURN_RESULT(mtSend(ZDO_USER_DESC_REQ, MT_LENGTH(ZDO_DESC_REQ_SREQ)), METHOD_ZDO_USER_DESC_REQ);
 #else
-    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_ZDO_USER_DESC_REQ);     
+    RETURN_RESULT_IF_FAIL(mtSend(ZDO_USER_DESC_REQ, MT_LENGTH(ZDO_DESC_REQ_SREQ)), METHOD_ZDO_USER_DESC_REQ);     
     
     // Now wait for the response...
 #define ZDO_USER_DESC_RSP_TIMEOUT 10
@@ -399,20 +457,13 @@ moduleResult_t zdoNodeDescriptorRequest(uint16_t destinationAddress, uint16_t ne
     printf("Requesting Node Descriptor for destination %04X, NWK address %04X\r\n", destinationAddress, networkAddressOfInterest);
 #endif 
     
-#define ZDO_NODE_DESC_REQ_PAYLOAD_LEN 4
-    zmBuf[0] = ZDO_USER_DESC_REQ_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZDO_NODE_DESC_REQ);             
-    zmBuf[2] = LSB(ZDO_NODE_DESC_REQ);      
-    
-    zmBuf[3] = LSB(destinationAddress);
-    zmBuf[4] = MSB(destinationAddress);
-    zmBuf[5] = LSB(networkAddressOfInterest);
-    zmBuf[6] = MSB(networkAddressOfInterest);
+    MT_PUT_U16(ZDO_DESC_REQ_SREQ_DESTINATION_ADDRESS, destinationAddress);
+    MT_PUT_U16(ZDO_DESC_REQ_SREQ_NWK_ADDRESS_OF_INTEREST, networkAddressOfInterest);
     
 #ifdef ZDO_NODE_DESC_RSP_HANDLED_BY_APPLICATION           //Return control to main application
-    RETURN_RESULT(sendMessage(), METHOD_ZDO_NODE_DESC_REQ);
+    RETURN_RESULT(mtSend(ZDO_NODE_DESC_REQ, MT_LENGTH(ZDO_DESC_REQ_SREQ)), METHOD_ZDO_NODE_DESC_REQ);
 #else
-    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_ZDO_NODE_DESC_REQ);     
+    RETURN_RESULT_IF_FAIL(mtSend(ZDO_NODE_DESC_REQ, MT_LENGTH(ZDO_DESC_REQ_SREQ)), METHOD_ZDO_NODE_DESC_REQ);     
     
     // Now wait for the response...
 #define ZDO_NODE_DESC_RSP_TIMEOUT 10
@@ -422,6 +473,13 @@ moduleResult_t zdoNodeDescriptorRequest(uint16_t destinationAddress, uint16_t ne
 }
 
 
+#define ZDO_USER_DESC_SET_SREQ_FIELDS(L, F) \
+    F(L, DESTINATION_ADDRESS, MT_U16) \
+    F(L, NWK_ADDRESS_OF_INTEREST, MT_U16) \
+    F(L, LENGTH, MT_U8) \
+    F(L, USER_DESCRIPTOR, MT_VARIABLE)
+MT_LAYOUT(ZDO_USER_DESC_SET_SREQ);
+
 #define METHOD_ZDO_USER_DESC_SET                    0x3A
 /** Sets a remote device's user descriptor. 
 @param destinationAddress the short address of the destination
@@ -435,17 +493,11 @@ moduleResult_t zdoUserDescriptorSet(uint16_t destinationAddress, uint16_t networ
            destinationAddress, networkAddressOfInterest, userDescriptorLength);
 #endif 
     
-#define ZDO_USER_DESC_SET_PAYLOAD_LEN_HEADER   5
-    zmBuf[0] = ZDO_USER_DESC_SET_PAYLOAD_LEN_HEADER + userDescriptorLength;
-    zmBuf[1] = MSB(ZDO_USER_DESC_SET);             
-    zmBuf[2] = LSB(ZDO_USER_DESC_SET);      
-    
-    zmBuf[3] = LSB(destinationAddress);
-    zmBuf[4] = MSB(destinationAddress);
-    zmBuf[5] = LSB(networkAddressOfInterest);
-    zmBuf[6] = MSB(networkAddressOfInterest);
-    zmBuf[7] = userDescriptorLength;
-    memcpy(zmBuf+8, userDescriptor, userDescriptorLength);
+    mtPack(zmBuf, ZDO_USER_DESC_SET, MT_LENGTH(ZDO_USER_DESC_SET_SREQ) + userDescriptorLength);
+    MT_PUT_U16(ZDO_USER_DESC_SET_SREQ_DESTINATION_ADDRESS, destinationAddress);
+    MT_PUT_U16(ZDO_USER_DESC_SET_SREQ_NWK_ADDRESS_OF_INTEREST, networkAddressOfInterest);
+    MT_PUT_U8(ZDO_USER_DESC_SET_SREQ_LENGTH, userDescriptorLength);
+    memcpy(MT_POINTER(ZDO_USER_DESC_SET_SREQ_USER_DESCRIPTOR), userDescriptor, userDescriptorLength);
     
     displayZmBuf();
 
@@ -453,6 +505,12 @@ moduleResult_t zdoUserDescriptorSet(uint16_t destinationAddress, uint16_t networ
 }
 
 
+#define ZDO_MGMT_PERMIT_JOIN_REQ_SREQ_FIELDS(L, F) \
+    F(L, DESTINATION_ADDRESS, MT_U16) \
+    F(L, DURATION, MT_U8) \
+    F(L, TC_SIGNIFICANCE, MT_U8)
+MT_LAYOUT(ZDO_MGMT_PERMIT_JOIN_REQ_SREQ);
+
 #define METHOD_ZDO_MGMT_PERMIT_JOIN_REQ 0x3B
 #define METHOD_ZDO_MGMT_PERMIT_JOIN_RSP 0x3C
 /** Set joining permission on or off for the destination device as specified by short address. If
@@ -480,20 +538,14 @@ moduleResult_t zdoManagementPermitJoinRequest(uint16_t destinationAddress, uint8
         printf("ON for %uS\r\n", duration);
 #endif 
     
-#define ZDO_MGMT_PERMIT_JOIN_REQ_PAYLOAD_LEN 3
-    zmBuf[0] = ZDO_MGMT_PERMIT_JOIN_REQ_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZDO_MGMT_PERMIT_JOIN_REQ);             
-    zmBuf[2] = LSB(ZDO_MGMT_PERMIT_JOIN_REQ);      
-    
-    zmBuf[3] = LSB(destinationAddress);
-    zmBuf[4] = MSB(destinationAddress);
-    zmBuf[5] = duration;
-    zmBuf[6] = tcSignificance;
+    MT_PUT_U16(ZDO_MGMT_PERMIT_JOIN_REQ_SREQ_DESTINATION_ADDRESS, destinationAddress);
+    MT_PUT_U8(ZDO_MGMT_PERMIT_JOIN_REQ_SREQ_DURATION, duration);
+    MT_PUT_U8(ZDO_MGMT_PERMIT_JOIN_REQ_SREQ_TC_SIGNIFICANCE, tcSignificance);
     
 #ifdef ZDO_MGMT_PERMIT_JOIN_RSP_HANDLED_BY_APPLICATION           //Return control to main application
-    RETURN_RESULT(sendMessage(), METHOD_ZDO_MGMT_PERMIT_JOIN_REQ);
+    RETURN_RESULT(mtSend(ZDO_MGMT_PERMIT_JOIN_REQ, MT_LENGTH(ZDO_MGMT_PERMIT_JOIN_REQ_SREQ)), METHOD_ZDO_MGMT_PERMIT_JOIN_REQ);
 #else
-    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_ZDO_MGMT_PERMIT_JOIN_REQ);     
+    RETURN_RESULT_IF_FAIL(mtSend(ZDO_MGMT_PERMIT_JOIN_REQ, MT_LENGTH(ZDO_MGMT_PERMIT_JOIN_REQ_SREQ)), METHOD_ZDO_MGMT_PERMIT_JOIN_REQ);     
     
     // Now wait for the response...
 #define ZDO_MGMT_PERMIT_JOIN_RSP_TIMEOUT 10
@@ -504,6 +556,11 @@ moduleResult_t zdoManagementPermitJoinRequest(uint16_t destinationAddress, uint8
 }
 
 
+#define ZDO_NWK_DISCOVERY_REQ_SREQ_FIELDS(L, F) \
+    F(L, SCAN_CHANNELS, MT_U32) \
+    F(L, SCAN_DURATION, MT_U8)
+MT_LAYOUT(ZDO_NWK_DISCOVERY_REQ_SREQ);
+
 #define METHOD_ZDO_NWK_DISCOVERY_REQ                     0x3D
 /** Performs an active network scan by sending out beacons. The device must NOT be on a network. If
 it is then an error will be returned.
@@ -528,25 +585,25 @@ moduleResult_t zdoNetworkDiscoveryRequest(uint32_t channelMask, uint8_t scanDura
 {
     RETURN_INVALID_PARAMETER_IF_TRUE( ((channelMask < MIN_CHANNEL_MASK) || (channelMask > MAX_CHANNEL_MASK)), METHOD_ZDO_NWK_DISCOVERY_REQ);
 
-#define ZDO_NWK_DISCOVERY_REQ_PAYLOAD_LEN 5
-    zmBuf[0] = ZDO_NWK_DISCOVERY_REQ_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZDO_NWK_DISCOVERY_REQ);
-    zmBuf[2] = LSB(ZDO_NWK_DISCOVERY_REQ);  
-    
-    zmBuf[3] = LSB(channelMask);
-    zmBuf[4] = (channelMask & 0xFF00) >> 8;
-    zmBuf[5] = (channelMask & 0xFF0000) >> 16;
-    zmBuf[6] = channelMask >> 24;    
-    zmBuf[7] = scanDuration;
+    MT_PUT_U32(ZDO_NWK_DISCOVERY_REQ_SREQ_SCAN_CHANNELS, channelMask);
+    MT_PUT_U8(ZDO_NWK_DISCOVERY_REQ_SREQ_SCAN_DURATION, scanDuration);
 
 #ifdef MODULE_INTERFACE_VERBOSE 
-    printf("Scanning for Networks with duration %02X and Channel List (LSB first): %02X %02X %02X %02X\r\n", scanDuration, zmBuf[3], zmBuf[4], zmBuf[5], zmBuf[6]);
+    printf("Scanning for Networks with duration %02X and Channel List (LSB first): ", scanDuration);
+    printHexBytes(MT_POINTER(ZDO_NWK_DISCOVERY_REQ_SREQ_SCAN_CHANNELS), MT_U32);
 #endif   
     
-    RETURN_RESULT(sendMessage(), METHOD_ZDO_NWK_DISCOVERY_REQ);
+    RETURN_RESULT(mtSend(ZDO_NWK_DISCOVERY_REQ, MT_LENGTH(ZDO_NWK_DISCOVERY_REQ_SREQ)), METHOD_ZDO_NWK_DISCOVERY_REQ);
 }
 
 
+#define ZDO_MGMT_NWK_DISCOVERY_REQ_SREQ_FIELDS(L, F) \
+    F(L, DESTINATION_ADDRESS, MT_U16) \
+    F(L, SCAN_CHANNELS, MT_U32) \
+    F(L, SCAN_DURATION, MT_U8) \
+    F(L, START_INDEX, MT_U8)
+MT_LAYOUT(ZDO_MGMT_NWK_DISCOVERY_REQ_SREQ);
+
 #define METHOD_ZDO_MGMT_NWK_DISCOVERY_REQ                     0x71
 /** Request that the destination device performs an active network scan by sending out beacons.
 Unlike zdoNetworkDiscoveryRequest, this function MAY be used while the device is ON the network.
@@ -572,30 +629,30 @@ moduleResult_t zdoManagementNetworkDiscoveryRequest(uint16_t destinationAddress,
 {
     RETURN_INVALID_PARAMETER_IF_TRUE( ((channelMask < MIN_CHANNEL_MASK) || (channelMask > MAX_CHANNEL_MASK)), METHOD_ZDO_MGMT_NWK_DISCOVERY_REQ);
 
-#define ZDO_MGMT_NWK_DISCOVERY_REQ_PAYLOAD_LEN 8
-    zmBuf[0] = ZDO_MGMT_NWK_DISCOVERY_REQ_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZDO_MGMT_NWK_DISCOVERY_REQ);
-    zmBuf[2] = LSB(ZDO_MGMT_NWK_DISCOVERY_REQ);
-
-    zmBuf[3] = LSB(destinationAddress);
-    zmBuf[4] = MSB(destinationAddress);
-    zmBuf[5] = LSB(channelMask);
-    zmBuf[6] = (channelMask & 0xFF00) >> 8;
-    zmBuf[7] = (channelMask & 0xFF0000) >> 16;
-    zmBuf[8] = channelMask >> 24;
-    zmBuf[9] = scanDuration;
-    zmBuf[10] = startIndex;
+    MT_PUT_U16(ZDO_MGMT_NWK_DISCOVERY_REQ_SREQ_DESTINATION_ADDRESS, destinationAddress);
+    MT_PUT_U32(ZDO_MGMT_NWK_DISCOVERY_REQ_SREQ_SCAN_CHANNELS, channelMask);
+    MT_PUT_U8(ZDO_MGMT_NWK_DISCOVERY_REQ_SREQ_SCAN_DURATION, scanDuration);
+    MT_PUT_U8(ZDO_MGMT_NWK_DISCOVERY_REQ_SREQ_START_INDEX, startIndex);
 
 #ifdef MODULE_INTERFACE_VERBOSE
     printf("Scanning for Networks with Dest:%04X Duration:%02X #%u ChanList:", destinationAddress, scanDuration, startIndex);
-    displayReverseHexBytes(zmBuf+5, 4, DISPLAY_HEX_BYTES_NO_SEPARATOR);
+    displayReverseHexBytes(MT_POINTER(ZDO_MGMT_NWK_DISCOVERY_REQ_SREQ_SCAN_CHANNELS), MT_U32, DISPLAY_HEX_BYTES_NO_SEPARATOR);
     printf("\r\n");
 #endif
 
-    RETURN_RESULT(sendMessage(), METHOD_ZDO_MGMT_NWK_DISCOVERY_REQ);
+    RETURN_RESULT(mtSend(ZDO_MGMT_NWK_DISCOVERY_REQ, MT_LENGTH(ZDO_MGMT_NWK_DISCOVERY_REQ_SREQ)), METHOD_ZDO_MGMT_NWK_DISCOVERY_REQ);
 }
 
 
+#define ZDO_JOIN_REQ_SREQ_FIELDS(L, F) \
+    F(L, CHANNEL, MT_U8) \
+    F(L, PAN_ID, MT_U16) \
+    F(L, EXTENDED_PAN_ID, MT_BYTES(8)) \
+    F(L, CHOSEN_PARENT, MT_U16) \
+    F(L, PARENT_DEPTH, MT_U8) \
+    F(L, STACK_PROFILE, MT_U8)
+MT_LAYOUT(ZDO_JOIN_REQ_SREQ);
+
 #define METHOD_ZDO_JOIN_REQ									0x72
 /** Join a specific network, selected by its RF channel and panId.
 This is an advanced feature and should not normally be needed. Use with caution.
@@ -611,20 +668,13 @@ moduleResult_t zdoJoinRequest(uint8_t channel, uint16_t panId, uint16_t parent,
     RETURN_INVALID_PARAMETER_IF_TRUE((!(IS_VALID_CHANNEL(channel))), METHOD_ZDO_JOIN_REQ);
     RETURN_INVALID_PARAMETER_IF_TRUE((!(IS_VALID_PANID(panId))), METHOD_ZDO_JOIN_REQ);
 
-#define ZDO_JOIN_REQ_PAYLOAD_LEN 0x0F
-    zmBuf[0] = ZDO_JOIN_REQ_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZDO_JOIN_REQ);
-    zmBuf[2] = LSB(ZDO_JOIN_REQ);
-
-    zmBuf[3] = channel;
-    zmBuf[4] = LSB(panId);
-    zmBuf[5] = MSB(panId);
-    /* zmBuf[6] ... zmBuf[13] should be all 0xFF since the version of Z-Stack we use is > version 1.1 */
-    memset(zmBuf+6, 0xFF, 8);
-    zmBuf[14] = LSB(parent);
-    zmBuf[15] = MSB(parent);
-    zmBuf[16] = depth;
-    zmBuf[17] = ZIGBEE_2007_PRO_STACK_PROFILE;
+    MT_PUT_U8(ZDO_JOIN_REQ_SREQ_CHANNEL, channel);
+    MT_PUT_U16(ZDO_JOIN_REQ_SREQ_PAN_ID, panId);
+    /* The extended PAN ID should be all 0xFF since the version of Z-Stack we use is > version 1.1 */
+    memset(MT_POINTER(ZDO_JOIN_REQ_SREQ_EXTENDED_PAN_ID), 0xFF, 8);
+    MT_PUT_U16(ZDO_JOIN_REQ_SREQ_CHOSEN_PARENT, parent);
+    MT_PUT_U8(ZDO_JOIN_REQ_SREQ_PARENT_DEPTH, depth);
+    MT_PUT_U8(ZDO_JOIN_REQ_SREQ_STACK_PROFILE, ZIGBEE_2007_PRO_STACK_PROFILE);
 
 #ifdef MODULE_INTERFACE_VERBOSE
     printf("Request Join on Channel=%u panID:%04X parent:%04X depth:%02X\r\n", channel, panId, parent, depth);
@@ -634,7 +684,7 @@ moduleResult_t zdoJoinRequest(uint8_t channel, uint16_t panId, uint16_t parent,
      asynchronous message - it does not return a SRSP. If we did wrap with RETURN_RESULT then we'll
      have an error. So, we perform the error suppression below - if we get an ZM_PHY_INCORRECT_SRSP
       then ignore it */
-    moduleResult_t err = sendMessage();
+    moduleResult_t err = mtSend(ZDO_JOIN_REQ, MT_LENGTH(ZDO_JOIN_REQ_SREQ));
     if ((err == ZM_PHY_INCORRECT_SRSP) || (err == MODULE_SUCCESS)) // Ignore ZM_PHY_INCORRECT_SRSP
     {
     	return MODULE_SUCCESS;
@@ -644,6 +694,12 @@ moduleResult_t zdoJoinRequest(uint8_t channel, uint16_t panId, uint16_t parent,
 }
 
 
+#define ZDO_MGMT_LEAVE_REQ_SREQ_FIELDS(L, F) \
+    F(L, DESTINATION_ADDRESS, MT_U16) \
+    F(L, DEVICE_ADDRESS, MT_BYTES(8)) \
+    F(L, REMOVE_CHILDREN_REJOIN, MT_U8)
+MT_LAYOUT(ZDO_MGMT_LEAVE_REQ_SREQ);
+
 #define METHOD_ZDO_MGMT_LEAVE_REQ                     0x3F
 #define METHOD_ZDO_MGMT_LEAVE_RSP                     0x70
 /** Requests a device to leave the network.
@@ -657,24 +713,15 @@ moduleResult_t zdoManagementLeaveRequest(uint8_t* ieeeAddress, uint16_t destinat
     printHexBytes(ieeeAddress, 8);
     printf(" and destinationAddress 0x%04X\r\n", destinationAddress);
 #endif
-#define ZDO_MGMT_LEAVE_REQ_PAYLOAD_LEN 0x0B
-    zmBuf[0] = ZDO_MGMT_LEAVE_REQ_PAYLOAD_LEN;
-    zmBuf[1] = MSB(ZDO_MGMT_LEAVE_REQ);
-    zmBuf[2] = LSB(ZDO_MGMT_LEAVE_REQ);
-
-    zmBuf[3] = MSB(destinationAddress);
-    zmBuf[4] = LSB(destinationAddress);
-
-    memcpy(zmBuf+5, ieeeAddress, 8);
+    MT_PUT_U16(ZDO_MGMT_LEAVE_REQ_SREQ_DESTINATION_ADDRESS, destinationAddress);
+    memcpy(MT_POINTER(ZDO_MGMT_LEAVE_REQ_SREQ_DEVICE_ADDRESS), ieeeAddress, 8);
 #define NO_REMOVE_CHILDREN_REJOIN  0   // Must be set to 0; see spec
-    zmBuf[13] = NO_REMOVE_CHILDREN_REJOIN;
-
-    //RETURN_RESULT(sendMessage(), METHOD_ZDO_MGMT_LEAVE_REQ);
+    MT_PUT_U8(ZDO_MGMT_LEAVE_REQ_SREQ_REMOVE_CHILDREN_REJOIN, NO_REMOVE_CHILDREN_REJOIN);
 
 #ifdef ZDO_MGMT_LEAVE_RSP_HANDLED_BY_APPLICATION           //Return control to main application
-    RETURN_RESULT(sendMessage(), METHOD_ZDO_MGMT_LEAVE_REQ);
+    RETURN_RESULT(mtSend(ZDO_MGMT_LEAVE_REQ, MT_LENGTH(ZDO_MGMT_LEAVE_REQ_SREQ)), METHOD_ZDO_MGMT_LEAVE_REQ);
 #else
-    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_ZDO_MGMT_LEAVE_REQ);
+    RETURN_RESULT_IF_FAIL(mtSend(ZDO_MGMT_LEAVE_REQ, MT_LENGTH(ZDO_MGMT_LEAVE_REQ_SREQ)), METHOD_ZDO_MGMT_LEAVE_REQ);
 printf(":) ");
     // Now wait for the response...
 #define ZDO_MGMT_LEAVE_RSP_TIMEOUT 10
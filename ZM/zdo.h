@@ -36,10 +36,15 @@
 
 #include "application_configuration.h"
 #include "module_errors.h"
+#include "zm_pipeline.h"
 
 moduleResult_t zdoStartApplication();
 moduleResult_t zdoRequestIeeeAddress(uint16_t shortAddress, uint8_t requestType, uint8_t startIndex);
 moduleResult_t zdoNetworkAddressRequest(uint8_t* ieeeAddress, uint8_t requestType, uint8_t startIndex);
+moduleResult_t zdoRequestIeeeAddressAsync(uint16_t shortAddress, uint8_t requestType, uint8_t startIndex,
+                                          requestCallback_t callback, requestToken_t* token);
+moduleResult_t zdoNetworkAddressRequestAsync(uint8_t* ieeeAddress, uint8_t requestType, uint8_t startIndex,
+                                             requestCallback_t callback, requestToken_t* token);
 void displayZdoAddressResponse(uint8_t* rsp);
 void displayZdoEndDeviceAnnounce(uint8_t* announce);
 moduleResult_t zdoUserDescriptorRequest(uint16_t destinationAddress, uint16_t networkAddressOfInterest);
@@ -119,6 +124,9 @@ void displayZdoStateChangeInd(uint8_t* rsp);
 #define ZDO_IEEE_ADDR_RSP_NUMBER_OF_ASSOCIATED_DEVICES_FIELD    12
 #define ZDO_IEEE_ADDR_RSP_ASSOCIATED_DEVICE_FIELD_START         13
 
+// For ZDO_NWK_ADDR_RSP, offset in zmBuf
+#define ZDO_NWK_ADDR_RSP_IEEE_ADDRESS_FIELD_START               (SRSP_PAYLOAD_START+1)
+
 // For MGMT_PERMIT_JOIN duration parameter
 #define PERMIT_JOIN_OFF                 0x00
 #define PERMIT_JOIN_ON_INDEFINITELY     0xFF
@@ -0,0 +1,204 @@
+/**
+* @file zm_compress.c
+*
+* @brief LZ-style compression of message payloads, to send fewer bytes over the air.
+*
+* Application messages repeat themselves: the same header, MAC address prefix and OIDs in every 
+* message. A payload is coded as a series of tokens, each starting with a control byte:
+* - 0x00 .. 0x7F: control + 1 literal bytes follow, 1 .. COMPRESS_MAX_LITERALS
+* - 0x80 .. 0xFF: a match of ((control >> 3) & 0x0F) + COMPRESS_MIN_MATCH bytes; the offset back to 
+* where they were seen before is ((control & 0x07) << 8) + the next byte + 1, up to COMPRESS_MAX_OFFSET.
+*
+* A match can refer to the earlier part of the same payload, or to a static dictionary that both 
+* sides have and that is treated as coming just before the payload. So even a short payload, which 
+* doesn't repeat itself, compresses if it looks like the dictionary, e.g. a template of the message 
+* header set with compressSetDictionary(). Both sides must use the same dictionary.
+*
+* Neither side uses any RAM apart from a few local variables: the compressor searches the data and 
+* the dictionary directly, and the decompressor copies matches from its own output. The time that the
+* compressor takes is bounded by COMPRESS_SEARCH_WINDOW.
+*
+* @see afSetCompression() to compress AF messages transparently.
+*
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "zm_compress.h"
+#include <stddef.h>                     //for NULL
+#include <stdint.h>
+
+/** Used when the application doesn't set a dictionary: runs of 0x00 and 0xFF, the OUI of the 
+Module MAC addresses (00124B, LSB first), and EMPTY_PARAMETER of the example messages */
+static const uint8_t defaultDictionary[] = 
+{
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4B, 0x12, 0x00, 
+    0xFC, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+static const uint8_t* dictionary = defaultDictionary;
+static uint16_t dictionaryLength = sizeof(defaultDictionary);
+
+#define METHOD_COMPRESS_SET_DICTIONARY              0xB100
+/** Sets the dictionary that compressData() and decompressData() refer to. Use bytes that most 
+messages have, e.g. a serialized header with this device's MAC address, most frequent first since 
+the compressor only looks COMPRESS_SEARCH_WINDOW bytes back.
+@param newDictionary the dictionary, or NULL for the default one. Must stay valid while in use.
+@param length length of the dictionary, at most COMPRESS_MAX_OFFSET
+@note the sender and the receiver must use the same dictionary, else the payload is garbled.
+*/
+moduleResult_t compressSetDictionary(const uint8_t* newDictionary, uint16_t length)
+{
+    RETURN_INVALID_LENGTH_IF_TRUE( (length > COMPRESS_MAX_OFFSET), METHOD_COMPRESS_SET_DICTIONARY);
+    if (newDictionary == NULL)
+    {
+        dictionary = defaultDictionary;
+        dictionaryLength = sizeof(defaultDictionary);
+    } else {
+        dictionary = newDictionary;
+        dictionaryLength = length;
+    }
+    return MODULE_SUCCESS;
+}
+
+/** Returns a byte of the dictionary followed by the data */
+static uint8_t historyByte(const uint8_t* data, uint16_t index)
+{
+    return (index < dictionaryLength) ? dictionary[index] : data[index - dictionaryLength];
+}
+
+#define METHOD_COMPRESS_DATA                        0xB200
+/** Compresses data, see the format in the file comment.
+@param data the data to compress
+@param length length of the data
+@param destination where to write the compressed data
+@param maxLength size of destination. COMPRESS_WORST_CASE_LENGTH(length) is always enough.
+@param compressedLength is set to the length of the compressed data
+@return MODULE_SUCCESS, or INVALID_LENGTH if the compressed data doesn't fit in maxLength bytes; 
+then send the data uncompressed.
+*/
+moduleResult_t compressData(const uint8_t* data, uint16_t length, 
+                            uint8_t* destination, uint16_t maxLength, uint16_t* compressedLength)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE( ((data == NULL) || (destination == NULL) || (compressedLength == NULL)), METHOD_COMPRESS_DATA);
+    uint16_t out = 0;
+    uint16_t position = 0;
+    uint16_t literalStart = 0;
+    uint8_t literals = 0;
+    while (position <= length)
+    {
+        uint8_t bestLength = 0;
+        uint16_t bestOffset = 0;
+        uint16_t here = dictionaryLength + position;
+        uint16_t start = (here > COMPRESS_SEARCH_WINDOW) ? (here - COMPRESS_SEARCH_WINDOW) : 0;
+        uint16_t candidate;
+        for (candidate = here; (position < length) && (candidate-- > start); )
+        {
+            uint8_t matchLength = 0;
+            while ((matchLength < COMPRESS_MAX_MATCH) && ((position + matchLength) < length) && 
+                   (historyByte(data, candidate + matchLength) == data[position + matchLength]))
+                matchLength++;
+            if (matchLength > bestLength)
+            {
+                bestLength = matchLength;
+                bestOffset = here - candidate;
+                if (bestLength == COMPRESS_MAX_MATCH)
+                    break;
+            }
+        }
+        
+        /* Write out the pending literals before a match, when there are as many as a token holds, 
+        and at the end */
+        if ((literals > 0) && ((bestLength >= COMPRESS_MIN_MATCH) || (literals == COMPRESS_MAX_LITERALS) || (position == length)))
+        {
+            RETURN_INVALID_LENGTH_IF_TRUE( ((out + 1 + literals) > maxLength), METHOD_COMPRESS_DATA);
+            destination[out++] = literals - 1;
+            while (literals > 0)
+            {
+                destination[out++] = data[literalStart++];
+                literals--;
+            }
+        }
+        if (position == length)
+            break;
+        
+        if (bestLength >= COMPRESS_MIN_MATCH)
+        {
+            RETURN_INVALID_LENGTH_IF_TRUE( ((out + 2) > maxLength), METHOD_COMPRESS_DATA);
+            bestOffset--;
+            destination[out++] = 0x80 | ((bestLength - COMPRESS_MIN_MATCH) << 3) | (bestOffset >> 8);
+            destination[out++] = bestOffset & 0xFF;
+            position += bestLength;
+        } else {
+            if (literals == 0)
+                literalStart = position;
+            literals++;
+            position++;
+        }
+    }
+    *compressedLength = out;
+    return MODULE_SUCCESS;
+}
+
+#define METHOD_DECOMPRESS_DATA                      0xB300
+/** Decompresses data that was compressed with compressData().
+@param data the compressed data
+@param length length of the compressed data
+@param destination where to write the original data
+@param maxLength size of destination
+@param decompressedLength is set to the length of the original data
+@return MODULE_SUCCESS, INVALID_LENGTH if the original data doesn't fit in maxLength bytes or a 
+token is cut off, or INVALID_PARAMETER if a match refers to before the start of the dictionary.
+*/
+moduleResult_t decompressData(const uint8_t* data, uint16_t length, 
+                              uint8_t* destination, uint16_t maxLength, uint16_t* decompressedLength)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE( ((data == NULL) || (destination == NULL) || (decompressedLength == NULL)), METHOD_DECOMPRESS_DATA);
+    uint16_t in = 0;
+    uint16_t out = 0;
+    while (in < length)
+    {
+        uint8_t control = data[in++];
+        if (control < 0x80)
+        {
+            uint8_t count = control + 1;
+            RETURN_INVALID_LENGTH_IF_TRUE( (((in + count) > length) || ((out + count) > maxLength)), METHOD_DECOMPRESS_DATA);
+            while (count-- > 0)
+                destination[out++] = data[in++];
+        } else {
+            RETURN_INVALID_LENGTH_IF_TRUE( (in >= length), METHOD_DECOMPRESS_DATA);
+            uint8_t count = ((control >> 3) & 0x0F) + COMPRESS_MIN_MATCH;
+            uint16_t offset = (((uint16_t) (control & 0x07) << 8) | data[in++]) + 1;
+            RETURN_INVALID_LENGTH_IF_TRUE( ((out + count) > maxLength), METHOD_DECOMPRESS_DATA);
+            RETURN_INVALID_PARAMETER_IF_TRUE( (offset > (dictionaryLength + out)), METHOD_DECOMPRESS_DATA);
+            uint16_t from = dictionaryLength + out - offset;
+            while (count-- > 0)                     //byte by byte, since a match may overlap its copy
+            {
+                destination[out++] = historyByte(destination, from++);
+            }
+        }
+    }
+    *decompressedLength = out;
+    return MODULE_SUCCESS;
+}
@@ -0,0 +1,65 @@
+/**
+* @file zm_compress.h
+*
+* @brief public methods for zm_compress.c
+*
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef ZM_COMPRESS_H
+#define ZM_COMPRESS_H
+#include <stdint.h>
+#include "module_errors.h"
+
+/** Shortest repeat that is coded as a match instead of literals; a match takes two bytes */
+#define COMPRESS_MIN_MATCH              3
+#define COMPRESS_MAX_MATCH              (COMPRESS_MIN_MATCH + 15)
+#define COMPRESS_MAX_OFFSET             2048
+#define COMPRESS_MAX_LITERALS           128
+
+/** How far back the compressor looks for a repeat. Longer finds more repeats but takes longer, 
+since the search uses no RAM to index the data: each byte is compared with up to this many earlier 
+ones. The decompressor handles any offset. */
+#ifndef COMPRESS_SEARCH_WINDOW
+#if defined LAUNCHPAD || defined MSP_EXP430F5529LP     // MSP430 is slow, keep compressing a payload short
+#define COMPRESS_SEARCH_WINDOW          32
+#else
+#define COMPRESS_SEARCH_WINDOW          256
+#endif
+#endif
+#if (COMPRESS_SEARCH_WINDOW < 1) || (COMPRESS_SEARCH_WINDOW > COMPRESS_MAX_OFFSET)
+#error "COMPRESS_SEARCH_WINDOW must be 1 .. COMPRESS_MAX_OFFSET"
+#endif
+
+/** Longest output of compressData() for length bytes of data, if nothing repeats */
+#define COMPRESS_WORST_CASE_LENGTH(length)  ((length) + (((length) + COMPRESS_MAX_LITERALS - 1) / COMPRESS_MAX_LITERALS))
+
+moduleResult_t compressSetDictionary(const uint8_t* newDictionary, uint16_t length);
+moduleResult_t compressData(const uint8_t* data, uint16_t length, 
+                            uint8_t* destination, uint16_t maxLength, uint16_t* compressedLength);
+moduleResult_t decompressData(const uint8_t* data, uint16_t length, 
+                              uint8_t* destination, uint16_t maxLength, uint16_t* decompressedLength);
+
+#endif
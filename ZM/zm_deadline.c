@@ -0,0 +1,105 @@
+/**
+* @file zm_deadline.c
+*
+* @brief Deadlines for the blocking waits of the library, so that a timeout is the same length of 
+* time on every processor and clock configuration.
+*
+* Timeouts used to be counted in loop iterations, e.g. (TICKS_PER_MS * 125) passes through a loop 
+* that is much slower than one tick per pass, or in polling intervals that don't include the time
+* spent processing. Instead, start a deadline and check it in the loop:
+* <pre>
+*   struct deadline d;
+*   deadlineStart(&d, 5000);
+*   while (SRDY_IS_HIGH())
+*       if (deadlineExpired(&d))
+*           return ZM_PHY_CHIP_SELECT_TIMEOUT;
+* </pre>
+* If the hal file has a free-running timer, HAL_TIMER_TICKS(), then time is measured with it, with 
+* microsecond resolution. The timer may wrap around more often than the deadline is long, so the 
+* elapsed time is brought up to date on every deadlineExpired(), which must be called at least once
+* per wrap of the timer (171 seconds on a Stellaris at 25MHz). Deadlines up to 71 minutes are 
+* supported.
+*
+* Otherwise, e.g. on a new hal file that has no timer to spare yet, deadlineExpired() waits 
+* DEADLINE_POLL_US with HAL_DELAY_US() and adds that to the elapsed time. The time taken by the
+* loop itself is not counted, so the timeout is somewhat longer than requested, but is never missed.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "zm_deadline.h"
+#include <stdint.h>
+
+#if !defined HAL_TIMER_TICKS && !defined HAL_DELAY_US
+#error "The hal file must define HAL_TIMER_TICKS() or HAL_DELAY_US() for deadlines"
+#endif
+
+/** 
+Starts a deadline.
+@param d the deadline
+@param us how long until it expires, in microseconds
+*/
+void deadlineStart(struct deadline* d, uint32_t us)
+{
+    d->durationUs = us;
+    d->elapsedUs = 0;
+#ifdef HAL_TIMER_TICKS
+    d->lastTicks = HAL_TIMER_TICKS();
+#endif
+}
+
+/** 
+Whether the deadline has expired. Call in the wait loop.
+@param d the deadline, started with deadlineStart()
+@return true (1) if at least the requested time has passed since deadlineStart(), else 0.
+*/
+uint8_t deadlineExpired(struct deadline* d)
+{
+#ifdef HAL_TIMER_TICKS
+    uint32_t elapsedTicks = HAL_TIMER_TICKS() - d->lastTicks;
+    if (elapsedTicks >= HAL_TIMER_TICKS_PER_US)
+    {
+        uint32_t us = elapsedTicks / HAL_TIMER_TICKS_PER_US;
+        d->elapsedUs += us;
+        d->lastTicks += us * HAL_TIMER_TICKS_PER_US;    //keep the remainder for next time
+    }
+#else
+    if (d->elapsedUs < d->durationUs)
+    {
+        HAL_DELAY_US(DEADLINE_POLL_US);
+        d->elapsedUs += DEADLINE_POLL_US;
+    }
+#endif
+    return (d->elapsedUs >= d->durationUs);
+}
+
+/** 
+Time since the deadline was started, as of the last deadlineExpired().
+@param d the deadline, started with deadlineStart()
+@return the elapsed time in microseconds
+*/
+uint32_t deadlineElapsedUs(const struct deadline* d)
+{
+    return d->elapsedUs;
+}
@@ -0,0 +1,246 @@
+/**
+* @file zm_frame.c
+*
+* @brief Pool of frame buffers shared by the Module physical interface and the library methods.
+*
+* Each frame holds one complete message in the same layout as zmBuf: length, command MSB, command 
+* LSB and then the payload. Frames are referred to by a frameHandle_t.
+*
+* One frame is the working frame, which zmBuf points to. The library methods build their SREQ in the
+* working frame, and the SRSP or received message is written to the working frame, as before. 
+* Other frames can be used to:
+*   - Keep a message: frameDetach() hands the working frame to the application and replaces it with 
+*     a free frame, so the received message stays put while the next request is built. 
+*   - Send a prepared message: build it once in a frame from frameAlloc() and send it with 
+*     sendFrame() as many times as needed; the SRSP goes into the working frame, so the request is
+*     not overwritten.
+*   - Park received messages: a message received while waiting for something else, e.g. in 
+*     waitForMessage(), is parked instead of being dropped. getMessage() hands parked messages over, 
+*     oldest first, by making them the working frame - nothing is copied.
+*
+* The pool size is set with ZM_FRAME_POOL_SIZE. If there is no free frame then messages that can't
+* be parked are dropped, as they were with the single zmBuf.
+*
+* @note These methods are not re-entrant and must not be called from an interrupt service routine.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "zm_frame.h"
+#include "../HAL/hal.h"
+#include "../Common/utilities.h"
+#include <stdint.h>
+
+/** The frames. If fragmentation support is not required then ZIGBEE_MODULE_BUFFER_SIZE can be 
+smaller, e.g. 100B. */
+static uint8_t framePool[ZM_FRAME_POOL_SIZE][ZIGBEE_MODULE_BUFFER_SIZE];
+
+/** Whether each frame is allocated. Frame 0 is the working frame at startup. */
+static uint8_t frameInUse[ZM_FRAME_POOL_SIZE] = {1};
+
+static frameHandle_t workingFrame = 0;
+uint8_t* zmBuf = framePool[0];
+
+/** Parked frames, oldest first. The working frame is never parked so this can't overflow. */
+static frameHandle_t parkedFrames[ZM_FRAME_POOL_SIZE];
+static uint8_t parkedFrameCount = 0;
+
+#define IS_VALID_FRAME(frame)           ((frame) < ZM_FRAME_POOL_SIZE)
+#define FRAME_COMMAND(frame)            (CONVERT_TO_INT(framePool[frame][SRSP_CMD_LSB_FIELD], framePool[frame][SRSP_CMD_MSB_FIELD]))
+
+static void setWorkingFrame(frameHandle_t frame)
+{
+    workingFrame = frame;
+    zmBuf = framePool[frame];
+}
+
+/** Removes the parked frame at this position, keeping the others in order. */
+static frameHandle_t removeParkedFrame(uint8_t index)
+{
+    frameHandle_t frame = parkedFrames[index];
+    parkedFrameCount--;
+    for (; index < parkedFrameCount; index++)
+        parkedFrames[index] = parkedFrames[index + 1];
+    return frame;
+}
+
+/** 
+Gets a free frame from the pool. 
+@return the frame, or FRAME_NONE if all frames are in use.
+@post the frame belongs to the caller until it is given back with frameFree().
+*/
+frameHandle_t frameAlloc()
+{
+    frameHandle_t frame;
+    for (frame = 0; frame < ZM_FRAME_POOL_SIZE; frame++)
+    {
+        if (!frameInUse[frame])
+        {
+            frameInUse[frame] = 1;
+            return frame;
+        }
+    }
+    return FRAME_NONE;
+}
+
+/** 
+Gives a frame from frameAlloc() or frameDetach() back to the pool. 
+@param frame the frame. The working frame can't be freed; this is ignored.
+*/
+void frameFree(frameHandle_t frame)
+{
+    if (IS_VALID_FRAME(frame) && (frame != workingFrame))
+        frameInUse[frame] = 0;
+}
+
+/** 
+Gets the bytes of a frame.
+@param frame the frame
+@return pointer to the start of the frame (the length field), or null if frame is not valid.
+*/
+uint8_t* frameData(frameHandle_t frame)
+{
+    return (IS_VALID_FRAME(frame) ? framePool[frame] : 0);
+}
+
+/** @return how many frames are free */
+uint8_t framesFree()
+{
+    uint8_t count = 0;
+    frameHandle_t frame;
+    for (frame = 0; frame < ZM_FRAME_POOL_SIZE; frame++)
+    {
+        if (!frameInUse[frame])
+            count++;
+    }
+    return count;
+}
+
+/** @return the frame that zmBuf currently points to */
+frameHandle_t getWorkingFrame()
+{
+    return workingFrame;
+}
+
+/** 
+Hands the working frame, e.g. a message that was just received with getMessage(), to the 
+application. A free frame becomes the new working frame, so the message won't be overwritten by 
+the next library method. Nothing is copied.
+@return the frame that was the working frame, or FRAME_NONE if there was no free frame to replace it.
+@post zmBuf points to the new working frame, which is empty.
+@post the application must give the frame back with frameFree() when done with it.
+*/
+frameHandle_t frameDetach()
+{
+    frameHandle_t replacement = frameAlloc();
+    if (replacement == FRAME_NONE)
+        return FRAME_NONE;
+    frameHandle_t detached = workingFrame;
+    setWorkingFrame(replacement);
+    zmBuf[SRSP_LENGTH_FIELD] = 0;
+    return detached;
+}
+
+/** 
+Parks the message in the working frame so that it will be returned by a later getMessage(). 
+Used by methods that wait for a particular message, for the other messages they receive.
+@return 1 if the message was parked, or 0 if there was no free frame; the message will then be 
+overwritten by the next library method.
+@post if parked, zmBuf points to a new working frame, which is empty.
+*/
+uint8_t frameParkWorking()
+{
+    frameHandle_t replacement = frameAlloc();
+    if (replacement == FRAME_NONE)
+        return 0;
+    parkedFrames[parkedFrameCount++] = workingFrame;
+    setWorkingFrame(replacement);
+    zmBuf[SRSP_LENGTH_FIELD] = 0;
+    return 1;
+}
+
+/** 
+Makes the oldest parked message the working frame. The previous working frame is freed.
+@return 1 if there was a parked message, else 0.
+@post if 1 was returned then zmBuf holds the message.
+*/
+uint8_t frameUnpark()
+{
+    if (parkedFrameCount == 0)
+        return 0;
+    frameInUse[workingFrame] = 0;
+    setWorkingFrame(removeParkedFrame(0));
+    return 1;
+}
+
+/** 
+Like frameUnpark() but only for a message with this command. Other parked messages stay parked, in
+order.
+@param command the command to look for, e.g. AF_DATA_CONFIRM
+@return 1 if a parked message had this command, else 0.
+@post if 1 was returned then zmBuf holds the oldest parked message with this command.
+*/
+uint8_t frameUnparkCommand(uint16_t command)
+{
+    uint8_t index;
+    for (index = 0; index < parkedFrameCount; index++)
+    {
+        if (FRAME_COMMAND(parkedFrames[index]) == command)
+        {
+            frameInUse[workingFrame] = 0;
+            setWorkingFrame(removeParkedFrame(index));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** @return how many received messages are parked */
+uint8_t framesParked()
+{
+    return parkedFrameCount;
+}
+
+/** 
+Frees all parked messages, for example after the Module was reset since they are no longer valid.
+*/
+void frameDiscardParked()
+{
+    while (parkedFrameCount)
+        frameInUse[parkedFrames[--parkedFrameCount]] = 0;
+}
+
+/** Displays the state of each frame in the pool and the command it holds. */
+void displayFramePool()
+{
+    frameHandle_t frame;
+    printf("Frame pool: %u frames, %u free, %u parked\r\n", ZM_FRAME_POOL_SIZE, framesFree(), parkedFrameCount);
+    for (frame = 0; frame < ZM_FRAME_POOL_SIZE; frame++)
+    {
+        if (frame == workingFrame)
+            printf("  %u: working, command %04X\r\n", frame, FRAME_COMMAND(frame));
+        else if (frameInUse[frame])
+            printf("  %u: in use, command %04X\r\n", frame, FRAME_COMMAND(frame));
+    }
+}
@@ -0,0 +1,81 @@
+/**
+*  @file zm_frame.h
+*
+*  @brief  public methods for zm_frame.c
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef ZM_FRAME_H
+#define ZM_FRAME_H
+#include <stdint.h>
+#include "module_errors.h"
+#include "zm_phy.h"
+
+/** Handle of a frame in the frame pool. Use frameData() to get the bytes of the frame. */
+typedef uint8_t frameHandle_t;
+
+/** Returned by frameAlloc() and frameDetach() when there are no free frames */
+#define FRAME_NONE                      0xFF
+
+/** Number of frames in the pool; each uses ZIGBEE_MODULE_BUFFER_SIZE bytes of RAM. One frame is 
+always the working frame (zmBuf). With only one frame the library behaves as it did with a single 
+zmBuf: received messages that nobody is waiting for are dropped. */
+#ifndef ZM_FRAME_POOL_SIZE
+#ifdef LAUNCHPAD                        // LaunchPad is RAM limited, so only the working frame
+#define ZM_FRAME_POOL_SIZE              1
+#else
+#define ZM_FRAME_POOL_SIZE              4
+#endif
+#endif
+
+#if (ZM_FRAME_POOL_SIZE < 1) || (ZM_FRAME_POOL_SIZE > 0xFE)
+#error "ZM_FRAME_POOL_SIZE must be between 1 and 254"
+#endif
+
+/** The working frame. All library methods build their SREQ here and the SRSP or received message is
+written here. This points into the frame pool and changes when a parked frame is handed over by 
+getMessage() or the working frame is detached with frameDetach(), so don't keep a copy of it. */
+extern uint8_t* zmBuf;
+
+frameHandle_t frameAlloc();
+void frameFree(frameHandle_t frame);
+uint8_t* frameData(frameHandle_t frame);
+uint8_t framesFree();
+frameHandle_t getWorkingFrame();
+frameHandle_t frameDetach();
+
+//Parked frames: received messages kept for later, in the order they were received
+uint8_t frameParkWorking();
+uint8_t frameUnpark();
+uint8_t frameUnparkCommand(uint16_t command);
+uint8_t framesParked();
+void frameDiscardParked();
+
+void displayFramePool();
+
+/** Implemented by the physical interface, zm_phy_spi.c or zm_phy_uart.c */
+moduleResult_t sendFrame(frameHandle_t frame);
+
+#endif
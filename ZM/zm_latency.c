@@ -0,0 +1,280 @@
+/**
+* @file zm_latency.c
+*
+* @brief Per-command latency statistics of the Module interface, to see which commands take up the
+* time of the application processor and the Module without attaching a logic analyser.
+*
+* The PHY file calls latencySreqSent() when it sends a SREQ, latencySrspReceived() when the SRSP has 
+* been received and latencyAreqReceived() for each AREQ received from the Module. For every MT 
+* command this records the count, minimum, maximum, total and a log2 histogram of two latencies:
+* - SREQ to SRSP, e.g. how long the processor is blocked in sendMessage()
+* - SREQ to AREQ, for requests that are completed by an AREQ, e.g. AF_DATA_REQUEST to AF_DATA_CONFIRM
+*   or ZDO_IEEE_ADDR_REQ to ZDO_IEEE_ADDR_RSP. See areqForSreq() for the pairs.
+*
+* If several requests with the same command are waiting then an AREQ is matched to the oldest. The 
+* AREQ time is when the AREQ was read from the Module, which may be later than when the Module had it
+* if the application was busy.
+*
+* Times are from the free-running hardware timer of the hal file, HAL_TIMER_TICKS(), so recording a 
+* latency takes a few microseconds. With an asynchronous PHY (ZM_PHY_SPI_ASYNC) these are called from
+* interrupt context; don't call latencyReset() or latencyDisplay() while a transaction is in progress.
+*
+* To use, define ZM_LATENCY_STATS. Display the statistics with latencyDisplay().
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "zm_latency.h"
+
+#ifdef ZM_LATENCY_STATS
+#include "module_commands.h"
+#include "zm_phy.h"
+#include "../HAL/hal.h"
+#include "../Common/utilities.h"
+#include <stdio.h>
+#include <stdint.h>
+
+#ifndef HAL_TIMER_TICKS
+#error "ZM_LATENCY_STATS needs a free-running timer: HAL_TIMER_TICKS() and HAL_TIMER_TICKS_PER_US in the hal file"
+#endif
+
+static struct latencyStatistics statistics[ZM_LATENCY_COMMANDS];
+static uint8_t statisticsCount = 0;
+
+/** Number of SREQs that weren't recorded because the table of commands was full */
+uint32_t latencyUntracked = 0;
+
+/** A request that is waiting for the AREQ that completes it */
+struct pendingAreq
+{
+    uint16_t areqCommand;
+    uint8_t index;                      //of the SREQ command in statistics[]
+    uint32_t startTicks;
+};
+
+static struct pendingAreq pending[ZM_LATENCY_PENDING];
+static uint8_t pendingCount = 0;        //oldest is pending[0]
+
+/** The SREQ that is waiting for its SRSP */
+static uint16_t sreqCommand = 0;
+static uint32_t sreqStartTicks = 0;
+
+/** Returns the AREQ that completes a request, or 0 if the SRSP is the only response. ZDO requests 
+0x25xx are answered by 0x45xx + 0x80, except for the ones listed. */
+static uint16_t areqForSreq(uint16_t command)
+{
+    switch (command)
+    {
+    case AF_DATA_REQUEST:
+    case AF_DATA_REQUEST_EXT:       return AF_DATA_CONFIRM;
+    case ZDO_STARTUP_FROM_APP:      return ZDO_STATE_CHANGE_IND;
+    case ZDO_USER_DESC_SET:         return ZDO_USER_DESC_CONF;
+    case ZDO_NWK_DISCOVERY_REQ:     return ZDO_NWK_DISCOVERY_CONF;
+    case ZB_APP_START_REQUEST:      return ZB_START_CONFIRM;
+    case ZB_SEND_DATA_REQUEST:      return ZB_SEND_DATA_CONFIRM;
+    case ZB_FIND_DEVICE_REQUEST:    return ZB_FIND_DEVICE_CONFIRM;
+    default:
+        if ((command & 0xFFC0) == 0x2500)
+            return (command + 0x2080);
+        return 0;
+    }
+}
+
+/** Finds the statistics of a command, adding it to the table if it isn't there yet.
+@return the index in statistics[], or ZM_LATENCY_COMMANDS if the table is full */
+static uint8_t findCommand(uint16_t command)
+{
+    uint8_t i;
+    for (i = 0; i < statisticsCount; i++)
+    {
+        if (statistics[i].command == command)
+            return i;
+    }
+    if (statisticsCount == ZM_LATENCY_COMMANDS)
+    {
+        latencyUntracked++;
+        return ZM_LATENCY_COMMANDS;
+    }
+    statistics[statisticsCount].command = command;
+    return statisticsCount++;
+}
+
+/** Adds one latency to a histogram. */
+static void record(struct latencyHistogram* h, uint32_t startTicks)
+{
+    uint32_t us = (HAL_TIMER_TICKS() - startTicks) / HAL_TIMER_TICKS_PER_US;
+    
+    if (h->count == 0 || us < h->minUs)
+        h->minUs = us;
+    if (us > h->maxUs)
+        h->maxUs = us;
+    if (h->count != 0xFFFFFFFF)
+        h->count++;
+    
+    h->totalMs += us / 1000;
+    h->totalRemainderUs += us % 1000;
+    if (h->totalRemainderUs >= 1000)
+    {
+        h->totalMs++;
+        h->totalRemainderUs -= 1000;
+    }
+    
+    uint8_t bucket = 0;
+    while ((us >>= 1) && (bucket < (LATENCY_BUCKETS - 1)))
+        bucket++;
+    if (h->buckets[bucket] != 0xFFFF)
+        h->buckets[bucket]++;
+}
+
+/** Removes an entry from the list of requests that are waiting for their AREQ. */
+static void removePending(uint8_t i)
+{
+    pendingCount--;
+    for (; i < pendingCount; i++)
+        pending[i] = pending[i+1];
+}
+
+/** 
+Starts timing a SREQ. Called by the PHY file just before the SREQ is sent.
+@param request the SREQ that is about to be sent
+*/
+void latencySreqSent(const uint8_t* request)
+{
+    sreqCommand = CONVERT_TO_INT(request[SRSP_CMD_LSB_FIELD], request[SRSP_CMD_MSB_FIELD]);
+    sreqStartTicks = HAL_TIMER_TICKS();
+}
+
+/** 
+Records the latency of the SREQ started with latencySreqSent(). If the request is completed by an 
+AREQ and the Module accepted it then starts waiting for the AREQ. Called by the PHY file when the 
+correct SRSP has been received.
+@param srsp the SRSP, e.g. zmBuf
+*/
+void latencySrspReceived(const uint8_t* srsp)
+{
+    uint8_t index = findCommand(sreqCommand);
+    if (index == ZM_LATENCY_COMMANDS)
+        return;
+    record(&statistics[index].srsp, sreqStartTicks);
+    
+    uint16_t areqCommand = areqForSreq(sreqCommand);
+    if (areqCommand == 0)
+        return;
+    //ZDO_STARTUP_FROM_APP has the start mode instead of a status; all others have a status
+    if ((sreqCommand != ZDO_STARTUP_FROM_APP) && (srsp[SRSP_LENGTH_FIELD] > 0) && 
+        (srsp[SRSP_PAYLOAD_START] != SRSP_STATUS_SUCCESS))
+        return;
+    if (pendingCount == ZM_LATENCY_PENDING)     //forget the oldest; its AREQ was probably lost
+        removePending(0);
+    pending[pendingCount].areqCommand = areqCommand;
+    pending[pendingCount].index = index;
+    pending[pendingCount].startTicks = sreqStartTicks;
+    pendingCount++;
+}
+
+/** 
+Records the latency of the oldest request that is completed by this AREQ, if there is one. Called 
+by the PHY file for each message received from the Module.
+@param areq the message, e.g. zmBuf
+*/
+void latencyAreqReceived(const uint8_t* areq)
+{
+    uint16_t command = CONVERT_TO_INT(areq[SRSP_CMD_LSB_FIELD], areq[SRSP_CMD_MSB_FIELD]);
+    uint8_t i;
+    for (i = 0; i < pendingCount; i++)
+    {
+        if (pending[i].areqCommand == command)
+        {
+            record(&statistics[pending[i].index].areq, pending[i].startTicks);
+            removePending(i);
+            return;
+        }
+    }
+}
+
+/** Clears all statistics, e.g. at the start of a measurement period. */
+void latencyReset()
+{
+    uint8_t* s = (uint8_t*) statistics;
+    uint16_t i;
+    for (i = 0; i < sizeof(statistics); i++)
+        s[i] = 0;
+    statisticsCount = 0;
+    pendingCount = 0;
+    latencyUntracked = 0;
+}
+
+/** 
+Gets the statistics of one command.
+@param command the SREQ command, e.g. AF_DATA_REQUEST
+@return the statistics, or null (0) if that command hasn't been sent since the last latencyReset().
+*/
+const struct latencyStatistics* latencyGetStatistics(uint16_t command)
+{
+    uint8_t i;
+    for (i = 0; i < statisticsCount; i++)
+    {
+        if (statistics[i].command == command)
+            return &statistics[i];
+    }
+    return 0;
+}
+
+/** Displays one histogram: count, min, average, max, total and the buckets that aren't empty. */
+static void displayHistogram(const char* name, const struct latencyHistogram* h)
+{
+    printf("  %s: count=%lu min=%luus avg=%luus max=%luus total=%lums\r\n", name, 
+           (unsigned long) h->count, (unsigned long) h->minUs, 
+           (unsigned long) (((uint64_t) h->totalMs * 1000 + h->totalRemainderUs) / h->count),    //in 32 bits this overflows after 71 minutes
+           (unsigned long) h->maxUs, (unsigned long) h->totalMs);
+    printf("    ");
+    uint8_t bucket;
+    for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+    {
+        if (h->buckets[bucket] != 0)
+            printf("%s%luus:%u ", (bucket == (LATENCY_BUCKETS - 1)) ? ">=" : "<", 
+                   (unsigned long) 1 << (bucket + ((bucket == (LATENCY_BUCKETS - 1)) ? 0 : 1)), 
+                   h->buckets[bucket]);
+    }
+    printf("\r\n");
+}
+
+/** Displays the statistics of every command on the console. */
+void latencyDisplay()
+{
+    printf("Latency statistics, %u commands:\r\n", statisticsCount);
+    uint8_t i;
+    for (i = 0; i < statisticsCount; i++)
+    {
+        printf("Command 0x%04X\r\n", statistics[i].command);
+        if (statistics[i].srsp.count != 0)
+            displayHistogram("SREQ-SRSP", &statistics[i].srsp);
+        if (statistics[i].areq.count != 0)
+            displayHistogram("SREQ-AREQ", &statistics[i].areq);
+    }
+    if (latencyUntracked != 0)
+        printf("%lu SREQs not recorded, table full\r\n", (unsigned long) latencyUntracked);
+}
+
+#endif
@@ -0,0 +1,89 @@
+/**
+* @file zm_latency.h
+*
+* @brief public methods for zm_latency.c
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef ZM_LATENCY_H
+#define ZM_LATENCY_H
+#include <stdint.h>
+
+/** Number of MT commands that statistics are kept for. Each uses about 130B of RAM. Commands that 
+are sent once the table is full are counted in latencyUntracked. */
+#ifndef ZM_LATENCY_COMMANDS
+#define ZM_LATENCY_COMMANDS             16
+#endif
+
+/** Number of requests that can be waiting for their AREQ at once, e.g. a window of AF_DATA_REQUESTs. 
+If more are sent then the oldest is forgotten. */
+#ifndef ZM_LATENCY_PENDING
+#define ZM_LATENCY_PENDING              8
+#endif
+
+/** Latency histogram buckets; bucket n counts latencies of 2^n .. 2^(n+1)-1 microseconds, and the 
+last bucket counts everything longer, so 20 buckets cover up to about 1 second. */
+#define LATENCY_BUCKETS                 20
+
+/** Statistics of one latency, all times in microseconds. Counts saturate instead of wrapping. */
+struct latencyHistogram
+{
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint32_t totalMs;                   //sum of all latencies, for the share of the duty cycle
+    uint16_t totalRemainderUs;
+    uint16_t buckets[LATENCY_BUCKETS];
+};
+
+/** Statistics of one MT command, keyed by the command of the SREQ, e.g. AF_DATA_REQUEST (0x2401). */
+struct latencyStatistics
+{
+    uint16_t command;
+    struct latencyHistogram srsp;       //from sending the SREQ until the SRSP was received
+    struct latencyHistogram areq;       //from sending the SREQ until its AREQ was received
+};
+
+#ifdef ZM_LATENCY_STATS
+extern uint32_t latencyUntracked;
+
+void latencySreqSent(const uint8_t* request);
+void latencySrspReceived(const uint8_t* srsp);
+void latencyAreqReceived(const uint8_t* areq);
+void latencyReset();
+const struct latencyStatistics* latencyGetStatistics(uint16_t command);
+void latencyDisplay();
+
+//Used by the PHY files, so that they don't need #ifdefs:
+#define LATENCY_SREQ_SENT(request)      latencySreqSent(request)
+#define LATENCY_SRSP_RECEIVED(srsp)     latencySrspReceived(srsp)
+#define LATENCY_AREQ_RECEIVED(areq)     latencyAreqReceived(areq)
+#else
+#define LATENCY_SREQ_SENT(request)      ((void) 0)
+#define LATENCY_SRSP_RECEIVED(srsp)     ((void) 0)
+#define LATENCY_AREQ_RECEIVED(areq)     ((void) 0)
+#endif
+
+#endif
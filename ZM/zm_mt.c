@@ -0,0 +1,86 @@
+/**
+* @file zm_mt.c
+*
+* @brief Building and decoding Module (MT) commands from frame layouts instead of magic offsets.
+*
+* The layout of each command is declared once, as a list of fields and their sizes, and MT_LAYOUT() 
+* turns it into an enum of field offsets. Everything is resolved by the compiler: a field access is a
+* constant index into zmBuf, as if it were written by hand, and fields of a received frame are read 
+* where they are without copying. Only the header and the exchange with the Module are common code: 
+* <pre>
+*   MT_PUT_U8(SYS_GPIO_SREQ_OPERATION, operation);
+*   MT_PUT_U8(SYS_GPIO_SREQ_VALUE, value);
+*   RETURN_RESULT(mtSend(SYS_GPIO, MT_LENGTH(SYS_GPIO_SREQ)), METHOD_SYS_GPIO);
+* </pre>
+* To add a command, define its SREQ and SRSP layouts next to its method's prototype, or next to the 
+* method in the .c file if the layout is only used there.
+*
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "zm_mt.h"
+#include "zm_phy.h"
+#include "zm_frame.h"
+#include "../Common/utilities.h"
+#include <stdint.h>
+
+/** 
+Writes the header of a command into a buffer that holds a frame.
+@param buf the frame, whose payload was or will be written with MT_BUF_PUT_U8() etc.
+@param command the command, e.g. AF_DATA_REQUEST
+@param payloadLength length of the payload
+*/
+void mtPack(uint8_t* buf, uint16_t command, uint8_t payloadLength)
+{
+    buf[SRSP_LENGTH_FIELD] = payloadLength;
+    buf[SRSP_CMD_MSB_FIELD] = MSB(command);
+    buf[SRSP_CMD_LSB_FIELD] = LSB(command);
+}
+
+/** 
+Sends the command in zmBuf to the Module and gets the response. 
+@pre the payload of the command was written into zmBuf, e.g. with MT_PUT_U8()
+@param command the command, e.g. SYS_GPIO
+@param payloadLength length of the payload, e.g. MT_LENGTH(SYS_GPIO_SREQ)
+@post if the command was an SREQ then zmBuf contains the SRSP
+@return the result of sendMessage()
+*/
+moduleResult_t mtSend(uint16_t command, uint8_t payloadLength)
+{
+    mtPack(zmBuf, command, payloadLength);
+    return sendMessage();
+}
+
+/** 
+Sends an SREQ with mtSend() whose SRSP starts with a status byte, and returns the status.
+@return the error from sendMessage(), or the status in the SRSP, SRSP_STATUS_SUCCESS if successful
+*/
+moduleResult_t mtRequest(uint16_t command, uint8_t payloadLength)
+{
+    moduleResult_t result = mtSend(command, payloadLength);
+    if (result != MODULE_SUCCESS)
+        return result;
+    return zmBuf[SRSP_PAYLOAD_START];
+}
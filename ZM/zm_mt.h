@@ -0,0 +1,81 @@
+/**
+* @file zm_mt.h
+*
+* @brief Frame layouts of Module commands and methods to build and decode them; see zm_mt.c
+*
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef ZM_MT_H
+#define ZM_MT_H
+#include <stdint.h>
+#include "module_errors.h"
+
+/* Sizes of the fields of a layout, in bytes. Multi-byte values are LSB first, as on the MT interface */
+#define MT_U8                           1
+#define MT_U16                          2
+#define MT_U32                          4
+#define MT_BYTES(length)                (length)
+/** For a field whose length is given by a preceding field. Must be the last field of a layout. */
+#define MT_VARIABLE                     0
+
+/** Expands one field of a layout into the offset of its first byte and of its last byte */
+#define MT_FIELD_OFFSET(layout, name, size)     layout##_##name, layout##_##name##_LAST_ = layout##_##name + (size) - 1,
+
+/** 
+Defines the offsets of the fields of a layout, relative to the start of the payload, as the 
+constants layout_NAME. The fields are listed in layout_FIELDS(L, F) as F(L, NAME, size), e.g.
+<pre>
+#define SYS_GPIO_SREQ_FIELDS(L, F)  F(L, OPERATION, MT_U8) F(L, VALUE, MT_U8)
+MT_LAYOUT(SYS_GPIO_SREQ);
+</pre>
+defines SYS_GPIO_SREQ_OPERATION = 0 and SYS_GPIO_SREQ_VALUE = 1.
+*/
+#define MT_LAYOUT(layout)               enum { layout##_FIRST_ = -1, layout##_FIELDS(layout, MT_FIELD_OFFSET) layout##_END_ }
+
+/** Length of the fixed part of the payload of a layout */
+#define MT_LENGTH(layout)               ((uint8_t) (layout##_END_))
+
+/* Access to the fields of the frame in zmBuf. field is one of the constants defined by MT_LAYOUT() */
+#define MT_INDEX(field)                 (SRSP_PAYLOAD_START + (field))
+#define MT_GET_U8(field)                (zmBuf[MT_INDEX(field)])
+#define MT_GET_U16(field)               (CONVERT_TO_INT(zmBuf[MT_INDEX(field)], zmBuf[MT_INDEX(field) + 1]))
+#define MT_POINTER(field)               (zmBuf + MT_INDEX(field))
+#define MT_PUT_U8(field, value)         MT_BUF_PUT_U8(zmBuf, field, value)
+#define MT_PUT_U16(field, value)        MT_BUF_PUT_U16(zmBuf, field, value)
+#define MT_PUT_U32(field, value)        (MT_PUT_U16(field, (value) & 0xFFFF), \
+                                         zmBuf[MT_INDEX(field) + 2] = LSB((value) >> 16), \
+                                         zmBuf[MT_INDEX(field) + 3] = LSB((value) >> 24))
+
+/* The same, for a frame that is built in another buffer, e.g. one from frameData() */
+#define MT_BUF_POINTER(buf, field)              ((buf) + MT_INDEX(field))
+#define MT_BUF_PUT_U8(buf, field, value)        ((buf)[MT_INDEX(field)] = (value))
+#define MT_BUF_PUT_U16(buf, field, value)       ((buf)[MT_INDEX(field)] = LSB(value), (buf)[MT_INDEX(field) + 1] = MSB(value))
+
+void mtPack(uint8_t* buf, uint16_t command, uint8_t payloadLength);
+moduleResult_t mtSend(uint16_t command, uint8_t payloadLength);
+moduleResult_t mtRequest(uint16_t command, uint8_t payloadLength);
+
+#endif
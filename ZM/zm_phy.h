@@ -4,7 +4,8 @@
 * @brief Zigbee Module physical interface (Phy) layer select file
 *
 * This file will include zm_phy_spi.h if ZM_PHY_SPI is defined, or zm_phy_uart.h if ZM_PHY_UART is
-* defined. One of these MUST be defined.
+* defined. One of these MUST be defined. On a Linux host ZM_PHY_SIM may be defined instead to use a 
+* simulated Module, see zm_phy_sim.c.
 *
 *
 * $Rev: 1767 $
@@ -39,6 +40,8 @@
 #include "../ZM/zm_phy_spi.h"
 #elif defined ZM_PHY_UART
 #include "../ZM/zm_phy_uart.h"	 
+#elif defined ZM_PHY_SIM
+#include "../ZM/zm_phy_sim.h"             //Simulated Module, only with LINUX_HOST
 #else
-#error "You must define a physical interface for the module library: ZM_PHY_SPI or ZM_PHY_UART. In IAR this is done in Project Options : C/C++ Compiler : Preprocessor : Defined Symbols. In CCS this is done in Project Properties : Compiler : Advanced Options : Predefined Symbols."
+#error "You must define a physical interface for the module library: ZM_PHY_SPI, ZM_PHY_UART or ZM_PHY_SIM. In IAR this is done in Project Options : C/C++ Compiler : Preprocessor : Defined Symbols. In CCS this is done in Project Properties : Compiler : Advanced Options : Predefined Symbols."
 #endif
@@ -0,0 +1,1036 @@
+/**
+* @file zm_phy_sim.c
+*
+* @brief Physical Interface Layer to a simulated Module, for running the library on a Linux host 
+* without a Module, e.g. to benchmark the throughput and latency of library changes.
+*
+* Instead of sending messages to a Module, sendMessage() answers each SREQ itself the way an A2530 
+* would, and generates the AREQs that would follow (SYS_RESET_IND, ZDO_STATE_CHANGE_IND, 
+* AF_DATA_CONFIRM, ZDO_IEEE_ADDR_RSP etc.). AREQs are held until their time has come, so latency is 
+* simulated without threads. Supported: SYS_RESET_IND, SYS_VERSION, SYS_RANDOM, SYS_GPIO, SYS_NV_READ,
+* SYS_NV_WRITE, SYS_SET_TX_POWER, ZB_WRITE_CONFIGURATION, ZB_READ_CONFIGURATION, ZB_GET_DEVICE_INFO, 
+* UTIL_GET_DEVICE_INFO, AF_REGISTER, AF_DATA_REQUEST, AF_DATA_REQUEST_EXT, AF_DATA_STORE, AF_DATA_RETRIEVE, 
+* ZDO_STARTUP_FROM_APP, ZDO_IEEE_ADDR_REQ, ZDO_NWK_ADDR_REQ, ZDO_EXT_ADD_GROUP and ZDO_EXT_REMOVE_GROUP. 
+* Any other SREQ gets a SRSP with a success status.
+*
+* Several simulated nodes, each a separate process, share one virtual network. Each node has a UDP 
+* socket on the loopback interface at networkPort + node, and its short address is its node number;
+* node 0 is the coordinator. AF messages are sent over these sockets, so the AF_INCOMING_MSG and
+* AF_INCOMING_MSG_EXT of one node arrive at another. A broadcast goes to every other node. A message 
+* to a node that is not running is lost without an error, as there is no MAC ACK. A group message is 
+broadcast, and kept only by the nodes with an endpoint in the group. ZDO address 
+* requests are answered from the fixed mapping between short address and IEEE address, see simIeee().
+*
+* The settings are read from the environment by zm_phy_init(), so the examples can be run unchanged:
+* - ZM_SIM_NODE node number, 0 .. SIM_MAX_NODES-1. Default 0.
+* - ZM_SIM_PORT UDP port of node 0. Default SIM_DEFAULT_NETWORK_PORT.
+* - ZM_SIM_SRSP_LATENCY_US time from a SREQ to its SRSP. Default 1000.
+* - ZM_SIM_AIR_LATENCY_US time for a message to cross the network. Default 5000.
+* - ZM_SIM_AIR_BYTE_US time on air per byte of payload. Default 32 (250kbps).
+* - ZM_SIM_LOSS percentage of messages over the network that are lost. Default 0.
+*
+* To use, define LINUX_HOST and ZM_PHY_SIM, and link with zm_phy_sim.c instead of zm_phy_spi.c.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "../HAL/hal.h"
+#include "zm_phy_sim.h"
+#include "zm_frame.h"
+#include "zm_latency.h"
+#include "module.h"
+#include "module_commands.h"
+#include "module_errors.h"
+#include "af.h"
+#include "../Common/utilities.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+struct simStatistics simStatistics;
+
+static struct simConfiguration simConfig;
+static int simSocket = -1;
+static unsigned int simRandomSeed = 1;
+
+#define SIM_PRODUCT_ID                  0x21    //A2530R24C, firmware 2.5.1 release 2
+#define SIM_LQI                         0xFF
+#define SIM_BROADCAST_ADDRESS_MIN       0xFFF8
+#define SIM_SHORT_ADDRESS_NONE          0xFFFE
+#define SIM_DEFAULT_PAN_ID              0x1A62
+#define SIM_DEFAULT_CHANNEL             11
+#define SIM_STATUS_FAILURE              0x01
+#define SIM_STATUS_MAC_NO_ACK           0xE9
+#define SIM_STATUS_INVALID_PARAMETER    0x02
+#define SIM_STATUS_NV_OPER_FAILED       0x0A
+
+//
+//  Time
+//
+/** @return microseconds since an arbitrary point. CLOCK_MONOTONIC is the same for all processes, so 
+this is also used to time messages between nodes. */
+static uint64_t simMicros()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+/** @return true (1) if a message over the network should be lost */
+static uint8_t simIsLost()
+{
+    return ((simConfig.lossPercent > 0) && ((uint8_t) (rand_r(&simRandomSeed) % 100) < simConfig.lossPercent));
+}
+
+/** @return the time that a message with this many bytes of payload takes to cross the network */
+static uint32_t simAirTimeUs(uint16_t payloadLength)
+{
+    return simConfig.airLatencyUs + (payloadLength * simConfig.airByteTimeUs);
+}
+
+//
+//  AREQs waiting for the application. Not kept in order; the earliest due is returned first.
+//
+struct simAreq
+{
+    uint64_t dueUs;
+    uint8_t frame[ZIGBEE_MODULE_BUFFER_SIZE];
+};
+static struct simAreq areqQueue[SIM_AREQ_QUEUE_SIZE];
+static uint8_t areqCount = 0;
+
+/** Holds an AREQ until dueUs. If the queue is full then the AREQ is dropped, like a Module that ran 
+out of buffers. */
+static void simQueueAreq(const uint8_t* frame, uint64_t dueUs)
+{
+    if (areqCount == SIM_AREQ_QUEUE_SIZE)
+    {
+        simStatistics.areqsDropped++;
+        return;
+    }
+    areqQueue[areqCount].dueUs = dueUs;
+    memcpy(areqQueue[areqCount].frame, frame, frame[0] + SRSP_HEADER_SIZE);
+    areqCount++;
+}
+
+/** @return the index of the earliest AREQ that is due, or -1 if none */
+static int8_t simDueAreq()
+{
+    uint64_t now = simMicros();
+    int8_t due = -1;
+    uint8_t i;
+    for (i = 0; i < areqCount; i++)
+    {
+        if ((areqQueue[i].dueUs <= now) && ((due < 0) || (areqQueue[i].dueUs < areqQueue[due].dueUs)))
+            due = i;
+    }
+    return due;
+}
+
+#ifdef ZM_WAIT_FOR_EVENT
+/** @return microseconds until the next AREQ is due, or 0xFFFFFFFF if there are none */
+static uint32_t simTimeToNextAreqUs()
+{
+    uint64_t now = simMicros();
+    uint64_t next = 0xFFFFFFFF;
+    uint8_t i;
+    for (i = 0; i < areqCount; i++)
+    {
+        uint64_t wait = (areqQueue[i].dueUs > now) ? (areqQueue[i].dueUs - now) : 0;
+        if (wait < next)
+            next = wait;
+    }
+    return (uint32_t) next;
+}
+#endif
+
+//
+//  Module state. NV items and configuration items are kept over a reset, like the Module's flash.
+//
+static uint8_t deviceState = DEV_HOLD;
+static uint8_t nvItems[MAX_NV_ITEM + 1][16];
+
+#define SIM_CONFIGURATION_ITEMS         24
+#define SIM_CONFIGURATION_ITEM_LENGTH   ZCD_NV_USERDESC_LEN
+struct simConfigurationItem
+{
+    uint8_t id;                 //0 if free
+    uint8_t length;
+    uint8_t value[SIM_CONFIGURATION_ITEM_LENGTH];
+};
+static struct simConfigurationItem configurationItems[SIM_CONFIGURATION_ITEMS];
+
+/** @return the configuration item with this id, or 0 if it was never written */
+static struct simConfigurationItem* simFindConfigurationItem(uint8_t id)
+{
+    uint8_t i;
+    for (i = 0; i < SIM_CONFIGURATION_ITEMS; i++)
+    {
+        if (configurationItems[i].id == id)
+            return &configurationItems[i];
+    }
+    return 0;
+}
+
+/** @return the logical type written with ZB_WRITE_CONFIGURATION, or by default COORDINATOR for node 0 
+and ROUTER for the others */
+static uint8_t simLogicalType()
+{
+    struct simConfigurationItem* item = simFindConfigurationItem(ZCD_NV_LOGICAL_TYPE);
+    if (item != 0)
+        return item->value[0];
+    return (simConfig.node == 0) ? COORDINATOR : ROUTER;
+}
+
+static uint16_t simPanId()
+{
+    struct simConfigurationItem* item = simFindConfigurationItem(ZCD_NV_PANID);
+    if ((item != 0) && (CONVERT_TO_INT(item->value[0], item->value[1]) != 0xFFFF))
+        return CONVERT_TO_INT(item->value[0], item->value[1]);
+    return SIM_DEFAULT_PAN_ID;
+}
+
+/** @return the lowest channel in the channel mask, or SIM_DEFAULT_CHANNEL */
+static uint8_t simChannel()
+{
+    struct simConfigurationItem* item = simFindConfigurationItem(ZCD_NV_CHANLIST);
+    if (item != 0)
+    {
+        uint32_t mask = item->value[0] | ((uint32_t) item->value[1] << 8) | 
+            ((uint32_t) item->value[2] << 16) | ((uint32_t) item->value[3] << 24);
+        uint8_t channel;
+        for (channel = 11; channel <= 26; channel++)
+        {
+            if (mask & (1UL << channel))
+                return channel;
+        }
+    }
+    return SIM_DEFAULT_CHANNEL;
+}
+
+/** Writes the IEEE address of a node, LSB first. The node's short address is in the two lowest bytes
+so that it can be found again by simNodeForIeee(). */
+static void simIeee(uint16_t shortAddress, uint8_t* ieee)
+{
+    static const uint8_t simIeeePrefix[6] = {0x00, 0x00, 0x53, 0x49, 0x4D, 0x00};   //"SIM"
+    ieee[0] = LSB(shortAddress);
+    ieee[1] = MSB(shortAddress);
+    memcpy(ieee + 2, simIeeePrefix, 6);
+}
+
+/** @return the short address of the node with this IEEE address, or SIM_SHORT_ADDRESS_NONE */
+static uint16_t simNodeForIeee(const uint8_t* ieee)
+{
+    uint8_t expected[8];
+    uint16_t shortAddress = CONVERT_TO_INT(ieee[0], ieee[1]);
+    simIeee(shortAddress, expected);
+    if ((memcmp(ieee, expected, 8) != 0) || (shortAddress >= SIM_MAX_NODES))
+        return SIM_SHORT_ADDRESS_NONE;
+    return shortAddress;
+}
+
+//
+//  Extended messages
+//
+#define AF_DATA_REQUEST_EXT_HEADER_LENGTH   20
+/** The AF_DATA_REQUEST_EXT being built with AF_DATA_STORE */
+static uint8_t extRequest[SRSP_HEADER_SIZE + AF_DATA_REQUEST_EXT_HEADER_LENGTH];
+static uint8_t extData[AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH];
+
+/** Received extended messages that were too long for the AF_INCOMING_MSG_EXT, for AF_DATA_RETRIEVE */
+#define SIM_EXT_STORE_SIZE              2
+struct simStoredMessage
+{
+    uint32_t timestamp;         //0 if free
+    uint16_t length;
+    uint8_t data[AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH];
+};
+static struct simStoredMessage storedMessages[SIM_EXT_STORE_SIZE];
+static uint32_t nextTimestamp = 1;
+
+/** Groups that the endpoints of this node are in, see ZDO_EXT_ADD_GROUP */
+#define SIM_MAX_GROUPS                  8
+struct simGroup
+{
+    uint8_t endpoint;           //0 if free
+    uint16_t groupId;
+};
+static struct simGroup simGroups[SIM_MAX_GROUPS];
+
+/** Finds the entry of an endpoint in a group.
+@param endpoint the endpoint, or 0 for any endpoint in the group
+@return the entry, or 0 if there is none */
+static struct simGroup* simFindGroup(uint8_t endpoint, uint16_t groupId)
+{
+    uint8_t i;
+    for (i = 0; i < SIM_MAX_GROUPS; i++)
+    {
+        if ((simGroups[i].endpoint != 0) && (simGroups[i].groupId == groupId) && 
+            ((endpoint == 0) || (simGroups[i].endpoint == endpoint)))
+            return &simGroups[i];
+    }
+    return 0;
+}
+
+#define AF_INCOMING_MSG_HEADER_LENGTH       17
+#define AF_INCOMING_MSG_EXT_HEADER_LENGTH   27
+/** Longest payload that fits in an AF_INCOMING_MSG_EXT; longer ones are stored */
+#define SIM_EXT_INLINE_MAX_LENGTH       (ZIGBEE_MODULE_BUFFER_SIZE - SRSP_HEADER_SIZE - AF_INCOMING_MSG_EXT_HEADER_LENGTH)
+
+//
+//  Network
+//
+/** A message between nodes: when it is due, followed by the AREQ for the destination. An
+AF_INCOMING_MSG_EXT may be longer than a frame, so its length is the length of the datagram. */
+#define SIM_PACKET_HEADER_LENGTH        8
+#define SIM_PACKET_MAX_LENGTH           (SIM_PACKET_HEADER_LENGTH + SRSP_HEADER_SIZE + AF_INCOMING_MSG_EXT_HEADER_LENGTH + AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH)
+
+/** Sends a packet to one node */
+static void simSendPacket(uint16_t node, const uint8_t* packet, uint16_t length)
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(simConfig.networkPort + node);
+    sendto(simSocket, packet, length, 0, (struct sockaddr*) &address, sizeof(address));
+}
+
+/** Sends an AREQ over the network to another node. 
+@param destination short address of the node, or a broadcast address
+@param areq the AREQ that the destination will receive; frame length in areq[0] is ignored
+@param areqLength total length of the AREQ
+@param payloadLength bytes of application payload, for the time on air
+@return true (1) if the message was delivered, or 0 if it was lost. Broadcasts are never acknowledged 
+so always return 1. */
+static uint8_t simTransmit(uint16_t destination, const uint8_t* areq, uint16_t areqLength, uint16_t payloadLength)
+{
+    static uint8_t packet[SIM_PACKET_MAX_LENGTH];
+    uint64_t dueUs = simMicros() + simAirTimeUs(payloadLength);
+    memcpy(packet, &dueUs, SIM_PACKET_HEADER_LENGTH);
+    memcpy(packet + SIM_PACKET_HEADER_LENGTH, areq, areqLength);
+    simStatistics.messagesSent++;
+    
+    if (destination >= SIM_BROADCAST_ADDRESS_MIN)
+    {
+        uint16_t node;
+        for (node = 0; node < SIM_MAX_NODES; node++)
+        {
+            if ((node != simConfig.node) && !simIsLost())
+                simSendPacket(node, packet, SIM_PACKET_HEADER_LENGTH + areqLength);
+        }
+        return 1;
+    }
+    if ((destination >= SIM_MAX_NODES) || simIsLost())
+    {
+        simStatistics.messagesLost++;
+        return 0;
+    }
+    simSendPacket(destination, packet, SIM_PACKET_HEADER_LENGTH + areqLength);
+    return 1;
+}
+
+/** Receives an AF_INCOMING_MSG_EXT from the network. If the payload doesn't fit in the frame then it
+is stored for AF_DATA_RETRIEVE and only the header is given to the application. 
+@param length length of the frame in the packet
+@return true (1) if the frame should be given to the application, 0 if it should be dropped */
+static uint8_t simReceiveExtended(uint8_t* frame, uint16_t length)
+{
+    uint16_t payloadLength = CONVERT_TO_INT(frame[AF_INCOMING_MESSAGE_EXT_PAYLOAD_LEN_LSB_FIELD], frame[AF_INCOMING_MESSAGE_EXT_PAYLOAD_LEN_MSB_FIELD]);
+    if (length < (AF_INCOMING_MESSAGE_EXT_PAYLOAD_START_FIELD + payloadLength))
+        return 0;                                           //truncated packet
+    uint32_t timestamp = nextTimestamp++;
+    memcpy(frame + AF_INCOMING_MESSAGE_EXT_TIMESTAMP_START_FIELD, &timestamp, 4);
+    if (payloadLength <= SIM_EXT_INLINE_MAX_LENGTH)
+    {
+        frame[0] = AF_INCOMING_MSG_EXT_HEADER_LENGTH + payloadLength;
+        return 1;
+    }
+    uint8_t i;
+    for (i = 0; i < SIM_EXT_STORE_SIZE; i++)
+    {
+        if (storedMessages[i].timestamp == 0)
+        {
+            storedMessages[i].timestamp = timestamp;
+            storedMessages[i].length = payloadLength;
+            memcpy(storedMessages[i].data, frame + AF_INCOMING_MESSAGE_EXT_PAYLOAD_START_FIELD, payloadLength);
+            frame[0] = AF_INCOMING_MSG_EXT_HEADER_LENGTH;
+            return 1;
+        }
+    }
+    return 0;   //Module is out of memory
+}
+
+/** Moves any packets received from other nodes into the AREQ queue */
+static void simPollNetwork()
+{
+    static uint8_t packet[SIM_PACKET_MAX_LENGTH];
+    if (simSocket < 0)
+        return;
+    while (1)
+    {
+        ssize_t length = recv(simSocket, packet, sizeof(packet), MSG_DONTWAIT);
+        if (length < (SIM_PACKET_HEADER_LENGTH + SRSP_HEADER_SIZE))
+            return;
+        uint64_t dueUs;
+        memcpy(&dueUs, packet, SIM_PACKET_HEADER_LENGTH);
+        uint8_t* frame = packet + SIM_PACKET_HEADER_LENGTH;
+        simStatistics.messagesReceived++;
+        if (CONVERT_TO_INT(frame[SRSP_CMD_LSB_FIELD], frame[SRSP_CMD_MSB_FIELD]) == AF_INCOMING_MSG_EXT)
+        {
+            uint16_t groupId = CONVERT_TO_INT(frame[AF_INCOMING_MESSAGE_GROUP_LSB_FIELD], frame[AF_INCOMING_MESSAGE_GROUP_MSB_FIELD]);
+            if (groupId != 0)
+            {
+                struct simGroup* group = simFindGroup(0, groupId);
+                if (group == 0)
+                    continue;                               //not for this node
+                frame[AF_INCOMING_MESSAGE_EXT_DESTINATION_EP_FIELD] = group->endpoint;
+            }
+            if (!simReceiveExtended(frame, length - SIM_PACKET_HEADER_LENGTH))
+            {
+                simStatistics.areqsDropped++;
+                continue;
+            }
+        }
+        simQueueAreq(frame, dueUs);
+    }
+}
+
+/** Opens the socket of this node, closing the old one if the node or port changed */
+static void simOpenSocket()
+{
+    if (simSocket >= 0)
+        close(simSocket);
+    simSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (simSocket < 0)
+    {
+        printf("zm_phy_sim: could not create socket\r\n");
+        return;
+    }
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(simConfig.networkPort + simConfig.node);
+    if (bind(simSocket, (struct sockaddr*) &address, sizeof(address)) != 0)
+    {
+        printf("zm_phy_sim: could not bind node %u to port %u; is another node using it?\r\n", 
+               simConfig.node, simConfig.networkPort + simConfig.node);
+        close(simSocket);
+        simSocket = -1;
+    }
+}
+
+//
+//  SREQ handlers. Each writes the SRSP payload into srsp and returns its length; they may queue AREQs.
+//
+/** Writes a frame header */
+static void simHeader(uint8_t* frame, uint16_t command, uint8_t length)
+{
+    frame[0] = length;
+    frame[1] = MSB(command);
+    frame[2] = LSB(command);
+}
+
+/** Writes the AF_DATA_CONFIRM for a message that was sent */
+static void simConfirm(uint8_t status, uint8_t endpoint, uint8_t transactionId, uint16_t payloadLength)
+{
+    uint8_t confirm[SRSP_HEADER_SIZE + 3];
+    simHeader(confirm, AF_DATA_CONFIRM, 3);
+    confirm[3] = status;
+    confirm[4] = endpoint;
+    confirm[5] = transactionId;
+    simQueueAreq(confirm, simMicros() + simAirTimeUs(payloadLength));
+}
+
+static uint8_t simAfDataRequest(const uint8_t* request, uint8_t* srsp)
+{
+    static uint8_t areq[SRSP_HEADER_SIZE + AF_INCOMING_MSG_HEADER_LENGTH + MAXIMUM_PAYLOAD_LENGTH];
+    uint16_t destination = CONVERT_TO_INT(request[3], request[4]);
+    uint8_t length = request[12];
+    if (length > MAXIMUM_PAYLOAD_LENGTH)
+    {
+        srsp[0] = SIM_STATUS_INVALID_PARAMETER;
+        return 1;
+    }
+    simHeader(areq, AF_INCOMING_MSG, AF_INCOMING_MSG_HEADER_LENGTH + length);
+    memset(areq + SRSP_PAYLOAD_START, 0, AF_INCOMING_MSG_HEADER_LENGTH);
+    areq[AF_INCOMING_MESSAGE_CLUSTER_LSB_FIELD] = request[7];
+    areq[AF_INCOMING_MESSAGE_CLUSTER_MSB_FIELD] = request[8];
+    areq[AF_INCOMING_MESSAGE_SHORT_ADDRESS_LSB_FIELD] = simConfig.node;
+    areq[AF_INCOMING_MESSAGE_SOURCE_EP_FIELD] = request[6];
+    areq[AF_INCOMING_MESSAGE_DESTINATION_EP_FIELD] = request[5];
+    areq[AF_INCOMING_MESSAGE_WAS_BROADCAST_FIELD] = (destination >= SIM_BROADCAST_ADDRESS_MIN);
+    areq[AF_INCOMING_MESSAGE_LQI_FIELD] = SIM_LQI;
+    areq[AF_INCOMING_MESSAGE_TRANSACTION_SEQUENCE_FIELD] = request[9];
+    areq[AF_INCOMING_MESSAGE_PAYLOAD_LEN_FIELD] = length;
+    memcpy(areq + AF_INCOMING_MESSAGE_PAYLOAD_START_FIELD, request + 13, length);
+    
+    uint8_t delivered = simTransmit(destination, areq, SRSP_HEADER_SIZE + AF_INCOMING_MSG_HEADER_LENGTH + length, length);
+    simConfirm(delivered ? MODULE_SUCCESS : SIM_STATUS_MAC_NO_ACK, request[6], request[9], length);
+    srsp[0] = MODULE_SUCCESS;
+    return 1;
+}
+
+/** Sends the AF_DATA_REQUEST_EXT in extRequest with the payload in extData */
+static void simSendExtended()
+{
+    static uint8_t areq[SRSP_HEADER_SIZE + AF_INCOMING_MSG_EXT_HEADER_LENGTH + AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH];
+    const uint8_t* request = extRequest;
+    uint16_t length = CONVERT_TO_INT(request[21], request[22]);
+    uint16_t destination = (request[3] == DESTINATION_ADDRESS_MODE_LONG) ? 
+        simNodeForIeee(request + 4) : CONVERT_TO_INT(request[4], request[5]);
+    
+    simHeader(areq, AF_INCOMING_MSG_EXT, 0);        //length is set by the receiver
+    memset(areq + SRSP_PAYLOAD_START, 0, AF_INCOMING_MSG_EXT_HEADER_LENGTH);
+    if (request[3] == DESTINATION_ADDRESS_MODE_GROUP)
+    {
+        areq[AF_INCOMING_MESSAGE_GROUP_LSB_FIELD] = request[4];
+        areq[AF_INCOMING_MESSAGE_GROUP_MSB_FIELD] = request[5];
+        destination = 0xFFFF;
+    }
+    areq[AF_INCOMING_MESSAGE_EXT_CLUSTER_LSB_FIELD] = request[16];
+    areq[AF_INCOMING_MESSAGE_EXT_CLUSTER_MSB_FIELD] = request[17];
+    areq[AF_INCOMING_MESSAGE_EXT_ADDRESSING_MODE_FIELD] = DESTINATION_ADDRESS_MODE_SHORT;
+    areq[AF_INCOMING_MESSAGE_EXT_SHORT_ADDRESS_LSB_FIELD] = simConfig.node;
+    areq[AF_INCOMING_MESSAGE_EXT_SOURCE_EP_FIELD] = request[15];
+    areq[AF_INCOMING_MESSAGE_EXT_SOURCE_EP_FIELD + 1] = LSB(simPanId());
+    areq[AF_INCOMING_MESSAGE_EXT_SOURCE_EP_FIELD + 2] = MSB(simPanId());
+    areq[AF_INCOMING_MESSAGE_EXT_DESTINATION_EP_FIELD] = request[12];
+    areq[AF_INCOMING_MESSAGE_EXT_WAS_BROADCAST_FIELD] = (destination >= SIM_BROADCAST_ADDRESS_MIN);
+    areq[AF_INCOMING_MESSAGE_EXT_LQI_FIELD] = SIM_LQI;
+    areq[AF_INCOMING_MESSAGE_EXT_TIMESTAMP_START_FIELD + 4] = request[18];     //transaction sequence number
+    areq[AF_INCOMING_MESSAGE_EXT_PAYLOAD_LEN_LSB_FIELD] = LSB(length);
+    areq[AF_INCOMING_MESSAGE_EXT_PAYLOAD_LEN_MSB_FIELD] = MSB(length);
+    memcpy(areq + AF_INCOMING_MESSAGE_EXT_PAYLOAD_START_FIELD, extData, length);
+    
+    uint8_t delivered = simTransmit(destination, areq, AF_INCOMING_MESSAGE_EXT_PAYLOAD_START_FIELD + length, length);
+    simConfirm(delivered ? MODULE_SUCCESS : SIM_STATUS_MAC_NO_ACK, request[15], request[18], length);
+}
+
+static uint8_t simAfDataRequestExt(const uint8_t* request, uint8_t* srsp)
+{
+    uint16_t length = CONVERT_TO_INT(request[21], request[22]);
+    if (length > AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH)
+    {
+        srsp[0] = SIM_STATUS_INVALID_PARAMETER;
+        return 1;
+    }
+    memcpy(extRequest, request, sizeof(extRequest));
+    if (request[0] > AF_DATA_REQUEST_EXT_HEADER_LENGTH)     //payload is in the request itself
+    {
+        memcpy(extData, request + SRSP_HEADER_SIZE + AF_DATA_REQUEST_EXT_HEADER_LENGTH, length);
+        simSendExtended();
+    }                                                       //else wait for AF_DATA_STORE
+    srsp[0] = MODULE_SUCCESS;
+    return 1;
+}
+
+static uint8_t simAfDataStore(const uint8_t* request, uint8_t* srsp)
+{
+    uint16_t index = CONVERT_TO_INT(request[3], request[4]);
+    uint8_t length = request[5];
+    srsp[0] = MODULE_SUCCESS;
+    if (length == 0)
+        simSendExtended();
+    else if ((index + length) <= AF_DATA_REQUEST_EXT_MAX_TOTAL_PAYLOAD_LENGTH)
+        memcpy(extData + index, request + 6, length);
+    else
+        srsp[0] = SIM_STATUS_INVALID_PARAMETER;
+    return 1;
+}
+
+static uint8_t simAfDataRetrieve(const uint8_t* request, uint8_t* srsp)
+{
+    uint32_t timestamp;
+    memcpy(&timestamp, request + 3, 4);
+    uint16_t index = CONVERT_TO_INT(request[7], request[8]);
+    uint8_t length = request[9];
+    uint8_t i;
+    for (i = 0; i < SIM_EXT_STORE_SIZE; i++)
+    {
+        struct simStoredMessage* m = &storedMessages[i];
+        if ((timestamp == 0) || (m->timestamp != timestamp))
+            continue;
+        if (length == 0)                                    //done; free the message
+        {
+            m->timestamp = 0;
+            srsp[0] = MODULE_SUCCESS;
+            srsp[1] = 0;
+            return 2;
+        }
+        if (((index + length) > m->length) || (length > MAXIMUM_AF_DATA_RETRIEVE_PAYLOAD_LENGTH))
+            break;
+        srsp[0] = MODULE_SUCCESS;
+        srsp[1] = length;
+        memcpy(srsp + 2, m->data + index, length);
+        return 2 + length;
+    }
+    srsp[0] = SIM_STATUS_INVALID_PARAMETER;
+    srsp[1] = 0;
+    return 2;
+}
+
+/** Queues the ZDO_STATE_CHANGE_INDs of starting or joining a network */
+static void simStartNetwork()
+{
+    static const uint8_t coordinatorStates[] = {DEV_COORD_STARTING, DEV_ZB_COORD};
+    static const uint8_t routerStates[] = {DEV_NWK_DISC, DEV_NWK_JOINING, DEV_ROUTER};
+    static const uint8_t endDeviceStates[] = {DEV_NWK_DISC, DEV_NWK_JOINING, DEV_END_DEVICE};
+    const uint8_t* states = routerStates;
+    uint8_t count = sizeof(routerStates);
+    if (simLogicalType() == COORDINATOR)
+    {
+        states = coordinatorStates;
+        count = sizeof(coordinatorStates);
+    } else if (simLogicalType() == END_DEVICE) {
+        states = endDeviceStates;
+        count = sizeof(endDeviceStates);
+    }
+    uint64_t dueUs = simMicros();
+    uint8_t i;
+    for (i = 0; i < count; i++)
+    {
+        uint8_t areq[SRSP_HEADER_SIZE + 1];
+        simHeader(areq, ZDO_STATE_CHANGE_IND, 1);
+        areq[3] = states[i];
+        dueUs += simConfig.airLatencyUs;
+        simQueueAreq(areq, dueUs);
+    }
+    deviceState = states[count - 1];
+}
+
+/** Queues the ZDO_IEEE_ADDR_RSP or ZDO_NWK_ADDR_RSP for a node, unless the request or response is lost */
+static void simAddressResponse(uint16_t command, uint16_t shortAddress)
+{
+    if ((shortAddress == SIM_SHORT_ADDRESS_NONE) || (shortAddress >= SIM_MAX_NODES) || simIsLost())
+        return;                                             //no response; request times out
+    uint8_t areq[SRSP_HEADER_SIZE + 13];
+    simHeader(areq, command, 13);
+    areq[3] = MODULE_SUCCESS;
+    simIeee(shortAddress, areq + 4);
+    areq[12] = LSB(shortAddress);
+    areq[13] = MSB(shortAddress);
+    areq[14] = 0;                                           //start index
+    areq[15] = 0;                                           //number of associated devices
+    simQueueAreq(areq, simMicros() + (2 * simAirTimeUs(0)));
+}
+
+static uint8_t simGetDeviceInfo(const uint8_t* request, uint8_t* srsp)
+{
+    uint8_t onNetwork = ((deviceState == DEV_ZB_COORD) || (deviceState == DEV_ROUTER) || (deviceState == DEV_END_DEVICE));
+    uint16_t shortAddress = onNetwork ? simConfig.node : SIM_SHORT_ADDRESS_NONE;
+    srsp[0] = request[3];
+    memset(srsp + 1, 0, 8);
+    switch (request[3])
+    {
+    case DIP_STATE:                 srsp[1] = deviceState; break;
+    case DIP_MAC_ADDRESS:           simIeee(simConfig.node, srsp + 1); break;
+    case DIP_SHORT_ADDRESS:         srsp[1] = LSB(shortAddress); srsp[2] = MSB(shortAddress); break;
+    case DIP_PARENT_SHORT_ADDRESS:  break;                  //the coordinator
+    case DIP_PARENT_MAC_ADDRESS:    simIeee(0, srsp + 1); break;
+    case DIP_CHANNEL:               srsp[1] = simChannel(); break;
+    case DIP_PANID:                 srsp[1] = LSB(simPanId()); srsp[2] = MSB(simPanId()); break;
+    case DIP_EXTENDED_PANID:        simIeee(0, srsp + 1); break;
+    }
+    return 9;
+}
+
+static uint8_t simUtilGetDeviceInfo(uint8_t* srsp)
+{
+    uint8_t onNetwork = ((deviceState == DEV_ZB_COORD) || (deviceState == DEV_ROUTER) || (deviceState == DEV_END_DEVICE));
+    uint16_t shortAddress = onNetwork ? simConfig.node : SIM_SHORT_ADDRESS_NONE;
+    srsp[0] = SRSP_STATUS_SUCCESS;
+    simIeee(simConfig.node, srsp + 1);
+    srsp[9] = LSB(shortAddress);
+    srsp[10] = MSB(shortAddress);
+    srsp[11] = simLogicalType();
+    srsp[12] = deviceState;
+    srsp[13] = 0;                                           //no associated devices
+    return 14;
+}
+
+static uint8_t simWriteConfiguration(const uint8_t* request, uint8_t* srsp)
+{
+    uint8_t length = request[4];
+    struct simConfigurationItem* item = simFindConfigurationItem(request[3]);
+    if (item == 0)
+        item = simFindConfigurationItem(0);
+    if ((item == 0) || (length > SIM_CONFIGURATION_ITEM_LENGTH))
+    {
+        srsp[0] = SIM_STATUS_NV_OPER_FAILED;
+        return 1;
+    }
+    item->id = request[3];
+    item->length = length;
+    memcpy(item->value, request + 5, length);
+    srsp[0] = MODULE_SUCCESS;
+    return 1;
+}
+
+/** Writes the value that a configuration item has if it was never written.
+@return the length of the item */
+static uint8_t simDefaultConfiguration(uint8_t id, uint8_t* value)
+{
+    memset(value, 0, SIM_CONFIGURATION_ITEM_LENGTH);
+    switch (id)
+    {
+    case ZCD_NV_USERDESC:           return ZCD_NV_USERDESC_LEN;
+    case ZCD_NV_CHANLIST:           value[1] = 0x08; return ZCD_NV_CHANLIST_LEN;     //channel 11
+    case ZCD_NV_PANID:              value[0] = 0xFF; value[1] = 0xFF; return ZCD_NV_PANID_LEN;
+    case ZCD_NV_LOGICAL_TYPE:       value[0] = simLogicalType(); return ZCD_NV_LOGICAL_TYPE_LEN;
+    case ZCD_NV_POLL_RATE:          value[0] = LSB(1000); value[1] = MSB(1000); return ZCD_NV_POLL_RATE_LEN;
+    case ZCD_NV_QUEUED_POLL_RATE:   value[0] = 100; return ZCD_NV_QUEUED_POLL_RATE_LEN;
+    case ZCD_NV_RESPONSE_POLL_RATE: value[0] = 100; return ZCD_NV_RESPONSE_POLL_RATE_LEN;
+    case ZCD_NV_PRECFGKEY:          return ZCD_NV_PRECFGKEY_LEN;
+    case ZCD_NV_SECURITY_MODE:      value[0] = 1; return ZCD_NV_SECURITY_MODE_LEN;
+    default:                        return 1;
+    }
+}
+
+static uint8_t simReadConfiguration(const uint8_t* request, uint8_t* srsp)
+{
+    struct simConfigurationItem* item = simFindConfigurationItem(request[3]);
+    srsp[0] = MODULE_SUCCESS;
+    srsp[1] = request[3];
+    if (item == 0)
+    {
+        srsp[2] = simDefaultConfiguration(request[3], srsp + 3);
+        return 3 + srsp[2];
+    }
+    srsp[2] = item->length;
+    memcpy(srsp + 3, item->value, item->length);
+    return 3 + item->length;
+}
+
+/** Only the user items, IDs 0x0F01 to 0x0F09, are simulated */
+static uint8_t simNvRead(const uint8_t* request, uint8_t* srsp)
+{
+    uint8_t item = request[3];
+    uint8_t offset = request[5];
+    if ((item > MAX_NV_ITEM) || (request[4] != 0x0F) || (offset > getNvItemSize(item)))
+    {
+        srsp[0] = SIM_STATUS_NV_OPER_FAILED;
+        srsp[1] = 0;
+        return 2;
+    }
+    srsp[0] = MODULE_SUCCESS;
+    srsp[1] = getNvItemSize(item) - offset;
+    memcpy(srsp + 2, nvItems[item] + offset, srsp[1]);
+    return 2 + srsp[1];
+}
+
+static uint8_t simNvWrite(const uint8_t* request, uint8_t* srsp)
+{
+    uint8_t item = request[3];
+    uint8_t offset = request[5];
+    uint8_t length = request[6];
+    if ((item > MAX_NV_ITEM) || (request[4] != 0x0F) || ((offset + length) > getNvItemSize(item)))
+    {
+        srsp[0] = SIM_STATUS_NV_OPER_FAILED;
+        return 1;
+    }
+    memcpy(nvItems[item] + offset, request + 7, length);
+    srsp[0] = MODULE_SUCCESS;
+    return 1;
+}
+
+static uint8_t simAddGroup(const uint8_t* request, uint8_t* srsp)
+{
+    uint16_t groupId = CONVERT_TO_INT(request[4], request[5]);
+    srsp[0] = MODULE_SUCCESS;
+    if (simFindGroup(request[3], groupId) != 0)
+        return 1;
+    uint8_t i;
+    for (i = 0; i < SIM_MAX_GROUPS; i++)
+    {
+        if (simGroups[i].endpoint == 0)
+        {
+            simGroups[i].endpoint = request[3];
+            simGroups[i].groupId = groupId;
+            return 1;
+        }
+    }
+    srsp[0] = SIM_STATUS_FAILURE;                           //group table is full
+    return 1;
+}
+
+static uint8_t simRemoveGroup(const uint8_t* request, uint8_t* srsp)
+{
+    struct simGroup* group = simFindGroup(request[3], CONVERT_TO_INT(request[4], request[5]));
+    if (group == 0)
+    {
+        srsp[0] = SIM_STATUS_FAILURE;
+        return 1;
+    }
+    group->endpoint = 0;
+    srsp[0] = MODULE_SUCCESS;
+    return 1;
+}
+
+/** Answers a SREQ like the Module would. 
+@param request the SREQ
+@param srsp where to write the SRSP */
+static void simHandleSreq(const uint8_t* request, uint8_t* srsp)
+{
+    uint16_t command = CONVERT_TO_INT(request[SRSP_CMD_LSB_FIELD], request[SRSP_CMD_MSB_FIELD]);
+    uint8_t* payload = srsp + SRSP_PAYLOAD_START;
+    uint8_t length = 1;
+    payload[0] = MODULE_SUCCESS;
+    simStatistics.sreqs++;
+    
+    switch (command)
+    {
+    case SYS_VERSION:
+        payload[0] = 2;                                     //transport revision
+        payload[1] = SIM_PRODUCT_ID;
+        payload[2] = 2;                                     //firmware 2.5.1
+        payload[3] = 5;
+        payload[4] = 1;
+        length = 5;
+        break;
+    case SYS_RANDOM:
+        payload[0] = (uint8_t) rand_r(&simRandomSeed);
+        payload[1] = (uint8_t) rand_r(&simRandomSeed);
+        length = 2;
+        break;
+    case SYS_GPIO:
+        payload[0] = 0;                                     //GPIO_READ: DIP switches select North America
+        break;
+    case SYS_SET_TX_POWER:
+        payload[0] = request[3];
+        break;
+    case SYS_NV_READ:               length = simNvRead(request, payload); break;
+    case SYS_NV_WRITE:              length = simNvWrite(request, payload); break;
+    case ZB_WRITE_CONFIGURATION:    length = simWriteConfiguration(request, payload); break;
+    case ZB_READ_CONFIGURATION:     length = simReadConfiguration(request, payload); break;
+    case ZB_GET_DEVICE_INFO:        length = simGetDeviceInfo(request, payload); break;
+    case UTIL_GET_DEVICE_INFO:      length = simUtilGetDeviceInfo(payload); break;
+    case AF_DATA_REQUEST:           length = simAfDataRequest(request, payload); break;
+    case AF_DATA_REQUEST_EXT:       length = simAfDataRequestExt(request, payload); break;
+    case AF_DATA_STORE:             length = simAfDataStore(request, payload); break;
+    case AF_DATA_RETRIEVE:          length = simAfDataRetrieve(request, payload); break;
+    case ZDO_EXT_ADD_GROUP:         length = simAddGroup(request, payload); break;
+    case ZDO_EXT_REMOVE_GROUP:      length = simRemoveGroup(request, payload); break;
+    case ZDO_STARTUP_FROM_APP:
+        simStartNetwork();
+        break;
+    case ZDO_IEEE_ADDR_REQ:
+        simAddressResponse(ZDO_IEEE_ADDR_RSP, CONVERT_TO_INT(request[3], request[4]));
+        break;
+    case ZDO_NWK_ADDR_REQ:
+        simAddressResponse(ZDO_NWK_ADDR_RSP, simNodeForIeee(request + 3));
+        break;
+    default:                                                //AF_REGISTER etc.
+        break;
+    }
+    simHeader(srsp, command + (SRSP_OFFSET << 8), length);
+}
+
+//
+//  PHY interface
+//
+/** Initializes the simulated Module with the settings from the environment, see the file comment. */
+void zm_phy_init()
+{
+    struct simConfiguration config;
+    const char* value;
+    config.node = ((value = getenv("ZM_SIM_NODE")) != 0) ? atoi(value) : 0;
+    config.networkPort = ((value = getenv("ZM_SIM_PORT")) != 0) ? atoi(value) : SIM_DEFAULT_NETWORK_PORT;
+    config.srspLatencyUs = ((value = getenv("ZM_SIM_SRSP_LATENCY_US")) != 0) ? atol(value) : 1000;
+    config.airLatencyUs = ((value = getenv("ZM_SIM_AIR_LATENCY_US")) != 0) ? atol(value) : 5000;
+    config.airByteTimeUs = ((value = getenv("ZM_SIM_AIR_BYTE_US")) != 0) ? atol(value) : 32;
+    config.lossPercent = ((value = getenv("ZM_SIM_LOSS")) != 0) ? atoi(value) : 0;
+    phySimConfigure(&config);
+}
+
+/** Changes the settings of the simulated Module. If the node or port changed then the node leaves the
+virtual network and joins again with the new settings.
+@param config the new settings */
+void phySimConfigure(const struct simConfiguration* config)
+{
+    uint8_t reopen = ((simSocket < 0) || (config->node != simConfig.node) || (config->networkPort != simConfig.networkPort));
+    simConfig = *config;
+    if (simConfig.node >= SIM_MAX_NODES)
+        simConfig.node = SIM_MAX_NODES - 1;
+    if (simConfig.lossPercent > 100)
+        simConfig.lossPercent = 100;
+    simRandomSeed = simConfig.node + 1;
+    if (reopen)
+        simOpenSocket();
+}
+
+/** @return the current settings of the simulated Module */
+const struct simConfiguration* phySimConfiguration()
+{
+    return &simConfig;
+}
+
+/** Resets the simulated Module, as if its reset line had been toggled, and writes the SYS_RESET_IND 
+into frame. */
+static void simReset(uint8_t* frame)
+{
+    areqCount = 0;
+    deviceState = DEV_HOLD;
+    memset(storedMessages, 0, sizeof(storedMessages));
+    simPollNetwork();                                       //messages to the old session are lost
+    areqCount = 0;
+    
+    simHeader(frame, SYS_RESET_IND, 6);
+    frame[3] = 2;                                           //reason: external
+    frame[4] = 2;                                           //transport revision
+    frame[5] = SIM_PRODUCT_ID;
+    frame[6] = 2;                                           //firmware 2.5
+    frame[7] = 5;
+    frame[8] = 0;                                           //hardware revision
+}
+
+/** Resets the simulated Module. Called by moduleReset().
+@post zmBuf contains the SYS_RESET_IND. */
+moduleResult_t phySimReset()
+{
+    simReset(zmBuf);
+    return MODULE_SUCCESS;
+}
+
+/** Resets the simulated Module without returning the SYS_RESET_IND; it is received like any other 
+AREQ, as from a real Module. Called by moduleResetStart(). */
+void phySimResetAsync()
+{
+    uint8_t indication[SRSP_HEADER_SIZE + 6];
+    simReset(indication);
+    simQueueAreq(indication, simMicros());
+}
+
+/** @return true (1) if the simulated Module has an AREQ whose time has come; parked messages are not 
+included. */
+uint8_t phyHasMessageWaiting()
+{
+    simPollNetwork();
+    return (simDueAreq() >= 0);
+}
+
+/** @return true (1) if there is a parked message or the simulated Module has a message, or 0 otherwise. */
+uint8_t moduleHasMessageWaiting()
+{
+    return (framesParked() || phyHasMessageWaiting());
+}
+
+/** 
+Gets the earliest AREQ that is due from the simulated Module. Parked messages are not returned.
+@pre  phyHasMessageWaiting() is true
+@post zmBuf holds the message
+*/
+moduleResult_t phyGetMessage()
+{
+    simPollNetwork();
+    int8_t due = simDueAreq();
+    if (due < 0)
+        return ZM_PHY_OTHER_ERROR;
+    memcpy(zmBuf, areqQueue[due].frame, areqQueue[due].frame[0] + SRSP_HEADER_SIZE);
+    areqCount--;
+    if (due != areqCount)
+        areqQueue[due] = areqQueue[areqCount];
+    simStatistics.areqs++;
+    LATENCY_AREQ_RECEIVED(zmBuf);
+    deviceInfoAreqReceived(zmBuf);
+    return MODULE_SUCCESS;
+}
+
+/** 
+Get the next message: the oldest parked message if there is one, else the earliest AREQ from the 
+simulated Module.
+@pre  moduleHasMessageWaiting() is true
+@post zmBuf holds the message
+*/
+moduleResult_t getMessage()
+{
+    if (frameUnpark())
+        return MODULE_SUCCESS;
+    return phyGetMessage();
+}
+
+/** Sends a message to the simulated Module and puts the SRSP into zmBuf after srspLatencyUs.
+@param request the message to send; zmBuf or another frame */
+static moduleResult_t sendRequest(const uint8_t* request)
+{
+    static uint8_t srsp[ZIGBEE_MODULE_BUFFER_SIZE];
+    LATENCY_SREQ_SENT(request);
+    simPollNetwork();
+    simHandleSreq(request, srsp);
+    if (simConfig.srspLatencyUs > 0)
+        usleep(simConfig.srspLatencyUs);
+    memcpy(zmBuf, srsp, srsp[0] + SRSP_HEADER_SIZE);
+    LATENCY_SRSP_RECEIVED(zmBuf);
+    return MODULE_SUCCESS;
+}
+
+/** 
+Public method to send messages to the Module. This will send one message and then receive the 
+Synchronous Response (SRSP) message from the Module to indicate the command was received.
+@pre zmBuf contains a properly formatted message
+@post buffer zmBuf contains the response (if any) from the Module. 
+*/
+moduleResult_t sendMessage()
+{
+    return sendRequest(zmBuf);
+}
+
+/** Sends a message that was prepared in a frame from frameAlloc(), for example with afBuildData(). 
+@param frame the frame holding a properly formatted message
+@post buffer zmBuf contains the response (if any) from the Module. 
+@return MODULE_SUCCESS, INVALID_PARAMETER if frame is not valid, or an error from sendMessage()
+*/
+moduleResult_t sendFrame(frameHandle_t frame)
+{
+    uint8_t* request = frameData(frame);
+    if (request == 0)
+        return INVALID_PARAMETER;
+    return sendRequest(request);
+}
+
+#ifdef ZM_WAIT_FOR_EVENT
+/** 
+Sleeps until the simulated Module has a message or the wait timer expires, waking when a packet 
+arrives from another node or the next AREQ is due.
+@pre the wait timer was started with halWaitTimerStart()
+@return true (1) if there is a message, or 0 if the wait timer expired.
+*/
+uint8_t phyWaitForMessage()
+{
+    while (!phyHasMessageWaiting() && !halWaitTimerExpired())
+    {
+        uint32_t waitUs = simTimeToNextAreqUs();
+        struct pollfd fd = {simSocket, POLLIN, 0};
+        poll(&fd, (simSocket < 0) ? 0 : 1, (waitUs < 1000) ? 1 : (waitUs / 1000));
+    }
+    return phyHasMessageWaiting();
+}
+#endif
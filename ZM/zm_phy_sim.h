@@ -0,0 +1,107 @@
+/**
+*  @file zm_phy_sim.h
+*
+*  @brief  public methods for zm_phy_sim.c
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef ZM_PHY_SIM_H
+#define ZM_PHY_SIM_H
+#include <stdint.h>
+#include "module_errors.h"
+
+moduleResult_t sendMessage();
+moduleResult_t getMessage();
+#define MODULE_HAS_MESSAGE_WAITING()  (moduleHasMessageWaiting())
+uint8_t moduleHasMessageWaiting();
+void zm_phy_init();
+moduleResult_t phySimReset();
+void phySimResetAsync();
+
+//Only the simulated Module, not the parked messages in the frame pool:
+moduleResult_t phyGetMessage();
+uint8_t phyHasMessageWaiting();
+#ifdef ZM_WAIT_FOR_EVENT
+uint8_t phyWaitForMessage();
+#endif
+
+#define ZIGBEE_MODULE_BUFFER_SIZE  0xFF
+
+#define SRSP_BUFFER_SIZE        20
+#define SRSP_HEADER_SIZE        3
+
+//SRSP MSB is 0x40 greater than SREQ MSB
+#define SRSP_OFFSET             0x40
+#define SRSP_PAYLOAD_START      3
+#define SRSP_LENGTH_FIELD       0  
+#define SRSP_CMD_LSB_FIELD      2
+#define SRSP_CMD_MSB_FIELD      1
+
+/** Settings of the simulated Module. Read from the environment by zm_phy_init(), see zm_phy_sim.c, 
+and may be changed afterwards with phySimConfigure(). */
+struct simConfiguration
+{
+    /** Which node of the virtual network this is, 0 .. SIM_MAX_NODES-1. Node 0 is the coordinator. 
+    The short address of a node is its node number. */
+    uint8_t node;
+    /** UDP port of node 0 on the loopback interface; node n uses networkPort + n */
+    uint16_t networkPort;
+    /** Time from a SREQ to its SRSP, in microseconds */
+    uint32_t srspLatencyUs;
+    /** Time for a message to cross the network, in microseconds, not including airByteTimeUs */
+    uint32_t airLatencyUs;
+    /** Time on air per byte of payload, in microseconds. 32 is 250kbps. */
+    uint32_t airByteTimeUs;
+    /** Percentage of messages over the network that are lost, 0 .. 100 */
+    uint8_t lossPercent;
+};
+
+void phySimConfigure(const struct simConfiguration* config);
+const struct simConfiguration* phySimConfiguration();
+
+/** Counters, for benchmarks */
+struct simStatistics
+{
+    uint32_t sreqs;
+    uint32_t areqs;
+    uint32_t messagesSent;
+    uint32_t messagesLost;
+    uint32_t messagesReceived;
+    uint32_t areqsDropped;
+};
+extern struct simStatistics simStatistics;
+
+/** Number of nodes that can share one virtual network */
+#define SIM_MAX_NODES                   16
+
+/** Default UDP port of node 0 if ZM_SIM_PORT is not set */
+#define SIM_DEFAULT_NETWORK_PORT        17540
+
+/** Number of AREQs that the simulated Module can hold for the application */
+#ifndef SIM_AREQ_QUEUE_SIZE
+#define SIM_AREQ_QUEUE_SIZE             16
+#endif
+
+#endif
@@ -10,12 +10,22 @@
 * In the defined symbols box, add:
 * ZM_PHY_SPI_VERBOSE
 *
-* Normally the module is quite fast in responding to a SREQ and there is not sufficient time on a 
-* slower processor (e.g. < 25MHz) to configure a timeout to detect a missing response. If using a 
-* fast processor then define FAST_PROCESSOR. This does several things:
-*   1. sendSreq() will timeout if a response was not received in time. 
-*   2. the amount of time spent in each part of the SREQ process is available in variables 
-*       timeFromChipSelectToSrdyLow and timeWaitingForSrsp.
+* sendSreq() times out with a deadline (see zm_deadline.c) if the Module doesn't respond within 
+* SPI_SRDY_LOW_TIMEOUT_US or SPI_SRSP_TIMEOUT_US, which may be defined per-project to fail faster. 
+* The time spent in each part of the SREQ process is available in variables 
+* timeFromChipSelectToSrdyLow and timeWaitingForSrsp.
+*
+* Messages are sent from, and received into, the working frame (zmBuf) of the frame pool in 
+* zm_frame.c. sendFrame() sends a message prepared in another frame without overwriting it. 
+* getMessage() first returns any messages that were parked while waiting for another message, e.g. 
+* in waitForMessage(), and then polls the Module.
+*
+* To free the processor while a frame is in flight, define ZM_PHY_SPI_ASYNC. This adds 
+* sendMessageAsync() and getMessageAsync(), which return immediately and run the SREQ/SRSP exchange 
+* from the SRDY interrupt and the SPI DMA/transfer complete interrupt, calling a callback when done. 
+* The hal file must provide halSpiStartTransfer(), halSpiAbortTransfer(), halSrdyInterruptEnable(), 
+* halSrdyInterruptDisable() and the spiTransferCompleteIsr function pointer. The synchronous methods 
+* are still available but must not be used while an asynchronous transaction is in progress.
 *
 * $Rev: 1796 $
 * $Author: dsmith $
@@ -47,22 +57,16 @@
 
 #include "../HAL/hal.h"
 #include "zm_phy_spi.h"
+#include "zm_frame.h"
+#include "zm_latency.h"
+#include "zm_deadline.h"
+#include "module.h"
 #include "module_errors.h"
 #include <stdint.h>
 
-
-/** This buffer will hold the transmitted messages and received SRSP Payload after sendMessage() was 
-called. If fragmentation support is not required then this can be smaller, e.g. 100B.*/
-uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
-
-#ifdef FAST_PROCESSOR           //used to report the amount of time it takes for the Module to respond over SPI
+/** Time it took for the Module to respond over SPI in the last sendSreq(), in microseconds */
 uint32_t timeFromChipSelectToSrdyLow = 0;
 uint32_t timeWaitingForSrsp = 0;
-//these will be used in sendSreq() for the timeouts:
-#define CHIP_SELECT_TO_SRDY_LOW_TIMEOUT (TICKS_PER_MS * 125)    
-#define WAIT_FOR_SRSP_TIMEOUT (TICKS_PER_MS * 125)              //typically takes less than 100mSec
-
-#endif
 
 /* Initializes the module PHY interface.
 */
@@ -72,9 +76,17 @@ void zm_phy_init()
 }
 
 /** Whether the module has a message waiting to be retrieved.
- @return true (1) if there is a complete message ready for processing, or 0 otherwise.
+ @return true (1) if there is a parked message or the Module has a message, or 0 otherwise.
 */
 uint8_t moduleHasMessageWaiting()
+{
+  return (framesParked() || SRDY_IS_LOW());
+}
+
+/** Whether the Module itself has a message waiting; parked messages are not included.
+ @return true (1) if SRDY is low, or 0 otherwise.
+*/
+uint8_t phyHasMessageWaiting()
 {
   return (SRDY_IS_LOW());
 }
@@ -84,38 +96,48 @@ Sends a Module Synchronous Request (SREQ) message and retrieves the response. A
 the Module that is immediately followed by a Synchronous Response (SRSP) message from the Module. As 
 opposed to an Asynchronous Request (AREQ) message, which does not have a SRSP. This is a private 
 method that gets wrapped by sendMessage() and spiPoll().
+@param request the message to send. May be zmBuf. Not modified, since the bytes received while it is
+sent are discarded.
 @pre Module has been initialized
-@pre zmBuf contains a properly formatted message. No validation is done.
+@pre request contains a properly formatted message. No validation is done.
 @post received data is written to zmBuf
-@return if FAST_PROCESSOR is defined then MODULE_SUCCESS, else an error code. If FAST_PROCESSOR is not defined, then MODULE_SUCCESS.
+@return MODULE_SUCCESS, ZM_PHY_CHIP_SELECT_TIMEOUT if SRDY didn't go low within 
+SPI_SRDY_LOW_TIMEOUT_US, or ZM_PHY_SRSP_TIMEOUT if the SRSP wasn't ready within SPI_SRSP_TIMEOUT_US.
 @note if running on a fast processor then you may need to modify the code to ensure that the module keeps up. See below
 */
-moduleResult_t sendSreq()
+static moduleResult_t sendSreq(const uint8_t* request)
 {
-#ifdef FAST_PROCESSOR                           //NOTE: only enable if using a processor with sufficient speed (25MHz+)
-  uint32_t timeLeft1 = CHIP_SELECT_TO_SRDY_LOW_TIMEOUT;
-  uint32_t timeLeft2 = WAIT_FOR_SRSP_TIMEOUT;
+  struct deadline d;
   
   SPI_SS_SET();                               // Assert SS
-  while (SRDY_IS_HIGH() && (timeLeft1 != 0))  //wait until SRDY goes low
-    timeLeft1--;
-  if (timeLeft1 == 0)                         //SRDY did not go low in time, so return an error
-    return ZM_PHY_CHIP_SELECT_TIMEOUT;
-  timeFromChipSelectToSrdyLow = (CHIP_SELECT_TO_SRDY_LOW_TIMEOUT - timeLeft1);
+  deadlineStart(&d, SPI_SRDY_LOW_TIMEOUT_US);
+  while (SRDY_IS_HIGH())                      //wait until SRDY goes low
+  {
+    if (deadlineExpired(&d))                  //SRDY did not go low in time, so return an error
+    {
+      SPI_SS_CLEAR();
+      return ZM_PHY_CHIP_SELECT_TIMEOUT;
+    }
+  }
+  timeFromChipSelectToSrdyLow = deadlineElapsedUs(&d);
   
-  spiWrite(zmBuf, (*zmBuf + 3));              // *bytes (first byte) is length after the first 3 bytes, all frames have at least the first 3 bytes
+  spiTransmit(request, (*request + 3));       // *bytes (first byte) is length after the first 3 bytes, all frames have at least the first 3 bytes
   *zmBuf = 0; *(zmBuf+1) = 0; *(zmBuf+2) = 0; //poll message is 0,0,0
   //NOTE: MRDY must remain asserted here, but can de-assert SS if the two signals are separate
   
   /* Now: Data was sent, so we wait for Synchronous Response (SRSP) to be received.
   This will be indicated by SRDY transitioning to high */
+  deadlineStart(&d, SPI_SRSP_TIMEOUT_US);
+  while (SRDY_IS_LOW())                       //wait for data
+  {
+    if (deadlineExpired(&d))
+    {
+      SPI_SS_CLEAR();
+      return ZM_PHY_SRSP_TIMEOUT;
+    }
+  }
+  timeWaitingForSrsp = deadlineElapsedUs(&d);
   
-  while (SRDY_IS_LOW() && (timeLeft2 != 0))    //wait for data
-    timeLeft2--;
-  if (timeLeft2 == 0)
-    return ZM_PHY_SRSP_TIMEOUT;
-  
-  timeWaitingForSrsp = (WAIT_FOR_SRSP_TIMEOUT - timeLeft2);
   //NOTE: if SS & MRDY are separate signals then can re-assert SS here.
   /*
   NOTE: if using a very fast processor then you may need to write the below two lines of code to:
@@ -129,57 +151,58 @@ moduleResult_t sendSreq()
   /* NOTE: if on a fast processor, may need a little delay here */
   if (*zmBuf > 0)                             // *bytes (first byte) contains number of bytes to receive
     spiWrite(zmBuf+3, *zmBuf);              //write-to-read: read data into buffer
-  SPI_SS_CLEAR();
-  return 0;
-#else                                           // In a slow processor there's not enough time to set up the timeout so there will be errors
-  SPI_SS_SET();   
-  while (SRDY_IS_HIGH()) ;                    //wait until SRDY goes low
-  spiWrite(zmBuf, (*zmBuf + 3));              // *bytes (first byte) is length after the first 3 bytes, all frames have at least the first 3 bytes
-  *zmBuf = 0; *(zmBuf+1) = 0; *(zmBuf+2) = 0; //poll message is 0,0,0
-  //NOTE: MRDY must remain asserted here, but can de-assert SS if the two signals are separate
-  
-  //Now: Data was sent, wait for Synchronous Response (SRSP)
-  while (SRDY_IS_LOW()) ;                     //wait for data
-  //NOTE: if SS & MRDY are separate signals then can re-assert SS here.
-  spiWrite(zmBuf, 3);
-  if (*zmBuf > 0)                             // *bytes (first byte) contains number of bytes to receive
-    spiWrite(zmBuf+3, *zmBuf);              //write-to-read: read data into buffer    
   SPI_SS_CLEAR();                             // re-assert MRDY and SS
-  return MODULE_SUCCESS;  
-#endif
+  return MODULE_SUCCESS;
 }
 
 /**
 Polls the Module for data. This is used to receive data from the Module, for example when a message 
-has arrived. This will be initiated by detecting SRDY going low. 
+has arrived. This will be initiated by detecting SRDY going low. Parked messages are not returned.
 @pre Module has been initialized.
 @pre SRDY has gone low
 @post received data is written to zmBuf
+*/
+moduleResult_t phyGetMessage()
+{
+  *zmBuf = 0; *(zmBuf+1) = 0; *(zmBuf+2) = 0;  //poll message is 0,0,0 
+  moduleResult_t result = sendSreq(zmBuf);
+  if (result == MODULE_SUCCESS)
+  {
+    LATENCY_AREQ_RECEIVED(zmBuf);
+    deviceInfoAreqReceived(zmBuf);
+  }
+  return result;
+}
+
+/**
+Gets the next message: the oldest parked message if there is one, else polls the Module. 
+@pre moduleHasMessageWaiting() is true
+@post the message is in zmBuf
 @note this method not required to be implemented when using UART interface.
 */
 moduleResult_t getMessage()
 {
-  *zmBuf = 0; *(zmBuf+1) = 0; *(zmBuf+2) = 0;  //poll message is 0,0,0 
-  return(sendSreq());
+  if (frameUnpark())
+    return MODULE_SUCCESS;
+  return phyGetMessage();
 }
 
-/** Public method to send messages to the Module. This will send one message and then receive the 
-Synchronous Response (SRSP) message from the Module to indicate the command was received.
-@pre zmBuf contains a properly formatted message
-@pre Module has been initialized
-@post buffer zmBuf contains the response (if any) from the Module. 
+/** Sends a message to the Module and receives the SRSP into zmBuf. Private method that gets wrapped 
+by sendMessage() and sendFrame().
+@param request the message to send; zmBuf or another frame
 */
-moduleResult_t sendMessage()
+static moduleResult_t sendRequest(const uint8_t* request)
 {
 #ifdef ZM_PHY_SPI_VERBOSE    
   printf("Tx: ");
-  printHexBytes(zmBuf, zmBuf[0] + 3);
+  printHexBytes((uint8_t*) request, request[0] + 3);
 #endif    
   
-  uint8_t expectedSrspCmdMsb = zmBuf[1] + SRSP_OFFSET;    //store these so we can compare with what is returned
-  uint8_t expectedSrspCmdLsb = zmBuf[2];
+  uint8_t expectedSrspCmdMsb = request[1] + SRSP_OFFSET;  //store these so we can compare with what is returned
+  uint8_t expectedSrspCmdLsb = request[2];
   
-  moduleResult_t result = sendSreq();                     //send message, buffer now holds received data
+  LATENCY_SREQ_SENT(request);
+  moduleResult_t result = sendSreq(request);              //send message, zmBuf now holds received data
   
   if (result != MODULE_SUCCESS)                           //ERROR - sendSreq() timeout
   {
@@ -193,6 +216,7 @@ moduleResult_t sendMessage()
   For example, if the SREQ is 0x2605 then the corresponding SRSP is 0x6605 */
   if ((zmBuf[SRSP_CMD_MSB_FIELD] == expectedSrspCmdMsb) && (zmBuf[SRSP_CMD_LSB_FIELD] == expectedSrspCmdLsb))    //verify the correct SRSP was received
   {
+    LATENCY_SRSP_RECEIVED(zmBuf);
     return MODULE_SUCCESS;
   } else {
 #ifdef ZM_PHY_SPI_VERBOSE_ERRORS    
@@ -202,3 +226,305 @@ moduleResult_t sendMessage()
   }
 }
 
+/** Public method to send messages to the Module. This will send one message and then receive the 
+Synchronous Response (SRSP) message from the Module to indicate the command was received.
+@pre zmBuf contains a properly formatted message
+@pre Module has been initialized
+@post buffer zmBuf contains the response (if any) from the Module. 
+*/
+moduleResult_t sendMessage()
+{
+  return sendRequest(zmBuf);
+}
+
+/** Sends a message that was prepared in a frame from frameAlloc(), for example with afBuildData(). 
+The frame is not modified, so the same message can be sent again without rebuilding it.
+@param frame the frame holding a properly formatted message
+@pre Module has been initialized
+@post buffer zmBuf contains the response (if any) from the Module. 
+@return MODULE_SUCCESS, INVALID_PARAMETER if frame is not valid, or an error from sendMessage()
+*/
+moduleResult_t sendFrame(frameHandle_t frame)
+{
+  uint8_t* request = frameData(frame);
+  if (request == 0)
+    return INVALID_PARAMETER;
+  return sendRequest(request);
+}
+
+
+#ifdef ZM_PHY_SPI_ASYNC
+//
+//  ASYNCHRONOUS TRANSPORT
+//
+/* Instead of busy-waiting on SRDY and moving every byte through spiWrite(), the SREQ/SRSP exchange
+is a state machine that is advanced by two events from the hal file:
+    - srdyIsr(), when SRDY reaches the level that was armed with halSrdyInterruptEnable()
+    - spiTransferCompleteIsr(), when a transfer started with halSpiStartTransfer() has finished
+The hal file moves the bytes with DMA (or the SPI interrupt if the processor has no DMA) so the 
+processor is free to do other work, or sleep, while the frame is in flight.
+
+    IDLE --> WAIT_SRDY_LOW --> TX --> WAIT_SRDY_HIGH --> RX_HEADER --> RX_PAYLOAD --> IDLE
+*/
+
+/** Function pointer (in hal file) called when SRDY changes to the armed level */
+extern void (*srdyIsr)(void);
+
+/** Function pointer (in hal file) called when halSpiStartTransfer() has finished */
+extern void (*spiTransferCompleteIsr)(void);
+
+static volatile uint8_t spiState = SPI_STATE_IDLE;
+static spiTransactionCallback_t spiCallback = 0;
+
+/** Application's srdyIsr; restored when the transaction has finished */
+static void (*applicationSrdyIsr)(void) = 0;
+
+/** If set then the SRSP command is compared with the SREQ command, as in sendMessage() */
+static uint8_t verifySrsp = 0;
+static uint8_t expectedSrspCmdMsb = 0;
+static uint8_t expectedSrspCmdLsb = 0;
+
+/** Milliseconds left before the transaction times out; decremented by spiTransactionTick() */
+static volatile uint16_t spiTimeLeftMs = 0;
+
+uint32_t spiTransactionTimeUs = 0;
+#ifdef HAL_GET_MICROS
+static uint32_t spiTransactionStartUs = 0;
+#endif
+
+static void spiAsyncSrdyIsr();
+
+/** Ends the transaction, de-asserts MRDY & SS and reports the result to the callback. */
+static void spiFinish(moduleResult_t result)
+{
+    halSrdyInterruptDisable();
+    SPI_SS_CLEAR();
+    srdyIsr = applicationSrdyIsr;
+    
+    if ((result == MODULE_SUCCESS) && verifySrsp && 
+        ((zmBuf[SRSP_CMD_MSB_FIELD] != expectedSrspCmdMsb) || (zmBuf[SRSP_CMD_LSB_FIELD] != expectedSrspCmdLsb)))
+    {
+#ifdef ZM_PHY_SPI_VERBOSE_ERRORS    
+        printf("ERROR - Wrong SRSP - received %02X-%02X, expected %02X-%02X\r\n", zmBuf[1], zmBuf[2],expectedSrspCmdMsb,expectedSrspCmdLsb);
+#endif
+        result = ZM_PHY_INCORRECT_SRSP;
+    }
+#ifdef HAL_GET_MICROS
+    spiTransactionTimeUs = HAL_GET_MICROS() - spiTransactionStartUs;
+#endif
+    if (result == MODULE_SUCCESS)
+    {
+        if (verifySrsp)
+            LATENCY_SRSP_RECEIVED(zmBuf);
+        else
+        {
+            LATENCY_AREQ_RECEIVED(zmBuf);
+            deviceInfoAreqReceived(zmBuf);
+        }
+    }
+    spiState = SPI_STATE_IDLE;
+    if (spiCallback != 0)
+        spiCallback(result);
+}
+
+/** 
+Arms the SRDY interrupt. SRDY may already be at the desired level before the interrupt was armed, in
+which case there will be no edge, so check the level afterwards.
+@param edge SRDY_EDGE_FALLING or SRDY_EDGE_RISING
+*/
+static void spiArmSrdy(uint8_t edge)
+{
+    halSrdyInterruptEnable(edge);
+    if ((edge == SRDY_EDGE_FALLING) ? SRDY_IS_LOW() : SRDY_IS_HIGH())
+        spiAsyncSrdyIsr();
+}
+
+/** Called when SRDY changes to the armed level. Starts the next transfer of the transaction. */
+static void spiAsyncSrdyIsr()
+{
+    if ((spiState == SPI_STATE_WAIT_SRDY_LOW) && SRDY_IS_LOW())
+    {
+        halSrdyInterruptDisable();
+        spiState = SPI_STATE_TX;
+        halSpiStartTransfer(zmBuf, (*zmBuf + 3));   // *bytes (first byte) is length after the first 3 bytes
+    }
+    else if ((spiState == SPI_STATE_WAIT_SRDY_HIGH) && SRDY_IS_HIGH())
+    {
+        //NOTE: if SS & MRDY are separate signals then can re-assert SS here.
+        halSrdyInterruptDisable();
+        spiState = SPI_STATE_RX_HEADER;
+        halSpiStartTransfer(zmBuf, 3);
+    }
+}
+
+/** Called when a transfer started with halSpiStartTransfer() has finished. */
+static void spiAsyncTransferComplete()
+{
+    switch (spiState)
+    {
+    case SPI_STATE_TX:
+        *zmBuf = 0; *(zmBuf+1) = 0; *(zmBuf+2) = 0; //poll message is 0,0,0
+        //NOTE: MRDY must remain asserted here, but can de-assert SS if the two signals are separate
+        spiState = SPI_STATE_WAIT_SRDY_HIGH;
+        spiArmSrdy(SRDY_EDGE_RISING);
+        break;
+    case SPI_STATE_RX_HEADER:
+        if (*zmBuf == 0)                            // *bytes (first byte) contains number of bytes to receive
+        {
+            spiFinish(MODULE_SUCCESS);
+        } 
+        else if (*zmBuf > (ZIGBEE_MODULE_BUFFER_SIZE - SRSP_HEADER_SIZE))
+        {
+            spiFinish(INVALID_LENGTH);              // would overrun zmBuf
+        } else {
+            spiState = SPI_STATE_RX_PAYLOAD;
+            halSpiStartTransfer(zmBuf+3, *zmBuf);   //write-to-read: read data into buffer
+        }
+        break;
+    case SPI_STATE_RX_PAYLOAD:
+        spiFinish(MODULE_SUCCESS);
+        break;
+    default:                                        // Spurious - no transfer was in progress
+        break;
+    }
+}
+
+/**
+Asynchronous version of sendSreq(). Asserts MRDY & SS and returns immediately; the rest of the 
+transaction is run from the SRDY and SPI transfer complete interrupts.
+@param callback called from interrupt context when the transaction has finished. May be null.
+@pre Module has been initialized
+@pre zmBuf contains a properly formatted message. No validation is done.
+@pre Interrupts are enabled
+@post when callback is called, zmBuf contains the received data
+@return MODULE_SUCCESS if the transaction was started, or ZM_PHY_BUSY if one is already in progress.
+*/
+static moduleResult_t sendSreqAsync(spiTransactionCallback_t callback)
+{
+    HAL_DISABLE_INTERRUPTS();
+    if (spiState != SPI_STATE_IDLE)
+    {
+        HAL_ENABLE_INTERRUPTS();
+        return ZM_PHY_BUSY;
+    }
+    spiCallback = callback;
+    spiTimeLeftMs = SPI_TRANSACTION_TIMEOUT_MS;
+    applicationSrdyIsr = srdyIsr;
+    srdyIsr = &spiAsyncSrdyIsr;
+    spiTransferCompleteIsr = &spiAsyncTransferComplete;
+#ifdef HAL_GET_MICROS
+    spiTransactionStartUs = HAL_GET_MICROS();
+#endif
+    spiState = SPI_STATE_WAIT_SRDY_LOW;
+    SPI_SS_SET();                                   // Assert SS
+    spiArmSrdy(SRDY_EDGE_FALLING);
+    HAL_ENABLE_INTERRUPTS();
+    return MODULE_SUCCESS;
+}
+
+/**
+Asynchronous version of sendMessage(). The SRSP is verified before the callback is called; if it was 
+not the SRSP for this SREQ then the callback is called with ZM_PHY_INCORRECT_SRSP.
+@param callback called from interrupt context when the transaction has finished. May be null.
+@pre zmBuf contains a properly formatted message
+@pre Module has been initialized
+@post when callback is called, zmBuf contains the response (if any) from the Module.
+@return MODULE_SUCCESS if the transaction was started, or ZM_PHY_BUSY if one is already in progress.
+*/
+moduleResult_t sendMessageAsync(spiTransactionCallback_t callback)
+{
+    if (spiState != SPI_STATE_IDLE)
+        return ZM_PHY_BUSY;
+#ifdef ZM_PHY_SPI_VERBOSE    
+    printf("Tx: ");
+    printHexBytes(zmBuf, zmBuf[0] + 3);
+#endif    
+    verifySrsp = 1;
+    expectedSrspCmdMsb = zmBuf[1] + SRSP_OFFSET;    //store these so we can compare with what is returned
+    expectedSrspCmdLsb = zmBuf[2];
+    LATENCY_SREQ_SENT(zmBuf);
+    return sendSreqAsync(callback);
+}
+
+/**
+Asynchronous version of getMessage(). Polls the Module for data.
+@param callback called from interrupt context when the message has been received. May be null.
+@pre SRDY has gone low
+@post when callback is called, zmBuf contains the received message.
+@return MODULE_SUCCESS if the transaction was started, or ZM_PHY_BUSY if one is already in progress.
+*/
+moduleResult_t getMessageAsync(spiTransactionCallback_t callback)
+{
+    if (spiState != SPI_STATE_IDLE)
+        return ZM_PHY_BUSY;
+    verifySrsp = 0;
+    *zmBuf = 0; *(zmBuf+1) = 0; *(zmBuf+2) = 0;     //poll message is 0,0,0 
+    return sendSreqAsync(callback);
+}
+
+/** Whether an asynchronous transaction is in progress.
+@return 1 if a transaction is in progress, else 0. 
+*/
+uint8_t spiTransactionInProgress()
+{
+    return (spiState != SPI_STATE_IDLE);
+}
+
+/**
+Times out a transaction that has stalled, e.g. because the Module never asserted SRDY. Call this 
+periodically, for example from the sysTickIsr.
+@param elapsedMs number of milliseconds since the last call, e.g. SYSTICK_INTERVAL_MS
+@post if the transaction timed out then the callback is called with ZM_PHY_CHIP_SELECT_TIMEOUT if the 
+Module never asserted SRDY, or ZM_PHY_SRSP_TIMEOUT otherwise.
+*/
+void spiTransactionTick(uint16_t elapsedMs)
+{
+    if (spiState == SPI_STATE_IDLE)
+        return;
+    if (spiTimeLeftMs > elapsedMs)
+    {
+        spiTimeLeftMs -= elapsedMs;
+        return;
+    }
+    spiTimeLeftMs = 0;
+    halSpiAbortTransfer();
+    spiFinish((spiState == SPI_STATE_WAIT_SRDY_LOW) ? ZM_PHY_CHIP_SELECT_TIMEOUT : ZM_PHY_SRSP_TIMEOUT);
+}
+#endif
+
+#ifdef ZM_WAIT_FOR_EVENT
+//
+//  EVENT-DRIVEN WAIT
+//
+/** Function pointer (in hal file) called when SRDY changes to the armed level */
+extern void (*srdyIsr)(void);
+
+/** Only wakes up the processor; phyWaitForMessage() reads SRDY itself */
+static void spiWaitSrdyIsr()
+{
+}
+
+/** 
+Sleeps until the Module has a message or the wait timer expires. Instead of polling SRDY every 
+100mSec, the SRDY interrupt wakes up the processor as soon as the Module asserts SRDY, so a blocking 
+wait takes only as long as the Module does.
+@pre the wait timer was started with halWaitTimerStart(); this may be called repeatedly until it 
+expires, e.g. when messages that the caller isn't waiting for are received.
+@return true (1) if the Module has a message waiting, or 0 if the wait timer expired.
+*/
+uint8_t phyWaitForMessage()
+{
+    void (*applicationSrdyIsr)(void) = srdyIsr;
+    srdyIsr = &spiWaitSrdyIsr;
+    halSrdyInterruptEnable(SRDY_EDGE_FALLING);
+    
+    HAL_DISABLE_INTERRUPTS();
+    while (!phyHasMessageWaiting() && !halWaitTimerExpired())
+        halWaitForEvent();
+    HAL_ENABLE_INTERRUPTS();
+    
+    halSrdyInterruptDisable();
+    srdyIsr = applicationSrdyIsr;
+    return phyHasMessageWaiting();
+}
+#endif
@@ -38,10 +38,17 @@
 
 moduleResult_t sendMessage();
 moduleResult_t getMessage();
-#define MODULE_HAS_MESSAGE_WAITING()  (SRDY_IS_LOW())
+#define MODULE_HAS_MESSAGE_WAITING()  (moduleHasMessageWaiting())
 uint8_t moduleHasMessageWaiting();
 void zm_phy_init();
 
+//Only the Module, not the parked messages in the frame pool:
+moduleResult_t phyGetMessage();
+uint8_t phyHasMessageWaiting();
+#ifdef ZM_WAIT_FOR_EVENT
+uint8_t phyWaitForMessage();
+#endif
+
 #ifdef LAUNCHPAD                        // LaunchPad is RAM limited, so we use a smaller buffer
 #define ZIGBEE_MODULE_BUFFER_SIZE  162         // AF_INCOMING_MSG_EXT is largest: 30B for header + 130B for 
                                         // Fragmentation Demo payload + 2B for UART framing bytes = 162B
@@ -49,6 +56,18 @@ void zm_phy_init();
 #define ZIGBEE_MODULE_BUFFER_SIZE  0xFF        // Allows for all module features, including full fragmentation support
 #endif
 
+/** How long the Module may take to assert SRDY after MRDY, in microseconds */
+#ifndef SPI_SRDY_LOW_TIMEOUT_US
+#define SPI_SRDY_LOW_TIMEOUT_US         125000UL
+#endif
+
+/** How long the Module may take to have the SRSP ready, in microseconds. Most SRSPs are ready in less
+than 20mSec, but ZDO_STARTUP_FROM_APP (zdoStartApplication()) takes about 400mSec, so this is the 
+same as the UART phy allows. */
+#ifndef SPI_SRSP_TIMEOUT_US
+#define SPI_SRSP_TIMEOUT_US             2000000UL
+#endif
+
 #define SRSP_BUFFER_SIZE        20
 #define SRSP_HEADER_SIZE        3
 
@@ -60,4 +79,29 @@ void zm_phy_init();
 #define SRSP_CMD_LSB_FIELD      2
 #define SRSP_CMD_MSB_FIELD      1
 
+#ifdef ZM_PHY_SPI_ASYNC
+/** Function called when an asynchronous SPI transaction has finished. Parameter is the result of
+the transaction: MODULE_SUCCESS, or an error code. Called from interrupt context. */
+typedef void (*spiTransactionCallback_t)(moduleResult_t);
+
+moduleResult_t sendMessageAsync(spiTransactionCallback_t callback);
+moduleResult_t getMessageAsync(spiTransactionCallback_t callback);
+uint8_t spiTransactionInProgress();
+void spiTransactionTick(uint16_t elapsedMs);
+
+/** If the transaction has not completed in this time then it will fail with a timeout error */
+#define SPI_TRANSACTION_TIMEOUT_MS      250
+
+//Transaction states, see sendSreqAsync()
+#define SPI_STATE_IDLE                  0
+#define SPI_STATE_WAIT_SRDY_LOW         1
+#define SPI_STATE_TX                    2
+#define SPI_STATE_WAIT_SRDY_HIGH        3
+#define SPI_STATE_RX_HEADER             4
+#define SPI_STATE_RX_PAYLOAD            5
+
+/** Time taken by the last asynchronous transaction, in microseconds. Only if HAL provides halMicros() */
+extern uint32_t spiTransactionTimeUs;
+#endif
+
 #endif
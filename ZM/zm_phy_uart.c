@@ -16,13 +16,36 @@
 * the UART interface are caused by flow control errors, so check these first.
 *
 * @section Concurrency
-* To prevent code in two places accessing the messageBuffer at the same time, we use a mutex.
-* This mutex is implemented as a bit flag in the messageFlags variable. Accessing the mutex is through
-* a spinlock, which waits until the buffer becomes available before using it. For example:
-<pre>
-  while (messageFlags & MESSAGE_BUFFER_IN_USE);   //wait for msgBuffer to be available
-  messageFlags |= MESSAGE_BUFFER_IN_USE;          //lock the buffer
-</pre>
+* Received frames are stored in a ring of UART_FRAME_RING_SIZE frame buffers. The ring has a single 
+* producer, auxSerialPortHandler() in the serial port ISR, and a single consumer, phyGetMessage() in the 
+* main loop. The producer only writes frameRingHead and the consumer only writes frameRingTail, so no
+* lock is needed. A frame is parsed directly into the slot at frameRingHead and only becomes visible 
+* to the consumer when its FCS has been checked and frameRingHead is advanced. If the ring fills up
+* then RTS is de-asserted until phyGetMessage() frees a slot, so the Module holds off instead of 
+* frames being dropped.
+*
+* If the serial port has a receive FIFO or DMA then define ZM_PHY_UART_BURST_RX and give the ISR's 
+* bytes to auxSerialPortBurstHandler() all at once; it parses the same ring, with less work per byte.
+*
+* Received frames are copied from the ring into the working frame (zmBuf) of the frame pool in 
+* zm_frame.c. AREQs that arrive while waiting for a SRSP, and messages received while waiting for 
+* another message, are parked in the frame pool and returned later by getMessage().
+*
+* @section Transmit
+* By default frames are sent with putcharAux(), which waits for each byte, so the processor is busy 
+* for the whole frame: about 22mSec for a 250B AF_DATA_REQUEST_EXT at 115,200 baud. If 
+* ZM_PHY_UART_BUFFERED_TX is defined then sendMessage() instead copies the frame into a transmit ring
+* of UART_TX_RING_SIZE bytes and the serial port transmit ISR sends it, see auxSerialPortTxHandler().
+* The first bytes are on the wire while the rest of the frame is being copied, and the processor can 
+* do other work while the frame is sent and the SRSP is awaited. 
+* uartTxFlush() waits until the ring is empty and uartTxSetCompleteCallback() sets a function that 
+* the ISR calls when it is. The ring has one producer, txPut() in the main loop, and one consumer, 
+* the ISR, like the receive ring.
+*
+* The Module asserts CTS when it can accept bytes. Use the hardware flow control of the serial port 
+* if it has it. If not, define ZM_PHY_UART_CTS and call auxSerialPortCtsHandler() from the CTS pin
+* interrupt; the ISR stops sending while CTS_IS_ON() is false and auxSerialPortCtsHandler() restarts 
+* it.
 *
 * $Rev: 1767 $
 * $Author: dsmith $
@@ -54,34 +77,60 @@
 
 #include "../HAL/hal.h"
 #include "zm_phy_uart.h"
+#include "zm_frame.h"
+#include "zm_latency.h"
+#include "zm_deadline.h"
+#include "module.h"
 #include "module_errors.h"
 #include "../Common/utilities.h"
 #include <stdint.h>
 #include <string.h>
 
-#define MODULE_BUFFER_SIZE  0xFF
-
-/** This buffer will hold the transmitted messages and received SRSP Payload after sendMessage() was 
-called. If fragmentation support is not required then this can be smaller, e.g. 100B.*/
-uint8_t zmBuf[MODULE_BUFFER_SIZE];
-
 /** Function pointer for the ISR called when a byte is received on the serial 
 port connected to the module. This must be defined in the hal file. */
 extern void (*auxSerialPort)(char);  //only used for UART interface
 
+#ifdef ZM_PHY_UART_BURST_RX
+/** Function pointer for the ISR called with a run of bytes received on the serial port connected to
+the module, instead of auxSerialPort. This must be defined in the hal file. */
+extern void (*auxSerialPortBurst)(const uint8_t*, uint16_t);
+#endif
+
+#ifdef ZM_PHY_UART_BUFFERED_TX
+/** Function pointer for the ISR called when the serial port connected to the module can accept a 
+byte. This must be defined in the hal file, together with AUX_TX_START(). */
+extern int16_t (*auxSerialPortTx)(void);
+#ifndef AUX_TX_START
+#error "ZM_PHY_UART_BUFFERED_TX needs AUX_TX_START() and the transmit ISR in the hal file, see auxSerialPortTxHandler()"
+#endif
+#endif
+
 //
 //  UART SPECIFIC DEFINES
 //
 
-/** Used to indicate an entire message has arrived. Set by ISR, cleared by main method */
-volatile uint8_t messageFlags = 0;
+//
+// Ring of received frames. frameRingHead is only written by the ISR, frameRingTail only by phyGetMessage().
+//
+static uint8_t frameRing[UART_FRAME_RING_SIZE][MESSAGE_BUFFER_SIZE];
+static volatile uint8_t frameRingHead = 0;    //slot being received into
+static volatile uint8_t frameRingTail = 0;    //oldest complete frame, if head != tail
+
+#define NEXT_FRAME_RING_SLOT(_slot)     (((_slot) + 1) % UART_FRAME_RING_SIZE)
+#define FRAME_RING_IS_EMPTY()           (frameRingHead == frameRingTail)
+#define FRAME_RING_IS_FULL()            (NEXT_FRAME_RING_SLOT(frameRingHead) == frameRingTail)
+
+/** Set by the ISR when RTS was de-asserted because the ring was full */
+static volatile uint8_t rtsHeld = 0;
+
+/** Number of frames discarded because they failed the FCS check or overran the frame buffer */
+volatile uint16_t uartFramesDiscarded = 0;
 
 //
-// UART specific variables, protected by messageFlags.MESSAGE_BUFFER_IN_USE mutex:
+// Receive state, only accessed in the ISR:
 //
-uint8_t messageBufferIndex = 0;
-uint8_t messageBuffer[MESSAGE_BUFFER_SIZE];  //Used for receiving UART messages
-uint8_t fcs = 0;  //frame check sequence
+static uint8_t messageBufferIndex = 0;
+static uint8_t fcs = 0;  //frame check sequence
 
 /** 
 The states of the messageBuffer receive state machine. This is private and
@@ -104,28 +153,62 @@ enum messageBufferStates {
 void zm_phy_init()
 {
   auxSerialPort = &auxSerialPortHandler;  //point the ISR function pointer to our method
+#ifdef ZM_PHY_UART_BURST_RX
+  auxSerialPortBurst = &auxSerialPortBurstHandler;
+#endif
+#ifdef ZM_PHY_UART_BUFFERED_TX
+  auxSerialPortTx = &auxSerialPortTxHandler;
+#endif
 }
 
 /** 
 Indicates whether the module has a message ready to be processed.
-@return true (1) if there is a complete message in messageBuffer ready for processing, or 0 otherwise.
+@return true (1) if there is a parked message or at least one complete message in the ring ready 
+for processing, or 0 otherwise.
 */
 uint8_t moduleHasMessageWaiting()
 {
-  return (messageBufferState == COMPLETE);
+  return (framesParked() || !FRAME_RING_IS_EMPTY());
 }
 
 /** 
-Clears the messageFlags and sets messageBufferIndex back to zero. After this method is called we are 
-ready to receive a new message from the Module.
+Indicates whether there is a message in the receive ring; parked messages are not included.
+@return true (1) if there is at least one complete message in the ring, or 0 otherwise.
 */
-void resetMessage()
+uint8_t phyHasMessageWaiting()
+{
+  return (!FRAME_RING_IS_EMPTY());
+}
+
+/** 
+Sets messageBufferIndex back to zero. After this method is called we are ready to receive a new 
+message from the Module into the slot at frameRingHead. Only called from the ISR, or with interrupts
+disabled.
+*/
+static void resetMessage()
 {
-  messageFlags |= MESSAGE_BUFFER_IN_USE; //lock the buffer with the mutex
   messageBufferIndex = 0;
   messageBufferState = NOT_STARTED;
   fcs = 0;
-  messageFlags = 0; //Note: this clears the mutex too.  
+}
+
+/** 
+Publishes the frame in the slot at frameRingHead to phyGetMessage(). Only called from the ISR.
+@pre the frame is complete and its FCS has been checked
+*/
+static void publishFrame()
+{
+  /* RTS is de-asserted whenever the ring is full so there is always a free slot here, unless the 
+  Module ignored flow control. In that case the frame stays in this slot and is overwritten. */
+  if (!FRAME_RING_IS_FULL())
+    frameRingHead = NEXT_FRAME_RING_SLOT(frameRingHead);
+  else
+    uartFramesDiscarded++;
+  if (FRAME_RING_IS_FULL())
+  {
+    rtsHeld = 1;
+    RTS_OFF();   //stop bytes coming from module with flow control until a slot is free
+  }
 }
 
 /** 
@@ -141,179 +224,542 @@ __interrupt void USCI1RX_ISR(void)
   }
 }
 </pre>
-Message processing is handled according to a simple state machine. If a message 
-has already started, then append bytes to messageBuffer. When a byte is received:
-1. Assert RTS so that the module doesn't send another byte while we're processing this one
-2. Set messageFlags.MESSAGE_BUFFER_IN_USE. This is a simple mutex to control 
-access to messageBufferIndex, messageBuffer, and fcs to prevent concurrency issues
-3. Process received byte based on the state of messageBufferState
-4. Clear messageFlags.MESSAGE_BUFFER_IN_USE mutex
-5. Deassert RTS to allow more bytes to be received
+Message processing is handled according to a simple state machine. Bytes are written directly into 
+the slot at frameRingHead. When the FCS has been checked the frame is published by advancing 
+frameRingHead. Nothing here waits: if the ring is now full then RTS is de-asserted so that the 
+Module stops sending until phyGetMessage() has freed a slot. Bytes that arrive between frames that are
+not a start of frame are ignored.
 @param c the byte that was received in the ISR.
 */
 void auxSerialPortHandler(char c)
 {
-  RTS_OFF();   //stop bytes coming from module with flow control
-  //do we need to check mutex in ISR?
-  while (messageFlags & MESSAGE_BUFFER_IN_USE);  //spinlock: wait for msgBuffer to be available   
-  //non spinlock implementation: messageFlags |= MESSAGE_BUFFER_IN_USE; //lock the buffer
+  uint8_t* messageBuffer = frameRing[frameRingHead];
+  uint8_t b = (uint8_t) c;   //char may be signed
   
   switch (messageBufferState)
   {
   case NOT_STARTED:
-    if (c == UART_START_OF_FRAME)  //mew message
-    {
+    if (b == UART_START_OF_FRAME)  //new message
       messageBufferState = STARTED;
-      break;
-    }
+    break;
   case STARTED:
     if (messageBufferIndex < MESSAGE_BUFFER_SIZE)
     {
-      messageBuffer[messageBufferIndex] = c;  //write byte to message buffer
+      messageBuffer[messageBufferIndex] = b;  //write byte to message buffer
       messageBufferIndex++;
       if (messageBufferIndex == (messageBuffer[UART_MESSAGE_LENGTH_FIELD] + MESSAGE_OVERHEAD))
         messageBufferState = AWAITING_FCS;  //next byte will be FCS
-      fcs ^= c;
+      fcs ^= b;
     } else {      //buffer overrun; discard the contents and reset the message.
       messageBufferState = ERROR;
     }
     break;
   case AWAITING_FCS:
-    if (c == fcs)
+    if (b == fcs)
     {
       messageBufferState = COMPLETE;
     } else {
       messageBufferState = ERROR;  //FCS check failed
     }
     break;
-  case COMPLETE:
-    //error - we received a byte with the messageBuffer still busy.
-    // *fall-through* (no break here)
   default:
     //error - should never happen
     messageBufferState = ERROR;
     break;
   }
   
-  if (messageBufferState == ERROR)
+  if (messageBufferState == COMPLETE)
+  {
+    publishFrame();
+    resetMessage();
+  } 
+  else if (messageBufferState == ERROR)
+  {
+    uartFramesDiscarded++;
     resetMessage();
+  }
+}
+
+#ifdef ZM_PHY_UART_BURST_RX
+/** 
+XORs a run of bytes, one processor word at a time.
+@param bytes the bytes
+@param length how many bytes
+@return the XOR of all the bytes
+*/
+static uint8_t xorBytes(const uint8_t* bytes, uint16_t length)
+{
+  uint8_t x = 0;
+  while ((length > 0) && (((uintptr_t) bytes) & (sizeof(unsigned int) - 1)))   //up to a word boundary
+  {
+    x ^= *bytes++;
+    length--;
+  }
   
-  messageFlags &= ~MESSAGE_BUFFER_IN_USE; //unlock the buffer
-  RTS_ON();
+  const unsigned int* words = (const unsigned int*) bytes;
+  uint16_t wordCount = length / sizeof(unsigned int);
+  unsigned int w = 0;
+  length -= wordCount * sizeof(unsigned int);
+  while (wordCount--)
+    w ^= *words++;
+  uint8_t shift;
+  for (shift = sizeof(unsigned int) * 4; shift >= 8; shift /= 2)   //fold the word into one byte
+    w ^= (w >> shift);
+  x ^= (uint8_t) w;
+  
+  bytes = (const uint8_t*) words;
+  while (length--)
+    x ^= *bytes++;
+  return x;
+}
+
+/** Bytes of a bad frame that are parsed again, see auxSerialPortBurstHandler() */
+static uint8_t resyncBuffer[MESSAGE_BUFFER_SIZE];
+
+/** 
+Processes a run of bytes received from the Module, e.g. the contents of the receive FIFO or of a DMA
+buffer. Does the same as calling auxSerialPortHandler() for each byte, but copies the body of a 
+frame with memmove() and computes its FCS a word at a time with xorBytes(), so the cost per byte is
+much lower. Should be called in the serial port ISR for the module serial port. For example on a 
+Stellaris processor:
+<pre>
+void UART1IntHandler(void)
+{
+  uint8_t bytes[16];          //size of the receive FIFO
+  uint8_t count = 0;
+  UARTIntClear(UART1_BASE, UARTIntStatus(UART1_BASE, true));
+  while (UARTCharsAvail(UART1_BASE) && (count < sizeof(bytes)))
+    bytes[count++] = UARTCharGetNonBlocking(UART1_BASE);
+  auxSerialPortBurst(bytes, count);
+}
+</pre>
+Set the receive FIFO level and enable the receive timeout interrupt, so that the last bytes of a 
+frame don't wait for the FIFO to fill up.
+
+If the FCS of a frame is wrong then its SOF may have been a data byte and the real start of frame may
+be inside it, so its bytes after the SOF are parsed again instead of being dropped, followed by the 
+byte that was taken as the FCS. A good frame right after a corrupted byte is not lost.
+@param bytes the bytes that were received
+@param length how many bytes
+*/
+void auxSerialPortBurstHandler(const uint8_t* bytes, uint16_t length)
+{
+  const uint8_t* saved = 0;         //rest of bytes, while parsing resyncBuffer
+  uint16_t savedLength = 0;
+  
+  for (;;)
+  {
+    if (length == 0)
+    {
+      if (saved == 0)
+        return;
+      bytes = saved;
+      length = savedLength;
+      saved = 0;
+      continue;
+    }
+    
+    uint8_t* messageBuffer = frameRing[frameRingHead];
+    switch (messageBufferState)
+    {
+    case NOT_STARTED:
+      {
+        const uint8_t* sof = memchr(bytes, UART_START_OF_FRAME, length);
+        if (sof == 0)
+        {
+          length = 0;                 //nothing but bytes between frames
+        } else {
+          length -= (sof - bytes) + 1;
+          bytes = sof + 1;
+          messageBufferState = STARTED;
+        }
+      }
+      break;
+      
+    case STARTED:
+      {
+        uint8_t lengthField = (messageBufferIndex == 0) ? bytes[0] : messageBuffer[UART_MESSAGE_LENGTH_FIELD];
+        uint16_t frameLength = lengthField + MESSAGE_OVERHEAD;
+        if (frameLength > MESSAGE_BUFFER_SIZE)  //too long for the frame buffer
+        {
+          uartFramesDiscarded++;
+          resetMessage();             //look for a SOF from the length byte onwards
+          break;
+        }
+        uint16_t count = frameLength - messageBufferIndex;
+        if (count > length)
+          count = length;
+        memmove(messageBuffer + messageBufferIndex, bytes, count);   //bytes may be in resyncBuffer
+        fcs ^= xorBytes(messageBuffer + messageBufferIndex, count);
+        messageBufferIndex += count;
+        bytes += count;
+        length -= count;
+        if (messageBufferIndex == frameLength)
+          messageBufferState = AWAITING_FCS;
+      }
+      break;
+      
+    case AWAITING_FCS:
+      if (*bytes == fcs)
+      {
+        bytes++;
+        length--;
+        publishFrame();
+        resetMessage();
+      } else {
+        /* Parse the bytes after the SOF again, starting at the next SOF if there is one, and then 
+        the byte that was taken as the FCS and everything after it. */
+        uartFramesDiscarded++;
+        const uint8_t* sof = memchr(messageBuffer, UART_START_OF_FRAME, messageBufferIndex);
+        if (sof != 0)
+        {
+          uint8_t resyncLength = messageBufferIndex - (sof - messageBuffer) - 1;
+          if (saved != 0)             //bytes is in resyncBuffer, after the bytes that failed
+          {
+            memmove(resyncBuffer + resyncLength, bytes, length);
+          } else {
+            saved = bytes;
+            savedLength = length;
+            length = 0;
+          }
+          memcpy(resyncBuffer, sof + 1, resyncLength);
+          bytes = resyncBuffer;
+          length += resyncLength;
+          resetMessage();
+          messageBufferState = STARTED;   //at the SOF that was found
+        } else {
+          resetMessage();
+        }
+      }
+      break;
+      
+    default:
+      resetMessage();
+      break;
+    }
+  }
+}
+#endif
+
+/** 
+Removes the oldest frame from the ring, re-asserting RTS if the ISR had to hold off the Module.
+@pre the ring is not empty
+*/
+static void releaseFrame()
+{
+  frameRingTail = NEXT_FRAME_RING_SLOT(frameRingTail);
+  if (rtsHeld)
+  {
+    HAL_DISABLE_INTERRUPTS();   //the ISR may fill the ring again and re-assert rtsHeld
+    if (!FRAME_RING_IS_FULL())
+    {
+      rtsHeld = 0;
+      RTS_ON();
+    }
+    HAL_ENABLE_INTERRUPTS();
+  }
+}
+
+/** 
+Empties the receive ring and abandons any partly received frame. Called by moduleReset(), since 
+frames from before the reset are no longer valid and one of them could be mistaken for the 
+SYS_RESET_IND. Interrupts are left enabled or disabled, as they were.
+*/
+void uartDiscardFrames()
+{
+  uint8_t interruptsWereEnabled = HAL_INTERRUPTS_ARE_ENABLED() ? 1 : 0;
+  HAL_DISABLE_INTERRUPTS();
+  frameRingTail = frameRingHead;
+  resetMessage();
+  if (rtsHeld)
+  {
+    rtsHeld = 0;
+    RTS_ON();
+  }
+  if (interruptsWereEnabled)
+    HAL_ENABLE_INTERRUPTS();
+}
+
+#ifdef ZM_PHY_UART_BUFFERED_TX
+//
+// Transmit ring. txRingHead is only written by txPut(), txRingTail only by the ISR. Both are 
+// free-running and wrap around, so the number of bytes in the ring is their difference.
+//
+static uint8_t txRing[UART_TX_RING_SIZE];
+static volatile uint16_t txRingHead = 0;
+static volatile uint16_t txRingTail = 0;
+
+#define TX_RING_COUNT()                 ((uint16_t) (txRingHead - txRingTail))
+
+/** Set by the ISR when it has stopped because there was nothing to send (or CTS was off); the next
+txPut() or auxSerialPortCtsHandler() restarts it with AUX_TX_START(). */
+static volatile uint8_t txIdle = 1;
+
+static void (*txCompleteCallback)(void) = 0;
+
+/** 
+Gets the next byte to send to the Module. Should be called in the serial port ISR for the module 
+serial port when it can accept another byte, and nowhere else: the ISR is the only consumer of the 
+transmit ring, so AUX_TX_START() must only enable or pend the transmit interrupt. For example:
+<pre>
+#define AUX_TX_START()  (UC1IE |= UCA1TXIE)     //UCA1TXIFG is set while UCA1TXBUF is empty
+
+#pragma vector=USCIAB1TX_VECTOR
+__interrupt void USCI1TX_ISR(void)
+{
+  int16_t c = auxSerialPortTx();
+  if (c == UART_TX_IDLE)
+    UC1IE &= ~UCA1TXIE;          //nothing to send; AUX_TX_START() sets UCA1TXIE again
+  else
+    UCA1TXBUF = c;               //writing this register clears the interrupt flag
 }
+</pre>
+On a Stellaris processor the transmit interrupt is only generated when the FIFO level goes down, so 
+AUX_TX_START() pends the interrupt instead, and UARTIntHandler() fills the FIFO:
+<pre>
+#define AUX_TX_START()  (IntPendSet(INT_UART1))
 
+    while (UARTSpaceAvail(UART1_BASE))       //in UARTIntHandler()
+    {
+        int16_t c = auxSerialPortTx();
+        if (c == UART_TX_IDLE)
+            break;
+        UARTCharPutNonBlocking(UART1_BASE, c);
+    }
+</pre>
+@return the byte to send, or UART_TX_IDLE if the ring is empty or CTS is off. After UART_TX_IDLE 
+this won't be called until AUX_TX_START().
+*/
+int16_t auxSerialPortTxHandler()
+{
+  if (TX_RING_COUNT() == 0)
+  {
+    txIdle = 1;
+    if (txCompleteCallback != 0)
+      txCompleteCallback();
+    return UART_TX_IDLE;
+  }
+#ifdef ZM_PHY_UART_CTS
+  if (!CTS_IS_ON())
+  {
+    txIdle = 1;
+    return UART_TX_IDLE;
+  }
+#endif
+  uint8_t b = txRing[txRingTail & (UART_TX_RING_SIZE - 1)];
+  txRingTail++;
+  return b;
+}
+
+#ifdef ZM_PHY_UART_CTS
+/** Restarts sending when the Module asserts CTS again. Call from the CTS pin interrupt. */
+void auxSerialPortCtsHandler()
+{
+  if (txIdle && (TX_RING_COUNT() != 0))
+  {
+    txIdle = 0;
+    AUX_TX_START();
+  }
+}
+#endif
+
+/** 
+Adds a byte to the transmit ring and starts the ISR if it had stopped. If the ring is full then 
+waits for the ISR to make room, for up to UART_TX_FULL_TIMEOUT_US; after that the byte is dropped, 
+so the Module will discard the frame for a bad FCS and the wait for its SRSP will time out.
+Interrupts stay enabled; this is safe because of the order of the writes. txRingHead is advanced 
+before txIdle is read, so an ISR that runs before that finds the ring empty and sets txIdle, which 
+is then seen here, and an ISR that runs after it sends the new byte. Either way a byte can't be left
+in the ring with the ISR stopped.
+@param b the byte to send
+*/
+static void txPut(uint8_t b)
+{
+  if (TX_RING_COUNT() == UART_TX_RING_SIZE)
+  {
+    struct deadline d;
+    deadlineStart(&d, UART_TX_FULL_TIMEOUT_US);
+    while (TX_RING_COUNT() == UART_TX_RING_SIZE)
+    {
+      if (deadlineExpired(&d))
+        return;                 //e.g. the Module is holding off with CTS
+    }
+  }
+  txRing[txRingHead & (UART_TX_RING_SIZE - 1)] = b;
+  txRingHead++;
+  if (txIdle)
+  {
+    txIdle = 0;
+    AUX_TX_START();
+  }
+}
+
+/** @return the number of bytes in the transmit ring that haven't been sent yet */
+uint16_t uartTxPending()
+{
+  return TX_RING_COUNT();
+}
+
+/** 
+Waits until every byte in the transmit ring has been given to the serial port, e.g. before putting
+the processor in a low power mode that stops the serial port.
+@param timeoutMs how long to wait, e.g. if the Module is holding off with CTS
+@return MODULE_SUCCESS, or TIMEOUT if there were still bytes in the ring after timeoutMs
+*/
+moduleResult_t uartTxFlush(uint16_t timeoutMs)
+{
+  struct deadline d;
+  deadlineStart(&d, timeoutMs * 1000UL);
+  while (TX_RING_COUNT() != 0)
+  {
+    if (deadlineExpired(&d))
+      return TIMEOUT;
+  }
+  return MODULE_SUCCESS;
+}
+
+/** 
+Sets a function to be called when the transmit ring has been emptied, e.g. to send the next frame 
+or to go to sleep. Called from interrupt context.
+@param callback the function, or null (0) for none
+*/
+void uartTxSetCompleteCallback(void (*callback)(void))
+{
+  txCompleteCallback = callback;
+}
+
+#define UART_TX_BYTE(b)                 txPut(b)
+#else
+#define UART_TX_BYTE(b)                 putcharAux(b)
+#endif
 
 /**
 Sends a Module Synchronous Request (SREQ) message and retrieves the response. A SREQ is a message to 
 the Module that is immediately followed by a Synchronous Response (SRSP) message from the Module. 
 As opposed to an Asynchronous Request (AREQ) message, which does not have a SRSP. This is a private 
-method that gets wrapped by sendMessage().
+method that gets wrapped by sendMessage() and sendFrame().
+@param request the message to send. May be zmBuf.
 @pre Module has been initialized
-@pre zmBuf contains a properly formatted message. No validation is done.
+@pre request contains a properly formatted message. No validation is done.
 @post received data is written to zmBuf
 */
-moduleResult_t sendSreq()
+static moduleResult_t sendSreq(const uint8_t* request)
 {  
   /* Frame Check Sequence - this will be computed on the fly, as each byte is
   received. It's just a simple XORing of all received bytes */
   uint8_t fcs = 0;                     
   
   /* The total message length, excluding start of frame and FCS. */
-  uint8_t messageLength = *zmBuf + 3;   
+  uint8_t messageLength = *request + 3;   
   
-  putcharAux(UART_START_OF_FRAME);      // Send the SOF (0xFE)
+  UART_TX_BYTE(UART_START_OF_FRAME);    // Send the SOF (0xFE)
   
   int i;
   for (i=0; i< messageLength; i++)  // Now, for all bytes in the message:
   {
-    putcharAux(zmBuf[i]);       // Send the byte
-    fcs ^= zmBuf[i];            // Compute FCS on this byte
+    UART_TX_BYTE(request[i]);   // Send the byte
+    fcs ^= request[i];          // Compute FCS on this byte
   }
   
-  putcharAux(fcs);  //The message body has been sent. now send FCS
+  UART_TX_BYTE(fcs);  //The message body has been sent. now send FCS
   
   /* Now await the reply. Most of this will be handled by the ISR so we need to 
   wait until the messageBufferState (set in ISR) indicates a message is ready. 
   Most responses are fast - 20mSec or less, but zdoStartApplication requires 
   approximately 400mSec.*/
-#define CHECK_MESSAGE_COMPLETE_INTERVAL_MS  2 //how often we check message complete
 #define CHECK_MESSAGE_COMPLETE_TIMEOUT_MS   2000  //how long to wait
   
-  return receiveAreq(CHECK_MESSAGE_COMPLETE_INTERVAL_MS, CHECK_MESSAGE_COMPLETE_TIMEOUT_MS);
+  return receiveAreq(CHECK_MESSAGE_COMPLETE_TIMEOUT_MS);
 }
 
 /** 
-Get a message that is in messageBuffer and copy to zmBuf for further processing.
-@pre  moduleHasMessageWaiting() is true
-@post zmBuf holds the message that was in messageBuffer
+Get the oldest message in the ring and copy to zmBuf for further processing. Parked messages are not
+returned.
+@pre  phyHasMessageWaiting() is true
+@post zmBuf holds the oldest message that was in the ring, and its slot is free for a new message
 */
-moduleResult_t getMessage()
+moduleResult_t phyGetMessage()
 {
-  if (messageBufferState == COMPLETE)
+  if (!FRAME_RING_IS_EMPTY())
   {
-    memcpy(zmBuf, messageBuffer, messageBufferIndex);    //now copy the received message into zmBuf
-    resetMessage();
+    uint8_t* frame = frameRing[frameRingTail];
+    memcpy(zmBuf, frame, frame[UART_MESSAGE_LENGTH_FIELD] + MESSAGE_OVERHEAD);  //now copy the received message into zmBuf
+    releaseFrame();
+    LATENCY_AREQ_RECEIVED(zmBuf);
+    deviceInfoAreqReceived(zmBuf);
     return MODULE_SUCCESS;
   } else {
     return ZM_PHY_OTHER_ERROR;    
   }
 }
 
+/** 
+Get the next message: the oldest parked message if there is one, else the oldest message in the ring.
+@pre  moduleHasMessageWaiting() is true
+@post zmBuf holds the message
+*/
+moduleResult_t getMessage()
+{
+  if (frameUnpark())
+    return MODULE_SUCCESS;
+  return phyGetMessage();
+}
+
 /** Wait to receive an asynchronous message. Similar to spiPoll() but with wait.
-@param intervalMs how often to check that we received the message.
 @param timeoutMs how long to wait, total, for the message
 @return MODULE_SUCCESS if message received before timeoutMs or else ZM_PHY_SRSP_TIMEOUT if no 
 message was received before timeout.
-@post received data is written to zmBuf and messageBuffer is reset
+@post received data is written to zmBuf and removed from the receive ring
 */
-moduleResult_t receiveAreq(uint8_t intervalMs, int16_t timeoutMs)
+moduleResult_t receiveAreq(uint16_t timeoutMs)
 {
 #ifdef ZM_PHY_UART_VERBOSE    
-  printf("Waiting to receive message; interval=%umSec, timeout=%umSec\r\n", intervalMs, timeoutMs);
+  printf("Waiting to receive message; timeout=%umSec\r\n", timeoutMs);
 #endif     
-  do {                // check to see if a message was received
-    delayMs(intervalMs);
-    timeoutMs -= intervalMs;
-  }
-  while ((!(messageBufferState == COMPLETE)) && (timeoutMs > 0));
+  struct deadline d;
+  deadlineStart(&d, timeoutMs * 1000UL);
+  while (FRAME_RING_IS_EMPTY() && !deadlineExpired(&d)) ;   // check to see if a message was received
   
-  if (timeoutMs > 0)  // received a message before timeout
+  if (!FRAME_RING_IS_EMPTY())  // received a message before timeout
   {
 #ifdef ZM_PHY_UART_VERBOSE    
-    printf("Success - response received %umSec before timeout\r\n", timeoutMs);
+    printf("Success - response received in %luuSec\r\n", (unsigned long) deadlineElapsedUs(&d));
     displayMessageBuffer();
 #endif     
-    memcpy(zmBuf, messageBuffer, messageBufferIndex);    //now copy the received message into zmBuf
-    resetMessage(); 
-    return MODULE_SUCCESS;  
+    return phyGetMessage();  
   } else {          // did not receive a message before timeout
 #ifdef ZM_PHY_UART_VERBOSE  
     printf("Timeout");
     displayMessageBuffer();    
 #endif         
-    resetMessage(); 
     return ZM_PHY_SRSP_TIMEOUT;
   }
 }
 
-/** 
-Public method to send messages to the Module. This will send one message and then receive the 
-Synchronous Response (SRSP) message from the Module to indicate the command was received.
-@pre zmBuf contains a properly formatted message
-@pre Module has been initialized
-@post buffer zmBuf contains the response (if any) from the Module. 
+/** Sends a message to the Module and receives the SRSP into zmBuf. Private method that gets wrapped 
+by sendMessage() and sendFrame().
+@param request the message to send; zmBuf or another frame
 */
-moduleResult_t sendMessage()
+static moduleResult_t sendRequest(const uint8_t* request)
 {
 #ifdef ZM_PHY_UART_VERBOSE    
   printf("Tx: ");
-  printHexBytes(zmBuf, zmBuf[0] + 3);
+  printHexBytes((uint8_t*) request, request[0] + 3);
 #endif    
   
-  uint8_t expectedSrspCmdMsb = zmBuf[1] + SRSP_OFFSET;    //store these so we can compare with what is returned
-  uint8_t expectedSrspCmdLsb = zmBuf[2];
+  uint8_t expectedSrspCmdMsb = request[1] + SRSP_OFFSET;  //store these so we can compare with what is returned
+  uint8_t expectedSrspCmdLsb = request[2];
+  
+  LATENCY_SREQ_SENT(request);
+  moduleResult_t result = sendSreq(request);              //send message, buffer now holds received data
   
-  moduleResult_t result = sendSreq();                     //send message, buffer now holds received data
+  /* An AREQ that the Module sent before the SRSP will be received first. Park it so that the 
+  application still gets it, and keep waiting for the SRSP. If it can't be parked it is dropped. */
+  while ((result == MODULE_SUCCESS) && ((zmBuf[SRSP_CMD_MSB_FIELD] & MT_CMD_TYPE_MASK) == MT_CMD_TYPE_AREQ))
+  {
+    frameParkWorking();
+    result = receiveAreq(CHECK_MESSAGE_COMPLETE_TIMEOUT_MS);
+  }
   
   if (result != MODULE_SUCCESS)                           //ERROR - sendSreq() timeout
   {
@@ -327,6 +773,7 @@ moduleResult_t sendMessage()
   For example, if the SREQ is 0x2605 then the corresponding SRSP is 0x6605 */
   if ((zmBuf[SRSP_CMD_MSB_FIELD] == expectedSrspCmdMsb) && (zmBuf[SRSP_CMD_LSB_FIELD] == expectedSrspCmdLsb))    //verify the correct SRSP was received
   {
+    LATENCY_SRSP_RECEIVED(zmBuf);
     return MODULE_SUCCESS;
   } else {
 #ifdef ZM_PHY_UART_VERBOSE_ERRORS    
@@ -336,21 +783,42 @@ moduleResult_t sendMessage()
   }
 }
 
+/** 
+Public method to send messages to the Module. This will send one message and then receive the 
+Synchronous Response (SRSP) message from the Module to indicate the command was received.
+@pre zmBuf contains a properly formatted message
+@pre Module has been initialized
+@post buffer zmBuf contains the response (if any) from the Module. 
+*/
+moduleResult_t sendMessage()
+{
+  return sendRequest(zmBuf);
+}
+
+/** Sends a message that was prepared in a frame from frameAlloc(), for example with afBuildData(). 
+The frame is not modified, so the same message can be sent again without rebuilding it.
+@param frame the frame holding a properly formatted message
+@pre Module has been initialized
+@post buffer zmBuf contains the response (if any) from the Module. 
+@return MODULE_SUCCESS, INVALID_PARAMETER if frame is not valid, or an error from sendMessage()
+*/
+moduleResult_t sendFrame(frameHandle_t frame)
+{
+  uint8_t* request = frameData(frame);
+  if (request == 0)
+    return INVALID_PARAMETER;
+  return sendRequest(request);
+}
+
 
 /** 
-Displays the contents of the messageBuffer. Locks the messageBuffer while reading to
-prevent a concurrency problem. 
-@note If you have sufficient memory and the printf is slow then it would be better to copy 
-messageBuffer to a new buffer and then printf that. Or use a circular buffer on the debug UART.
+Displays the state of the receive ring and the contents of the oldest complete message, if any. 
+The ISR never writes a published frame, so this doesn't need to lock anything.
 */
 void displayMessageBuffer()
 {
-  while (messageFlags & MESSAGE_BUFFER_IN_USE);   //wait for msgBuffer to be available
-  messageFlags |= MESSAGE_BUFFER_IN_USE;          //lock the buffer
-  printf("messageFlags = 0x%02X, fcs=0x%02X, messageBufferIndex = %u\r\n", messageFlags, fcs, messageBufferIndex);
-  printHexBytes(messageBuffer, messageBufferIndex);
-  //for (int i=0; i<messageBufferIndex; i++)
-  //  printf("%02X ", messageBuffer[i]);
-  //printf("\r\n");
-  messageFlags &= MESSAGE_BUFFER_IN_USE;          //unlock the buffer
+  uint8_t tail = frameRingTail;
+  printf("frameRingHead = %u, frameRingTail = %u, discarded = %u\r\n", frameRingHead, tail, uartFramesDiscarded);
+  if (tail != frameRingHead)
+    printHexBytes(frameRing[tail], frameRing[tail][UART_MESSAGE_LENGTH_FIELD] + MESSAGE_OVERHEAD);
 }
\ No newline at end of file
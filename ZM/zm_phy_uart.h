@@ -37,21 +37,40 @@
 #include "module_errors.h"
 
 moduleResult_t sendMessage();
-moduleResult_t receiveAreq(uint8_t intervalMs, int16_t timeoutMs);
+moduleResult_t receiveAreq(uint16_t timeoutMs);
 moduleResult_t getMessage();
 void displayMessageBuffer();
 void auxSerialPortHandler(char c);
+#ifdef ZM_PHY_UART_BURST_RX
+void auxSerialPortBurstHandler(const uint8_t* bytes, uint16_t length);
+#endif
 void zm_phy_init();
 uint8_t moduleHasMessageWaiting();
 
+//Only the receive ring, not the parked messages in the frame pool:
+moduleResult_t phyGetMessage();
+uint8_t phyHasMessageWaiting();
+
+/* A sleeping processor must be woken with HAL_WAKEUP() from the Module serial port ISR when a frame is 
+complete, and no hal file has that ISR yet, so a wait would always last until its timeout. */
+#ifdef ZM_WAIT_FOR_EVENT
+#error "ZM_WAIT_FOR_EVENT is not supported with ZM_PHY_UART"
+#endif
+
 /** The size of the Zigbee Buffer. This is used for both send and receive */
 #define ZIGBEE_MODULE_BUFFER_SIZE      0xFF
 
 #define UART_START_OF_FRAME 0xFE
-//messageFlags:
-#define MESSAGE_BUFFER_IN_USE 0x01  //simple mutex
 
 #define MESSAGE_BUFFER_SIZE 0xFF //largest message is AF_DATA_REQUEST_EXT + SOF + FCS = 0xFF total length
+
+/** Number of slots in the receive ring. One slot is always being received into, so this holds 
+UART_FRAME_RING_SIZE - 1 complete frames. Uses UART_FRAME_RING_SIZE * MESSAGE_BUFFER_SIZE of RAM. */
+#ifndef UART_FRAME_RING_SIZE
+#define UART_FRAME_RING_SIZE    4
+#endif
+extern volatile uint16_t uartFramesDiscarded;
+void uartDiscardFrames();
 #define UART_MESSAGE_LENGTH_FIELD 0  //SOF is not included in this count
 #define MINIMUM_MESSAGE_SIZE  4 //TBD - doesn't include SOF
 #define MESSAGE_OVERHEAD 3 //4  //used in computation of message length
@@ -62,9 +81,40 @@ uint8_t moduleHasMessageWaiting();
 //SRSP MSB is 0x40 greater than SREQ MSB
 #define SRSP_OFFSET             0x40
 
+//Command type is in the top 3 bits of the command MSB
+#define MT_CMD_TYPE_MASK        0xE0
+#define MT_CMD_TYPE_AREQ        0x40
+
 #define SRSP_PAYLOAD_START      3
 #define SRSP_LENGTH_FIELD       0  
 #define SRSP_CMD_LSB_FIELD      2
 #define SRSP_CMD_MSB_FIELD      1
 
+#ifdef ZM_PHY_UART_BUFFERED_TX
+/** Size of the transmit ring, must be a power of two. The default holds the largest frame, so that 
+sendMessage() never waits for bytes to be sent. */
+#ifndef UART_TX_RING_SIZE
+#define UART_TX_RING_SIZE       256
+#endif
+#if ((UART_TX_RING_SIZE & (UART_TX_RING_SIZE - 1)) != 0)
+#error "UART_TX_RING_SIZE must be a power of two"
+#endif
+
+/** How long to wait for room in a full transmit ring before dropping the byte, in microseconds */
+#ifndef UART_TX_FULL_TIMEOUT_US
+#define UART_TX_FULL_TIMEOUT_US 100000UL
+#endif
+
+/** Returned by auxSerialPortTxHandler() when there is nothing to send */
+#define UART_TX_IDLE            (-1)
+
+int16_t auxSerialPortTxHandler();
+#ifdef ZM_PHY_UART_CTS
+void auxSerialPortCtsHandler();
+#endif
+uint16_t uartTxPending();
+moduleResult_t uartTxFlush(uint16_t timeoutMs);
+void uartTxSetCompleteCallback(void (*callback)(void));
+#endif
+
 #endif
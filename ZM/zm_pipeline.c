@@ -0,0 +1,225 @@
+/**
+* @file zm_pipeline.c
+*
+* @brief Non-blocking requests: send a request and get a callback when its response arrives.
+*
+* Methods like zdoRequestIeeeAddress() send a request and then block in waitForMessage() until the 
+* response arrives, so only one request can be outstanding at once. With the pipeline, a request is 
+* sent and then recorded in a table of outstanding requests together with the response command to 
+* expect and a field of the response to match it on, e.g. the transaction ID of an AF_DATA_CONFIRM or 
+* the address in a ZDO_IEEE_ADDR_RSP. Many requests can be outstanding at once and their responses 
+* may arrive in any order.
+*
+* The application loop hands each received message to pipelineDispatch(), which calls the callback of
+* the request that it completes, and calls pipelineTick() periodically to time out requests whose 
+* response never arrives:
+<pre>
+    while (1)
+    {
+        if (moduleHasMessageWaiting())
+        {
+            getMessage();
+            if (!pipelineDispatch())
+                handleMessage();            // Not a response to an outstanding request
+        }
+        if (tickElapsed)
+            pipelineTick(TICK_MS);
+    }
+</pre>
+* Responses received by a blocking method, e.g. in waitForMessage(), are parked in the frame pool and 
+* returned later by getMessage(), so they still reach pipelineDispatch().
+*
+* @note These methods are not re-entrant and must not be called from an interrupt service routine.
+* Callbacks may send new requests.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "zm_pipeline.h"
+#include "zm_frame.h"
+#include "../HAL/hal.h"
+#include "../Common/utilities.h"
+#include <string.h>                 //for memcpy(), memcmp()
+#include <stdint.h>
+
+/** An outstanding request. A responseCommand of zero marks a free entry. */
+struct pendingRequest
+{
+    uint16_t responseCommand;
+    uint16_t timeLeftMs;
+    requestCallback_t callback;
+    uint8_t statusField;
+    uint8_t matchField;
+    uint8_t matchLength;
+    uint8_t matchValue[PIPELINE_MAX_MATCH_LENGTH];
+};
+
+static struct pendingRequest pendingRequests[ZM_PIPELINE_SIZE];
+
+#define IS_VALID_TOKEN(token)           ((token) < ZM_PIPELINE_SIZE)
+#define IS_PENDING(token)               (pendingRequests[token].responseCommand != 0)
+
+/** Removes the request from the table and calls its callback. The entry is freed first so that the 
+callback may send a new request. */
+static void completeRequest(requestToken_t token, moduleResult_t status)
+{
+    requestCallback_t callback = pendingRequests[token].callback;
+    pendingRequests[token].responseCommand = 0;
+    if (callback != 0)
+        callback(token, status);
+}
+
+#define METHOD_PIPELINE_SEND                    0x5100
+/** Sends the request in zmBuf and, if the Module accepts it, adds it to the table of outstanding 
+requests. Used by the non-blocking library methods like afSendDataAsync(); may also be used for any 
+request whose SRSP has a status as the first byte of its payload.
+@param responseCommand the message that completes this request, e.g. AF_DATA_CONFIRM
+@param matchField the field of the response to match, e.g. AF_DATA_CONFIRM_TRANS_ID_FIELD
+@param matchValue the bytes that the response must have at matchField to complete this request
+@param matchLength number of bytes of matchValue, 0 .. PIPELINE_MAX_MATCH_LENGTH. If zero then the
+first response with that command completes the request.
+@param statusField the field of the response that is given to the callback as the status
+@param timeoutMs if no matching response is received in this time then the request completes with a
+TIMEOUT status. Measured by pipelineTick().
+@param callback called when the request completes
+@param token is set to the token of the request, or REQUEST_TOKEN_NONE if it was not sent.
+@pre zmBuf contains the request
+@post zmBuf contains the SRSP.
+@return MODULE_SUCCESS if the request is outstanding, else ZM_PIPELINE_FULL if there are already
+ZM_PIPELINE_SIZE outstanding requests, or the error from sending or the SRSP status. If an error is
+returned then the callback won't be called.
+*/
+moduleResult_t pipelineSend(uint16_t responseCommand, uint8_t matchField, const uint8_t* matchValue, 
+                            uint8_t matchLength, uint8_t statusField, uint16_t timeoutMs,
+                            requestCallback_t callback, requestToken_t* token)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((token == 0), METHOD_PIPELINE_SEND);
+    *token = REQUEST_TOKEN_NONE;
+    RETURN_INVALID_PARAMETER_IF_TRUE((responseCommand == 0), METHOD_PIPELINE_SEND);
+    RETURN_INVALID_LENGTH_IF_TRUE((matchLength > PIPELINE_MAX_MATCH_LENGTH), METHOD_PIPELINE_SEND);
+    RETURN_NULL_PARAMETER_IF_TRUE(((matchLength > 0) && (matchValue == 0)), METHOD_PIPELINE_SEND);
+    
+    requestToken_t t;
+    for (t = 0; t < ZM_PIPELINE_SIZE; t++)
+    {
+        if (!IS_PENDING(t))
+            break;
+    }
+    RETURN_RESULT_IF_EXPRESSION_TRUE((t == ZM_PIPELINE_SIZE), METHOD_PIPELINE_SEND, ZM_PIPELINE_FULL);
+    
+    //Fill in the entry before sending since matchValue may point into zmBuf
+    struct pendingRequest* r = &pendingRequests[t];
+    r->timeLeftMs = timeoutMs;
+    r->callback = callback;
+    r->statusField = statusField;
+    r->matchField = matchField;
+    r->matchLength = matchLength;
+    memcpy(r->matchValue, matchValue, matchLength);
+    
+    RETURN_RESULT_IF_FAIL(sendMessage(), METHOD_PIPELINE_SEND);
+    RETURN_RESULT_IF_FAIL(zmBuf[SRSP_PAYLOAD_START], METHOD_PIPELINE_SEND);
+    
+    r->responseCommand = responseCommand;
+    *token = t;
+    return MODULE_SUCCESS;
+}
+
+/** Checks whether the message in zmBuf is the response to an outstanding request and if so calls the
+callback of that request. If it matches more than one request then the one closest to timing out is completed.
+@pre zmBuf contains a received message, e.g. from getMessage()
+@return 1 if the message completed a request, else 0 and the application should handle the message.
+*/
+uint8_t pipelineDispatch()
+{
+    uint16_t command = CONVERT_TO_INT(zmBuf[SRSP_CMD_LSB_FIELD], zmBuf[SRSP_CMD_MSB_FIELD]);
+    requestToken_t match = REQUEST_TOKEN_NONE;
+    uint16_t matchTimeLeft = 0xFFFF;
+    requestToken_t t;
+    for (t = 0; t < ZM_PIPELINE_SIZE; t++)
+    {
+        struct pendingRequest* r = &pendingRequests[t];
+        if ((r->responseCommand != command) || (r->timeLeftMs > matchTimeLeft))
+            continue;
+        if (r->matchLength > 0)
+        {
+            if ((r->matchField + r->matchLength) > (zmBuf[SRSP_LENGTH_FIELD] + SRSP_PAYLOAD_START))
+                continue;
+            if (memcmp(zmBuf + r->matchField, r->matchValue, r->matchLength) != 0)
+                continue;
+        }
+        match = t;
+        matchTimeLeft = r->timeLeftMs;
+    }
+    if (match == REQUEST_TOKEN_NONE)
+        return 0;
+    
+    uint8_t statusField = pendingRequests[match].statusField;
+    moduleResult_t status = (statusField < (zmBuf[SRSP_LENGTH_FIELD] + SRSP_PAYLOAD_START)) ? 
+        zmBuf[statusField] : INVALID_LENGTH;
+    completeRequest(match, status);
+    return 1;
+}
+
+/** Counts down the timeout of each outstanding request and completes those that have expired with
+a TIMEOUT status.
+@param elapsedMs the time since pipelineTick() was last called
+@note call this from the main loop, not from an interrupt service routine, since the callbacks run
+here.
+*/
+void pipelineTick(uint16_t elapsedMs)
+{
+    requestToken_t t;
+    for (t = 0; t < ZM_PIPELINE_SIZE; t++)
+    {
+        if (!IS_PENDING(t))
+            continue;
+        if (pendingRequests[t].timeLeftMs > elapsedMs)
+            pendingRequests[t].timeLeftMs -= elapsedMs;
+        else
+            completeRequest(t, TIMEOUT);
+    }
+}
+
+/** Forgets an outstanding request without calling its callback. If the response arrives later then 
+pipelineDispatch() won't match it.
+@param token the token of the request
+*/
+void pipelineCancel(requestToken_t token)
+{
+    if (IS_VALID_TOKEN(token))
+        pendingRequests[token].responseCommand = 0;
+}
+
+/** @return how many requests are outstanding */
+uint8_t pipelineOutstanding()
+{
+    uint8_t count = 0;
+    requestToken_t t;
+    for (t = 0; t < ZM_PIPELINE_SIZE; t++)
+    {
+        if (IS_PENDING(t))
+            count++;
+    }
+    return count;
+}
@@ -0,0 +1,75 @@
+/**
+*  @file zm_pipeline.h
+*
+*  @brief  public methods for zm_pipeline.c
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef ZM_PIPELINE_H
+#define ZM_PIPELINE_H
+#include <stdint.h>
+#include "module_errors.h"
+#include "zm_phy.h"
+
+/** Identifies an outstanding request. Given to the callback when the request completes. */
+typedef uint8_t requestToken_t;
+
+/** Returned in place of a token when the request could not be sent */
+#define REQUEST_TOKEN_NONE              0xFF
+
+/** Called from pipelineDispatch() or pipelineTick() when an outstanding request completes. 
+Parameters are the token that the request was given and the status: the status field of the 
+response, or TIMEOUT if no response was received in time. If a response was received then it is in 
+zmBuf while the callback runs; use frameDetach() to keep it. */
+typedef void (*requestCallback_t)(requestToken_t token, moduleResult_t status);
+
+/** Maximum number of outstanding requests. Each uses about 20B of RAM. */
+#ifndef ZM_PIPELINE_SIZE
+#ifdef LAUNCHPAD                        // LaunchPad is RAM limited
+#define ZM_PIPELINE_SIZE                2
+#else
+#define ZM_PIPELINE_SIZE                8
+#endif
+#endif
+
+#if (ZM_PIPELINE_SIZE < 1) || (ZM_PIPELINE_SIZE > 0xFE)
+#error "ZM_PIPELINE_SIZE must be between 1 and 254"
+#endif
+
+/** Longest value that a response can be matched on: an IEEE Address */
+#define PIPELINE_MAX_MATCH_LENGTH       8
+
+/** Default time to wait for the response, in milliseconds */
+#define PIPELINE_DEFAULT_TIMEOUT_MS     5000
+
+moduleResult_t pipelineSend(uint16_t responseCommand, uint8_t matchField, const uint8_t* matchValue, 
+                            uint8_t matchLength, uint8_t statusField, uint16_t timeoutMs,
+                            requestCallback_t callback, requestToken_t* token);
+uint8_t pipelineDispatch();
+void pipelineTick(uint16_t elapsedMs);
+void pipelineCancel(requestToken_t token);
+uint8_t pipelineOutstanding();
+
+#endif
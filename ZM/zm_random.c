@@ -0,0 +1,169 @@
+/**
+* @file zm_random.c
+*
+* @brief Random numbers from a pool in RAM, filled with SYS_RANDOM while the Module is idle.
+*
+* sysRandom() is a full SREQ/SRSP exchange for every 16 bits, which is slow to do in the middle of 
+* sending a message just to get a sequence number or a random delay. Instead, the application loop 
+* calls randomPoolIdle() when it has nothing else to do, and that tops up the pool with a batch of 
+* SYS_RANDOMs whenever it has fallen below ZM_RANDOM_POOL_LOW_WATER bytes:
+<pre>
+    while (1)
+    {
+        if (moduleHasMessageWaiting())
+        {
+            getMessage();
+            handleMessage();
+        } else {
+            randomPoolIdle();
+        }
+    }
+</pre>
+* getRandom8(), getRandom16(), getRandom32() and getRandomBytes() are then served from RAM. If the 
+* pool runs out they fill it from the Module first, so they always return random bytes from the 
+* Module's hardware random number generator, just sometimes more slowly. Each byte is only used once.
+*
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "zm_random.h"
+#include "module.h"
+#include "zm_phy.h"
+#include "zm_frame.h"
+#include "../Common/utilities.h"
+#include <stddef.h>                     //for NULL
+#include <stdint.h>
+
+/** Random bytes that haven't been used yet; the first poolCount bytes are valid */
+static uint8_t pool[ZM_RANDOM_POOL_SIZE];
+static uint8_t poolCount = 0;
+
+/** 
+Private method to fill the pool from the Module with SYS_RANDOM.
+@param stopIfMessageWaiting if set then stops early when the Module has a message for us, so that 
+filling the pool doesn't delay handling it
+@post zmBuf is overwritten
+*/
+static moduleResult_t fillPool(uint8_t stopIfMessageWaiting)
+{
+    while (poolCount < ZM_RANDOM_POOL_SIZE)
+    {
+        if (stopIfMessageWaiting && moduleHasMessageWaiting())
+            break;
+        moduleResult_t result = sysRandom();
+        if (result != MODULE_SUCCESS)
+            return result;
+        uint16_t r = SYS_RANDOM_RESULT();
+        pool[poolCount++] = LSB(r);
+        if (poolCount < ZM_RANDOM_POOL_SIZE)            //bytes are taken one at a time, so only one slot may be left
+            pool[poolCount++] = MSB(r);
+    }
+    return MODULE_SUCCESS;
+}
+
+#define METHOD_RANDOM_POOL_IDLE                 0x8100
+/** 
+Refills the random number pool if it has fewer than ZM_RANDOM_POOL_LOW_WATER bytes left. Call it 
+from the application loop when there is no message to handle. Filling stops early if a message 
+arrives from the Module, and continues on the next call.
+@return MODULE_SUCCESS, or the error from SYS_RANDOM
+@post zmBuf is overwritten if the pool was refilled
+*/
+moduleResult_t randomPoolIdle()
+{
+    if (poolCount >= ZM_RANDOM_POOL_LOW_WATER)
+        return MODULE_SUCCESS;
+    RETURN_RESULT(fillPool(1), METHOD_RANDOM_POOL_IDLE);
+}
+
+/** 
+@return how many random bytes are in the pool
+*/
+uint8_t randomPoolCount()
+{
+    return poolCount;
+}
+
+#define METHOD_GET_RANDOM_BYTES                 0x8200
+/** 
+Copies random bytes from the pool. If there aren't enough then the pool is refilled from the Module 
+first, which takes one SYS_RANDOM per two bytes.
+@param data where to put the random bytes
+@param length how many random bytes
+@return MODULE_SUCCESS, or the error from SYS_RANDOM if the pool had to be refilled and couldn't be
+@post zmBuf is overwritten if the pool had to be refilled
+*/
+moduleResult_t getRandomBytes(uint8_t* data, uint8_t length)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((data == NULL), METHOD_GET_RANDOM_BYTES);
+    while (length > 0)
+    {
+        if (poolCount == 0)
+        {
+            RETURN_RESULT_IF_FAIL(fillPool(0), METHOD_GET_RANDOM_BYTES);
+        }
+        *data++ = pool[--poolCount];
+        length--;
+    }
+    return MODULE_SUCCESS;
+}
+
+//note: no method ID for this one; errors are reported by getRandomBytes().
+/** 
+Gets a random number from the pool, see getRandomBytes().
+@param value the random number
+*/
+moduleResult_t getRandom8(uint8_t* value)
+{
+    return getRandomBytes(value, 1);
+}
+
+#define METHOD_GET_RANDOM_16                    0x8300
+/** 
+Gets a random number from the pool, see getRandomBytes().
+@param value the random number
+*/
+moduleResult_t getRandom16(uint16_t* value)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((value == NULL), METHOD_GET_RANDOM_16);
+    uint8_t r[2];
+    RETURN_RESULT_IF_FAIL(getRandomBytes(r, sizeof(r)), METHOD_GET_RANDOM_16);
+    *value = ((uint16_t) r[1] << 8) | r[0];
+    return MODULE_SUCCESS;
+}
+
+#define METHOD_GET_RANDOM_32                    0x8400
+/** 
+Gets a random number from the pool, see getRandomBytes().
+@param value the random number
+*/
+moduleResult_t getRandom32(uint32_t* value)
+{
+    RETURN_NULL_PARAMETER_IF_TRUE((value == NULL), METHOD_GET_RANDOM_32);
+    uint8_t r[4];
+    RETURN_RESULT_IF_FAIL(getRandomBytes(r, sizeof(r)), METHOD_GET_RANDOM_32);
+    *value = ((uint32_t) r[3] << 24) | ((uint32_t) r[2] << 16) | ((uint16_t) r[1] << 8) | r[0];
+    return MODULE_SUCCESS;
+}
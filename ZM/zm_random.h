@@ -0,0 +1,61 @@
+/**
+* @file zm_random.h
+*
+* @brief public methods for zm_random.c
+*
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef ZM_RANDOM_H
+#define ZM_RANDOM_H
+#include <stdint.h>
+#include "module_errors.h"
+
+/** Number of random bytes kept in RAM. Each SYS_RANDOM returns two bytes. */
+#ifndef ZM_RANDOM_POOL_SIZE
+#ifdef LAUNCHPAD                        // LaunchPad is RAM limited
+#define ZM_RANDOM_POOL_SIZE             16
+#else
+#define ZM_RANDOM_POOL_SIZE             32
+#endif
+#endif
+
+/** randomPoolIdle() refills the pool when it has fewer bytes than this */
+#ifndef ZM_RANDOM_POOL_LOW_WATER
+#define ZM_RANDOM_POOL_LOW_WATER        (ZM_RANDOM_POOL_SIZE / 2)
+#endif
+
+#if (ZM_RANDOM_POOL_SIZE < 2) || (ZM_RANDOM_POOL_SIZE > 0xFE)
+#error "ZM_RANDOM_POOL_SIZE must be between 2 and 254"
+#endif
+
+moduleResult_t randomPoolIdle();
+uint8_t randomPoolCount();
+moduleResult_t getRandomBytes(uint8_t* data, uint8_t length);
+moduleResult_t getRandom8(uint8_t* value);
+moduleResult_t getRandom16(uint16_t* value);
+moduleResult_t getRandom32(uint32_t* value);
+
+#endif
@@ -0,0 +1,601 @@
+/**
+* @file zm_transfer.c
+*
+* @brief Reliable transfer of objects larger than an extended message, e.g. firmware images, logs or 
+* calibration tables, as a series of AF messages.
+*
+* The object is split into numbered blocks of TRANSFER_BLOCK_LENGTH bytes. The sender sends up to 
+* TRANSFER_WINDOW blocks in a burst, without waiting for each to be acknowledged, and marks the last 
+* one with TRANSFER_MESSAGE_DATA_LAST. The receiver then answers with a TRANSFER_MESSAGE_ACK that 
+* holds its cursor, the number of blocks received without a gap, and a bitmap of the blocks after the
+* cursor that it has received. The next burst starts at the cursor and skips the blocks in the bitmap,
+* so only missing blocks are sent again. If the acknowledgement doesn't arrive then the sender sends 
+* the last block of the burst again after TRANSFER_ACK_TIMEOUT_MS.
+*
+* The receiver keeps its cursor in NV item TRANSFER_NV_ITEM of the Module. A transfer always begins 
+* with a TRANSFER_MESSAGE_START that names the object and its length, and if the receiver has part 
+* of that object already then its answer makes the sender resume from there, e.g. after a reset.
+*
+* Messages, all values LSB first:
+* - START: type, object ID (2), length (4), block length (1)
+* - DATA, DATA_LAST: type, block number (2), data
+* - ACK: type, status, object ID (2), cursor (2), bitmap (2). Bit 0 of the bitmap is block cursor+1.
+*
+* Both sides are non-blocking, like the pipeline: transferDispatch() is given each received message 
+* and transferTick() is called periodically. The blocks are sent with afSendDataWindowed(), so 
+* AF_DATA_CONFIRMs must be given to pipelineDispatch():
+<pre>
+    transferReceiveBegin(DEFAULT_ENDPOINT, LOG_TRANSFER_CLUSTER, writeToFlash, transferDone);
+    while (1)
+    {
+        if (moduleHasMessageWaiting())
+        {
+            getMessage();
+            if (!pipelineDispatch() && !transferDispatch())
+                handleMessage();
+        }
+        if (tickFlag)
+        {
+            pipelineTick(10);
+            transferTick(10);
+        }
+    }
+</pre>
+*
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "zm_transfer.h"
+#include "af.h"
+#include "module.h"
+#include "zm_pipeline.h"
+#include "../Common/utilities.h"
+#include <stddef.h>                     //for NULL
+#include <stdint.h>
+
+//Fields of the messages
+#define TRANSFER_TYPE_FIELD             0
+#define TRANSFER_START_OBJECT_FIELD     1
+#define TRANSFER_START_LENGTH_FIELD     3
+#define TRANSFER_START_BLOCK_LENGTH_FIELD   7
+#define TRANSFER_START_LENGTH           8
+#define TRANSFER_DATA_BLOCK_FIELD       1
+#define TRANSFER_DATA_START_FIELD       TRANSFER_DATA_HEADER_LENGTH
+#define TRANSFER_ACK_STATUS_FIELD       1
+#define TRANSFER_ACK_OBJECT_FIELD       2
+#define TRANSFER_ACK_CURSOR_FIELD       4
+#define TRANSFER_ACK_BITMAP_FIELD       6
+#define TRANSFER_ACK_LENGTH             8
+
+#define GET_U16(p)                      (CONVERT_TO_INT((p)[0], (p)[1]))
+#define BIT(n)                          ((uint16_t) 1 << (n))
+
+/** Builds each message that is sent */
+static uint8_t transferBuffer[MAXIMUM_PAYLOAD_LENGTH];
+static struct transferStatistics transferStatistics;
+
+//
+//  Sender
+//
+static uint8_t sendState = TRANSFER_IDLE;
+static uint8_t sendDestinationEndpoint;
+static uint8_t sendSourceEndpoint;
+static uint16_t sendAddress;
+static uint16_t sendCluster;
+static uint16_t sendObjectId;
+static uint32_t sendLength;
+static uint16_t sendBlocks;
+static uint16_t sendCursor;                     //blocks acknowledged without a gap
+static uint16_t sendBitmap;                     //blocks after the cursor that were acknowledged
+static uint16_t sendHighest;                    //one more than the highest block sent so far
+static uint16_t sendLastBlock;                  //the last block of the last burst
+static uint8_t sendBurstPending;                //an acknowledgement arrived; send the next burst
+static uint16_t sendTimerMs;
+static uint8_t sendRetries;
+static transferSource_t sendSource;
+static transferCallback_t sendCallback;
+
+//
+//  Receiver
+//
+static uint8_t receiveState = TRANSFER_IDLE;
+static uint8_t receiveEndpoint;
+static uint16_t receiveCluster;
+static uint16_t receiveAddress;
+static uint8_t receiveSourceEndpoint;
+static uint16_t receiveObjectId;
+static uint32_t receiveLength;
+static uint16_t receiveBlocks;
+static uint16_t receiveCursor;
+static uint16_t receiveBitmap;
+static uint16_t receivePersistedCursor;
+static uint16_t receiveTimerMs;
+static transferSink_t receiveSink;
+static transferCallback_t receiveCallback;
+
+static uint16_t blocksForLength(uint32_t length)
+{
+    return (uint16_t) ((length + TRANSFER_BLOCK_LENGTH - 1) / TRANSFER_BLOCK_LENGTH);
+}
+
+static uint8_t blockLength(uint16_t block, uint32_t length)
+{
+    uint32_t remaining = length - ((uint32_t) block * TRANSFER_BLOCK_LENGTH);
+    return (remaining > TRANSFER_BLOCK_LENGTH) ? TRANSFER_BLOCK_LENGTH : (uint8_t) remaining;
+}
+
+/** Adds elapsedMs to a timer. Returns true (1) if the timer has reached timeoutMs. */
+static uint8_t timerExpired(uint16_t* timerMs, uint16_t elapsedMs, uint16_t timeoutMs)
+{
+    if (elapsedMs >= (timeoutMs - *timerMs))
+        return 1;
+    *timerMs += elapsedMs;
+    return 0;
+}
+
+//
+//  Cursor in NV memory: object ID, length, cursor and a check byte
+//
+#define TRANSFER_RECORD_LENGTH          9
+#define TRANSFER_RECORD_CHECK           0xA5
+
+#if (TRANSFER_NV_ITEM != 0)
+/** Writes the cursor of the receiver to NV memory. A failed write is ignored: a resume then just 
+starts further back. */
+static void transferPersist()
+{
+    uint8_t record[TRANSFER_RECORD_LENGTH];
+    uint8_t i;
+    record[0] = LSB(receiveObjectId);
+    record[1] = MSB(receiveObjectId);
+    for (i = 0; i < 4; i++)
+        record[2 + i] = (uint8_t) (receiveLength >> (8 * i));
+    record[6] = LSB(receiveCursor);
+    record[7] = MSB(receiveCursor);
+    record[8] = TRANSFER_RECORD_CHECK;
+    for (i = 0; i < 8; i++)
+        record[8] ^= record[i];
+    sysNvWriteBytes(NV_USER_ITEM_ID(TRANSFER_NV_ITEM), 0, TRANSFER_RECORD_LENGTH, record);
+    receivePersistedCursor = receiveCursor;
+}
+
+/** Returns the cursor in NV memory if it is for this object, else 0 */
+static uint16_t transferResumeCursor(uint16_t objectId, uint32_t length)
+{
+    uint8_t record[TRANSFER_RECORD_LENGTH];
+    uint8_t check = TRANSFER_RECORD_CHECK;
+    uint32_t recordLength = 0;
+    uint8_t i;
+    if (sysNvReadBytes(NV_USER_ITEM_ID(TRANSFER_NV_ITEM), 0, TRANSFER_RECORD_LENGTH, record) != MODULE_SUCCESS)
+        return 0;
+    for (i = 0; i < 8; i++)
+        check ^= record[i];
+    for (i = 0; i < 4; i++)
+        recordLength |= (uint32_t) record[2 + i] << (8 * i);
+    if ((check != record[8]) || (GET_U16(record) != objectId) || (recordLength != length))
+        return 0;
+    uint16_t cursor = GET_U16(record + 6);
+    return (cursor > blocksForLength(length)) ? 0 : cursor;
+}
+#else
+static void transferPersist() 
+{
+    receivePersistedCursor = receiveCursor;
+}
+#define transferResumeCursor(objectId, length)  0
+#endif
+
+//
+//  Sender
+//
+static void transferSendEnd(uint8_t state, moduleResult_t result)
+{
+    sendState = state;
+    if (sendCallback != NULL)
+        sendCallback(state, result);
+}
+
+#define METHOD_TRANSFER_SEND_START                  0xA400
+static moduleResult_t transferSendStart()
+{
+    uint8_t i;
+    transferBuffer[TRANSFER_TYPE_FIELD] = TRANSFER_MESSAGE_START;
+    transferBuffer[TRANSFER_START_OBJECT_FIELD] = LSB(sendObjectId);
+    transferBuffer[TRANSFER_START_OBJECT_FIELD + 1] = MSB(sendObjectId);
+    for (i = 0; i < 4; i++)
+        transferBuffer[TRANSFER_START_LENGTH_FIELD + i] = (uint8_t) (sendLength >> (8 * i));
+    transferBuffer[TRANSFER_START_BLOCK_LENGTH_FIELD] = TRANSFER_BLOCK_LENGTH;
+    sendTimerMs = 0;
+    RETURN_RESULT(afSendDataWindowed(sendDestinationEndpoint, sendSourceEndpoint, sendAddress, sendCluster, 
+                                     transferBuffer, TRANSFER_START_LENGTH, NULL), METHOD_TRANSFER_SEND_START);
+}
+
+#define METHOD_TRANSFER_SEND_BLOCK                  0xA500
+/** Sends one block. If the source fails then the transfer fails. */
+static moduleResult_t transferSendBlock(uint16_t block, uint8_t type)
+{
+    uint8_t length = blockLength(block, sendLength);
+    moduleResult_t result = sendSource((uint32_t) block * TRANSFER_BLOCK_LENGTH, 
+                                       transferBuffer + TRANSFER_DATA_START_FIELD, length);
+    if (result != MODULE_SUCCESS)
+    {
+        transferSendEnd(TRANSFER_FAILED, result);
+        RETURN_RESULT(result, METHOD_TRANSFER_SEND_BLOCK);
+    }
+    transferBuffer[TRANSFER_TYPE_FIELD] = type;
+    transferBuffer[TRANSFER_DATA_BLOCK_FIELD] = LSB(block);
+    transferBuffer[TRANSFER_DATA_BLOCK_FIELD + 1] = MSB(block);
+    transferStatistics.blocksSent++;
+    if (block < sendHighest)
+        transferStatistics.blocksRetransmitted++;
+    else
+        sendHighest = block + 1;
+    RETURN_RESULT(afSendDataWindowed(sendDestinationEndpoint, sendSourceEndpoint, sendAddress, sendCluster, 
+                                     transferBuffer, TRANSFER_DATA_HEADER_LENGTH + length, NULL), 
+                  METHOD_TRANSFER_SEND_BLOCK);
+}
+
+/** Sends the blocks in the window after the cursor that the receiver doesn't have yet */
+static moduleResult_t transferSendBurst()
+{
+    uint8_t i;
+    uint8_t last = 0;
+    sendBurstPending = 0;
+    sendTimerMs = 0;
+    for (i = 0; (i < TRANSFER_WINDOW) && ((sendCursor + i) < sendBlocks); i++)
+    {
+        if ((i == 0) || !(sendBitmap & BIT(i - 1)))
+            last = i;
+    }
+    sendLastBlock = sendCursor + last;
+    for (i = 0; i <= last; i++)
+    {
+        if ((i == 0) || !(sendBitmap & BIT(i - 1)))
+        {
+            RETURN_RESULT_IF_FAIL(transferSendBlock(sendCursor + i, (i == last) ? TRANSFER_MESSAGE_DATA_LAST : 
+                                                    TRANSFER_MESSAGE_DATA), METHOD_TRANSFER_SEND_BLOCK);
+        }
+    }
+    return MODULE_SUCCESS;
+}
+
+static void transferHandleAck(const uint8_t* ack)
+{
+    uint16_t cursor = GET_U16(ack + TRANSFER_ACK_CURSOR_FIELD);
+    transferStatistics.acksReceived++;
+    if (ack[TRANSFER_ACK_STATUS_FIELD] != MODULE_SUCCESS)
+    {
+        transferSendEnd(TRANSFER_FAILED, ack[TRANSFER_ACK_STATUS_FIELD]);
+        return;
+    }
+    if (cursor >= sendBlocks)
+    {
+        transferSendEnd(TRANSFER_DONE, MODULE_SUCCESS);
+        return;
+    }
+    if ((sendState == TRANSFER_SENDING) && (cursor < sendCursor))
+        return;                                     //an old acknowledgement
+    sendCursor = cursor;
+    sendBitmap = GET_U16(ack + TRANSFER_ACK_BITMAP_FIELD);
+    if (sendState == TRANSFER_STARTING)
+        sendHighest = cursor;                       //resuming: blocks before the cursor weren't sent now
+    sendState = TRANSFER_SENDING;
+    sendRetries = 0;
+    sendBurstPending = 1;
+}
+
+#define METHOD_TRANSFER_SEND_BEGIN                  0xA100
+/** Starts to send an object to another device, which must have called transferReceiveBegin(). If a
+transfer is being sent already then it is replaced. The receiver answers with how much of the object
+it has already, so a transfer that was interrupted, e.g. by a reset, resumes where it stopped.
+@param objectId identifies the object, e.g. a firmware version; with length it tells the receiver 
+whether it is the object that it has part of.
+@param length length of the object, 1 .. TRANSFER_MAX_LENGTH
+@param source called with each block of the object as it is sent
+@param callback called with TRANSFER_DONE when the receiver has the whole object, or with 
+TRANSFER_FAILED and the error. May be NULL.
+@see afSendData for description of the other fields.
+@return MODULE_SUCCESS, or an error if the start message couldn't be sent. In that case it is sent 
+again by transferTick().
+*/
+moduleResult_t transferSendBegin(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                                 uint16_t destinationShortAddress, uint16_t clusterId, 
+                                 uint16_t objectId, uint32_t length, 
+                                 transferSource_t source, transferCallback_t callback)
+{
+    RETURN_INVALID_LENGTH_IF_TRUE( ((length == 0) || (length > TRANSFER_MAX_LENGTH)), METHOD_TRANSFER_SEND_BEGIN);
+    RETURN_INVALID_CLUSTER_IF_TRUE( (clusterId == 0), METHOD_TRANSFER_SEND_BEGIN);
+    RETURN_NULL_PARAMETER_IF_TRUE( (source == NULL), METHOD_TRANSFER_SEND_BEGIN);
+    sendDestinationEndpoint = destinationEndpoint;
+    sendSourceEndpoint = sourceEndpoint;
+    sendAddress = destinationShortAddress;
+    sendCluster = clusterId;
+    sendObjectId = objectId;
+    sendLength = length;
+    sendBlocks = blocksForLength(length);
+    sendCursor = 0;
+    sendBitmap = 0;
+    sendHighest = 0;
+    sendBurstPending = 0;
+    sendRetries = 0;
+    sendSource = source;
+    sendCallback = callback;
+    sendState = TRANSFER_STARTING;
+    RETURN_RESULT(transferSendStart(), METHOD_TRANSFER_SEND_BEGIN);
+}
+
+//
+//  Receiver
+//
+static void transferReceiveEnd(uint8_t state, moduleResult_t result)
+{
+    receiveState = TRANSFER_LISTENING;
+    if (receiveCallback != NULL)
+        receiveCallback(state, result);
+}
+
+/** Acknowledges the blocks received so far, or rejects the transfer if status is an error. 
+@param address the sender, which is not receiveAddress if a new transfer is rejected
+*/
+static void transferSendAckTo(uint16_t address, uint8_t sourceEndpoint, moduleResult_t status, uint16_t objectId)
+{
+    transferBuffer[TRANSFER_TYPE_FIELD] = TRANSFER_MESSAGE_ACK;
+    transferBuffer[TRANSFER_ACK_STATUS_FIELD] = status;
+    transferBuffer[TRANSFER_ACK_OBJECT_FIELD] = LSB(objectId);
+    transferBuffer[TRANSFER_ACK_OBJECT_FIELD + 1] = MSB(objectId);
+    transferBuffer[TRANSFER_ACK_CURSOR_FIELD] = LSB(receiveCursor);
+    transferBuffer[TRANSFER_ACK_CURSOR_FIELD + 1] = MSB(receiveCursor);
+    transferBuffer[TRANSFER_ACK_BITMAP_FIELD] = LSB(receiveBitmap >> 1);
+    transferBuffer[TRANSFER_ACK_BITMAP_FIELD + 1] = MSB(receiveBitmap >> 1);
+    afSendData(sourceEndpoint, receiveEndpoint, address, receiveCluster, 
+               transferBuffer, TRANSFER_ACK_LENGTH);    //if lost, the sender asks again
+}
+
+/** Acknowledges the blocks of the transfer being received, see transferSendAckTo() */
+static void transferSendAck(moduleResult_t status, uint16_t objectId)
+{
+    transferSendAckTo(receiveAddress, receiveSourceEndpoint, status, objectId);
+}
+
+static void transferHandleStart(const uint8_t* start, uint16_t address, uint8_t sourceEndpoint)
+{
+    uint16_t objectId = GET_U16(start + TRANSFER_START_OBJECT_FIELD);
+    uint32_t length = 0;
+    uint8_t i;
+    for (i = 0; i < 4; i++)
+        length |= (uint32_t) start[TRANSFER_START_LENGTH_FIELD + i] << (8 * i);
+    uint8_t startBlockLength = start[TRANSFER_START_BLOCK_LENGTH_FIELD];
+    
+    uint8_t sameTransfer = (receiveState == TRANSFER_RECEIVING) && (address == receiveAddress) && 
+        (sourceEndpoint == receiveSourceEndpoint) && (objectId == receiveObjectId) && (length == receiveLength);
+    if (sameTransfer)                               //the sender started again, e.g. after a reset
+    {
+        receiveTimerMs = 0;
+        transferSendAck(MODULE_SUCCESS, objectId);
+        return;
+    }
+    if ((startBlockLength != TRANSFER_BLOCK_LENGTH) || (length == 0) || (length > TRANSFER_MAX_LENGTH))
+    {
+        transferSendAckTo(address, sourceEndpoint, INVALID_LENGTH, objectId);    //a transfer being received continues
+        return;
+    }
+    if (receiveState == TRANSFER_RECEIVING)         //a different transfer replaces this one
+        transferPersist();
+    receiveAddress = address;
+    receiveSourceEndpoint = sourceEndpoint;
+    receiveCursor = transferResumeCursor(objectId, length);
+    receiveObjectId = objectId;
+    receiveLength = length;
+    receiveBlocks = blocksForLength(length);
+    receiveBitmap = 0;
+    receiveTimerMs = 0;
+    receiveState = TRANSFER_RECEIVING;
+    if (receiveCallback != NULL)
+        receiveCallback(TRANSFER_RECEIVING, MODULE_SUCCESS);
+    transferPersist();
+    transferSendAck(MODULE_SUCCESS, objectId);
+    if (receiveCursor == receiveBlocks)             //had all of it already
+        transferReceiveEnd(TRANSFER_DONE, MODULE_SUCCESS);
+}
+
+static void transferHandleData(const uint8_t* data, uint8_t dataLength, uint16_t address)
+{
+    if ((receiveState != TRANSFER_RECEIVING) || (address != receiveAddress))
+        return;
+    uint8_t type = data[TRANSFER_TYPE_FIELD];         //data is in zmBuf, which the sink and transferPersist() may overwrite
+    uint16_t block = GET_U16(data + TRANSFER_DATA_BLOCK_FIELD);
+    if ((block >= receiveBlocks) || ((dataLength - TRANSFER_DATA_HEADER_LENGTH) != blockLength(block, receiveLength)))
+        return;
+    receiveTimerMs = 0;
+    if ((block >= receiveCursor) && ((block - receiveCursor) < TRANSFER_WINDOW) && 
+        !(receiveBitmap & BIT(block - receiveCursor)))
+    {
+        moduleResult_t result = receiveSink((uint32_t) block * TRANSFER_BLOCK_LENGTH, 
+                                            data + TRANSFER_DATA_START_FIELD, dataLength - TRANSFER_DATA_HEADER_LENGTH);
+        if (result != MODULE_SUCCESS)
+        {
+            transferPersist();
+            transferSendAck(result, receiveObjectId);
+            transferReceiveEnd(TRANSFER_FAILED, result);
+            return;
+        }
+        receiveBitmap |= BIT(block - receiveCursor);
+        while (receiveBitmap & 1)
+        {
+            receiveBitmap >>= 1;
+            receiveCursor++;
+        }
+        if (receiveCursor == receiveBlocks)
+        {
+            transferPersist();
+            transferSendAck(MODULE_SUCCESS, receiveObjectId);
+            transferReceiveEnd(TRANSFER_DONE, MODULE_SUCCESS);
+            return;
+        }
+        if ((receiveCursor - receivePersistedCursor) >= TRANSFER_PERSIST_BLOCKS)
+            transferPersist();
+    }
+    if (type == TRANSFER_MESSAGE_DATA_LAST)
+        transferSendAck(MODULE_SUCCESS, receiveObjectId);
+}
+
+#define METHOD_TRANSFER_RECEIVE_BEGIN               0xA200
+/** Starts to listen for objects sent with transferSendBegin(). Each object is received in the 
+background, by transferDispatch() and transferTick(), and then the receiver listens again.
+@param endpoint the endpoint that receives the objects
+@param clusterId the cluster that the sender uses for the transfer
+@param sink called with each block of the object as it is received
+@param callback called with TRANSFER_RECEIVING when an object starts to arrive, with TRANSFER_DONE 
+when all of it has been given to the sink, and with TRANSFER_FAILED and the error if the sink fails or 
+the sender stops sending. May be NULL.
+*/
+moduleResult_t transferReceiveBegin(uint8_t endpoint, uint16_t clusterId, 
+                                    transferSink_t sink, transferCallback_t callback)
+{
+    RETURN_INVALID_PARAMETER_IF_TRUE( (endpoint == 0), METHOD_TRANSFER_RECEIVE_BEGIN);
+    RETURN_INVALID_CLUSTER_IF_TRUE( (clusterId == 0), METHOD_TRANSFER_RECEIVE_BEGIN);
+    RETURN_NULL_PARAMETER_IF_TRUE( (sink == NULL), METHOD_TRANSFER_RECEIVE_BEGIN);
+    receiveEndpoint = endpoint;
+    receiveCluster = clusterId;
+    receiveSink = sink;
+    receiveCallback = callback;
+    receiveState = TRANSFER_LISTENING;
+    return MODULE_SUCCESS;
+}
+
+/** Stops the transfer being sent and stops listening for transfers, without calling the callbacks. 
+The cursor of a transfer being received is kept, so it can be resumed. */
+void transferCancel()
+{
+    if (receiveState == TRANSFER_RECEIVING)
+        transferPersist();
+    sendState = TRANSFER_IDLE;
+    receiveState = TRANSFER_IDLE;
+}
+
+/**
+Gives the message in zmBuf to the transfers, see transferSendBegin() and transferReceiveBegin().
+@return 1 if the message was for a transfer. Otherwise 0 and the application should handle the message.
+*/
+uint8_t transferDispatch()
+{
+    if (!IS_AF_INCOMING_MESSAGE() || (AF_INCOMING_MESSAGE_PAYLOAD_LEN == 0))
+        return 0;
+    const uint8_t* payload = zmBuf + AF_INCOMING_MESSAGE_PAYLOAD_START_FIELD;
+    uint8_t length = AF_INCOMING_MESSAGE_PAYLOAD_LEN;
+    uint16_t cluster = AF_INCOMING_MESSAGE_CLUSTER();
+    uint16_t address = AF_INCOMING_MESSAGE_SHORT_ADDRESS();
+    
+    if (((sendState == TRANSFER_STARTING) || (sendState == TRANSFER_SENDING)) && (cluster == sendCluster) && 
+        (payload[TRANSFER_TYPE_FIELD] == TRANSFER_MESSAGE_ACK))
+    {
+        if ((length >= TRANSFER_ACK_LENGTH) && (address == sendAddress) && 
+            (GET_U16(payload + TRANSFER_ACK_OBJECT_FIELD) == sendObjectId))
+            transferHandleAck(payload);
+        return 1;
+    }
+    if ((receiveState == TRANSFER_IDLE) || (cluster != receiveCluster) || 
+        (zmBuf[AF_INCOMING_MESSAGE_DESTINATION_EP_FIELD] != receiveEndpoint))
+        return 0;
+    switch (payload[TRANSFER_TYPE_FIELD])
+    {
+    case TRANSFER_MESSAGE_START:
+        if (length >= TRANSFER_START_LENGTH)
+            transferHandleStart(payload, address, zmBuf[AF_INCOMING_MESSAGE_SOURCE_EP_FIELD]);
+        return 1;
+    case TRANSFER_MESSAGE_DATA:
+    case TRANSFER_MESSAGE_DATA_LAST:
+        if (length > TRANSFER_DATA_HEADER_LENGTH)
+            transferHandleData(payload, length, address);
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+#define METHOD_TRANSFER_TICK                        0xA300
+/** Sends the next burst of blocks once the receiver has acknowledged the last one, and handles the 
+timeouts of both sides. Call periodically, e.g. from the same timer as pipelineTick().
+@param elapsedMs time since the last call, in milliseconds
+@return MODULE_SUCCESS, or the error if a message couldn't be sent. It is sent again after 
+TRANSFER_ACK_TIMEOUT_MS.
+*/
+moduleResult_t transferTick(uint16_t elapsedMs)
+{
+    moduleResult_t result = MODULE_SUCCESS;
+    if (receiveState == TRANSFER_RECEIVING)
+    {
+        if (timerExpired(&receiveTimerMs, elapsedMs, TRANSFER_RECEIVE_TIMEOUT_MS))
+        {
+            transferPersist();
+            transferReceiveEnd(TRANSFER_FAILED, TIMEOUT);
+        }
+    }
+    if ((sendState != TRANSFER_STARTING) && (sendState != TRANSFER_SENDING))
+        return MODULE_SUCCESS;
+    if (sendBurstPending)
+    {
+        result = transferSendBurst();
+    } else if (timerExpired(&sendTimerMs, elapsedMs, TRANSFER_ACK_TIMEOUT_MS)) {
+        transferStatistics.timeouts++;
+        if (++sendRetries > TRANSFER_MAX_RETRIES)
+        {
+            transferSendEnd(TRANSFER_FAILED, TIMEOUT);
+            RETURN_RESULT(TIMEOUT, METHOD_TRANSFER_TICK);
+        }
+        sendTimerMs = 0;
+        if (sendState == TRANSFER_STARTING)
+            result = transferSendStart();
+        else
+            result = transferSendBlock(sendLastBlock, TRANSFER_MESSAGE_DATA_LAST);
+    }
+    RETURN_RESULT(result, METHOD_TRANSFER_TICK);
+}
+
+/** Returns the state of the sender: TRANSFER_IDLE, TRANSFER_STARTING, TRANSFER_SENDING, TRANSFER_DONE 
+or TRANSFER_FAILED */
+uint8_t transferSendState()
+{
+    return sendState;
+}
+
+/** Returns the state of the receiver: TRANSFER_IDLE, TRANSFER_LISTENING or TRANSFER_RECEIVING */
+uint8_t transferReceiveState()
+{
+    return receiveState;
+}
+
+/** Returns how much of the object being received, or received last, has been received without a gap */
+uint32_t transferReceivedLength()
+{
+    uint32_t length = (uint32_t) receiveCursor * TRANSFER_BLOCK_LENGTH;
+    return (length > receiveLength) ? receiveLength : length;
+}
+
+/** Returns the counters of the sender */
+const struct transferStatistics* transferGetStatistics()
+{
+    return &transferStatistics;
+}
@@ -0,0 +1,141 @@
+/**
+* @file zm_transfer.h
+*
+* @brief public methods for zm_transfer.c
+*
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED AS IS 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef ZM_TRANSFER_H
+#define ZM_TRANSFER_H
+#include <stdint.h>
+#include "module_errors.h"
+#include "module.h"
+#include "af.h"
+#include "module_utilities.h"
+
+/** Supplies part of an object as it is sent, see transferSendBegin(). Must copy length bytes of the 
+object, starting at offset, to destination. Returns MODULE_SUCCESS, or an error to stop the transfer. */
+typedef moduleResult_t (*transferSource_t)(uint32_t offset, uint8_t* destination, uint8_t length);
+
+/** Consumes part of an object as it is received, see transferReceiveBegin(). data holds length bytes 
+of the object starting at offset; it points into zmBuf so copy what is needed before calling any 
+library methods. Blocks may arrive out of order and more than once. Returns MODULE_SUCCESS, or an 
+error to stop the transfer. */
+typedef moduleResult_t (*transferSink_t)(uint32_t offset, const uint8_t* data, uint8_t length);
+
+/** Called when a transfer changes state, with TRANSFER_RECEIVING, TRANSFER_DONE or TRANSFER_FAILED */
+typedef void (*transferCallback_t)(uint8_t state, moduleResult_t result);
+
+//States of the sender and of the receiver
+#define TRANSFER_IDLE                   0
+#define TRANSFER_STARTING               1       //sender: waiting for the receiver to answer the start
+#define TRANSFER_SENDING                2       //sender: waiting for the acknowledgement of a burst
+#define TRANSFER_LISTENING              3       //receiver: waiting for a transfer to start
+#define TRANSFER_RECEIVING              4       //receiver: receiving blocks
+#define TRANSFER_DONE                   5
+#define TRANSFER_FAILED                 6
+
+//Messages, the first byte of the payload
+#define TRANSFER_MESSAGE_START          0x01
+#define TRANSFER_MESSAGE_DATA           0x02    //a block
+#define TRANSFER_MESSAGE_DATA_LAST      0x03    //the last block of a burst; the receiver acknowledges
+#define TRANSFER_MESSAGE_ACK            0x04
+
+/** Each block is preceded by the message type and the block number */
+#define TRANSFER_DATA_HEADER_LENGTH     3
+#define TRANSFER_BLOCK_LENGTH           (AF_MAXIMUM_DATA_LENGTH - TRANSFER_DATA_HEADER_LENGTH)
+#define TRANSFER_MAX_BLOCKS             0xFFFF
+#define TRANSFER_MAX_LENGTH             ((uint32_t) TRANSFER_MAX_BLOCKS * TRANSFER_BLOCK_LENGTH)
+
+/** Blocks that may be sent before the receiver acknowledges them, at most 16 */
+#ifndef TRANSFER_WINDOW
+#ifdef LAUNCHPAD
+#define TRANSFER_WINDOW                 4
+#else
+#define TRANSFER_WINDOW                 8
+#endif
+#endif
+#if (TRANSFER_WINDOW < 1) || (TRANSFER_WINDOW > 16)
+#error "TRANSFER_WINDOW must be 1 .. 16"
+#endif
+
+/** How long the sender waits for an acknowledgement before it asks again */
+#ifndef TRANSFER_ACK_TIMEOUT_MS
+#define TRANSFER_ACK_TIMEOUT_MS         1000
+#endif
+
+/** How many times in a row the sender asks for an acknowledgement before the transfer fails */
+#ifndef TRANSFER_MAX_RETRIES
+#define TRANSFER_MAX_RETRIES            5
+#endif
+
+/** How long the receiver waits for the next block before the transfer fails */
+#ifndef TRANSFER_RECEIVE_TIMEOUT_MS
+#define TRANSFER_RECEIVE_TIMEOUT_MS     ((TRANSFER_MAX_RETRIES + 1) * TRANSFER_ACK_TIMEOUT_MS)
+#endif
+
+/** User NV item where the receiver keeps its cursor, so that a transfer resumes after a reset of 
+either side. Must be one of the 16 byte items, 5 or 6, since items 1 .. 4 are too short for the 
+9 byte cursor record, and not WARM_START_NV_ITEM. 0 to not keep the cursor. */
+#ifndef TRANSFER_NV_ITEM
+#define TRANSFER_NV_ITEM                5
+#endif
+#if (TRANSFER_NV_ITEM != 0) && (TRANSFER_NV_ITEM != 5) && (TRANSFER_NV_ITEM != 6)
+#error "TRANSFER_NV_ITEM must be 0, 5 or 6"
+#endif
+#if (TRANSFER_NV_ITEM == WARM_START_NV_ITEM)
+#error "TRANSFER_NV_ITEM must not be WARM_START_NV_ITEM, which saveNetworkState() uses"
+#endif
+
+/** The cursor is written to NV memory each time it has moved this many blocks, and at the end */
+#ifndef TRANSFER_PERSIST_BLOCKS
+#define TRANSFER_PERSIST_BLOCKS         32
+#endif
+
+/** Counters of the sender, since the program started */
+struct transferStatistics
+{
+    uint32_t blocksSent;                //including retransmissions
+    uint32_t blocksRetransmitted;
+    uint32_t acksReceived;
+    uint32_t timeouts;
+};
+
+moduleResult_t transferSendBegin(uint8_t destinationEndpoint, uint8_t sourceEndpoint, 
+                                 uint16_t destinationShortAddress, uint16_t clusterId, 
+                                 uint16_t objectId, uint32_t length, 
+                                 transferSource_t source, transferCallback_t callback);
+moduleResult_t transferReceiveBegin(uint8_t endpoint, uint16_t clusterId, 
+                                    transferSink_t sink, transferCallback_t callback);
+void transferCancel();
+uint8_t transferDispatch();
+moduleResult_t transferTick(uint16_t elapsedMs);
+uint8_t transferSendState();
+uint8_t transferReceiveState();
+uint32_t transferReceivedLength();
+const struct transferStatistics* transferGetStatistics();
+
+#endif
@@ -110,6 +110,9 @@ This directory includes the drivers to the module, including:
 - simple_api.c: Implements the Simple API
 - af.c: Implements the Application Framework interface
 - zdo.c: Implements the Zigbee Device Objects interface
+- zm_pipeline.c: non-blocking requests with a completion callback, e.g. afSendDataAsync(), so many can be outstanding at once
+- zm_transfer.c: reliable transfer of objects of many kilobytes, e.g. firmware images, over AF with selective acknowledgements and resume
+- zm_compress.c: small LZ compression of AF payloads with a preset dictionary, see AF_COMPRESSION in af.c
 - application_configuration.c: used by both interfaces for advanced configuration of module behavior
 
 @subsection zmhw Zigbee Module Hardware Interface
@@ -117,12 +120,18 @@ This directory includes the drivers to the module, including:
 - zm_phy.h: This will load the appropriate physical interface file based on the compile options.
 - zm_phy_spi.c: SPI interface
 - zm_phy_uart.c: UART interface
+- zm_phy_sim.c: simulated Module and virtual network for a Linux host, for benchmarking without a Module
+- zm_frame.c: pool of frame buffers used by both interfaces. zmBuf points to the working frame; see ZM_FRAME_POOL_SIZE.
+- zm_latency.c: per-command latency statistics of all interfaces if ZM_LATENCY_STATS is defined; see latencyDisplay().
+- zm_deadline.c: timeouts measured in time instead of loop iterations, used by the blocking waits.
+- zm_mt.c: frame layouts of Module commands, so that commands are built and decoded without magic offsets.
 
 @subsection utils Miscellaneous Zigbee Module Utilities
 Methods or defines used by one or more of the previous files.
 - module_errors.h: describes the error handling system and how to use it.
 - module_errors.c: defines the error codes used, and a simple utility for checking the return status.
 - module_utilities.c: various utilities used for working with the module
+- zm_random.c: random numbers served from a pool in RAM that is filled with SYS_RANDOM while the Module is idle.
 
  @section changing Changing Hardware Platforms
 The Hardware Abstraction Layer (HAL) provides an easy way to port the Zigbee Module library and 